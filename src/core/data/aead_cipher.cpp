@@ -0,0 +1,1061 @@
+#include "aead_cipher.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define AEAD_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+// 只对硬件路径的函数启用AES-NI等指令，其余代码仍按基础指令集编译
+#define AEAD_HW_TARGET __attribute__((target("aes,pclmul,ssse3,sse4.1")))
+#else
+#include <intrin.h>
+#define AEAD_HW_TARGET
+#endif
+// x86-64上SSE2总是可用，ChaCha20用它一次计算四个块
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AEAD_SSE2 1
+#endif
+#endif
+
+namespace LocalNetworkApp {
+
+namespace {
+
+// ---------- 通用工具 ----------
+
+inline quint32 load32le(const quint8 *p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+inline void store32le(quint8 *p, quint32 v)
+{
+    p[0] = quint8(v);
+    p[1] = quint8(v >> 8);
+    p[2] = quint8(v >> 16);
+    p[3] = quint8(v >> 24);
+}
+
+inline void store64le(quint8 *p, quint64 v)
+{
+    store32le(p, quint32(v));
+    store32le(p + 4, quint32(v >> 32));
+}
+
+inline quint64 load64be(const quint8 *p)
+{
+    quint64 v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+inline void store64be(quint8 *p, quint64 v)
+{
+    for (int i = 7; i >= 0; --i) {
+        p[i] = quint8(v);
+        v >>= 8;
+    }
+}
+
+inline void store32be(quint8 *p, quint32 v)
+{
+    p[0] = quint8(v >> 24);
+    p[1] = quint8(v >> 16);
+    p[2] = quint8(v >> 8);
+    p[3] = quint8(v);
+}
+
+// 常数时间比较认证标签
+bool tagsEqual(const quint8 *a, const quint8 *b)
+{
+    quint8 diff = 0;
+    for (int i = 0; i < AeadCipher::TAG_SIZE; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+// 把mask异或到data上：SSE2每次处理16字节，其余按8字节处理，最后逐字节
+void xorBytes(quint8 *data, const quint8 *mask, qsizetype length)
+{
+    qsizetype i = 0;
+#ifdef AEAD_SSE2
+    for (; i + 16 <= length; i += 16) {
+        __m128i *p = reinterpret_cast<__m128i *>(data + i);
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), m));
+    }
+#endif
+    for (; i + 8 <= length; i += 8) {
+        quint64 a;
+        quint64 b;
+        std::memcpy(&a, data + i, 8);
+        std::memcpy(&b, mask + i, 8);
+        a ^= b;
+        std::memcpy(data + i, &a, 8);
+    }
+    for (; i < length; ++i) {
+        data[i] ^= mask[i];
+    }
+}
+
+// 清除密钥材料（避免被编译器优化掉）
+void secureZero(void *p, size_t n)
+{
+    volatile quint8 *v = static_cast<volatile quint8 *>(p);
+    while (n--) {
+        *v++ = 0;
+    }
+}
+
+// ---------- AES-256（软件实现，供无AES-NI的CPU使用） ----------
+
+const quint8 AES_SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+inline quint8 xtime(quint8 x)
+{
+    return quint8((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+// FIPS-197密钥扩展；AES-NI使用相同的轮密钥
+void aesExpandKey(const quint8 *key, quint8 *roundKeys)
+{
+    std::memcpy(roundKeys, key, 32);
+    quint8 rcon = 0x01;
+    for (int i = 8; i < 60; ++i) {
+        quint8 t[4];
+        std::memcpy(t, roundKeys + (i - 1) * 4, 4);
+        if (i % 8 == 0) {
+            quint8 first = t[0];
+            t[0] = AES_SBOX[t[1]] ^ rcon;
+            t[1] = AES_SBOX[t[2]];
+            t[2] = AES_SBOX[t[3]];
+            t[3] = AES_SBOX[first];
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            for (int j = 0; j < 4; ++j) {
+                t[j] = AES_SBOX[t[j]];
+            }
+        }
+        for (int j = 0; j < 4; ++j) {
+            roundKeys[i * 4 + j] = roundKeys[(i - 8) * 4 + j] ^ t[j];
+        }
+    }
+}
+
+void aesEncryptBlockSoft(const quint8 *roundKeys, const quint8 *in, quint8 *out)
+{
+    quint8 s[16];
+    for (int i = 0; i < 16; ++i) {
+        s[i] = in[i] ^ roundKeys[i];
+    }
+
+    for (int round = 1; round <= 14; ++round) {
+        // 字节代换和行移位
+        quint8 t[16];
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                t[c * 4 + r] = AES_SBOX[s[((c + r) % 4) * 4 + r]];
+            }
+        }
+
+        // 列混淆（最后一轮没有）
+        if (round != 14) {
+            for (int c = 0; c < 4; ++c) {
+                quint8 *col = t + c * 4;
+                quint8 a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                quint8 all = a0 ^ a1 ^ a2 ^ a3;
+                col[0] = a0 ^ all ^ xtime(a0 ^ a1);
+                col[1] = a1 ^ all ^ xtime(a1 ^ a2);
+                col[2] = a2 ^ all ^ xtime(a2 ^ a3);
+                col[3] = a3 ^ all ^ xtime(a3 ^ a0);
+            }
+        }
+
+        for (int i = 0; i < 16; ++i) {
+            s[i] = t[i] ^ roundKeys[round * 16 + i];
+        }
+    }
+
+    std::memcpy(out, s, 16);
+}
+
+// ---------- GCM（软件实现） ----------
+
+struct Block128 {
+    quint64 hi;
+    quint64 lo;
+};
+
+inline Block128 loadBlock(const quint8 *p)
+{
+    return Block128{load64be(p), load64be(p + 8)};
+}
+
+// GF(2^128)乘法（GCM的比特反射约定）
+Block128 gfMultiplySoft(Block128 x, Block128 h)
+{
+    Block128 z{0, 0};
+    Block128 v = h;
+    for (int i = 0; i < 128; ++i) {
+        quint64 word = i < 64 ? x.hi : x.lo;
+        if ((word >> (63 - (i % 64))) & 1) {
+            z.hi ^= v.hi;
+            z.lo ^= v.lo;
+        }
+        bool carry = v.lo & 1;
+        v.lo = (v.lo >> 1) | (v.hi << 63);
+        v.hi >>= 1;
+        if (carry) {
+            v.hi ^= 0xe100000000000000ULL;
+        }
+    }
+    return z;
+}
+
+void ghashSoft(Block128 &x, Block128 h, const quint8 *data, qsizetype length)
+{
+    while (length > 0) {
+        quint8 block[16] = {0};
+        qsizetype n = qMin<qsizetype>(length, 16);
+        std::memcpy(block, data, size_t(n));
+        Block128 b = loadBlock(block);
+        x.hi ^= b.hi;
+        x.lo ^= b.lo;
+        x = gfMultiplySoft(x, h);
+        data += n;
+        length -= n;
+    }
+}
+
+// CTR模式，计数器为块的最后4字节（大端）
+void gcmCtrSoft(const quint8 *roundKeys, const quint8 *nonce, quint32 counter,
+                quint8 *data, qsizetype length)
+{
+    quint8 block[16];
+    quint8 stream[16];
+    std::memcpy(block, nonce, 12);
+    while (length > 0) {
+        store32be(block + 12, counter++);
+        aesEncryptBlockSoft(roundKeys, block, stream);
+        qsizetype n = qMin<qsizetype>(length, 16);
+        xorBytes(data, stream, n);
+        data += n;
+        length -= n;
+    }
+}
+
+// 计算GCM认证标签（data为密文）
+void gcmTagSoft(const quint8 *roundKeys, const quint8 *hashKey, const quint8 *nonce,
+                const quint8 *aad, qsizetype aadLength, const quint8 *data, qsizetype length,
+                quint8 *tag)
+{
+    Block128 h = loadBlock(hashKey);
+    Block128 x{0, 0};
+    ghashSoft(x, h, aad, aadLength);
+    ghashSoft(x, h, data, length);
+
+    quint8 lengths[16];
+    store64be(lengths, quint64(aadLength) * 8);
+    store64be(lengths + 8, quint64(length) * 8);
+    ghashSoft(x, h, lengths, 16);
+
+    quint8 j0[16];
+    std::memcpy(j0, nonce, 12);
+    store32be(j0 + 12, 1);
+    quint8 mask[16];
+    aesEncryptBlockSoft(roundKeys, j0, mask);
+
+    store64be(tag, x.hi);
+    store64be(tag + 8, x.lo);
+    for (int i = 0; i < 16; ++i) {
+        tag[i] ^= mask[i];
+    }
+}
+
+// ---------- GCM（AES-NI和PCLMULQDQ） ----------
+
+#ifdef AEAD_X86
+
+bool detectAesHardware()
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+#else
+    int info[4];
+    __cpuid(info, 1);
+    ecx = static_cast<unsigned int>(info[2]);
+#endif
+    const unsigned int pclmul = 1u << 1;
+    const unsigned int ssse3 = 1u << 9;
+    const unsigned int sse41 = 1u << 19;
+    const unsigned int aes = 1u << 25;
+    const unsigned int required = pclmul | ssse3 | sse41 | aes;
+    return (ecx & required) == required;
+}
+
+// 把块的16个字节倒序，使GHASH可以直接用无进位乘法
+AEAD_HW_TARGET inline __m128i byteSwap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+// 无进位乘法的部分积累加到lo/mid/hi，多个乘积可以只约简一次
+AEAD_HW_TARGET inline void clmulAccumulate(__m128i a, __m128i b, __m128i &lo, __m128i &mid, __m128i &hi)
+{
+    lo = _mm_xor_si128(lo, _mm_clmulepi64_si128(a, b, 0x00));
+    mid = _mm_xor_si128(mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01)));
+    hi = _mm_xor_si128(hi, _mm_clmulepi64_si128(a, b, 0x11));
+}
+
+// 把256位乘积约简为128位（Intel《Carry-Less Multiplication and Its Usage for
+// Computing the GCM Mode》中的算法，输入输出为字节倒序表示）
+AEAD_HW_TARGET inline __m128i gfReduceHw(__m128i lo, __m128i mid, __m128i hi)
+{
+    lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+    hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+    // 256位乘积整体左移一位（比特反射）
+    __m128i loCarry = _mm_srli_epi32(lo, 31);
+    __m128i hiCarry = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    __m128i cross = _mm_srli_si128(loCarry, 12);
+    hiCarry = _mm_slli_si128(hiCarry, 4);
+    loCarry = _mm_slli_si128(loCarry, 4);
+    lo = _mm_or_si128(lo, loCarry);
+    hi = _mm_or_si128(hi, hiCarry);
+    hi = _mm_or_si128(hi, cross);
+
+    // 模x^128 + x^7 + x^2 + x + 1约简
+    __m128i a1 = _mm_slli_epi32(lo, 31);
+    __m128i a2 = _mm_slli_epi32(lo, 30);
+    __m128i a3 = _mm_slli_epi32(lo, 25);
+    a1 = _mm_xor_si128(_mm_xor_si128(a1, a2), a3);
+    __m128i carry = _mm_srli_si128(a1, 4);
+    a1 = _mm_slli_si128(a1, 12);
+    lo = _mm_xor_si128(lo, a1);
+    __m128i b1 = _mm_srli_epi32(lo, 1);
+    __m128i b2 = _mm_srli_epi32(lo, 2);
+    __m128i b3 = _mm_srli_epi32(lo, 7);
+    b1 = _mm_xor_si128(_mm_xor_si128(b1, b2), b3);
+    b1 = _mm_xor_si128(b1, carry);
+    lo = _mm_xor_si128(lo, b1);
+    return _mm_xor_si128(hi, lo);
+}
+
+AEAD_HW_TARGET inline __m128i gfMultiplyHw(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    clmulAccumulate(a, b, lo, mid, hi);
+    return gfReduceHw(lo, mid, hi);
+}
+
+AEAD_HW_TARGET inline void loadRoundKeys(const quint8 *roundKeys, __m128i *rk)
+{
+    for (int i = 0; i < 15; ++i) {
+        rk[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(roundKeys + i * 16));
+    }
+}
+
+AEAD_HW_TARGET inline void loadHashKeys(const quint8 (*hashKeys)[16], __m128i *h)
+{
+    for (int i = 0; i < 4; ++i) {
+        h[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(hashKeys[i]));
+    }
+}
+
+AEAD_HW_TARGET inline __m128i aesEncryptBlockHw(const __m128i *rk, __m128i x)
+{
+    x = _mm_xor_si128(x, rk[0]);
+    for (int i = 1; i < 14; ++i) {
+        x = _mm_aesenc_si128(x, rk[i]);
+    }
+    return _mm_aesenclast_si128(x, rk[14]);
+}
+
+// 计算H及其2到4次幂（字节倒序表示）
+AEAD_HW_TARGET void gcmInitHw(const quint8 *roundKeys, quint8 (*hashKeys)[16])
+{
+    __m128i rk[15];
+    loadRoundKeys(roundKeys, rk);
+    __m128i h = byteSwap(aesEncryptBlockHw(rk, _mm_setzero_si128()));
+    __m128i power = h;
+    for (int i = 0; i < 4; ++i) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(hashKeys[i]), power);
+        power = gfMultiplyHw(power, h);
+    }
+}
+
+// 合并四个块：X = (X ^ B0)·H^4 ^ B1·H^3 ^ B2·H^2 ^ B3·H，只约简一次
+AEAD_HW_TARGET inline void ghash4Hw(__m128i &x, const __m128i *h, const quint8 *data)
+{
+    const __m128i *p = reinterpret_cast<const __m128i *>(data);
+    __m128i lo = _mm_setzero_si128();
+    __m128i mid = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    clmulAccumulate(_mm_xor_si128(x, byteSwap(_mm_loadu_si128(p))), h[3], lo, mid, hi);
+    clmulAccumulate(byteSwap(_mm_loadu_si128(p + 1)), h[2], lo, mid, hi);
+    clmulAccumulate(byteSwap(_mm_loadu_si128(p + 2)), h[1], lo, mid, hi);
+    clmulAccumulate(byteSwap(_mm_loadu_si128(p + 3)), h[0], lo, mid, hi);
+    x = gfReduceHw(lo, mid, hi);
+}
+
+AEAD_HW_TARGET void ghashHw(__m128i &x, const __m128i *h, const quint8 *data, qsizetype length)
+{
+    while (length >= 64) {
+        ghash4Hw(x, h, data);
+        data += 64;
+        length -= 64;
+    }
+
+    while (length > 0) {
+        __m128i b;
+        if (length >= 16) {
+            b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        } else {
+            alignas(16) quint8 block[16] = {0};
+            std::memcpy(block, data, size_t(length));
+            b = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+        }
+        x = gfMultiplyHw(_mm_xor_si128(x, byteSwap(b)), h[0]);
+        qsizetype n = qMin<qsizetype>(length, 16);
+        data += n;
+        length -= n;
+    }
+}
+
+// 在nonce后填入大端计数器
+AEAD_HW_TARGET inline __m128i counterBlock(__m128i iv, quint32 value)
+{
+    quint8 be[4];
+    store32be(be, value);
+    quint32 word;
+    std::memcpy(&word, be, 4);
+    return _mm_insert_epi32(iv, static_cast<int>(word), 3);
+}
+
+AEAD_HW_TARGET inline __m128i nonceBlock(const quint8 *nonce)
+{
+    alignas(16) quint8 base[16] = {0};
+    std::memcpy(base, nonce, 12);
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(base));
+}
+
+// 并行加密四个计数器块并与64字节数据异或
+AEAD_HW_TARGET inline void ctr4Hw(const __m128i *rk, __m128i iv, quint32 counter, quint8 *data)
+{
+    __m128i c0 = _mm_xor_si128(counterBlock(iv, counter), rk[0]);
+    __m128i c1 = _mm_xor_si128(counterBlock(iv, counter + 1), rk[0]);
+    __m128i c2 = _mm_xor_si128(counterBlock(iv, counter + 2), rk[0]);
+    __m128i c3 = _mm_xor_si128(counterBlock(iv, counter + 3), rk[0]);
+    for (int i = 1; i < 14; ++i) {
+        c0 = _mm_aesenc_si128(c0, rk[i]);
+        c1 = _mm_aesenc_si128(c1, rk[i]);
+        c2 = _mm_aesenc_si128(c2, rk[i]);
+        c3 = _mm_aesenc_si128(c3, rk[i]);
+    }
+    c0 = _mm_aesenclast_si128(c0, rk[14]);
+    c1 = _mm_aesenclast_si128(c1, rk[14]);
+    c2 = _mm_aesenclast_si128(c2, rk[14]);
+    c3 = _mm_aesenclast_si128(c3, rk[14]);
+
+    __m128i *p = reinterpret_cast<__m128i *>(data);
+    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), c0));
+    _mm_storeu_si128(p + 1, _mm_xor_si128(_mm_loadu_si128(p + 1), c1));
+    _mm_storeu_si128(p + 2, _mm_xor_si128(_mm_loadu_si128(p + 2), c2));
+    _mm_storeu_si128(p + 3, _mm_xor_si128(_mm_loadu_si128(p + 3), c3));
+}
+
+// CTR模式处理不足64字节的尾部
+AEAD_HW_TARGET void ctrTailHw(const __m128i *rk, __m128i iv, quint32 counter, quint8 *data, qsizetype length)
+{
+    while (length > 0) {
+        __m128i stream = aesEncryptBlockHw(rk, counterBlock(iv, counter++));
+        if (length >= 16) {
+            __m128i *p = reinterpret_cast<__m128i *>(data);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), stream));
+        } else {
+            alignas(16) quint8 bytes[16];
+            _mm_store_si128(reinterpret_cast<__m128i *>(bytes), stream);
+            xorBytes(data, bytes, length);
+        }
+        qsizetype n = qMin<qsizetype>(length, 16);
+        data += n;
+        length -= n;
+    }
+}
+
+// 哈希长度块并与E(K, J0)异或得到认证标签
+AEAD_HW_TARGET void gcmFinishHw(const __m128i *rk, const __m128i *h, __m128i iv, __m128i x,
+                                qsizetype aadLength, qsizetype length, quint8 *tag)
+{
+    alignas(16) quint8 lengths[16];
+    store64be(lengths, quint64(aadLength) * 8);
+    store64be(lengths + 8, quint64(length) * 8);
+    ghashHw(x, h, lengths, 16);
+
+    __m128i mask = aesEncryptBlockHw(rk, counterBlock(iv, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(tag), _mm_xor_si128(byteSwap(x), mask));
+}
+
+// 加密时每64字节先做CTR再立即哈希密文，数据只经过缓存一次
+AEAD_HW_TARGET void gcmEncryptHw(const quint8 *roundKeys, const quint8 (*hashKeys)[16], const quint8 *nonce,
+                                 const quint8 *aad, qsizetype aadLength, quint8 *data, qsizetype length,
+                                 quint8 *tag)
+{
+    __m128i rk[15];
+    __m128i h[4];
+    loadRoundKeys(roundKeys, rk);
+    loadHashKeys(hashKeys, h);
+    const __m128i iv = nonceBlock(nonce);
+
+    __m128i x = _mm_setzero_si128();
+    ghashHw(x, h, aad, aadLength);
+
+    quint32 counter = 2;
+    quint8 *p = data;
+    qsizetype remaining = length;
+    while (remaining >= 64) {
+        ctr4Hw(rk, iv, counter, p);
+        ghash4Hw(x, h, p);
+        counter += 4;
+        p += 64;
+        remaining -= 64;
+    }
+    ctrTailHw(rk, iv, counter, p, remaining);
+    ghashHw(x, h, p, remaining);
+
+    gcmFinishHw(rk, h, iv, x, aadLength, length, tag);
+}
+
+// 解密时必须先校验认证标签，再原地解密
+AEAD_HW_TARGET bool gcmDecryptHw(const quint8 *roundKeys, const quint8 (*hashKeys)[16], const quint8 *nonce,
+                                 const quint8 *aad, qsizetype aadLength, quint8 *data, qsizetype length,
+                                 const quint8 *tag)
+{
+    __m128i rk[15];
+    __m128i h[4];
+    loadRoundKeys(roundKeys, rk);
+    loadHashKeys(hashKeys, h);
+    const __m128i iv = nonceBlock(nonce);
+
+    __m128i x = _mm_setzero_si128();
+    ghashHw(x, h, aad, aadLength);
+    ghashHw(x, h, data, length);
+    quint8 expected[16];
+    gcmFinishHw(rk, h, iv, x, aadLength, length, expected);
+    if (!tagsEqual(expected, tag)) {
+        return false;
+    }
+
+    quint32 counter = 2;
+    while (length >= 64) {
+        ctr4Hw(rk, iv, counter, data);
+        counter += 4;
+        data += 64;
+        length -= 64;
+    }
+    ctrTailHw(rk, iv, counter, data, length);
+    return true;
+}
+
+#else
+
+bool detectAesHardware()
+{
+    return false;
+}
+
+#endif
+
+// ---------- ChaCha20（RFC 8439） ----------
+
+inline quint32 rotl32(quint32 v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = rotl32(d, 16);   \
+    c += d; b ^= c; b = rotl32(b, 12);   \
+    a += b; d ^= a; d = rotl32(d, 8);    \
+    c += d; b ^= c; b = rotl32(b, 7);
+
+void chachaBlock(const quint32 *input, quint8 *output)
+{
+    quint32 x[16];
+    std::memcpy(x, input, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        store32le(output + i * 4, x[i] + input[i]);
+    }
+}
+
+#undef CHACHA_QUARTER_ROUND
+
+#ifdef AEAD_SSE2
+
+inline __m128i rotl32x4(__m128i v, int n)
+{
+    return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n));
+}
+
+#define CHACHA_QUARTER_ROUND_X4(a, b, c, d)                                      \
+    a = _mm_add_epi32(a, b); d = rotl32x4(_mm_xor_si128(d, a), 16);             \
+    c = _mm_add_epi32(c, d); b = rotl32x4(_mm_xor_si128(b, c), 12);             \
+    a = _mm_add_epi32(a, b); d = rotl32x4(_mm_xor_si128(d, a), 8);              \
+    c = _mm_add_epi32(c, d); b = rotl32x4(_mm_xor_si128(b, c), 7);
+
+// 同时计算计数器为counter到counter+3的四个块（每个向量的第i个分量属于第i个块），
+// 并与256字节数据异或
+void chachaXor4(const quint32 *input, quint8 *data)
+{
+    __m128i x[16];
+    __m128i orig[16];
+    for (int i = 0; i < 16; ++i) {
+        x[i] = _mm_set1_epi32(static_cast<int>(input[i]));
+    }
+    x[12] = _mm_add_epi32(x[12], _mm_set_epi32(3, 2, 1, 0));
+    for (int i = 0; i < 16; ++i) {
+        orig[i] = x[i];
+    }
+
+    for (int i = 0; i < 10; ++i) {
+        CHACHA_QUARTER_ROUND_X4(x[0], x[4], x[8], x[12]);
+        CHACHA_QUARTER_ROUND_X4(x[1], x[5], x[9], x[13]);
+        CHACHA_QUARTER_ROUND_X4(x[2], x[6], x[10], x[14]);
+        CHACHA_QUARTER_ROUND_X4(x[3], x[7], x[11], x[15]);
+        CHACHA_QUARTER_ROUND_X4(x[0], x[5], x[10], x[15]);
+        CHACHA_QUARTER_ROUND_X4(x[1], x[6], x[11], x[12]);
+        CHACHA_QUARTER_ROUND_X4(x[2], x[7], x[8], x[13]);
+        CHACHA_QUARTER_ROUND_X4(x[3], x[4], x[9], x[14]);
+    }
+
+    // 每次转置四个状态字，得到四个块中对应的16字节
+    for (int j = 0; j < 16; j += 4) {
+        __m128i t0 = _mm_add_epi32(x[j], orig[j]);
+        __m128i t1 = _mm_add_epi32(x[j + 1], orig[j + 1]);
+        __m128i t2 = _mm_add_epi32(x[j + 2], orig[j + 2]);
+        __m128i t3 = _mm_add_epi32(x[j + 3], orig[j + 3]);
+        __m128i a0 = _mm_unpacklo_epi32(t0, t1);
+        __m128i a1 = _mm_unpacklo_epi32(t2, t3);
+        __m128i a2 = _mm_unpackhi_epi32(t0, t1);
+        __m128i a3 = _mm_unpackhi_epi32(t2, t3);
+        __m128i lanes[4] = {
+            _mm_unpacklo_epi64(a0, a1),
+            _mm_unpackhi_epi64(a0, a1),
+            _mm_unpacklo_epi64(a2, a3),
+            _mm_unpackhi_epi64(a2, a3)
+        };
+        for (int block = 0; block < 4; ++block) {
+            __m128i *p = reinterpret_cast<__m128i *>(data + block * 64 + j * 4);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), lanes[block]));
+        }
+    }
+}
+
+#undef CHACHA_QUARTER_ROUND_X4
+
+#endif
+
+void chachaInit(quint32 *state, const quint8 *key, const quint8 *nonce, quint32 counter)
+{
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        state[4 + i] = load32le(key + i * 4);
+    }
+    state[12] = counter;
+    state[13] = load32le(nonce);
+    state[14] = load32le(nonce + 4);
+    state[15] = load32le(nonce + 8);
+}
+
+void chachaXor(const quint8 *key, const quint8 *nonce, quint32 counter, quint8 *data, qsizetype length)
+{
+    quint32 state[16];
+    chachaInit(state, key, nonce, counter);
+#ifdef AEAD_SSE2
+    while (length >= 256) {
+        chachaXor4(state, data);
+        state[12] += 4;
+        data += 256;
+        length -= 256;
+    }
+#endif
+    quint8 stream[64];
+    while (length > 0) {
+        chachaBlock(state, stream);
+        state[12]++;
+        qsizetype n = qMin<qsizetype>(length, 64);
+        xorBytes(data, stream, n);
+        data += n;
+        length -= n;
+    }
+    secureZero(stream, sizeof(stream));
+}
+
+// ---------- Poly1305（26位分段，参考poly1305-donna） ----------
+
+class Poly1305 {
+public:
+    explicit Poly1305(const quint8 *key)
+    {
+        r[0] = load32le(key) & 0x3ffffff;
+        r[1] = (load32le(key + 3) >> 2) & 0x3ffff03;
+        r[2] = (load32le(key + 6) >> 4) & 0x3ffc0ff;
+        r[3] = (load32le(key + 9) >> 6) & 0x3f03fff;
+        r[4] = (load32le(key + 12) >> 8) & 0x00fffff;
+        for (int i = 0; i < 4; ++i) {
+            pad[i] = load32le(key + 16 + i * 4);
+        }
+    }
+
+    ~Poly1305()
+    {
+        secureZero(r, sizeof(r));
+        secureZero(pad, sizeof(pad));
+    }
+
+    // 处理数据并补零到16字节边界（AEAD构造要求的填充）
+    void updatePadded(const quint8 *data, qsizetype length)
+    {
+        qsizetype full = length & ~qsizetype(15);
+        blocks(data, full, 1u << 24);
+        if (length > full) {
+            quint8 block[16] = {0};
+            std::memcpy(block, data + full, size_t(length - full));
+            blocks(block, 16, 1u << 24);
+        }
+    }
+
+    void update16(const quint8 *block)
+    {
+        blocks(block, 16, 1u << 24);
+    }
+
+    void finish(quint8 *mac)
+    {
+        const quint32 mask = 0x3ffffff;
+        quint32 c;
+        c = h[1] >> 26; h[1] &= mask;
+        h[2] += c; c = h[2] >> 26; h[2] &= mask;
+        h[3] += c; c = h[3] >> 26; h[3] &= mask;
+        h[4] += c; c = h[4] >> 26; h[4] &= mask;
+        h[0] += c * 5; c = h[0] >> 26; h[0] &= mask;
+        h[1] += c;
+
+        // 计算h - p，若不为负则取之
+        quint32 g[5];
+        g[0] = h[0] + 5; c = g[0] >> 26; g[0] &= mask;
+        g[1] = h[1] + c; c = g[1] >> 26; g[1] &= mask;
+        g[2] = h[2] + c; c = g[2] >> 26; g[2] &= mask;
+        g[3] = h[3] + c; c = g[3] >> 26; g[3] &= mask;
+        g[4] = h[4] + c - (1u << 26);
+
+        quint32 select = (g[4] >> 31) - 1;
+        for (int i = 0; i < 5; ++i) {
+            h[i] = (h[i] & ~select) | (g[i] & select);
+        }
+
+        quint32 out0 = h[0] | (h[1] << 26);
+        quint32 out1 = (h[1] >> 6) | (h[2] << 20);
+        quint32 out2 = (h[2] >> 12) | (h[3] << 14);
+        quint32 out3 = (h[3] >> 18) | (h[4] << 8);
+
+        quint64 f = quint64(out0) + pad[0];
+        store32le(mac, quint32(f));
+        f = quint64(out1) + pad[1] + (f >> 32);
+        store32le(mac + 4, quint32(f));
+        f = quint64(out2) + pad[2] + (f >> 32);
+        store32le(mac + 8, quint32(f));
+        f = quint64(out3) + pad[3] + (f >> 32);
+        store32le(mac + 12, quint32(f));
+    }
+
+private:
+    quint32 r[5];
+    quint32 h[5] = {0, 0, 0, 0, 0};
+    quint32 pad[4];
+
+    void blocks(const quint8 *m, qsizetype length, quint32 hibit)
+    {
+        const quint32 mask = 0x3ffffff;
+        const quint32 s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+        quint32 h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+        while (length >= 16) {
+            h0 += load32le(m) & mask;
+            h1 += (load32le(m + 3) >> 2) & mask;
+            h2 += (load32le(m + 6) >> 4) & mask;
+            h3 += (load32le(m + 9) >> 6) & mask;
+            h4 += (load32le(m + 12) >> 8) | hibit;
+
+            quint64 d0 = quint64(h0) * r[0] + quint64(h1) * s4 + quint64(h2) * s3 + quint64(h3) * s2 + quint64(h4) * s1;
+            quint64 d1 = quint64(h0) * r[1] + quint64(h1) * r[0] + quint64(h2) * s4 + quint64(h3) * s3 + quint64(h4) * s2;
+            quint64 d2 = quint64(h0) * r[2] + quint64(h1) * r[1] + quint64(h2) * r[0] + quint64(h3) * s4 + quint64(h4) * s3;
+            quint64 d3 = quint64(h0) * r[3] + quint64(h1) * r[2] + quint64(h2) * r[1] + quint64(h3) * r[0] + quint64(h4) * s4;
+            quint64 d4 = quint64(h0) * r[4] + quint64(h1) * r[3] + quint64(h2) * r[2] + quint64(h3) * r[1] + quint64(h4) * r[0];
+
+            quint32 c = quint32(d0 >> 26); h0 = quint32(d0) & mask;
+            d1 += c; c = quint32(d1 >> 26); h1 = quint32(d1) & mask;
+            d2 += c; c = quint32(d2 >> 26); h2 = quint32(d2) & mask;
+            d3 += c; c = quint32(d3 >> 26); h3 = quint32(d3) & mask;
+            d4 += c; c = quint32(d4 >> 26); h4 = quint32(d4) & mask;
+            h0 += c * 5; c = h0 >> 26; h0 &= mask;
+            h1 += c;
+
+            m += 16;
+            length -= 16;
+        }
+
+        h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+    }
+};
+
+// 计算ChaCha20-Poly1305认证标签（data为密文）
+void chachaTag(const quint8 *key, const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+               const quint8 *data, qsizetype length, quint8 *tag)
+{
+    // 第0个密钥流块的前32字节作为一次性Poly1305密钥
+    quint32 state[16];
+    chachaInit(state, key, nonce, 0);
+    quint8 block[64];
+    chachaBlock(state, block);
+
+    Poly1305 mac(block);
+    secureZero(block, sizeof(block));
+    mac.updatePadded(aad, aadLength);
+    mac.updatePadded(data, length);
+
+    quint8 lengths[16];
+    store64le(lengths, quint64(aadLength));
+    store64le(lengths + 8, quint64(length));
+    mac.update16(lengths);
+    mac.finish(tag);
+}
+
+} // namespace
+
+AeadCipher::AeadCipher(Algorithm algorithm, const QByteArray &key) :
+    algo(algorithm),
+    valid(false),
+    accelerated(false)
+{
+    std::memset(roundKeys, 0, sizeof(roundKeys));
+    std::memset(hashKeys, 0, sizeof(hashKeys));
+    std::memset(chachaKey, 0, sizeof(chachaKey));
+
+    if (key.size() != KEY_SIZE) {
+        return;
+    }
+    const quint8 *keyBytes = reinterpret_cast<const quint8 *>(key.constData());
+
+    switch (algorithm) {
+    case Algorithm::Aes256Gcm: {
+        aesExpandKey(keyBytes, roundKeys);
+#ifdef AEAD_X86
+        accelerated = hasAesAcceleration();
+        if (accelerated) {
+            gcmInitHw(roundKeys, hashKeys);
+            valid = true;
+            break;
+        }
+#endif
+        // 软件路径使用普通字节序的H
+        quint8 zero[16] = {0};
+        aesEncryptBlockSoft(roundKeys, zero, hashKeys[0]);
+        valid = true;
+        break;
+    }
+    case Algorithm::ChaCha20Poly1305:
+        std::memcpy(chachaKey, keyBytes, KEY_SIZE);
+        valid = true;
+        break;
+    }
+}
+
+AeadCipher::~AeadCipher()
+{
+    secureZero(roundKeys, sizeof(roundKeys));
+    secureZero(hashKeys, sizeof(hashKeys));
+    secureZero(chachaKey, sizeof(chachaKey));
+}
+
+AeadCipher::Algorithm AeadCipher::algorithm() const
+{
+    return algo;
+}
+
+bool AeadCipher::isValid() const
+{
+    return valid;
+}
+
+void AeadCipher::encrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                         quint8 *data, qsizetype length, quint8 *tag) const
+{
+    if (!valid) {
+        return;
+    }
+    if (algo == Algorithm::Aes256Gcm) {
+        gcmEncrypt(nonce, aad, aadLength, data, length, tag);
+    } else {
+        chachaEncrypt(nonce, aad, aadLength, data, length, tag);
+    }
+}
+
+bool AeadCipher::decrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                         quint8 *data, qsizetype length, const quint8 *tag) const
+{
+    if (!valid) {
+        return false;
+    }
+    if (algo == Algorithm::Aes256Gcm) {
+        return gcmDecrypt(nonce, aad, aadLength, data, length, tag);
+    }
+    return chachaDecrypt(nonce, aad, aadLength, data, length, tag);
+}
+
+QByteArray AeadCipher::seal(const QByteArray &nonce, const QByteArray &plaintext, const QByteArray &aad) const
+{
+    if (!valid || nonce.size() != NONCE_SIZE) {
+        return QByteArray();
+    }
+
+    // 密文与认证标签在同一块缓冲区中，只分配一次
+    QByteArray result(plaintext.size() + TAG_SIZE, Qt::Uninitialized);
+    quint8 *out = reinterpret_cast<quint8 *>(result.data());
+    std::memcpy(out, plaintext.constData(), size_t(plaintext.size()));
+    encrypt(reinterpret_cast<const quint8 *>(nonce.constData()),
+            reinterpret_cast<const quint8 *>(aad.constData()), aad.size(),
+            out, plaintext.size(), out + plaintext.size());
+    return result;
+}
+
+bool AeadCipher::open(const QByteArray &nonce, const QByteArray &sealed,
+                      const QByteArray &aad, QByteArray *plaintext) const
+{
+    if (!valid || nonce.size() != NONCE_SIZE || sealed.size() < TAG_SIZE || !plaintext) {
+        return false;
+    }
+
+    qsizetype length = sealed.size() - TAG_SIZE;
+    QByteArray result = sealed.left(length);
+    if (!decrypt(reinterpret_cast<const quint8 *>(nonce.constData()),
+                 reinterpret_cast<const quint8 *>(aad.constData()), aad.size(),
+                 reinterpret_cast<quint8 *>(result.data()), length,
+                 reinterpret_cast<const quint8 *>(sealed.constData()) + length)) {
+        return false;
+    }
+    *plaintext = result;
+    return true;
+}
+
+QByteArray AeadCipher::makeNonce(quint32 prefix, quint64 counter)
+{
+    QByteArray nonce(NONCE_SIZE, Qt::Uninitialized);
+    quint8 *p = reinterpret_cast<quint8 *>(nonce.data());
+    store32be(p, prefix);
+    store64be(p + 4, counter);
+    return nonce;
+}
+
+AeadCipher::Algorithm AeadCipher::preferredAlgorithm()
+{
+    return hasAesAcceleration() ? Algorithm::Aes256Gcm : Algorithm::ChaCha20Poly1305;
+}
+
+bool AeadCipher::hasAesAcceleration()
+{
+    static const bool supported = detectAesHardware();
+    return supported;
+}
+
+void AeadCipher::gcmEncrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                            quint8 *data, qsizetype length, quint8 *tag) const
+{
+#ifdef AEAD_X86
+    if (accelerated) {
+        gcmEncryptHw(roundKeys, hashKeys, nonce, aad, aadLength, data, length, tag);
+        return;
+    }
+#endif
+    gcmCtrSoft(roundKeys, nonce, 2, data, length);
+    gcmTagSoft(roundKeys, hashKeys[0], nonce, aad, aadLength, data, length, tag);
+}
+
+bool AeadCipher::gcmDecrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                            quint8 *data, qsizetype length, const quint8 *tag) const
+{
+#ifdef AEAD_X86
+    if (accelerated) {
+        return gcmDecryptHw(roundKeys, hashKeys, nonce, aad, aadLength, data, length, tag);
+    }
+#endif
+    quint8 expected[TAG_SIZE];
+    gcmTagSoft(roundKeys, hashKeys[0], nonce, aad, aadLength, data, length, expected);
+    if (!tagsEqual(expected, tag)) {
+        return false;
+    }
+    gcmCtrSoft(roundKeys, nonce, 2, data, length);
+    return true;
+}
+
+void AeadCipher::chachaEncrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                               quint8 *data, qsizetype length, quint8 *tag) const
+{
+    chachaXor(chachaKey, nonce, 1, data, length);
+    chachaTag(chachaKey, nonce, aad, aadLength, data, length, tag);
+}
+
+bool AeadCipher::chachaDecrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                               quint8 *data, qsizetype length, const quint8 *tag) const
+{
+    quint8 expected[TAG_SIZE];
+    chachaTag(chachaKey, nonce, aad, aadLength, data, length, expected);
+    if (!tagsEqual(expected, tag)) {
+        return false;
+    }
+    chachaXor(chachaKey, nonce, 1, data, length);
+    return true;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,87 @@
+#ifndef AEAD_CIPHER_H
+#define AEAD_CIPHER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+namespace LocalNetworkApp {
+
+// 认证加密（AEAD）
+//
+// 支持AES-256-GCM和ChaCha20-Poly1305两种算法。CPU支持AES-NI和PCLMULQDQ时
+// AES-GCM使用硬件指令并行处理多个块，否则首选ChaCha20-Poly1305；
+// 两种算法在所有平台上都可解密，因此对端可以各自选择首选算法。
+// 同一密钥下每个nonce只能使用一次，文件块和消息帧可以用makeNonce
+// 由连接前缀和递增序号构造nonce。
+class AeadCipher {
+public:
+    enum class Algorithm : quint8 {
+        Aes256Gcm = 1,         // AES-256-GCM
+        ChaCha20Poly1305 = 2   // ChaCha20-Poly1305（RFC 8439）
+    };
+
+    static const int KEY_SIZE = 32;   // 密钥长度
+    static const int NONCE_SIZE = 12; // nonce长度
+    static const int TAG_SIZE = 16;   // 认证标签长度
+
+    AeadCipher(Algorithm algorithm, const QByteArray &key);
+    ~AeadCipher();
+
+    AeadCipher(const AeadCipher &) = delete;
+    AeadCipher &operator=(const AeadCipher &) = delete;
+
+    // 获取算法
+    Algorithm algorithm() const;
+
+    // 密钥长度和算法是否有效
+    bool isValid() const;
+
+    // 原地加密length字节，并把认证标签写入tag（TAG_SIZE字节）
+    void encrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                 quint8 *data, qsizetype length, quint8 *tag) const;
+
+    // 校验认证标签后原地解密；校验失败时返回false且不修改data
+    bool decrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                 quint8 *data, qsizetype length, const quint8 *tag) const;
+
+    // 加密并返回密文加认证标签
+    QByteArray seal(const QByteArray &nonce, const QByteArray &plaintext,
+                    const QByteArray &aad = QByteArray()) const;
+
+    // 校验并解密seal的输出
+    bool open(const QByteArray &nonce, const QByteArray &sealed,
+              const QByteArray &aad, QByteArray *plaintext) const;
+
+    // 由4字节前缀和8字节序号构造nonce
+    static QByteArray makeNonce(quint32 prefix, quint64 counter);
+
+    // 本机首选算法
+    static Algorithm preferredAlgorithm();
+
+    // CPU是否支持AES-NI和PCLMULQDQ
+    static bool hasAesAcceleration();
+
+private:
+    Algorithm algo;          // 算法
+    bool valid;              // 是否有效
+    bool accelerated;        // AES-GCM是否使用硬件指令
+    alignas(16) quint8 roundKeys[240];   // AES-256轮密钥
+    alignas(16) quint8 hashKeys[4][16];  // GHASH密钥H的1到4次幂
+    quint8 chachaKey[KEY_SIZE];          // ChaCha20密钥
+
+    // AES-GCM加解密
+    void gcmEncrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                    quint8 *data, qsizetype length, quint8 *tag) const;
+    bool gcmDecrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                    quint8 *data, qsizetype length, const quint8 *tag) const;
+
+    // ChaCha20-Poly1305加解密
+    void chachaEncrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                       quint8 *data, qsizetype length, quint8 *tag) const;
+    bool chachaDecrypt(const quint8 *nonce, const quint8 *aad, qsizetype aadLength,
+                       quint8 *data, qsizetype length, const quint8 *tag) const;
+};
+
+} // namespace LocalNetworkApp
+
+#endif // AEAD_CIPHER_H
@@ -0,0 +1,302 @@
+#include "file_hasher.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtEndian>
+#include <QDebug>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include "../filetransfer/file_manifest.h"
+#include "../utils/xxhash64.h"
+
+namespace LocalNetworkApp {
+
+// 一次哈希任务的共享状态，由工作线程和发起方共同持有
+struct FileHasher::Job {
+    QString filePath;                      // 文件路径（为空时哈希内存数据）
+    const char *memory = nullptr;          // 内存数据
+    qint64 totalBytes = 0;                 // 总字节数
+    qint64 chunkSize = Constants::HASH_CHUNK_SIZE; // 块大小
+    qint64 chunkCount = 0;                 // 块数
+    QList<QByteArray> chunkDigests;        // 每块的SHA-256（预先分配）
+    QByteArray *digestSlots = nullptr;     // chunkDigests的数据指针，各线程写入不同下标
+    int blockSize = 0;                     // 清单块大小（为0时不按块计算）
+    FileBlockHashes blocks;                // 每块的校验和与叶子哈希（预先分配）
+    quint64 *checksumSlots = nullptr;      // blocks.checksums的数据指针
+    char *leafSlots = nullptr;             // blocks.leafHashes的数据指针
+    std::atomic<qint64> nextChunk{0};      // 下一个待领取的块
+    std::atomic<qint64> bytesHashed{0};    // 已完成的字节数
+    std::atomic<int> activeWorkers{0};     // 仍在运行的线程数
+    std::atomic<bool> cancelRequested{false}; // 是否已请求取消
+    std::atomic<bool> failed{false};       // 是否出错
+    QString errorMessage;                  // 错误信息（failed由false变为true的线程写入）
+    std::function<void()> onDone;          // 最后一个线程结束时调用
+};
+
+FileHasher::FileHasher(QObject *parent) :
+    QObject(parent)
+{
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+
+    progressTimer = new QTimer(this);
+    progressTimer->setInterval(Constants::HASH_PROGRESS_INTERVAL_MS);
+    connect(progressTimer, &QTimer::timeout, this, &FileHasher::reportProgress);
+}
+
+FileHasher::~FileHasher()
+{
+    // 工作线程引用本对象的完成回调，必须等它们结束
+    cancel();
+    pool.waitForDone();
+}
+
+bool FileHasher::start(const QString &filePath, int blockSize)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile() || !fileInfo.isReadable()) {
+        qWarning() << "无法读取文件:" << filePath;
+        return false;
+    }
+
+    std::shared_ptr<Job> newJob = createJob(filePath, nullptr, fileInfo.size(), blockSize);
+
+    // 回调保存在任务中，只能弱引用任务本身，否则任务永远不会释放
+    std::weak_ptr<Job> weakJob = newJob;
+    newJob->onDone = [this, weakJob]() {
+        if (std::shared_ptr<Job> doneJob = weakJob.lock()) {
+            QMetaObject::invokeMethod(this, [this, doneJob]() { onJobFinished(doneJob); }, Qt::QueuedConnection);
+        }
+    };
+    job = newJob;
+
+    launch(job, &pool);
+    progressTimer->start();
+    return true;
+}
+
+void FileHasher::cancel()
+{
+    if (job) {
+        job->cancelRequested = true;
+    }
+}
+
+bool FileHasher::isRunning() const
+{
+    return job != nullptr;
+}
+
+QByteArray FileHasher::hashFile(const QString &filePath, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.isFile()) {
+        return QByteArray();
+    }
+
+    std::shared_ptr<Job> fileJob = createJob(filePath, nullptr, fileInfo.size());
+    QThreadPool workers;
+    workers.setMaxThreadCount(QThread::idealThreadCount());
+    launch(fileJob, &workers);
+    workers.waitForDone();
+
+    if (fileJob->failed) {
+        qWarning() << fileJob->errorMessage;
+        return QByteArray();
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return combine(*fileJob);
+}
+
+QByteArray FileHasher::hashData(const QByteArray &data)
+{
+    std::shared_ptr<Job> dataJob = createJob(QString(), data.constData(), data.size());
+    QThreadPool workers;
+    workers.setMaxThreadCount(QThread::idealThreadCount());
+    launch(dataJob, &workers);
+    workers.waitForDone();
+    return combine(*dataJob);
+}
+
+double FileHasher::benchmark(qint64 size)
+{
+    if (size <= 0) {
+        return 0.0;
+    }
+
+    QByteArray data(size, '\x5a');
+    QElapsedTimer timer;
+    timer.start();
+    hashData(data);
+    qint64 elapsed = qMax<qint64>(timer.nsecsElapsed(), 1);
+
+    double bytesPerSecond = double(size) * 1e9 / double(elapsed);
+    qInfo() << "文件哈希吞吐量:" << bytesPerSecond / (1024.0 * 1024.0) << "MB/s，线程数:"
+            << QThread::idealThreadCount();
+    return bytesPerSecond;
+}
+
+void FileHasher::reportProgress()
+{
+    if (job) {
+        emit progressChanged(job->bytesHashed.load(), job->totalBytes);
+    }
+}
+
+void FileHasher::onJobFinished(const std::shared_ptr<Job> &finishedJob)
+{
+    if (finishedJob != job) {
+        return; // 已被新任务替代
+    }
+
+    progressTimer->stop();
+    job.reset();
+
+    if (finishedJob->cancelRequested) {
+        emit cancelled();
+    } else if (finishedJob->failed) {
+        qWarning() << finishedJob->errorMessage;
+        emit failed(finishedJob->errorMessage);
+    } else {
+        emit progressChanged(finishedJob->totalBytes, finishedJob->totalBytes);
+        if (finishedJob->blockSize > 0) {
+            emit blocksHashed(finishedJob->blocks);
+        }
+        emit finished(combine(*finishedJob));
+    }
+}
+
+std::shared_ptr<FileHasher::Job> FileHasher::createJob(const QString &filePath, const char *memory, qint64 size,
+                                                      int blockSize)
+{
+    auto newJob = std::make_shared<Job>();
+    newJob->filePath = filePath;
+    newJob->memory = memory;
+    newJob->totalBytes = size;
+    if (blockSize > 0) {
+        // 分块大小取块大小的整数倍，清单的块不会跨两个分块
+        newJob->blockSize = blockSize;
+        newJob->chunkSize = qMax<qint64>(1, Constants::HASH_CHUNK_SIZE / blockSize) * blockSize;
+
+        qint64 blockCount = (size + blockSize - 1) / blockSize;
+        newJob->blocks.fileSize = size;
+        newJob->blocks.blockSize = blockSize;
+        newJob->blocks.checksums.resize(blockCount);
+        newJob->blocks.leafHashes.resize(blockCount * 32);
+        newJob->checksumSlots = newJob->blocks.checksums.data();
+        newJob->leafSlots = newJob->blocks.leafHashes.data();
+    }
+    newJob->chunkCount = (size + newJob->chunkSize - 1) / newJob->chunkSize;
+    newJob->chunkDigests.resize(newJob->chunkCount);
+    newJob->digestSlots = newJob->chunkDigests.data();
+    return newJob;
+}
+
+void FileHasher::launch(const std::shared_ptr<Job> &job, QThreadPool *pool)
+{
+    int workers = static_cast<int>(qMin<qint64>(pool->maxThreadCount(), job->chunkCount));
+    if (workers <= 0) {
+        // 空文件：没有块需要计算
+        if (job->onDone) {
+            job->onDone();
+        }
+        return;
+    }
+
+    job->activeWorkers = workers;
+    for (int i = 0; i < workers; ++i) {
+        pool->start([job]() {
+            hashChunks(*job);
+            if (job->activeWorkers.fetch_sub(1) == 1 && job->onDone) {
+                job->onDone();
+            }
+        });
+    }
+}
+
+void FileHasher::hashChunks(Job &job)
+{
+    QFile file(job.filePath);
+    QByteArray buffer;
+    if (!job.memory) {
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            bool expected = false;
+            if (job.failed.compare_exchange_strong(expected, true)) {
+                job.errorMessage = QString("无法打开文件: %1 %2").arg(job.filePath, file.errorString());
+            }
+            return;
+        }
+        buffer.resize(job.chunkSize);
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    while (!job.cancelRequested && !job.failed) {
+        qint64 index = job.nextChunk.fetch_add(1);
+        if (index >= job.chunkCount) {
+            break;
+        }
+
+        qint64 offset = index * job.chunkSize;
+        qint64 length = qMin(job.chunkSize, job.totalBytes - offset);
+        const char *data = job.memory ? job.memory + offset : nullptr;
+
+        // 每块一次大块读取，块边界按块大小对齐
+        if (!data) {
+            if (!file.seek(offset) || file.read(buffer.data(), length) != length) {
+                bool expected = false;
+                if (job.failed.compare_exchange_strong(expected, true)) {
+                    job.errorMessage = QString("读取文件失败: %1 %2").arg(job.filePath, file.errorString());
+                }
+                break;
+            }
+            data = buffer.constData();
+        }
+
+        hash.reset();
+        hash.addData(QByteArrayView(data, length));
+        job.digestSlots[index] = hash.result();
+
+        if (job.blockSize > 0) {
+            qint64 firstBlock = offset / job.blockSize;
+            for (qint64 blockOffset = 0; blockOffset < length; blockOffset += job.blockSize) {
+                qint64 blockIndex = firstBlock + blockOffset / job.blockSize;
+                qint64 blockLength = qMin<qint64>(job.blockSize, length - blockOffset);
+                const char *block = data + blockOffset;
+                job.checksumSlots[blockIndex] = XxHash64::hash(block, blockLength);
+                QByteArray leaf = MerkleTreeBuilder::leafHash(block, blockLength);
+                memcpy(job.leafSlots + blockIndex * 32, leaf.constData(), 32);
+            }
+        }
+        job.bytesHashed += length;
+    }
+}
+
+QByteArray FileHasher::combine(const Job &job)
+{
+    // 根哈希 = SHA-256("LNFH" | 文件大小 | 块大小 | 块哈希...)
+    char header[4 + 8 + 8];
+    memcpy(header, "LNFH", 4);
+    qToBigEndian<qint64>(job.totalBytes, header + 4);
+    qToBigEndian<qint64>(job.chunkSize, header + 12);
+
+    QCryptographicHash root(QCryptographicHash::Sha256);
+    root.addData(QByteArrayView(header, sizeof(header)));
+    for (const QByteArray &digest : job.chunkDigests) {
+        root.addData(digest);
+    }
+    return root.result();
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,102 @@
+#ifndef FILE_HASHER_H
+#define FILE_HASHER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 按块计算的结果，用于生成文件清单
+struct FileBlockHashes {
+    qint64 fileSize = 0;        // 文件大小
+    int blockSize = 0;          // 块大小
+    QList<quint64> checksums;   // 每块的XXH64校验和
+    QByteArray leafHashes;      // 每块的Merkle叶子哈希，按块顺序连续存放，每个32字节
+};
+
+// 并行文件哈希
+//
+// 文件按Constants::HASH_CHUNK_SIZE对齐分块，多个线程各自打开文件、按块大读取并
+// 计算块的SHA-256，最后对文件大小、块大小和全部块哈希再做一次SHA-256得到文件哈希
+// （两层树哈希）。异步计算时定期报告进度，可随时取消；同步接口在调用线程等待结果。
+// 指定blockSize时分块大小取其整数倍，读入的数据同时按blockSize计算每块的XXH64和
+// Merkle叶子哈希，一次读取即可得到文件清单所需的全部数据。
+class FileHasher : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FileHasher(QObject *parent = nullptr);
+    ~FileHasher();
+
+    // 开始异步计算文件哈希，blockSize大于0时同时计算每块的校验和；
+    // 已有任务在进行或文件无法打开时返回false
+    bool start(const QString &filePath, int blockSize = 0);
+
+    // 取消当前任务
+    void cancel();
+
+    // 是否有任务在进行
+    bool isRunning() const;
+
+    // 同步计算文件哈希（内部仍多线程并行）；ok返回是否成功
+    static QByteArray hashFile(const QString &filePath, bool *ok = nullptr);
+
+    // 计算内存数据的哈希，与内容相同的文件结果一致
+    static QByteArray hashData(const QByteArray &data);
+
+    // 吞吐量测试：并行哈希size字节的内存数据，返回每秒处理的字节数
+    static double benchmark(qint64 size = Constants::HASH_BENCHMARK_BYTES);
+
+signals:
+    // 进度更新
+    void progressChanged(qint64 bytesHashed, qint64 totalBytes);
+
+    // 计算完成（digest为32字节原始哈希）
+    void finished(const QByteArray &digest);
+
+    // 按块计算的结果（仅start时指定了blockSize，在finished之前发出）
+    void blocksHashed(const FileBlockHashes &blocks);
+
+    // 计算失败
+    void failed(const QString &errorMessage);
+
+    // 任务已取消
+    void cancelled();
+
+private slots:
+    // 报告当前进度
+    void reportProgress();
+
+private:
+    struct Job;
+
+    std::shared_ptr<Job> job;  // 当前任务
+    QThreadPool pool;          // 哈希线程
+    QTimer *progressTimer;     // 进度报告定时器
+
+    // 任务的所有线程都已结束
+    void onJobFinished(const std::shared_ptr<Job> &finishedJob);
+
+    // 创建任务（filePath为空时哈希内存数据）
+    static std::shared_ptr<Job> createJob(const QString &filePath, const char *memory, qint64 size,
+                                          int blockSize = 0);
+
+    // 启动工作线程
+    static void launch(const std::shared_ptr<Job> &job, QThreadPool *pool);
+
+    // 工作线程：不断领取下一个块并计算哈希
+    static void hashChunks(Job &job);
+
+    // 合并块哈希得到文件哈希
+    static QByteArray combine(const Job &job);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // FILE_HASHER_H
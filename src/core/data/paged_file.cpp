@@ -0,0 +1,538 @@
+#include "paged_file.h"
+#include <QSaveFile>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include "security_manager.h"
+#include "../utils/constants.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace LocalNetworkApp {
+
+PagedFile::PagedFile(QObject *parent) :
+    QIODevice(parent),
+    pageSize(Constants::STORAGE_PAGE_SIZE),
+    logicalSize(0),
+    cachedPage(-1)
+{
+}
+
+PagedFile::PagedFile(const QString &fileName, const QByteArray &key, QObject *parent) :
+    PagedFile(parent)
+{
+    file.setFileName(fileName);
+    storageKey = key;
+}
+
+PagedFile::~PagedFile()
+{
+    if (isOpen()) {
+        close();
+    }
+}
+
+void PagedFile::setFileName(const QString &fileName)
+{
+    file.setFileName(fileName);
+}
+
+QString PagedFile::fileName() const
+{
+    return file.fileName();
+}
+
+void PagedFile::setKey(const QByteArray &key)
+{
+    storageKey = key;
+}
+
+bool PagedFile::isEncrypted() const
+{
+    return !storageKey.isEmpty();
+}
+
+bool PagedFile::open(OpenMode mode)
+{
+    if (isOpen()) {
+        return false;
+    }
+
+    bool writable = mode.testFlag(QIODevice::WriteOnly);
+    OpenMode fileMode = mode & (QIODevice::ReadWrite | QIODevice::Truncate);
+    if (isEncrypted() && writable) {
+        // 修改页内的部分内容需要先读出整页
+        fileMode |= QIODevice::ReadOnly;
+    }
+
+    if (!file.open(fileMode)) {
+        setErrorString(file.errorString());
+        return false;
+    }
+
+    if (!initialize(writable)) {
+        file.close();
+        cipher.reset();
+        return false;
+    }
+
+    QIODevice::open(mode | QIODevice::Unbuffered);
+    if (mode.testFlag(QIODevice::Append)) {
+        seek(size());
+    }
+    return true;
+}
+
+void PagedFile::close()
+{
+    QIODevice::close();
+    file.close();
+    cipher.reset();
+    logicalSize = 0;
+    cachedPage = -1;
+    cachedData.clear();
+}
+
+qint64 PagedFile::size() const
+{
+    return isEncrypted() ? logicalSize : file.size();
+}
+
+bool PagedFile::seek(qint64 pos)
+{
+    if (!QIODevice::seek(pos)) {
+        return false;
+    }
+    return isEncrypted() || file.seek(pos);
+}
+
+bool PagedFile::resize(qint64 newSize)
+{
+    if (!isEncrypted()) {
+        return file.resize(newSize);
+    }
+    if (!isOpen() || newSize < 0) {
+        return false;
+    }
+    if (newSize == logicalSize) {
+        return true;
+    }
+
+    if (newSize > logicalSize) {
+        // 逐页补零，保证除最后一页外都是整页
+        QByteArray zeros(pageSize, '\0');
+        while (logicalSize < newSize) {
+            if (!writeAt(logicalSize, zeros.constData(), qMin<qint64>(zeros.size(), newSize - logicalSize))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    qint64 pageCount = (newSize + pageSize - 1) / pageSize;
+    qint64 tailLength = newSize % pageSize;
+    QByteArray tail;
+    if (tailLength > 0) {
+        if (!loadPage(pageCount - 1)) {
+            return false;
+        }
+        tail = cachedData.left(tailLength);
+    }
+
+    // 截掉多余的页，保留的最后一页不完整时重新加密
+    qint64 keptPages = tail.isEmpty() ? pageCount : pageCount - 1;
+    if (!file.resize(pageOffset(keptPages))) {
+        setErrorString(file.errorString());
+        return false;
+    }
+
+    logicalSize = newSize;
+    cachedPage = -1;
+    cachedData.clear();
+    if (!tail.isEmpty()) {
+        cachedPage = pageCount - 1;
+        cachedData = tail;
+        return storePage();
+    }
+    return true;
+}
+
+bool PagedFile::flush()
+{
+    // 页在写入时已加密并交给底层文件
+    return file.flush();
+}
+
+bool PagedFile::sync()
+{
+    if (!isOpen() || !file.flush()) {
+        return false;
+    }
+
+#ifdef Q_OS_WIN
+    HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()));
+    return FlushFileBuffers(handle) != 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool PagedFile::isEncryptedFile(const QString &fileName)
+{
+    QFile input(fileName);
+    return input.open(QIODevice::ReadOnly) && isEncryptedData(input.read(4));
+}
+
+bool PagedFile::isEncryptedData(const QByteArray &data)
+{
+    return data.size() >= 4 && qFromBigEndian<quint32>(data.constData()) == FILE_MAGIC;
+}
+
+QByteArray PagedFile::encryptBuffer(const QByteArray &plaintext, const QByteArray &key)
+{
+    if (key.isEmpty()) {
+        return plaintext;
+    }
+
+    AeadCipher::Algorithm algorithm = AeadCipher::preferredAlgorithm();
+    QByteArray fileId = SecurityManager::generateRandomKey(FILE_ID_SIZE);
+    std::unique_ptr<AeadCipher> pageCipher(createCipher(algorithm, key, fileId));
+    const qint64 size = Constants::STORAGE_PAGE_SIZE;
+
+    QByteArray data = createHeader(algorithm, size, key, fileId);
+
+    qint64 pageCount = (plaintext.size() + size - 1) / size;
+    data.reserve(HEADER_SIZE + plaintext.size() + pageCount * PAGE_OVERHEAD);
+    for (qint64 page = 0; page < pageCount; ++page) {
+        qint64 offset = page * size;
+        data.append(sealPage(*pageCipher, page, plaintext.constData() + offset,
+                             qMin<qint64>(size, plaintext.size() - offset)));
+    }
+    return data;
+}
+
+QByteArray PagedFile::decryptBuffer(const QByteArray &data, const QByteArray &key, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (data.size() < HEADER_SIZE || !isEncryptedData(data) || key.isEmpty() ||
+        static_cast<quint8>(data[4]) != FILE_VERSION || !checkKey(data, key)) {
+        return QByteArray();
+    }
+
+    auto algorithm = static_cast<AeadCipher::Algorithm>(static_cast<quint8>(data[5]));
+    qint64 size = qFromBigEndian<quint32>(data.constData() + 8);
+    std::unique_ptr<AeadCipher> pageCipher(createCipher(algorithm, key, data.mid(16, FILE_ID_SIZE)));
+    if (!pageCipher->isValid() || size <= 0 || size > Constants::STORAGE_MAX_PAGE_SIZE) {
+        return QByteArray();
+    }
+
+    QByteArray plaintext;
+    qint64 position = HEADER_SIZE;
+    for (qint64 page = 0; position < data.size(); ++page) {
+        qint64 length = qMin<qint64>(size, data.size() - position - PAGE_OVERHEAD);
+        if (length <= 0) {
+            return QByteArray();
+        }
+
+        const quint8 *physical = reinterpret_cast<const quint8 *>(data.constData() + position);
+        QByteArray pageData(reinterpret_cast<const char *>(physical) + AeadCipher::NONCE_SIZE, length);
+        QByteArray aad = pageAad(page);
+        if (!pageCipher->decrypt(physical, reinterpret_cast<const quint8 *>(aad.constData()), aad.size(),
+                                 reinterpret_cast<quint8 *>(pageData.data()), length,
+                                 physical + AeadCipher::NONCE_SIZE + length)) {
+            return QByteArray();
+        }
+
+        plaintext.append(pageData);
+        position += length + PAGE_OVERHEAD;
+    }
+
+    if (ok) {
+        *ok = true;
+    }
+    return plaintext;
+}
+
+bool PagedFile::encryptFile(const QString &fileName, const QByteArray &key)
+{
+    if (key.isEmpty() || isEncryptedFile(fileName)) {
+        return true;
+    }
+
+    QFile input(fileName);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray data = encryptBuffer(input.readAll(), key);
+    input.close();
+
+    // 写入临时文件后原子替换，中途失败时原文件不受影响
+    QSaveFile output(fileName);
+    if (!output.open(QIODevice::WriteOnly) || output.write(data) != data.size() || !output.commit()) {
+        qWarning() << "无法加密文件:" << fileName << output.errorString();
+        return false;
+    }
+    return true;
+}
+
+qint64 PagedFile::readData(char *data, qint64 maxSize)
+{
+    if (!isEncrypted()) {
+        if (file.pos() != pos() && !file.seek(pos())) {
+            return -1;
+        }
+        return file.read(data, maxSize);
+    }
+
+    qint64 position = pos();
+    qint64 length = qMin(maxSize, logicalSize - position);
+    qint64 done = 0;
+    while (done < length) {
+        qint64 page = (position + done) / pageSize;
+        qint64 pageStart = (position + done) % pageSize;
+        if (!loadPage(page)) {
+            return done > 0 ? done : -1;
+        }
+
+        qint64 n = qMin(length - done, cachedData.size() - pageStart);
+        memcpy(data + done, cachedData.constData() + pageStart, n);
+        done += n;
+    }
+    return qMax<qint64>(done, 0);
+}
+
+qint64 PagedFile::writeData(const char *data, qint64 maxSize)
+{
+    if (!isEncrypted()) {
+        if (file.pos() != pos() && !file.seek(pos())) {
+            return -1;
+        }
+        return file.write(data, maxSize);
+    }
+
+    // 在末尾之后写入时先补零
+    if (pos() > logicalSize && !resize(pos())) {
+        return -1;
+    }
+    return writeAt(pos(), data, maxSize) ? maxSize : -1;
+}
+
+bool PagedFile::initialize(bool writable)
+{
+    logicalSize = 0;
+    cachedPage = -1;
+    cachedData.clear();
+    pageSize = Constants::STORAGE_PAGE_SIZE;
+
+    if (!isEncrypted()) {
+        // 不能把加密文件当作明文读写
+        if (file.isReadable() && isEncryptedData(file.peek(4))) {
+            setErrorString("文件已加密，缺少存储密钥");
+            return false;
+        }
+        return true;
+    }
+
+    qint64 physicalSize = file.size();
+    QByteArray header = file.read(qMin<qint64>(physicalSize, HEADER_SIZE));
+
+    if (physicalSize < HEADER_SIZE) {
+        if (physicalSize > 0 && !writable) {
+            setErrorString("加密文件头不完整");
+            return false;
+        }
+        if (!writable) {
+            return true; // 只读打开的空文件
+        }
+
+        // 新文件（或只写了一部分的文件头）
+        AeadCipher::Algorithm algorithm = AeadCipher::preferredAlgorithm();
+        QByteArray fileId = SecurityManager::generateRandomKey(FILE_ID_SIZE);
+        header = createHeader(algorithm, pageSize, storageKey, fileId);
+
+        if (!file.resize(0) || !file.seek(0) || file.write(header) != header.size()) {
+            setErrorString(file.errorString());
+            return false;
+        }
+        cipher.reset(createCipher(algorithm, storageKey, fileId));
+        return true;
+    }
+
+    if (!isEncryptedData(header) || static_cast<quint8>(header[4]) != FILE_VERSION) {
+        setErrorString("不是可识别的加密文件");
+        return false;
+    }
+    if (!checkKey(header, storageKey)) {
+        // 用错误的密钥打开时所有页都无法认证，不能当作损坏处理
+        setErrorString("存储密钥与文件不匹配");
+        return false;
+    }
+
+    pageSize = qFromBigEndian<quint32>(header.constData() + 8);
+    auto algorithm = static_cast<AeadCipher::Algorithm>(static_cast<quint8>(header[5]));
+    cipher.reset(createCipher(algorithm, storageKey, header.mid(16, FILE_ID_SIZE)));
+    if (pageSize <= 0 || pageSize > Constants::STORAGE_MAX_PAGE_SIZE || !cipher->isValid()) {
+        setErrorString("加密文件头无效");
+        return false;
+    }
+
+    // 除最后一页外都是整页，由文件大小推算逻辑大小
+    qint64 body = physicalSize - HEADER_SIZE;
+    qint64 fullPages = body / (pageSize + PAGE_OVERHEAD);
+    qint64 rest = body % (pageSize + PAGE_OVERHEAD);
+    logicalSize = fullPages * pageSize + qMax<qint64>(rest - PAGE_OVERHEAD, 0);
+
+    // 密钥已通过校验，最后一页仍无法认证说明写入中断，丢弃该页
+    if (logicalSize > 0 && !loadPage((logicalSize - 1) / pageSize)) {
+        qint64 lastPage = (logicalSize - 1) / pageSize;
+        qWarning() << "加密文件的最后一页已损坏，已丢弃:" << file.fileName();
+        logicalSize = lastPage * pageSize;
+        cachedPage = -1;
+        if (writable && !file.resize(pageOffset(lastPage))) {
+            setErrorString(file.errorString());
+            return false;
+        }
+    } else if (writable && physicalSize != pageOffset(fullPages) + (rest > PAGE_OVERHEAD ? rest : 0)) {
+        // 丢弃不足一页开销的残留字节
+        file.resize(pageOffset(fullPages));
+    }
+    return true;
+}
+
+bool PagedFile::loadPage(qint64 page)
+{
+    if (page == cachedPage) {
+        return true;
+    }
+
+    cachedPage = -1;
+    qint64 start = page * pageSize;
+    if (start >= logicalSize) {
+        cachedData.clear();
+        cachedPage = page;
+        return true;
+    }
+
+    qint64 length = qMin(pageSize, logicalSize - start);
+    QByteArray physical(length + PAGE_OVERHEAD, Qt::Uninitialized);
+    if (!cipher || !file.seek(pageOffset(page)) || file.read(physical.data(), physical.size()) != physical.size()) {
+        setErrorString(file.errorString());
+        return false;
+    }
+
+    const quint8 *nonce = reinterpret_cast<const quint8 *>(physical.constData());
+    cachedData = QByteArray(physical.constData() + AeadCipher::NONCE_SIZE, length);
+    QByteArray aad = pageAad(page);
+    if (!cipher->decrypt(nonce, reinterpret_cast<const quint8 *>(aad.constData()), aad.size(),
+                         reinterpret_cast<quint8 *>(cachedData.data()), length,
+                         nonce + AeadCipher::NONCE_SIZE + length)) {
+        setErrorString(QString("第%1页认证失败").arg(page));
+        cachedData.clear();
+        return false;
+    }
+
+    cachedPage = page;
+    return true;
+}
+
+bool PagedFile::storePage()
+{
+    QByteArray physical = sealPage(*cipher, cachedPage, cachedData.constData(), cachedData.size());
+    if (!file.seek(pageOffset(cachedPage)) || file.write(physical) != physical.size()) {
+        setErrorString(file.errorString());
+        cachedPage = -1;
+        return false;
+    }
+    return true;
+}
+
+bool PagedFile::writeAt(qint64 position, const char *data, qint64 length)
+{
+    if (!cipher) {
+        setErrorString("文件未以写入方式打开");
+        return false;
+    }
+
+    qint64 done = 0;
+    while (done < length) {
+        qint64 page = (position + done) / pageSize;
+        qint64 pageStart = (position + done) % pageSize;
+        qint64 n = qMin(length - done, pageSize - pageStart);
+        if (!loadPage(page)) {
+            return false;
+        }
+
+        // 只重新加密被修改的页
+        if (cachedData.size() < pageStart + n) {
+            cachedData.resize(pageStart + n);
+        }
+        memcpy(cachedData.data() + pageStart, data + done, n);
+        if (!storePage()) {
+            return false;
+        }
+
+        done += n;
+        logicalSize = qMax(logicalSize, position + done);
+    }
+    return true;
+}
+
+QByteArray PagedFile::pageAad(qint64 page)
+{
+    QByteArray aad(8, Qt::Uninitialized);
+    qToBigEndian<qint64>(page, aad.data());
+    return aad;
+}
+
+QByteArray PagedFile::createHeader(AeadCipher::Algorithm algorithm, qint64 pageSize, const QByteArray &key,
+                                   const QByteArray &fileId)
+{
+    QByteArray header(HEADER_SIZE, 0);
+    qToBigEndian<quint32>(FILE_MAGIC, header.data());
+    header[4] = static_cast<char>(FILE_VERSION);
+    header[5] = static_cast<char>(algorithm);
+    qToBigEndian<quint32>(static_cast<quint32>(pageSize), header.data() + 8);
+    QByteArray check = SecurityManager::hkdfSha256(key, fileId, QByteArray("LNEP key check"), KEY_CHECK_SIZE);
+    memcpy(header.data() + 12, check.constData(), KEY_CHECK_SIZE);
+    memcpy(header.data() + 16, fileId.constData(), FILE_ID_SIZE);
+    return header;
+}
+
+bool PagedFile::checkKey(const QByteArray &header, const QByteArray &key)
+{
+    QByteArray check = SecurityManager::hkdfSha256(key, header.mid(16, FILE_ID_SIZE), QByteArray("LNEP key check"),
+                                                   KEY_CHECK_SIZE);
+    return header.mid(12, KEY_CHECK_SIZE) == check;
+}
+
+AeadCipher *PagedFile::createCipher(AeadCipher::Algorithm algorithm, const QByteArray &key,
+                                    const QByteArray &fileId)
+{
+    // 每个文件使用独立的页密钥，随机nonce只需在单个文件内不重复
+    QByteArray pageKey = SecurityManager::hkdfSha256(key, fileId, QByteArray("LNEP page key"),
+                                                     AeadCipher::KEY_SIZE);
+    return new AeadCipher(algorithm, pageKey);
+}
+
+QByteArray PagedFile::sealPage(const AeadCipher &cipher, qint64 page, const char *data, qint64 length)
+{
+    QByteArray physical(length + PAGE_OVERHEAD, Qt::Uninitialized);
+    QByteArray nonce = SecurityManager::generateRandomKey(AeadCipher::NONCE_SIZE);
+    quint8 *p = reinterpret_cast<quint8 *>(physical.data());
+    memcpy(p, nonce.constData(), AeadCipher::NONCE_SIZE);
+    memcpy(p + AeadCipher::NONCE_SIZE, data, length);
+
+    QByteArray aad = pageAad(page);
+    cipher.encrypt(p, reinterpret_cast<const quint8 *>(aad.constData()), aad.size(),
+                   p + AeadCipher::NONCE_SIZE, length, p + AeadCipher::NONCE_SIZE + length);
+    return physical;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,129 @@
+#ifndef PAGED_FILE_H
+#define PAGED_FILE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <memory>
+#include "aead_cipher.h"
+
+namespace LocalNetworkApp {
+
+// 按页加密的文件
+//
+// 逻辑内容按固定大小分页，每页单独认证加密，每次写入都使用新的随机nonce。
+// 页密钥由存储密钥和文件ID经HKDF派生，页号作为附加数据，页不能在文件内调换。
+// 读取只解密涉及的页，修改只重新加密涉及的页，写入直接进入底层文件，
+// 与明文文件的落盘时机相同。未设置密钥时直接读写明文文件。
+//
+// 文件格式：文件头(32) | 页0 | 页1 | ...，每页为 nonce(12) | 密文 | 认证标签(16)。
+// 除最后一页外密文都是整页，逻辑大小由文件大小推算。文件头带有存储密钥的
+// 校验值，密钥不匹配时打开失败且不修改文件；密钥正确而最后一页写入中断时
+// 打开文件会丢弃该页；整页截断不会被发现，调用方仍需校验自己的记录。
+class PagedFile : public QIODevice {
+    Q_OBJECT
+
+public:
+    explicit PagedFile(QObject *parent = nullptr);
+    PagedFile(const QString &fileName, const QByteArray &key, QObject *parent = nullptr);
+    ~PagedFile();
+
+    // 设置文件路径（打开前调用）
+    void setFileName(const QString &fileName);
+
+    // 获取文件路径
+    QString fileName() const;
+
+    // 设置存储密钥（打开前调用），为空时读写明文
+    void setKey(const QByteArray &key);
+
+    // 是否加密
+    bool isEncrypted() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+    // 调整逻辑大小，增大的部分以零填充
+    bool resize(qint64 newSize);
+
+    // 把写入交给系统
+    bool flush();
+
+    // 刷新并等待写入磁盘
+    bool sync();
+
+    // 文件是否为加密格式
+    static bool isEncryptedFile(const QString &fileName);
+
+    // 数据是否为加密格式
+    static bool isEncryptedData(const QByteArray &data);
+
+    // 把整段数据加密为分页格式，密钥为空时原样返回
+    static QByteArray encryptBuffer(const QByteArray &plaintext, const QByteArray &key);
+
+    // 解密分页格式的数据，认证失败或格式错误时ok为false
+    static QByteArray decryptBuffer(const QByteArray &data, const QByteArray &key, bool *ok = nullptr);
+
+    // 把明文文件原子替换为加密格式，已加密的文件保持不变
+    static bool encryptFile(const QString &fileName, const QByteArray &key);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    // 文件头布局：魔术数字(4) 版本(1) 算法(1) 保留(2) 页大小(4) 密钥校验(4) 文件ID(16)
+    static const quint32 FILE_MAGIC = 0x4C4E4550; // "LNEP"
+    static const quint8 FILE_VERSION = 1;
+    static const int HEADER_SIZE = 32;
+    static const int FILE_ID_SIZE = 16;
+    static const int KEY_CHECK_SIZE = 4;
+    static const int PAGE_OVERHEAD = AeadCipher::NONCE_SIZE + AeadCipher::TAG_SIZE;
+
+    QFile file;                          // 底层文件
+    QByteArray storageKey;               // 存储密钥
+    std::unique_ptr<AeadCipher> cipher;  // 本文件的页密钥（空文件只读打开时为空）
+    qint64 pageSize;                     // 页大小
+    qint64 logicalSize;                  // 明文长度
+    qint64 cachedPage;                   // 已解密的页号，-1表示没有
+    QByteArray cachedData;               // 已解密的页内容
+
+    // 页在文件中的偏移
+    qint64 pageOffset(qint64 page) const { return HEADER_SIZE + page * (pageSize + PAGE_OVERHEAD); }
+
+    // 读取文件头并推算逻辑大小；文件为空且可写时写入新文件头
+    bool initialize(bool writable);
+
+    // 解密一页到缓存，超出末尾的页为空
+    bool loadPage(qint64 page);
+
+    // 加密缓存的页并写入文件
+    bool storePage();
+
+    // 从position开始写入，position不能超过逻辑大小
+    bool writeAt(qint64 position, const char *data, qint64 length);
+
+    // 页的附加数据
+    static QByteArray pageAad(qint64 page);
+
+    // 生成新文件的文件头
+    static QByteArray createHeader(AeadCipher::Algorithm algorithm, qint64 pageSize, const QByteArray &key,
+                                   const QByteArray &fileId);
+
+    // 文件头中的密钥校验值是否与存储密钥匹配
+    static bool checkKey(const QByteArray &header, const QByteArray &key);
+
+    // 由存储密钥和文件ID创建页密钥
+    static AeadCipher *createCipher(AeadCipher::Algorithm algorithm, const QByteArray &key,
+                                    const QByteArray &fileId);
+
+    // 加密一页，返回nonce、密文和认证标签
+    static QByteArray sealPage(const AeadCipher &cipher, qint64 page, const char *data, qint64 length);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // PAGED_FILE_H
@@ -2,13 +2,23 @@
 #include <QSettings>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QMessageAuthenticationCode>
+#include <QThreadPool>
+#include <QPromise>
+#include <QFutureWatcher>
+#include <QPointer>
 #include <QDebug>
+#include <memory>
+#include "../utils/persistence_service.h"
 
 namespace LocalNetworkApp {
 
 PasswordManager::PasswordManager(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    kdfIterations(0),
+    tokenKey(SecurityManager::generateRandomKey())
 {
+    tokenClock.start();
     loadFromLocal();
 }
 
@@ -21,14 +31,14 @@ bool PasswordManager::addPassword(const QString &password)
     }
 
     // 检查密码是否已存在
-    QByteArray passwordHash = SecurityManager::hashPassword(password);
-    if (passwordHashes.contains(passwordHash)) {
+    ensureKdfParameters();
+    if (!matchPassword(password, passwordHashes, kdfSalt, kdfIterations).matchedHash.isEmpty()) {
         qWarning() << "密码已存在";
         return false;
     }
 
-    // 添加密码哈希
-    passwordHashes.append(passwordHash);
+    // 添加密码哈希（使用本机共用的盐值和迭代次数）
+    passwordHashes.append(SecurityManager::hashPassword(password, kdfSalt, kdfIterations));
 
     // 保存到本地
     if (saveToLocal()) {
@@ -42,17 +52,17 @@ bool PasswordManager::addPassword(const QString &password)
 
 bool PasswordManager::removePassword(const QString &password)
 {
-    // 计算密码哈希
-    QByteArray passwordHash = SecurityManager::hashPassword(password);
-
     // 查找并移除密码
-    int index = passwordHashes.indexOf(passwordHash);
-    if (index == -1) {
+    ensureKdfParameters();
+    MatchResult result = matchPassword(password, passwordHashes, kdfSalt, kdfIterations);
+    int index = passwordHashes.indexOf(result.matchedHash);
+    if (result.matchedHash.isEmpty() || index == -1) {
         qWarning() << "密码不存在";
         return false;
     }
 
     passwordHashes.removeAt(index);
+    verifiedTokens.clear();
 
     // 保存到本地
     if (saveToLocal()) {
@@ -64,10 +74,47 @@ bool PasswordManager::removePassword(const QString &password)
     return false;
 }
 
-bool PasswordManager::verifyPassword(const QString &password) const
+bool PasswordManager::verifyPassword(const QString &password)
 {
-    QByteArray passwordHash = SecurityManager::hashPassword(password);
-    return passwordHashes.contains(passwordHash);
+    if (isTokenCached(password)) {
+        return true;
+    }
+
+    ensureKdfParameters();
+    return acceptMatch(password, matchPassword(password, passwordHashes, kdfSalt, kdfIterations));
+}
+
+void PasswordManager::verifyPasswordAsync(const QString &password, QObject *context, std::function<void(bool)> callback)
+{
+    // 最近验证过的密码不再派生
+    if (isTokenCached(password)) {
+        QMetaObject::invokeMethod(context, [callback]() { callback(true); }, Qt::QueuedConnection);
+        return;
+    }
+
+    ensureKdfParameters();
+
+    auto promise = std::make_shared<QPromise<MatchResult>>();
+    auto *watcher = new QFutureWatcher<MatchResult>(this);
+    QPointer<QObject> receiver(context);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, password, receiver, callback]() {
+        bool verified = acceptMatch(password, watcher->result());
+        watcher->deleteLater();
+        if (receiver) {
+            callback(verified);
+        }
+    });
+    watcher->setFuture(promise->future());
+
+    // 派生在后台线程进行，只传入副本
+    QList<QByteArray> hashes = passwordHashes;
+    QByteArray salt = kdfSalt;
+    int iterations = kdfIterations;
+    QThreadPool::globalInstance()->start([promise, password, hashes, salt, iterations]() {
+        promise->start();
+        promise->addResult(matchPassword(password, hashes, salt, iterations));
+        promise->finish();
+    });
 }
 
 bool PasswordManager::hasPasswords() const
@@ -82,17 +129,15 @@ QList<QByteArray> PasswordManager::getPasswordHashes() const
 
 bool PasswordManager::saveToLocal() const
 {
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-
     // 将密码哈希转换为JSON数组
     QJsonArray passwordArray;
     for (const auto &hash : passwordHashes) {
         passwordArray.append(QString::fromUtf8(hash));
     }
 
-    // 保存到设置文件
-    settings.setValue("security/passwords", QString::fromUtf8(QJsonDocument(passwordArray).toJson()));
-    return settings.status() == QSettings::NoError;
+    // 交给后台线程写入设置文件
+    PersistenceService::instance()->setValue("security/passwords", QString::fromUtf8(QJsonDocument(passwordArray).toJson()));
+    return true;
 }
 
 bool PasswordManager::loadFromLocal()
@@ -114,16 +159,102 @@ bool PasswordManager::loadFromLocal()
         passwordHashes.append(value.toString().toUtf8());
     }
 
+    // 本机共用的密码哈希参数
+    kdfSalt = QByteArray::fromBase64(settings.value("security/passwordSalt").toByteArray());
+    kdfIterations = settings.value("security/passwordIterations", 0).toInt();
+
     return true;
 }
 
 void PasswordManager::clearAllPasswords()
 {
     passwordHashes.clear();
+    verifiedTokens.clear();
     saveToLocal();
     emit passwordsChanged();
 }
 
+PasswordManager::MatchResult PasswordManager::matchPassword(const QString &password, const QList<QByteArray> &hashes,
+                                                            const QByteArray &salt, int iterations)
+{
+    // 使用本机参数的哈希共用一次派生结果，其他格式逐个验证
+    MatchResult result;
+    QByteArray current;
+    QByteArray prefix = "pbkdf2-sha256$" + QByteArray::number(iterations) + "$" + salt.toBase64() + "$";
+
+    for (const QByteArray &hash : hashes) {
+        bool sharesParameters = hash.startsWith(prefix);
+        bool matched = false;
+        if (sharesParameters) {
+            if (current.isEmpty()) {
+                current = SecurityManager::hashPassword(password, salt, iterations);
+            }
+            matched = SecurityManager::constantTimeEquals(current, hash);
+        } else {
+            matched = SecurityManager::verifyPassword(password, hash);
+        }
+
+        if (matched) {
+            result.matchedHash = hash;
+            // 旧格式或参数不同的哈希按本机参数重新计算
+            if (!sharesParameters) {
+                result.upgradedHash = current.isEmpty() ? SecurityManager::hashPassword(password, salt, iterations)
+                                                        : current;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+bool PasswordManager::acceptMatch(const QString &password, const MatchResult &result)
+{
+    // 后台验证期间密码可能已被移除
+    int index = result.matchedHash.isEmpty() ? -1 : passwordHashes.indexOf(result.matchedHash);
+    if (index == -1) {
+        return false;
+    }
+
+    if (!result.upgradedHash.isEmpty()) {
+        passwordHashes[index] = result.upgradedHash;
+        saveToLocal();
+    }
+
+    verifiedTokens.insert(verificationToken(password), tokenClock.elapsed() + Constants::PASSWORD_TOKEN_TTL_MS);
+    return true;
+}
+
+QByteArray PasswordManager::verificationToken(const QString &password) const
+{
+    return QMessageAuthenticationCode::hash(password.toUtf8(), tokenKey, QCryptographicHash::Sha256);
+}
+
+bool PasswordManager::isTokenCached(const QString &password)
+{
+    auto it = verifiedTokens.find(verificationToken(password));
+    if (it == verifiedTokens.end()) {
+        return false;
+    }
+
+    if (it.value() < tokenClock.elapsed()) {
+        verifiedTokens.erase(it);
+        return false;
+    }
+    return true;
+}
+
+void PasswordManager::ensureKdfParameters()
+{
+    if (!kdfSalt.isEmpty() && kdfIterations >= Constants::PASSWORD_MIN_ITERATIONS) {
+        return;
+    }
+
+    kdfSalt = SecurityManager::generateRandomKey(Constants::PASSWORD_SALT_SIZE);
+    kdfIterations = SecurityManager::calibratePasswordIterations();
+    PersistenceService::instance()->setValue("security/passwordSalt", QString::fromLatin1(kdfSalt.toBase64()));
+    PersistenceService::instance()->setValue("security/passwordIterations", kdfIterations);
+}
+
 QString PasswordManager::getPasswordFilePath() const
 {
     return QSettings().fileName();
@@ -5,6 +5,9 @@
 #include <QList>
 #include <QByteArray>
 #include <QString>
+#include <QHash>
+#include <QElapsedTimer>
+#include <functional>
 #include "security_manager.h"
 #include "../utils/constants.h"
 
@@ -23,8 +26,11 @@ public:
     // 移除密码
     bool removePassword(const QString &password);
 
-    // 验证密码
-    bool verifyPassword(const QString &password) const;
+    // 验证密码（在调用线程派生密码哈希；验证通过的密码在缓存期内无需重新派生）
+    bool verifyPassword(const QString &password);
+
+    // 在后台线程验证密码，完成后在context所在线程调用callback
+    void verifyPasswordAsync(const QString &password, QObject *context, std::function<void(bool)> callback);
 
     // 检查是否有密码
     bool hasPasswords() const;
@@ -52,7 +58,34 @@ signals:
     void passwordsChanged();
 
 private:
+    // 密码匹配结果
+    struct MatchResult {
+        QByteArray matchedHash;  // 匹配的哈希（为空表示没有匹配）
+        QByteArray upgradedHash; // 按当前参数重新计算的哈希（不需要升级时为空）
+    };
+
     QList<QByteArray> passwordHashes; // 密码哈希列表
+    QByteArray kdfSalt;               // 本机密码共用的盐值，验证时只需派生一次
+    int kdfIterations;                // 本机密码共用的迭代次数
+    QByteArray tokenKey;              // 验证缓存的随机密钥（只在内存中）
+    QHash<QByteArray, qint64> verifiedTokens; // 验证通过的密码标记 -> 过期时间
+    QElapsedTimer tokenClock;         // 验证缓存的计时
+
+    // 在哈希列表中查找与密码匹配的项（可在任意线程调用）
+    static MatchResult matchPassword(const QString &password, const QList<QByteArray> &hashes,
+                                     const QByteArray &salt, int iterations);
+
+    // 处理匹配结果：升级旧哈希并缓存验证标记；匹配的密码已被移除时返回false
+    bool acceptMatch(const QString &password, const MatchResult &result);
+
+    // 密码的验证标记
+    QByteArray verificationToken(const QString &password) const;
+
+    // 密码是否在验证缓存中
+    bool isTokenCached(const QString &password);
+
+    // 首次使用时生成盐值并校准迭代次数
+    void ensureKdfParameters();
 
     // 获取密码文件路径
     QString getPasswordFilePath() const;
@@ -0,0 +1,135 @@
+#include "record_format_benchmark.h"
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDebug>
+#include "../message/message.h"
+#include "../user/contact_manager.h"
+
+namespace LocalNetworkApp {
+
+namespace {
+
+// 随机的中英文混合文本，长度在minLength到maxLength之间
+QString randomText(QRandomGenerator &random, int minLength, int maxLength)
+{
+    static const QString alphabet = QStringLiteral("abcdefghijklmnopqrstuvwxyz 0123456789你好今天文件传输局域网消息");
+    int length = random.bounded(minLength, maxLength + 1);
+    QString text;
+    text.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        text.append(alphabet.at(random.bounded(alphabet.size())));
+    }
+    return text;
+}
+
+// 编码全部记录再逐条解码，记录两段耗时；decode返回false时计为解码失败
+template <typename Record, typename Encode, typename Decode>
+RecordFormatResult measure(const QString &recordName, const QString &formatName,
+                           const QList<Record> &records, Encode encode, Decode decode)
+{
+    RecordFormatResult result;
+    result.record = recordName;
+    result.format = formatName;
+    if (records.isEmpty()) {
+        return result;
+    }
+
+    QList<QByteArray> encoded;
+    encoded.reserve(records.size());
+
+    QElapsedTimer timer;
+    timer.start();
+    for (const Record &record : records) {
+        encoded.append(encode(record));
+    }
+    qint64 encodeNs = timer.nsecsElapsed();
+
+    int failures = 0;
+    timer.restart();
+    for (const QByteArray &data : std::as_const(encoded)) {
+        if (!decode(data)) {
+            ++failures;
+        }
+    }
+    qint64 decodeNs = timer.nsecsElapsed();
+
+    for (const QByteArray &data : std::as_const(encoded)) {
+        result.totalBytes += data.size();
+    }
+    result.encodeNsPerRecord = double(encodeNs) / records.size();
+    result.decodeNsPerRecord = double(decodeNs) / records.size();
+
+    if (failures > 0) {
+        qWarning() << "记录格式测试解码失败:" << recordName << formatName << failures;
+    }
+    qInfo().noquote() << QString("%1 %2: 编码 %3 ns/条，解码 %4 ns/条，平均 %5 字节/条")
+                             .arg(recordName, formatName)
+                             .arg(result.encodeNsPerRecord, 0, 'f', 0)
+                             .arg(result.decodeNsPerRecord, 0, 'f', 0)
+                             .arg(double(result.totalBytes) / records.size(), 0, 'f', 1);
+    return result;
+}
+
+} // namespace
+
+QList<RecordFormatResult> RecordFormatBenchmark::run(int count)
+{
+    QList<RecordFormatResult> results;
+    if (count <= 0) {
+        return results;
+    }
+
+    // 固定种子，两种格式处理完全相同的内容，多次运行可比较
+    QRandomGenerator random(20240601);
+    QUuid self = QUuid::createUuid();
+
+    QList<Message> messages;
+    QList<ContactInfo> contacts;
+    messages.reserve(count);
+    contacts.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        messages.append(Message(self, QUuid::createUuid(), randomText(random, 5, 200)));
+
+        ContactInfo contact;
+        contact.id = QUuid::createUuid();
+        contact.nickname = randomText(random, 2, 16);
+        contact.remark = random.bounded(2) ? randomText(random, 2, 16) : QString();
+        contact.group = random.bounded(2) ? randomText(random, 2, 8) : QString();
+        contact.state = static_cast<UserState>(random.bounded(3));
+        contact.lastSeen = QDateTime::currentDateTime().addSecs(-random.bounded(86400 * 30));
+        contacts.append(contact);
+    }
+
+    results.append(measure(QStringLiteral("Message"), QStringLiteral("JSON"), messages,
+        [](const Message &message) { return QJsonDocument(message.toJson()).toJson(QJsonDocument::Compact); },
+        [](const QByteArray &data) {
+            QJsonDocument doc = QJsonDocument::fromJson(data);
+            return doc.isObject() && !Message(doc.object()).getMessageId().isNull();
+        }));
+    results.append(measure(QStringLiteral("Message"), QStringLiteral("二进制"), messages,
+        [](const Message &message) { return message.toBinary(); },
+        [](const QByteArray &data) {
+            bool ok = false;
+            Message::fromBinary(data, &ok);
+            return ok;
+        }));
+
+    results.append(measure(QStringLiteral("ContactInfo"), QStringLiteral("JSON"), contacts,
+        [](const ContactInfo &contact) { return QJsonDocument(contact.toJson()).toJson(QJsonDocument::Compact); },
+        [](const QByteArray &data) {
+            QJsonDocument doc = QJsonDocument::fromJson(data);
+            return doc.isObject() && !ContactInfo::fromJson(doc.object()).id.isNull();
+        }));
+    results.append(measure(QStringLiteral("ContactInfo"), QStringLiteral("二进制"), contacts,
+        [](const ContactInfo &contact) { return contact.toBinary(); },
+        [](const QByteArray &data) {
+            bool ok = false;
+            ContactInfo::fromBinary(data, &ok);
+            return ok;
+        }));
+
+    return results;
+}
+
+} // namespace LocalNetworkApp
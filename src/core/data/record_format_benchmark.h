@@ -0,0 +1,34 @@
+#ifndef RECORD_FORMAT_BENCHMARK_H
+#define RECORD_FORMAT_BENCHMARK_H
+
+#include <QString>
+#include <QList>
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 一种记录在一种格式下的测试结果
+struct RecordFormatResult {
+    QString record;          // 记录类型（Message或ContactInfo）
+    QString format;          // 格式（JSON或二进制）
+    qint64 totalBytes = 0;   // 全部记录编码后的字节数
+    double encodeNsPerRecord = 0.0; // 平均每条编码耗时（纳秒）
+    double decodeNsPerRecord = 0.0; // 平均每条解码耗时（纳秒）
+};
+
+// 记录格式测试
+//
+// 用同一批随机内容的Message和ContactInfo分别测量JSON格式和紧凑二进制格式的
+// 编码耗时、解码耗时和体积，结果写入日志。
+class RecordFormatBenchmark {
+public:
+    RecordFormatBenchmark() = delete;
+    ~RecordFormatBenchmark() = delete;
+
+    // 每种记录编码解码count条，返回各记录类型和格式的结果
+    static QList<RecordFormatResult> run(int count = Constants::RECORD_BENCHMARK_COUNT);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // RECORD_FORMAT_BENCHMARK_H
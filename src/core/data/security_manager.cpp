@@ -1,95 +1,351 @@
 #include "security_manager.h"
-#include <QFile>
+#include "aead_cipher.h"
 #include <QRandomGenerator>
+#include <QMessageAuthenticationCode>
+#include <QPasswordDigestor>
+#include <QElapsedTimer>
 #include <QRegularExpression>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
 #include <QStringList>
 #include <QDebug>
+#include <cstring>
+#include <atomic>
 
 namespace LocalNetworkApp {
 
 QByteArray SecurityManager::hashPassword(const QString &password)
 {
-    // 使用SHA-256算法哈希密码
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(password.toUtf8());
-    return hash.result().toHex();
+    return hashPassword(password, generateRandomKey(Constants::PASSWORD_SALT_SIZE), calibratePasswordIterations());
+}
+
+QByteArray SecurityManager::hashPassword(const QString &password, const QByteArray &salt, int iterations)
+{
+    QByteArray digest = QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256, password.toUtf8(),
+                                                           salt, iterations, 32);
+    return "pbkdf2-sha256$" + QByteArray::number(iterations) + "$" + salt.toBase64() + "$" + digest.toBase64();
 }
 
 bool SecurityManager::verifyPassword(const QString &password, const QByteArray &hash)
 {
-    QByteArray passwordHash = hashPassword(password);
-    return passwordHash == hash;
+    int iterations = 0;
+    QByteArray salt;
+    QByteArray digest;
+    if (parsePasswordHash(hash, &iterations, &salt, &digest)) {
+        return constantTimeEquals(hashPassword(password, salt, iterations), hash);
+    }
+
+    // 旧版：无盐的SHA-256十六进制
+    QByteArray legacy = QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex();
+    return constantTimeEquals(legacy, hash);
+}
+
+bool SecurityManager::needsRehash(const QByteArray &hash)
+{
+    int iterations = 0;
+    QByteArray salt;
+    QByteArray digest;
+    return !parsePasswordHash(hash, &iterations, &salt, &digest) ||
+           iterations < Constants::PASSWORD_MIN_ITERATIONS;
+}
+
+int SecurityManager::calibratePasswordIterations(int targetMs)
+{
+    static std::atomic<int> calibrated{0};
+    static std::atomic<int> calibratedTarget{0};
+    if (calibrated.load() > 0 && calibratedTarget.load() == targetMs) {
+        return calibrated.load();
+    }
+
+    // 先用少量迭代测速，再按比例推算目标耗时对应的迭代次数
+    const int probeIterations = 20000;
+    QElapsedTimer timer;
+    timer.start();
+    QPasswordDigestor::deriveKeyPbkdf2(QCryptographicHash::Sha256, QByteArray("calibration"),
+                                       QByteArray(Constants::PASSWORD_SALT_SIZE, '\0'), probeIterations, 32);
+    qint64 elapsedNs = qMax<qint64>(timer.nsecsElapsed(), 1);
+
+    double iterations = double(probeIterations) * double(targetMs) * 1e6 / double(elapsedNs);
+    int result = static_cast<int>(qBound<double>(Constants::PASSWORD_MIN_ITERATIONS, iterations,
+                                                 Constants::PASSWORD_MAX_ITERATIONS));
+    result = result / 1000 * 1000;
+
+    calibratedTarget = targetMs;
+    calibrated = result;
+    qInfo() << "密码哈希迭代次数:" << result << "目标耗时:" << targetMs << "ms";
+    return result;
+}
+
+bool SecurityManager::constantTimeEquals(const QByteArray &a, const QByteArray &b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    uchar diff = 0;
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        diff |= static_cast<uchar>(a.at(i) ^ b.at(i));
+    }
+    return diff == 0;
+}
+
+bool SecurityManager::parsePasswordHash(const QByteArray &hash, int *iterations, QByteArray *salt, QByteArray *digest)
+{
+    QList<QByteArray> parts = hash.split('$');
+    if (parts.size() != 4 || parts.at(0) != "pbkdf2-sha256") {
+        return false;
+    }
+
+    bool ok = false;
+    *iterations = parts.at(1).toInt(&ok);
+    *salt = QByteArray::fromBase64(parts.at(2));
+    *digest = QByteArray::fromBase64(parts.at(3));
+    return ok && *iterations > 0 && *iterations <= Constants::PASSWORD_MAX_ITERATIONS &&
+           !salt->isEmpty() && digest->size() == 32;
 }
 
 QByteArray SecurityManager::generateRandomKey(int length)
 {
-    QByteArray key;
-    key.resize(length);
+    // 密钥和nonce使用系统的密码学安全随机数
+    QByteArray key(length, Qt::Uninitialized);
+    for (int i = 0; i < length; i += 4) {
+        quint32 value = QRandomGenerator::system()->generate();
+        int n = qMin(4, length - i);
+        memcpy(key.data() + i, &value, n);
+    }
 
-    for (int i = 0; i < length; ++i) {
-        key[i] = QRandomGenerator::global()->bounded(256);
+    return key;
+}
+
+QByteArray SecurityManager::storageKey()
+{
+    // 进程内只读取一次
+    static const QByteArray key = loadStorageKey();
+    return key;
+}
+
+QByteArray SecurityManager::loadStorageKey()
+{
+    QString path = storageKeyPath();
+    if (QFile::exists(path)) {
+        QByteArray key = readStorageKey(path);
+        if (key.isEmpty()) {
+            qWarning() << "存储密钥文件无效:" << path;
+        }
+        return key; // 无效时不覆盖，避免已加密的数据永久无法读取
+    }
+
+    // 旧版本把密钥和数据文件放在同一目录，复制数据目录时会连同密钥一起带走；
+    // 迁移到配置目录后删除旧文件
+    if (QFile::exists(Constants::STORAGE_KEY_FILE)) {
+        QByteArray key = readStorageKey(Constants::STORAGE_KEY_FILE);
+        if (key.isEmpty()) {
+            qWarning() << "存储密钥文件无效:" << Constants::STORAGE_KEY_FILE;
+            return QByteArray();
+        }
+        if (writeStorageKey(path, key)) {
+            QFile::remove(Constants::STORAGE_KEY_FILE);
+        } else {
+            qWarning() << "无法迁移存储密钥，继续使用数据目录中的密钥:" << Constants::STORAGE_KEY_FILE;
+        }
+        return key;
     }
 
+    // 密钥必须在任何数据用它加密之前落盘，因此同步写入
+    QByteArray key = generateRandomKey(Constants::STORAGE_KEY_SIZE);
+    if (!writeStorageKey(path, key)) {
+        qWarning() << "无法保存存储密钥，本地数据将以明文保存:" << path;
+        return QByteArray();
+    }
     return key;
 }
 
-QByteArray SecurityManager::encryptData(const QByteArray &data, const QString &key)
+QString SecurityManager::storageKeyPath()
 {
-    // 生成随机IV
-    QByteArray iv = generateRandomKey(16);
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+    return directory + "/" + Constants::STORAGE_KEY_DIR_NAME + "/" + Constants::STORAGE_KEY_FILE;
+}
 
-    // 使用SHA-256哈希密钥
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(key.toUtf8());
-    QByteArray keyHash = hash.result();
+QByteArray SecurityManager::readStorageKey(const QString &path)
+{
+    QFile file(path);
+    QByteArray key;
+    if (file.open(QIODevice::ReadOnly)) {
+        key = file.read(Constants::STORAGE_KEY_SIZE + 1);
+    }
+    return key.size() == Constants::STORAGE_KEY_SIZE ? key : QByteArray();
+}
+
+bool SecurityManager::writeStorageKey(const QString &path, const QByteArray &key)
+{
+    QString directory = QFileInfo(path).absolutePath();
+    if (!QDir().mkpath(directory)) {
+        return false;
+    }
+    QFile::setPermissions(directory, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+
+    // 先收紧临时文件的权限再写入密钥，任何时刻其他用户都读不到
+    QSaveFile output(path);
+    if (!output.open(QIODevice::WriteOnly) ||
+        !output.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner) ||
+        output.write(key) != key.size() || !output.commit()) {
+        qWarning() << "无法保存存储密钥:" << path << output.errorString();
+        return false;
+    }
+    return true;
+}
 
-    // 加密数据
-    QByteArray paddedData = padData(data, 16);
-    QByteArray encrypted = encryptAES(paddedData, keyHash, iv);
+QByteArray SecurityManager::encryptData(const QByteArray &data, const QString &key)
+{
+    AeadCipher cipher(AeadCipher::preferredAlgorithm(), deriveKey(key));
 
-    // 返回IV + 加密数据
-    return iv + encrypted;
+    // 一次分配，明文复制到信封中间后原地加密
+    QByteArray result(data.size() + ENVELOPE_OVERHEAD, Qt::Uninitialized);
+    memcpy(result.data() + ENVELOPE_HEADER_SIZE, data.constData(), data.size());
+    encryptInPlace(cipher, std::as_writable_bytes(std::span(result.data(), result.size())));
+    return result;
 }
 
 QByteArray SecurityManager::decryptData(const QByteArray &data, const QString &key)
 {
-    if (data.size() < 16) {
+    if (data.size() < ENVELOPE_OVERHEAD) {
+        return QByteArray();
+    }
+
+    // 按数据中记录的算法解密
+    quint8 algorithm = static_cast<quint8>(data[0]);
+    if (algorithm != static_cast<quint8>(AeadCipher::Algorithm::Aes256Gcm) &&
+        algorithm != static_cast<quint8>(AeadCipher::Algorithm::ChaCha20Poly1305)) {
+        qWarning() << "未知的加密算法:" << algorithm;
         return QByteArray();
     }
+    AeadCipher cipher(static_cast<AeadCipher::Algorithm>(algorithm), deriveKey(key));
+
+    // 直接解密到结果中，只分配一次
+    QByteArray plaintext(data.size() - ENVELOPE_OVERHEAD, Qt::Uninitialized);
+    qsizetype length = decryptTo(cipher,
+                                 std::as_bytes(std::span(data.constData(), data.size())),
+                                 std::as_writable_bytes(std::span(plaintext.data(), plaintext.size())));
+    return length < 0 ? QByteArray() : plaintext;
+}
 
-    // 提取IV
-    QByteArray iv = data.left(16);
-    QByteArray encrypted = data.mid(16);
+std::unique_ptr<AeadCipher> SecurityManager::createCipher(const QString &key, AeadCipher::Algorithm algorithm)
+{
+    return std::make_unique<AeadCipher>(algorithm, deriveKey(key));
+}
 
-    // 使用SHA-256哈希密钥
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    hash.addData(key.toUtf8());
-    QByteArray keyHash = hash.result();
+bool SecurityManager::encryptInPlace(const AeadCipher &cipher, std::span<std::byte> envelope)
+{
+    if (envelope.size() < static_cast<size_t>(ENVELOPE_OVERHEAD)) {
+        return false;
+    }
 
-    // 解密数据
-    QByteArray decrypted = decryptAES(encrypted, keyHash, iv);
-    if (decrypted.isEmpty()) {
-        return QByteArray();
+    // 算法字节作为附加数据参与认证；nonce随机生成，写在栈上
+    quint8 *out = reinterpret_cast<quint8 *>(envelope.data());
+    quint32 nonceWords[AeadCipher::NONCE_SIZE / 4];
+    QRandomGenerator::system()->fillRange(nonceWords);
+    out[0] = static_cast<quint8>(cipher.algorithm());
+    memcpy(out + 1, nonceWords, AeadCipher::NONCE_SIZE);
+
+    qsizetype length = envelope.size() - ENVELOPE_OVERHEAD;
+    quint8 *payload = out + ENVELOPE_HEADER_SIZE;
+    cipher.encrypt(out + 1, out, 1, payload, length, payload + length);
+    return true;
+}
+
+std::span<std::byte> SecurityManager::decryptInPlace(const AeadCipher &cipher, std::span<std::byte> envelope)
+{
+    if (envelope.size() < static_cast<size_t>(ENVELOPE_OVERHEAD)) {
+        return {};
     }
 
-    // 移除填充
-    return unpadData(decrypted);
+    quint8 *in = reinterpret_cast<quint8 *>(envelope.data());
+    if (in[0] != static_cast<quint8>(cipher.algorithm())) {
+        return {};
+    }
+
+    qsizetype length = envelope.size() - ENVELOPE_OVERHEAD;
+    quint8 *payload = in + ENVELOPE_HEADER_SIZE;
+    if (!cipher.decrypt(in + 1, in, 1, payload, length, payload + length)) {
+        return {};
+    }
+    return envelope.subspan(ENVELOPE_HEADER_SIZE, length);
 }
 
-QByteArray SecurityManager::calculateFileHash(const QString &filePath)
+qsizetype SecurityManager::encryptTo(const AeadCipher &cipher, std::span<const std::byte> plaintext,
+                                     std::span<std::byte> output)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
+    qsizetype total = plaintext.size() + ENVELOPE_OVERHEAD;
+    if (output.size() < static_cast<size_t>(total)) {
+        return -1;
+    }
+
+    // 明文已在信封中对应的位置时无需复制
+    std::span<std::byte> envelope = output.first(total);
+    std::byte *payload = envelope.data() + ENVELOPE_HEADER_SIZE;
+    if (payload != plaintext.data()) {
+        memmove(payload, plaintext.data(), plaintext.size());
+    }
+    encryptInPlace(cipher, envelope);
+    return total;
+}
+
+qsizetype SecurityManager::decryptTo(const AeadCipher &cipher, std::span<const std::byte> envelope,
+                                     std::span<std::byte> output)
+{
+    if (envelope.size() < static_cast<size_t>(ENVELOPE_OVERHEAD)) {
+        return -1;
+    }
+
+    qsizetype length = envelope.size() - ENVELOPE_OVERHEAD;
+    const quint8 *in = reinterpret_cast<const quint8 *>(envelope.data());
+    if (output.size() < static_cast<size_t>(length) || in[0] != static_cast<quint8>(cipher.algorithm())) {
+        return -1;
+    }
+
+    // 先取出nonce和认证标签，输出缓冲区可以与输入重叠
+    quint8 header[ENVELOPE_HEADER_SIZE];
+    quint8 tag[AeadCipher::TAG_SIZE];
+    memcpy(header, in, ENVELOPE_HEADER_SIZE);
+    memcpy(tag, in + ENVELOPE_HEADER_SIZE + length, AeadCipher::TAG_SIZE);
+
+    quint8 *out = reinterpret_cast<quint8 *>(output.data());
+    memmove(out, in + ENVELOPE_HEADER_SIZE, length);
+    if (!cipher.decrypt(header + 1, header, 1, out, length, tag)) {
+        return -1;
+    }
+    return length;
+}
+
+QByteArray SecurityManager::hkdfSha256(const QByteArray &inputKey, const QByteArray &salt,
+                                       const QByteArray &info, int length)
+{
+    const int hashLength = 32;
+    if (length <= 0 || length > 255 * hashLength) {
         return QByteArray();
     }
 
-    QCryptographicHash hash(QCryptographicHash::Sha256);
-    while (!file.atEnd()) {
-        QByteArray chunk = file.read(8192);
-        hash.addData(chunk);
+    // 提取：PRK = HMAC(salt, IKM)，salt为空时使用全零
+    QByteArray prk = QMessageAuthenticationCode::hash(
+        inputKey, salt.isEmpty() ? QByteArray(hashLength, '\0') : salt, QCryptographicHash::Sha256);
+
+    // 扩展：T(i) = HMAC(PRK, T(i-1) | info | i)
+    QByteArray output;
+    QByteArray block;
+    QMessageAuthenticationCode mac(QCryptographicHash::Sha256, prk);
+    for (int i = 1; output.size() < length; ++i) {
+        mac.reset();
+        mac.addData(block);
+        mac.addData(info);
+        mac.addData(QByteArray(1, static_cast<char>(i)));
+        block = mac.result();
+        output.append(block);
     }
 
-    return hash.result().toHex();
+    return output.left(length);
 }
 
 bool SecurityManager::isStrongPassword(const QString &password)
@@ -158,111 +414,10 @@ QString SecurityManager::getPasswordStrength(const QString &password)
     }
 }
 
-QByteArray SecurityManager::encryptAES(const QByteArray &data, const QByteArray &key, const QByteArray &iv)
+QByteArray SecurityManager::deriveKey(const QString &key)
 {
-    QByteArray paddedData = padData(data);
-    QByteArray normalizedKey = normalizeKey(key);
-    QByteArray result;
-    QByteArray prevBlock = iv;
-
-    // CBC模式加密（分块处理，每块16字节）
-    for (int i = 0; i < paddedData.size(); i += 16) {
-        QByteArray block = paddedData.mid(i, 16);
-        // CBC步骤1：与前一块（或IV）XOR
-        block = xorBytes(block, prevBlock);
-        // CBC步骤2：加密当前块
-        block = aesBlockEncrypt(block, normalizedKey);
-        // 保存结果
-        result.append(block);
-        // 更新前一块
-        prevBlock = block;
-    }
-
-    return result;
-}
-
-QByteArray SecurityManager::decryptAES(const QByteArray &data, const QByteArray &key, const QByteArray &iv)
-{
-    QByteArray normalizedKey = normalizeKey(key);
-    QByteArray result;
-    QByteArray prevBlock = iv;
-
-    // CBC模式解密（分块处理）
-    for (int i = 0; i < data.size(); i += 16) {
-        QByteArray block = data.mid(i, 16);
-        // 保存当前块用于下一轮XOR
-        QByteArray currentBlock = block;
-        // CBC步骤1：解密当前块
-        block = aesBlockDecrypt(block, normalizedKey);
-        // CBC步骤2：与前一块（或IV）XOR
-        block = xorBytes(block, prevBlock);
-        // 保存结果
-        result.append(block);
-        // 更新前一块
-        prevBlock = currentBlock;
-    }
-
-    // 去除填充
-    return unpadData(result);
-}
-
-QByteArray SecurityManager::padData(const QByteArray &data, int blockSize)
-{
-    int padding = blockSize - (data.size() % blockSize);
-    QByteArray padded = data;
-    padded.append(padding, padding);
-    return padded;
-}
-
-QByteArray SecurityManager::unpadData(const QByteArray &data)
-{
-    if (data.isEmpty()) {
-        return data;
-    }
-
-    int padding = static_cast<unsigned char>(data.back());
-    if (padding > data.size()) {
-        return data;
-    }
-
-    return data.left(data.size() - padding);
-}
-
-// 辅助函数实现
-QByteArray SecurityManager::xorBytes(const QByteArray &a, const QByteArray &b)
-{
-    QByteArray result;
-    int size = qMin(a.size(), b.size());
-    for (int i = 0; i < size; ++i) {
-        result.append(static_cast<char>(static_cast<unsigned char>(a[i]) ^ static_cast<unsigned char>(b[i])));
-    }
-    return result;
-}
-
-QByteArray SecurityManager::aesBlockEncrypt(const QByteArray &block, const QByteArray &key)
-{
-    // 简化版AES块加密（实际项目建议使用QCA或第三方库）
-    // 这里使用Qt哈希模拟（仅作示例，生产环境请用QCA）
-    QByteArray encrypted = QCryptographicHash::hash(block + key, QCryptographicHash::Sha256);
-    return encrypted.left(16); // 取前16字节作为块加密结果
-}
-
-QByteArray SecurityManager::aesBlockDecrypt(const QByteArray &block, const QByteArray &key)
-{
-    // 简化版AES块解密（与加密对应）
-    QByteArray decrypted = QCryptographicHash::hash(block + key, QCryptographicHash::Sha256);
-    return decrypted.left(16);
-}
-
-QByteArray SecurityManager::normalizeKey(const QByteArray &key)
-{
-    // 将任意长度的密钥转换为32字节（256位）的密钥
-    if (key.size() == 32) {
-        return key;
-    }
-    // 使用SHA-256哈希生成固定长度的密钥
-    return QCryptographicHash::hash(key, QCryptographicHash::Sha256);
+    // 使用SHA-256哈希密钥
+    return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256);
 }
 
-
 } // namespace LocalNetworkApp
@@ -4,6 +4,11 @@
 #include <QString>
 #include <QByteArray>
 #include <QCryptographicHash>
+#include <span>
+#include <cstddef>
+#include <memory>
+#include "aead_cipher.h"
+#include "../utils/constants.h"
 
 namespace LocalNetworkApp {
 
@@ -12,23 +17,66 @@ public:
     SecurityManager() = delete;
     ~SecurityManager() = delete;
 
-    // 密码哈希算法
+    // 密码哈希：PBKDF2-HMAC-SHA256，随机盐值，迭代次数按本机速度校准
+    // 格式为"pbkdf2-sha256$迭代次数$盐值(Base64)$哈希(Base64)"
     static QByteArray hashPassword(const QString &password);
 
-    // 验证密码
+    // 使用指定的盐值和迭代次数计算密码哈希
+    static QByteArray hashPassword(const QString &password, const QByteArray &salt, int iterations);
+
+    // 验证密码（兼容旧版无盐的SHA-256十六进制哈希）
     static bool verifyPassword(const QString &password, const QByteArray &hash);
 
+    // 哈希是否需要按当前参数重新计算（旧格式或迭代次数过低）
+    static bool needsRehash(const QByteArray &hash);
+
+    // 校准PBKDF2迭代次数，使一次派生约耗时targetMs毫秒；结果在进程内缓存
+    static int calibratePasswordIterations(int targetMs = Constants::PASSWORD_HASH_TARGET_MS);
+
+    // 常量时间比较，耗时与内容无关
+    static bool constantTimeEquals(const QByteArray &a, const QByteArray &b);
+
     // 生成随机密钥
     static QByteArray generateRandomKey(int length = 32);
 
-    // 加密数据
+    // 本地数据加密密钥：首次使用时随机生成并保存在密钥文件中（仅所有者可读写），
+    // 无法保存时返回空，调用方以明文存储
+    static QByteArray storageKey();
+
+    // encryptData输出格式：[算法(1)][nonce(12)][密文][认证标签(16)]
+    static const int ENVELOPE_HEADER_SIZE = 1 + AeadCipher::NONCE_SIZE;
+    static const int ENVELOPE_OVERHEAD = ENVELOPE_HEADER_SIZE + AeadCipher::TAG_SIZE;
+
+    // 加密数据（认证加密，密文被篡改时解密失败）
     static QByteArray encryptData(const QByteArray &data, const QString &key);
 
-    // 解密数据
+    // 解密数据，认证失败或格式错误时返回空
     static QByteArray decryptData(const QByteArray &data, const QString &key);
 
-    // 计算文件哈希
-    static QByteArray calculateFileHash(const QString &filePath);
+    // 由字符串密钥创建可重复使用的加密器，避免每次加解密都重新派生和展开密钥
+    static std::unique_ptr<AeadCipher> createCipher(const QString &key,
+                                                    AeadCipher::Algorithm algorithm = AeadCipher::preferredAlgorithm());
+
+    // 原地加密：envelope前ENVELOPE_HEADER_SIZE字节和末尾TAG_SIZE字节由调用方预留，
+    // 中间为明文；加密后envelope即为encryptData格式。不分配堆内存
+    static bool encryptInPlace(const AeadCipher &cipher, std::span<std::byte> envelope);
+
+    // 原地解密encryptData格式的数据，成功时返回envelope内的明文区间，失败时返回空区间
+    static std::span<std::byte> decryptInPlace(const AeadCipher &cipher, std::span<std::byte> envelope);
+
+    // 加密到调用方提供的缓冲区（至少为明文长度加ENVELOPE_OVERHEAD），返回写入的字节数，
+    // 缓冲区不足时返回-1
+    static qsizetype encryptTo(const AeadCipher &cipher, std::span<const std::byte> plaintext,
+                               std::span<std::byte> output);
+
+    // 解密到调用方提供的缓冲区（至少为密文长度减ENVELOPE_OVERHEAD），返回明文长度，
+    // 认证失败或缓冲区不足时返回-1
+    static qsizetype decryptTo(const AeadCipher &cipher, std::span<const std::byte> envelope,
+                               std::span<std::byte> output);
+
+    // HKDF-SHA256密钥派生（RFC 5869）
+    static QByteArray hkdfSha256(const QByteArray &inputKey, const QByteArray &salt,
+                                 const QByteArray &info, int length);
 
     // 验证密码强度
     static bool isStrongPassword(const QString &password);
@@ -37,29 +85,23 @@ public:
     static QString getPasswordStrength(const QString &password);
 
 private:
-    // 加密算法
-    static QByteArray encryptAES(const QByteArray &data, const QByteArray &key, const QByteArray &iv);
-
-    // 解密算法
-    static QByteArray decryptAES(const QByteArray &data, const QByteArray &key, const QByteArray &iv);
-
-    // 填充数据
-    static QByteArray padData(const QByteArray &data, int blockSize = 16);
+    // 读取或创建本地数据加密密钥
+    static QByteArray loadStorageKey();
 
-    // 移除填充
-    static QByteArray unpadData(const QByteArray &data);
+    // 存储密钥的路径（用户配置目录，不与数据文件放在一起）
+    static QString storageKeyPath();
 
-    // 辅助函数：XOR两个等长字节数组
-    static QByteArray xorBytes(const QByteArray &a, const QByteArray &b);
+    // 读取密钥文件，长度不对时返回空
+    static QByteArray readStorageKey(const QString &path);
 
-    // 辅助函数：AES单块加密（简化实现）
-    static QByteArray aesBlockEncrypt(const QByteArray &block, const QByteArray &key);
+    // 以仅所有者可读写的权限保存密钥文件
+    static bool writeStorageKey(const QString &path, const QByteArray &key);
 
-    // 辅助函数：AES单块解密（简化实现）
-    static QByteArray aesBlockDecrypt(const QByteArray &block, const QByteArray &key);
+    // 由字符串派生256位密钥
+    static QByteArray deriveKey(const QString &key);
 
-    // 辅助函数：将密钥标准化为256位（32字节）
-    static QByteArray normalizeKey(const QByteArray &key);
+    // 解析PBKDF2格式的密码哈希
+    static bool parsePasswordHash(const QByteArray &hash, int *iterations, QByteArray *salt, QByteArray *digest);
 };
 
 } // namespace LocalNetworkApp
@@ -0,0 +1,226 @@
+#include "x25519.h"
+#include "security_manager.h"
+
+namespace LocalNetworkApp {
+
+namespace {
+
+// GF(2^255 - 19)上的元素，16个16位分段（参考TweetNaCl）
+typedef qint64 FieldElement[16];
+
+const FieldElement A24 = {0xDB41, 1}; // (486662 - 2) / 4
+
+void carry(FieldElement o)
+{
+    for (int i = 0; i < 16; ++i) {
+        o[i] += (qint64(1) << 16);
+        qint64 c = o[i] >> 16;
+        o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+        o[i] -= c * (qint64(1) << 16);
+    }
+}
+
+// b为1时交换p和q（常数时间）
+void conditionalSwap(FieldElement p, FieldElement q, int b)
+{
+    qint64 mask = ~(qint64(b) - 1);
+    for (int i = 0; i < 16; ++i) {
+        qint64 t = mask & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+void pack(quint8 *out, const FieldElement n)
+{
+    FieldElement t;
+    FieldElement m;
+    for (int i = 0; i < 16; ++i) {
+        t[i] = n[i];
+    }
+    carry(t);
+    carry(t);
+    carry(t);
+
+    // 两次条件减去p，得到唯一表示
+    for (int j = 0; j < 2; ++j) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; ++i) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int b = int((m[15] >> 16) & 1);
+        m[14] &= 0xffff;
+        conditionalSwap(t, m, 1 - b);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        out[2 * i] = quint8(t[i] & 0xff);
+        out[2 * i + 1] = quint8(t[i] >> 8);
+    }
+}
+
+void unpack(FieldElement o, const quint8 *n)
+{
+    for (int i = 0; i < 16; ++i) {
+        o[i] = n[2 * i] + (qint64(n[2 * i + 1]) << 8);
+    }
+    o[15] &= 0x7fff;
+}
+
+void add(FieldElement o, const FieldElement a, const FieldElement b)
+{
+    for (int i = 0; i < 16; ++i) {
+        o[i] = a[i] + b[i];
+    }
+}
+
+void subtract(FieldElement o, const FieldElement a, const FieldElement b)
+{
+    for (int i = 0; i < 16; ++i) {
+        o[i] = a[i] - b[i];
+    }
+}
+
+void multiply(FieldElement o, const FieldElement a, const FieldElement b)
+{
+    qint64 t[31] = {0};
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            t[i + j] += a[i] * b[j];
+        }
+    }
+    // 2^256 = 38 (mod p)
+    for (int i = 0; i < 15; ++i) {
+        t[i] += 38 * t[i + 16];
+    }
+    for (int i = 0; i < 16; ++i) {
+        o[i] = t[i];
+    }
+    carry(o);
+    carry(o);
+}
+
+void square(FieldElement o, const FieldElement a)
+{
+    multiply(o, a, a);
+}
+
+// 求逆：a^(p-2)
+void invert(FieldElement o, const FieldElement a)
+{
+    FieldElement c;
+    for (int i = 0; i < 16; ++i) {
+        c[i] = a[i];
+    }
+    for (int i = 253; i >= 0; --i) {
+        square(c, c);
+        if (i != 2 && i != 4) {
+            multiply(c, c, a);
+        }
+    }
+    for (int i = 0; i < 16; ++i) {
+        o[i] = c[i];
+    }
+}
+
+// Montgomery阶梯计算标量乘法
+void scalarMultiply(quint8 *out, const quint8 *scalar, const quint8 *point)
+{
+    quint8 z[32];
+    for (int i = 0; i < 32; ++i) {
+        z[i] = scalar[i];
+    }
+    z[31] = (scalar[31] & 127) | 64;
+    z[0] &= 248;
+
+    FieldElement x;
+    FieldElement a, b, c, d, e, f;
+    unpack(x, point);
+    for (int i = 0; i < 16; ++i) {
+        b[i] = x[i];
+        a[i] = c[i] = d[i] = 0;
+    }
+    a[0] = d[0] = 1;
+
+    for (int i = 254; i >= 0; --i) {
+        int bit = (z[i >> 3] >> (i & 7)) & 1;
+        conditionalSwap(a, b, bit);
+        conditionalSwap(c, d, bit);
+        add(e, a, c);
+        subtract(a, a, c);
+        add(c, b, d);
+        subtract(b, b, d);
+        square(d, e);
+        square(f, a);
+        multiply(a, c, a);
+        multiply(c, b, e);
+        add(e, a, c);
+        subtract(a, a, c);
+        square(b, a);
+        subtract(c, d, f);
+        multiply(a, c, A24);
+        add(a, a, d);
+        multiply(c, c, a);
+        multiply(a, d, f);
+        multiply(d, b, x);
+        square(b, e);
+        conditionalSwap(a, b, bit);
+        conditionalSwap(c, d, bit);
+    }
+
+    invert(c, c);
+    multiply(a, a, c);
+    pack(out, a);
+
+    for (int i = 0; i < 32; ++i) {
+        z[i] = 0;
+    }
+}
+
+} // namespace
+
+QByteArray X25519::generatePrivateKey()
+{
+    return SecurityManager::generateRandomKey(KEY_SIZE);
+}
+
+QByteArray X25519::publicKey(const QByteArray &privateKey)
+{
+    if (privateKey.size() != KEY_SIZE) {
+        return QByteArray();
+    }
+
+    // 基点u = 9
+    quint8 basePoint[KEY_SIZE] = {9};
+    QByteArray result(KEY_SIZE, Qt::Uninitialized);
+    scalarMultiply(reinterpret_cast<quint8 *>(result.data()),
+                   reinterpret_cast<const quint8 *>(privateKey.constData()), basePoint);
+    return result;
+}
+
+QByteArray X25519::sharedSecret(const QByteArray &privateKey, const QByteArray &peerPublicKey)
+{
+    if (privateKey.size() != KEY_SIZE || peerPublicKey.size() != KEY_SIZE) {
+        return QByteArray();
+    }
+
+    QByteArray result(KEY_SIZE, Qt::Uninitialized);
+    scalarMultiply(reinterpret_cast<quint8 *>(result.data()),
+                   reinterpret_cast<const quint8 *>(privateKey.constData()),
+                   reinterpret_cast<const quint8 *>(peerPublicKey.constData()));
+
+    // 对方公钥为小阶点时结果全零，不能作为密钥
+    quint8 bits = 0;
+    for (char byte : std::as_const(result)) {
+        bits |= static_cast<quint8>(byte);
+    }
+    if (bits == 0) {
+        return QByteArray();
+    }
+
+    return result;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,31 @@
+#ifndef X25519_H
+#define X25519_H
+
+#include <QByteArray>
+
+namespace LocalNetworkApp {
+
+// X25519密钥协商（RFC 7748）
+//
+// 用于每个连接的临时密钥交换：双方各自生成私钥并交换公钥，
+// 用本方私钥和对方公钥计算出相同的共享密钥。
+class X25519 {
+public:
+    X25519() = delete;
+    ~X25519() = delete;
+
+    static const int KEY_SIZE = 32; // 私钥、公钥和共享密钥的长度
+
+    // 生成随机私钥
+    static QByteArray generatePrivateKey();
+
+    // 由私钥计算公钥
+    static QByteArray publicKey(const QByteArray &privateKey);
+
+    // 计算共享密钥；参数长度错误或对方公钥为小阶点（结果全零）时返回空
+    static QByteArray sharedSecret(const QByteArray &privateKey, const QByteArray &peerPublicKey);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // X25519_H
@@ -0,0 +1,319 @@
+#include "content_index.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QSet>
+#include <QDebug>
+#include "../utils/persistence_service.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+#ifdef Q_OS_MACOS
+#include <sys/clonefile.h>
+#endif
+
+namespace LocalNetworkApp {
+
+ContentIndex::ContentIndex(const QString &filePath) :
+    filePath(filePath)
+{
+    saveTimer.setSingleShot(true);
+    saveTimer.callOnTimeout([this]() { save(); });
+}
+
+ContentIndex::~ContentIndex()
+{
+    flush();
+}
+
+bool ContentIndex::load()
+{
+    entries.clear();
+    blockIndex.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        qWarning() << "内容索引格式无效，已忽略:" << filePath;
+        return false;
+    }
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        QByteArray manifestJson;
+        stream >> entry.path >> entry.size >> entry.modifiedMs >> entry.addedMs >> manifestJson;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        entry.manifest = FileManifest::fromJson(QJsonDocument::fromJson(manifestJson).object());
+        if (entry.manifest.isValid()) {
+            entries.insert(entry.manifest.getMerkleRoot(), entry);
+        }
+    }
+
+    rebuildBlockIndex();
+    return true;
+}
+
+void ContentIndex::addFile(const QString &path, const FileManifest &manifest)
+{
+    QFileInfo fileInfo(path);
+    if (!manifest.isValid() || !fileInfo.isFile() || fileInfo.size() != manifest.getFileSize()) {
+        return;
+    }
+
+    Entry entry;
+    entry.path = fileInfo.absoluteFilePath();
+    entry.size = fileInfo.size();
+    entry.modifiedMs = fileInfo.lastModified().toMSecsSinceEpoch();
+    entry.addedMs = QDateTime::currentMSecsSinceEpoch();
+    entry.manifest = manifest;
+
+    // 已有相同内容的有效文件时保留原条目，块索引不变
+    QByteArray root = manifest.getMerkleRoot();
+    auto existing = entries.constFind(root);
+    if (existing != entries.constEnd() && isUnchanged(existing.value())) {
+        return;
+    }
+
+    bool rebuild = existing != entries.constEnd();
+    entries.insert(root, entry);
+
+    // 超过上限时移除最早加入的文件
+    while (entries.size() > Constants::CONTENT_INDEX_MAX_FILES) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->addedMs < oldest->addedMs) {
+                oldest = it;
+            }
+        }
+        entries.erase(oldest);
+        rebuild = true;
+    }
+
+    if (rebuild) {
+        rebuildBlockIndex();
+    } else {
+        indexBlocks(entry);
+    }
+    scheduleSave();
+}
+
+QString ContentIndex::findFile(const FileManifest &manifest)
+{
+    auto it = entries.constFind(manifest.getMerkleRoot());
+    if (it == entries.constEnd()) {
+        return QString();
+    }
+
+    if (!isUnchanged(it.value())) {
+        removeStale({it.key()});
+        return QString();
+    }
+    return it->path;
+}
+
+QHash<qint64, LocalBlock> ContentIndex::findBlocks(const FileManifest &manifest)
+{
+    QHash<qint64, LocalBlock> blocks;
+    if (!manifest.isValid() || blockIndex.isEmpty()) {
+        return blocks;
+    }
+
+    for (qint64 i = 0; i < manifest.getBlockCount(); ++i) {
+        auto it = blockIndex.constFind(manifest.getBlockChecksum(i));
+        if (it != blockIndex.constEnd()) {
+            blocks.insert(i, it.value());
+        }
+    }
+
+    // 每个来源文件只检查一次是否被修改
+    QSet<QString> checkedPaths;
+    QList<QByteArray> staleRoots;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (!isUnchanged(it.value())) {
+            staleRoots.append(it.key());
+        } else {
+            checkedPaths.insert(it->path);
+        }
+    }
+
+    if (removeStale(staleRoots) > 0) {
+        for (auto it = blocks.begin(); it != blocks.end();) {
+            if (!checkedPaths.contains(it->filePath)) {
+                it = blocks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return blocks;
+}
+
+int ContentIndex::count() const
+{
+    return entries.size();
+}
+
+void ContentIndex::clear()
+{
+    entries.clear();
+    blockIndex.clear();
+    save();
+}
+
+void ContentIndex::flush()
+{
+    if (dirty) {
+        save();
+    }
+}
+
+bool ContentIndex::cloneFile(const QString &source, const QString &target, bool allowHardLink)
+{
+    QFileInfo sourceInfo(source);
+    if (!sourceInfo.isFile()) {
+        return false;
+    }
+
+    // 目标就是源文件本身
+    QFileInfo targetInfo(target);
+    if (targetInfo.exists() && targetInfo.canonicalFilePath() == sourceInfo.canonicalFilePath()) {
+        return true;
+    }
+
+    QDir().mkpath(targetInfo.absolutePath());
+    QFile::remove(target);
+
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    // 写时复制：两个文件共享磁盘数据，修改任一文件都不影响另一个
+    {
+        QFile input(source);
+        QFile output(target);
+        if (input.open(QIODevice::ReadOnly) && output.open(QIODevice::WriteOnly)) {
+            if (::ioctl(output.handle(), FICLONE, input.handle()) == 0) {
+                return true;
+            }
+            output.close();
+            QFile::remove(target);
+        }
+    }
+#elif defined(Q_OS_MACOS)
+    if (::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(target).constData(), 0) == 0) {
+        return true;
+    }
+#endif
+
+    // 硬链接共享同一份数据，修改会互相影响，只在调用方允许时使用
+    if (allowHardLink) {
+#ifdef Q_OS_WIN
+        QString nativeSource = QDir::toNativeSeparators(sourceInfo.absoluteFilePath());
+        QString nativeTarget = QDir::toNativeSeparators(targetInfo.absoluteFilePath());
+        if (CreateHardLinkW(reinterpret_cast<LPCWSTR>(nativeTarget.utf16()),
+                            reinterpret_cast<LPCWSTR>(nativeSource.utf16()), nullptr)) {
+            return true;
+        }
+#else
+        if (::link(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0) {
+            return true;
+        }
+#endif
+    }
+
+    return QFile::copy(source, target);
+}
+
+bool ContentIndex::isUnchanged(const Entry &entry)
+{
+    QFileInfo fileInfo(entry.path);
+    return fileInfo.isFile() && fileInfo.size() == entry.size &&
+           fileInfo.lastModified().toMSecsSinceEpoch() == entry.modifiedMs;
+}
+
+void ContentIndex::indexBlocks(const Entry &entry)
+{
+    const FileManifest &manifest = entry.manifest;
+    for (qint64 i = 0; i < manifest.getBlockCount(); ++i) {
+        if (blockIndex.size() >= Constants::CONTENT_INDEX_MAX_BLOCKS) {
+            return;
+        }
+        blockIndex.insert(manifest.getBlockChecksum(i), LocalBlock{entry.path, i * manifest.getBlockSize()});
+    }
+}
+
+int ContentIndex::removeStale(const QList<QByteArray> &roots)
+{
+    int removed = 0;
+    for (const QByteArray &root : roots) {
+        removed += entries.remove(root);
+    }
+
+    if (removed > 0) {
+        rebuildBlockIndex();
+        scheduleSave();
+    }
+    return removed;
+}
+
+void ContentIndex::rebuildBlockIndex()
+{
+    blockIndex.clear();
+    for (const Entry &entry : std::as_const(entries)) {
+        indexBlocks(entry);
+    }
+}
+
+void ContentIndex::scheduleSave()
+{
+    dirty = true;
+    if (!saveTimer.isActive()) {
+        saveTimer.start(Constants::CONTENT_INDEX_SAVE_DELAY_MS);
+    }
+}
+
+void ContentIndex::save()
+{
+    saveTimer.stop();
+    dirty = false;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << INDEX_MAGIC << INDEX_VERSION << static_cast<quint32>(entries.size());
+
+    for (const Entry &entry : entries) {
+        stream << entry.path << entry.size << entry.modifiedMs << entry.addedMs
+               << QJsonDocument(entry.manifest.toJson()).toJson(QJsonDocument::Compact);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "无法写入内容索引:" << filePath;
+        return;
+    }
+
+    // 由后台线程原子替换索引文件
+    PersistenceService::instance()->writeFile(filePath, data);
+}
+
+} // namespace LocalNetworkApp
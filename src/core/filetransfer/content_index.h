@@ -0,0 +1,94 @@
+#ifndef CONTENT_INDEX_H
+#define CONTENT_INDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+#include <QTimer>
+#include "file_manifest.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 本地已有数据块的位置
+struct LocalBlock {
+    QString filePath;  // 所在文件
+    qint64 offset = 0; // 文件内偏移
+};
+
+// 已接收文件的内容索引
+//
+// 以文件清单的Merkle根为键记录已完整接收并校验过的文件，同时按每块的XXH64
+// 建立块索引。收到内容相同的传输请求时直接从本地文件生成目标文件；内容部分相同时
+// 只需从发送方接收缺少的块。文件大小或修改时间变化的条目视为失效并移除，
+// 从本地读出的块仍按清单校验，最终由Merkle根确认整个文件。
+class ContentIndex {
+public:
+    ContentIndex(const QString &filePath = Constants::CONTENT_INDEX_FILE);
+    ~ContentIndex();
+
+    // 加载索引
+    bool load();
+
+    // 记录一个已完整接收并校验的文件
+    void addFile(const QString &path, const FileManifest &manifest);
+
+    // 查找内容相同且未被修改的本地文件，没有时返回空字符串
+    QString findFile(const FileManifest &manifest);
+
+    // 查找清单中可以从本地文件读取的块（块下标 -> 位置）
+    QHash<qint64, LocalBlock> findBlocks(const FileManifest &manifest);
+
+    // 已索引的文件数
+    int count() const;
+
+    // 清空索引
+    void clear();
+
+    // 立即写入尚未保存的变化
+    void flush();
+
+    // 用本地文件生成目标文件：优先写时复制（reflink），允许时使用硬链接，否则复制
+    static bool cloneFile(const QString &source, const QString &target, bool allowHardLink = false);
+
+private:
+    struct Entry {
+        QString path;          // 本地文件路径
+        qint64 size = 0;       // 记录时的文件大小
+        qint64 modifiedMs = 0; // 记录时的修改时间
+        qint64 addedMs = 0;    // 加入索引的时间
+        FileManifest manifest; // 文件清单
+    };
+
+    QString filePath;                      // 索引文件路径
+    QHash<QByteArray, Entry> entries;      // Merkle根 -> 文件
+    QHash<quint64, LocalBlock> blockIndex; // XXH64 -> 块位置
+    QTimer saveTimer;                      // 延迟保存定时器（连续的变化合并为一次写入）
+    bool dirty = false;                    // 是否有尚未保存的变化
+
+    static const quint32 INDEX_MAGIC = 0x4C4E4349; // "LNCI"
+    static const quint16 INDEX_VERSION = 1;
+
+    // 文件是否仍与记录时一致
+    static bool isUnchanged(const Entry &entry);
+
+    // 把文件的块加入块索引（达到上限后不再加入）
+    void indexBlocks(const Entry &entry);
+
+    // 移除失效的文件，返回移除的个数
+    int removeStale(const QList<QByteArray> &roots);
+
+    // 重建块索引
+    void rebuildBlockIndex();
+
+    // 标记索引已变化，延迟写入
+    void scheduleSave();
+
+    // 写入索引文件
+    void save();
+};
+
+} // namespace LocalNetworkApp
+
+#endif // CONTENT_INDEX_H
@@ -0,0 +1,447 @@
+#include "delta_sync.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cmath>
+#include "../utils/xxhash64.h"
+
+namespace LocalNetworkApp {
+
+namespace {
+
+// 指令格式：复制 = 1 | 起始块(u64) | 块数(u32)，字面量 = 2 | 长度(u32) | 数据，整数均为大端
+constexpr char OP_COPY = 1;
+constexpr char OP_LITERAL = 2;
+constexpr int COPY_SIZE = 1 + 8 + 4;
+constexpr int LITERAL_HEADER_SIZE = 1 + 4;
+
+} // namespace
+
+void RollingChecksum::reset(const char *data, qsizetype length)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data);
+    a = 0;
+    b = 0;
+    this->length = static_cast<quint32>(length);
+    for (qsizetype i = 0; i < length; ++i) {
+        a += p[i];
+        b += static_cast<quint32>(length - i) * p[i];
+    }
+    a &= 0xffff;
+    b &= 0xffff;
+}
+
+void RollingChecksum::roll(uchar out, uchar in)
+{
+    a = (a - out + in) & 0xffff;
+    b = (b - length * out + a) & 0xffff;
+}
+
+DeltaSignature DeltaSignature::fromFile(const QString &filePath, bool *ok)
+{
+    DeltaSignature signature;
+    if (ok) {
+        *ok = false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取基准文件:" << filePath;
+        return signature;
+    }
+
+    signature.fileSize = file.size();
+    signature.blockSize = blockSizeFor(signature.fileSize);
+    qint64 blockCount = (signature.fileSize + signature.blockSize - 1) / signature.blockSize;
+    signature.weak.reserve(blockCount);
+    signature.strong.reserve(blockCount);
+
+    // 每次读取多个块，减少系统调用
+    const qint64 chunkBlocks = qMax<qint64>(1, Constants::DELTA_READ_SIZE / signature.blockSize);
+    QByteArray chunk(chunkBlocks * signature.blockSize, Qt::Uninitialized);
+    qint64 remaining = signature.fileSize;
+    RollingChecksum checksum;
+
+    while (remaining > 0) {
+        qint64 wanted = qMin<qint64>(chunk.size(), remaining);
+        if (file.read(chunk.data(), wanted) != wanted) {
+            qWarning() << "读取基准文件失败:" << filePath << file.errorString();
+            return DeltaSignature();
+        }
+
+        for (qint64 offset = 0; offset < wanted; offset += signature.blockSize) {
+            qint64 length = qMin<qint64>(signature.blockSize, wanted - offset);
+            const char *block = chunk.constData() + offset;
+            checksum.reset(block, length);
+            signature.weak.append(checksum.value());
+            signature.strong.append(XxHash64::hash(block, length));
+        }
+        remaining -= wanted;
+    }
+
+    if (ok) {
+        *ok = true;
+    }
+    return signature;
+}
+
+int DeltaSignature::blockSizeFor(qint64 fileSize)
+{
+    // 块越小匹配越精细，但签名越大；取平方根使两者平衡，并按1KB对齐
+    qint64 size = static_cast<qint64>(std::sqrt(static_cast<double>(fileSize)));
+    size = (size + 1023) / 1024 * 1024;
+    return static_cast<int>(qBound<qint64>(Constants::DELTA_MIN_BLOCK_SIZE, size, Constants::DELTA_MAX_BLOCK_SIZE));
+}
+
+DeltaSignature DeltaSignature::fromJson(const QJsonObject &json)
+{
+    DeltaSignature signature;
+    signature.fileSize = json["fileSize"].toInteger();
+    signature.blockSize = json["blockSize"].toInt();
+
+    // 每块依次为小端的弱校验和(4字节)和强校验和(8字节)
+    QByteArray packed = QByteArray::fromBase64(json["sums"].toString().toLatin1());
+    signature.weak.reserve(packed.size() / 12);
+    signature.strong.reserve(packed.size() / 12);
+    for (qsizetype i = 0; i + 12 <= packed.size(); i += 12) {
+        signature.weak.append(qFromLittleEndian<quint32>(packed.constData() + i));
+        signature.strong.append(qFromLittleEndian<quint64>(packed.constData() + i + 4));
+    }
+
+    if (!signature.isValid()) {
+        return DeltaSignature();
+    }
+    return signature;
+}
+
+QJsonObject DeltaSignature::toJson() const
+{
+    QByteArray packed(weak.size() * 12, Qt::Uninitialized);
+    for (qsizetype i = 0; i < weak.size(); ++i) {
+        qToLittleEndian<quint32>(weak.at(i), packed.data() + i * 12);
+        qToLittleEndian<quint64>(strong.at(i), packed.data() + i * 12 + 4);
+    }
+
+    QJsonObject json;
+    json["fileSize"] = fileSize;
+    json["blockSize"] = blockSize;
+    json["sums"] = QString::fromLatin1(packed.toBase64());
+    return json;
+}
+
+bool DeltaSignature::isValid() const
+{
+    return blockSize >= Constants::DELTA_MIN_BLOCK_SIZE && blockSize <= Constants::DELTA_MAX_BLOCK_SIZE &&
+           fileSize > 0 && weak.size() == strong.size() &&
+           weak.size() == (fileSize + blockSize - 1) / blockSize;
+}
+
+qint64 DeltaSignature::getFileSize() const
+{
+    return fileSize;
+}
+
+int DeltaSignature::getBlockSize() const
+{
+    return blockSize;
+}
+
+qint64 DeltaSignature::getBlockCount() const
+{
+    return weak.size();
+}
+
+qint64 DeltaSignature::blockLength(qint64 blockIndex) const
+{
+    if (blockIndex < 0 || blockIndex >= weak.size()) {
+        return -1;
+    }
+    return qMin<qint64>(blockSize, fileSize - blockIndex * blockSize);
+}
+
+quint32 DeltaSignature::weakChecksum(qint64 blockIndex) const
+{
+    return weak.value(blockIndex);
+}
+
+quint64 DeltaSignature::strongChecksum(qint64 blockIndex) const
+{
+    return strong.value(blockIndex);
+}
+
+DeltaEncoder::DeltaEncoder(const DeltaSignature &signature) :
+    signature(signature),
+    weakFilter(1 << 16)
+{
+    // 只索引完整的块；较短的最后一块在文件末尾单独比较
+    qint64 fullBlocks = signature.getFileSize() / qMax(1, signature.getBlockSize());
+    weakIndex.reserve(fullBlocks);
+    for (qint64 i = 0; i < fullBlocks; ++i) {
+        quint32 weakSum = signature.weakChecksum(i);
+        weakIndex.insert(weakSum, i);
+        weakFilter.setBit(filterKey(weakSum));
+    }
+}
+
+bool DeltaEncoder::open(const QString &filePath)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开文件进行增量编码:" << filePath << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool DeltaEncoder::nextChunk(QByteArray *chunk, int maxBytes)
+{
+    chunk->clear();
+    const qsizetype blockSize = signature.getBlockSize();
+
+    // 大段匹配的输出很短，同时限制每段读取的输入量，避免长时间阻塞
+    const qint64 inputLimit = position() + Constants::DELTA_CHUNK_MAX_INPUT;
+
+    while (!finished && chunk->size() < maxBytes && bufferOffset + pos < inputLimit) {
+        if (!fill(blockSize)) {
+            return false;
+        }
+
+        qsizetype available = buffer.size() - pos;
+        if (available < blockSize) {
+            // 文件末尾不足一块：与基准文件较短的最后一块相同时复制，否则作为字面量
+            qint64 lastBlock = signature.getBlockCount() - 1;
+            if (available > 0 && available == signature.blockLength(lastBlock) &&
+                available < blockSize &&
+                findBlock(buffer.constData() + pos, available, 0) == lastBlock) {
+                flushLiteral(chunk);
+                addCopy(lastBlock, chunk);
+                matched += available;
+                pos += available;
+                literalStart = pos;
+            }
+            pos = buffer.size();
+            finished = true;
+            break;
+        }
+
+        const char *window = buffer.constData() + pos;
+        if (!rollingValid) {
+            rolling.reset(window, blockSize);
+            rollingValid = true;
+        }
+
+        qint64 blockIndex = findBlock(window, blockSize, rolling.value());
+        if (blockIndex >= 0) {
+            flushLiteral(chunk);
+            addCopy(blockIndex, chunk);
+            matched += blockSize;
+            pos += blockSize;
+            literalStart = pos;
+            rollingValid = false;
+            continue;
+        }
+
+        // 没有匹配，窗口后移一个字节
+        if (pos + blockSize < buffer.size()) {
+            rolling.roll(static_cast<uchar>(buffer.at(pos)), static_cast<uchar>(buffer.at(pos + blockSize)));
+        } else {
+            rollingValid = false;
+        }
+        pos++;
+
+        if (pos - literalStart >= maxBytes) {
+            flushLiteral(chunk);
+        }
+    }
+
+    // 每段输出都是完整的指令序列
+    flushLiteral(chunk);
+    flushCopy(chunk);
+    return true;
+}
+
+bool DeltaEncoder::atEnd() const
+{
+    return finished;
+}
+
+qint64 DeltaEncoder::position() const
+{
+    return bufferOffset + literalStart;
+}
+
+qint64 DeltaEncoder::matchedBytes() const
+{
+    return matched;
+}
+
+bool DeltaEncoder::fill(qsizetype needed)
+{
+    while (!eof && buffer.size() - pos < needed) {
+        // 丢弃已输出的数据
+        if (literalStart > 0) {
+            buffer.remove(0, literalStart);
+            bufferOffset += literalStart;
+            pos -= literalStart;
+            literalStart = 0;
+        }
+
+        qsizetype oldSize = buffer.size();
+        buffer.resize(oldSize + Constants::DELTA_READ_SIZE);
+        qint64 read = file.read(buffer.data() + oldSize, Constants::DELTA_READ_SIZE);
+        if (read < 0) {
+            qWarning() << "增量编码读取文件失败:" << file.fileName() << file.errorString();
+            buffer.resize(oldSize);
+            return false;
+        }
+        buffer.resize(oldSize + read);
+        if (read == 0) {
+            eof = true;
+        }
+    }
+    return true;
+}
+
+qint64 DeltaEncoder::findBlock(const char *data, qsizetype length, quint32 weakSum) const
+{
+    // 较短的最后一块不在弱校验和索引中，只比较强校验和
+    if (length < signature.getBlockSize()) {
+        qint64 lastBlock = signature.getBlockCount() - 1;
+        return XxHash64::hash(data, length) == signature.strongChecksum(lastBlock) ? lastBlock : -1;
+    }
+
+    if (!weakFilter.testBit(filterKey(weakSum))) {
+        return -1;
+    }
+
+    quint64 strongSum = 0;
+    bool strongComputed = false;
+    auto range = weakIndex.equal_range(weakSum);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (!strongComputed) {
+            strongSum = XxHash64::hash(data, length);
+            strongComputed = true;
+        }
+        if (signature.strongChecksum(it.value()) == strongSum) {
+            return it.value();
+        }
+    }
+    return -1;
+}
+
+void DeltaEncoder::addCopy(qint64 blockIndex, QByteArray *chunk)
+{
+    if (copyCount > 0 && copyStart + copyCount == blockIndex && copyCount < 0xffffffff) {
+        copyCount++;
+        return;
+    }
+
+    flushCopy(chunk);
+    copyStart = blockIndex;
+    copyCount = 1;
+}
+
+void DeltaEncoder::flushCopy(QByteArray *chunk)
+{
+    if (copyCount == 0) {
+        return;
+    }
+
+    char op[COPY_SIZE];
+    op[0] = OP_COPY;
+    qToBigEndian<quint64>(copyStart, op + 1);
+    qToBigEndian<quint32>(static_cast<quint32>(copyCount), op + 9);
+    chunk->append(op, sizeof(op));
+    copyCount = 0;
+}
+
+void DeltaEncoder::flushLiteral(QByteArray *chunk)
+{
+    qsizetype length = pos - literalStart;
+    if (length <= 0) {
+        return;
+    }
+
+    // 字面量在前面的复制之后
+    flushCopy(chunk);
+
+    char header[LITERAL_HEADER_SIZE];
+    header[0] = OP_LITERAL;
+    qToBigEndian<quint32>(static_cast<quint32>(length), header + 1);
+    chunk->append(header, sizeof(header));
+    chunk->append(buffer.constData() + literalStart, length);
+    literalStart = pos;
+}
+
+QByteArray DeltaEncoder::literalChunk(const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(LITERAL_HEADER_SIZE + data.size());
+    char header[LITERAL_HEADER_SIZE];
+    header[0] = OP_LITERAL;
+    qToBigEndian<quint32>(static_cast<quint32>(data.size()), header + 1);
+    chunk.append(header, sizeof(header));
+    chunk.append(data);
+    return chunk;
+}
+
+bool DeltaDecoder::open(const QString &basisPath, int blockSize)
+{
+    this->blockSize = blockSize;
+    basis.setFileName(basisPath);
+    if (blockSize <= 0 || !basis.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开基准文件:" << basisPath << basis.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool DeltaDecoder::apply(const QByteArray &chunk, qint64 limit, QByteArray *output)
+{
+    if (!basis.isOpen()) {
+        return false;
+    }
+
+    // 先按长度检查，再为还原的数据分配内存
+    const qsizetype startSize = output->size();
+    const char *p = chunk.constData();
+    const char *end = p + chunk.size();
+    while (p < end) {
+        if (*p == OP_COPY && end - p >= COPY_SIZE) {
+            quint64 start = qFromBigEndian<quint64>(p + 1);
+            quint32 count = qFromBigEndian<quint32>(p + 9);
+            p += COPY_SIZE;
+
+            // 复制范围必须在基准文件之内
+            qint64 basisBlocks = (basis.size() + blockSize - 1) / blockSize;
+            if (count == 0 || start >= static_cast<quint64>(basisBlocks) ||
+                count > static_cast<quint64>(basisBlocks) - start) {
+                return false;
+            }
+
+            qint64 offset = static_cast<qint64>(start) * blockSize;
+            qint64 length = qMin<qint64>(static_cast<qint64>(count) * blockSize, basis.size() - offset);
+            qsizetype oldSize = output->size();
+            if (length > limit - (oldSize - startSize)) {
+                return false;
+            }
+            output->resize(oldSize + length);
+            if (!basis.seek(offset) || basis.read(output->data() + oldSize, length) != length) {
+                output->resize(oldSize);
+                return false;
+            }
+        } else if (*p == OP_LITERAL && end - p >= LITERAL_HEADER_SIZE) {
+            quint32 length = qFromBigEndian<quint32>(p + 1);
+            p += LITERAL_HEADER_SIZE;
+            if (length > static_cast<quint64>(end - p) || length > limit - (output->size() - startSize)) {
+                return false;
+            }
+            output->append(p, length);
+            p += length;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,169 @@
+#ifndef DELTA_SYNC_H
+#define DELTA_SYNC_H
+
+#include <QByteArray>
+#include <QBitArray>
+#include <QFile>
+#include <QList>
+#include <QMultiHash>
+#include <QString>
+#include <QJsonObject>
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// rsync的滚动校验和
+//
+// 窗口后移一个字节只需常数次运算，发送方借此在每个字节偏移上查找接收方已有的块。
+class RollingChecksum {
+public:
+    // 计算窗口的校验和
+    void reset(const char *data, qsizetype length);
+
+    // 窗口后移一个字节：移出out，移入in
+    void roll(uchar out, uchar in);
+
+    // 当前校验和
+    quint32 value() const { return (a & 0xffff) | (b << 16); }
+
+private:
+    quint32 a = 0;        // 字节和
+    quint32 b = 0;        // 加权字节和
+    quint32 length = 0;   // 窗口长度
+};
+
+// 基准文件的块签名
+//
+// 接收方把已有的旧版本文件按固定大小分块，为每块计算弱校验和（滚动校验和）
+// 和强校验和（XXH64），随传输响应发给发送方。
+class DeltaSignature {
+public:
+    DeltaSignature() = default;
+    ~DeltaSignature() = default;
+
+    // 读取基准文件生成签名；ok返回是否成功
+    static DeltaSignature fromFile(const QString &filePath, bool *ok = nullptr);
+
+    // 按文件大小选择块大小（约为文件大小的平方根）
+    static int blockSizeFor(qint64 fileSize);
+
+    // 从JSON格式创建
+    static DeltaSignature fromJson(const QJsonObject &json);
+
+    // 转换为JSON格式
+    QJsonObject toJson() const;
+
+    // 是否包含有效的签名
+    bool isValid() const;
+
+    // 基准文件大小
+    qint64 getFileSize() const;
+
+    // 块大小
+    int getBlockSize() const;
+
+    // 块数
+    qint64 getBlockCount() const;
+
+    // 块的长度（最后一块可能较短）
+    qint64 blockLength(qint64 blockIndex) const;
+
+    // 块的弱校验和
+    quint32 weakChecksum(qint64 blockIndex) const;
+
+    // 块的强校验和
+    quint64 strongChecksum(qint64 blockIndex) const;
+
+private:
+    qint64 fileSize = 0;   // 基准文件大小
+    int blockSize = 0;     // 块大小
+    QList<quint32> weak;   // 每块的滚动校验和
+    QList<quint64> strong; // 每块的XXH64
+};
+
+// 增量编码器（发送方使用）
+//
+// 用滚动校验和在新文件的每个字节偏移上查找接收方已有的块，弱校验和命中后再比较
+// 强校验和。输出由复制指令（连续的基准块）和字面量（新数据）组成，每段输出都是
+// 完整的指令序列，可以作为一个数据块单独发送。
+class DeltaEncoder {
+public:
+    explicit DeltaEncoder(const DeltaSignature &signature);
+    ~DeltaEncoder() = default;
+
+    // 打开要发送的新文件
+    bool open(const QString &filePath);
+
+    // 编码下一段，输出约maxBytes字节的指令；读取失败时返回false
+    bool nextChunk(QByteArray *chunk, int maxBytes = Constants::DELTA_CHUNK_SIZE);
+
+    // 是否已编码完整个文件
+    bool atEnd() const;
+
+    // 已编码的新文件字节数
+    qint64 position() const;
+
+    // 通过复制指令传输的字节数
+    qint64 matchedBytes() const;
+
+    // 把一段原始数据编码为只含字面量的指令（无法打开编码器时仍按接收方期望的增量格式发送）
+    static QByteArray literalChunk(const QByteArray &data);
+
+private:
+    DeltaSignature signature;             // 接收方的块签名
+    QMultiHash<quint32, qint64> weakIndex; // 弱校验和 -> 块下标
+    QBitArray weakFilter;                 // 弱校验和的16位摘要，快速排除不存在的校验和
+    QFile file;                           // 新文件
+    QByteArray buffer;                    // 已读入的文件数据
+    qint64 bufferOffset = 0;              // buffer起点在文件中的位置
+    qsizetype pos = 0;                    // 当前窗口起点（buffer下标）
+    qsizetype literalStart = 0;           // 尚未输出的字面量起点（buffer下标）
+    bool eof = false;                     // 文件已读完
+    bool finished = false;                // 已编码完整个文件
+    RollingChecksum rolling;              // 当前窗口的滚动校验和
+    bool rollingValid = false;            // 滚动校验和是否对应当前窗口
+    qint64 copyStart = 0;                 // 待输出的连续复制起始块
+    qint64 copyCount = 0;                 // 待输出的连续复制块数
+    qint64 matched = 0;                   // 复制指令覆盖的字节数
+
+    // 保证窗口后至少有needed字节（文件末尾除外）
+    bool fill(qsizetype needed);
+
+    // 查找与窗口内容相同的块，没有时返回-1
+    qint64 findBlock(const char *data, qsizetype length, quint32 weakSum) const;
+
+    // 记录一个匹配的块，与前一个连续时合并
+    void addCopy(qint64 blockIndex, QByteArray *chunk);
+
+    // 输出待定的复制指令
+    void flushCopy(QByteArray *chunk);
+
+    // 输出待定的字面量
+    void flushLiteral(QByteArray *chunk);
+
+    // 16位摘要
+    static uint filterKey(quint32 weakSum) { return (weakSum ^ (weakSum >> 16)) & 0xffff; }
+};
+
+// 增量解码器（接收方使用）
+//
+// 按指令从基准文件复制块或取出字面量，还原新文件的数据。
+class DeltaDecoder {
+public:
+    DeltaDecoder() = default;
+    ~DeltaDecoder() = default;
+
+    // 打开基准文件
+    bool open(const QString &basisPath, int blockSize);
+
+    // 解码一段指令，还原的数据追加到output；指令无效或还原的数据超过limit字节时返回false
+    bool apply(const QByteArray &chunk, qint64 limit, QByteArray *output);
+
+private:
+    QFile basis;        // 基准文件
+    int blockSize = 0;  // 签名的块大小
+};
+
+} // namespace LocalNetworkApp
+
+#endif // DELTA_SYNC_H
@@ -0,0 +1,185 @@
+#include "file_manifest.h"
+#include <QCryptographicHash>
+#include <QtEndian>
+#include "../utils/xxhash64.h"
+#include "../data/file_hasher.h"
+
+namespace LocalNetworkApp {
+
+void MerkleTreeBuilder::addLeaf(const QByteArray &leafHash)
+{
+    // 与二进制计数器进位相同：高度相同的相邻子树立即合并
+    Node node{0, leafHash};
+    while (!pending.isEmpty() && pending.last().level == node.level) {
+        Node left = pending.takeLast();
+        node.hash = nodeHash(left.hash, node.hash);
+        node.level++;
+    }
+    pending.append(node);
+    leaves++;
+}
+
+qint64 MerkleTreeBuilder::leafCount() const
+{
+    return leaves;
+}
+
+QByteArray MerkleTreeBuilder::root() const
+{
+    if (pending.isEmpty()) {
+        return QCryptographicHash::hash(QByteArray(), QCryptographicHash::Sha256);
+    }
+
+    // 从右向左合并剩余的子树
+    QByteArray hash = pending.last().hash;
+    for (qsizetype i = pending.size() - 2; i >= 0; --i) {
+        hash = nodeHash(pending.at(i).hash, hash);
+    }
+    return hash;
+}
+
+QByteArray MerkleTreeBuilder::leafHash(const char *data, qsizetype length)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArrayView("\x00", 1));
+    hash.addData(QByteArrayView(data, length));
+    return hash.result();
+}
+
+QByteArray MerkleTreeBuilder::nodeHash(const QByteArray &left, const QByteArray &right)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArrayView("\x01", 1));
+    hash.addData(left);
+    hash.addData(right);
+    return hash.result();
+}
+
+FileManifest FileManifest::fromBlockHashes(const FileBlockHashes &blocks)
+{
+    FileManifest manifest;
+    if (blocks.blockSize <= 0 || blocks.leafHashes.size() != blocks.checksums.size() * 32) {
+        return manifest;
+    }
+
+    manifest.fileSize = blocks.fileSize;
+    manifest.blockSize = blocks.blockSize;
+    manifest.checksums = blocks.checksums;
+
+    MerkleTreeBuilder tree;
+    for (qsizetype offset = 0; offset < blocks.leafHashes.size(); offset += 32) {
+        tree.addLeaf(blocks.leafHashes.mid(offset, 32));
+    }
+    manifest.merkleRoot = tree.root();
+
+    if (!manifest.isValid()) {
+        return FileManifest();
+    }
+    return manifest;
+}
+
+FileManifest FileManifest::fromJson(const QJsonObject &json)
+{
+    FileManifest manifest;
+    manifest.fileSize = json["fileSize"].toVariant().toLongLong();
+    manifest.blockSize = json["blockSize"].toInt();
+    manifest.merkleRoot = QByteArray::fromHex(json["merkleRoot"].toString().toLatin1());
+
+    // 校验和按小端8字节连续存放
+    QByteArray packed = QByteArray::fromBase64(json["checksums"].toString().toLatin1());
+    manifest.checksums.reserve(packed.size() / 8);
+    for (qsizetype i = 0; i + 8 <= packed.size(); i += 8) {
+        manifest.checksums.append(qFromLittleEndian<quint64>(packed.constData() + i));
+    }
+
+    if (!manifest.isValid()) {
+        return FileManifest();
+    }
+    return manifest;
+}
+
+QJsonObject FileManifest::toJson() const
+{
+    QByteArray packed(checksums.size() * 8, Qt::Uninitialized);
+    for (qsizetype i = 0; i < checksums.size(); ++i) {
+        qToLittleEndian<quint64>(checksums.at(i), packed.data() + i * 8);
+    }
+
+    QJsonObject json;
+    json["fileSize"] = fileSize;
+    json["blockSize"] = blockSize;
+    json["merkleRoot"] = QString::fromLatin1(merkleRoot.toHex());
+    json["checksums"] = QString::fromLatin1(packed.toBase64());
+    return json;
+}
+
+bool FileManifest::isValid() const
+{
+    return blockSize > 0 && blockSize % Constants::FILE_BLOCK_SIZE == 0 && fileSize >= 0 &&
+           merkleRoot.size() == 32 &&
+           checksums.size() == (fileSize + blockSize - 1) / blockSize;
+}
+
+qint64 FileManifest::getFileSize() const
+{
+    return fileSize;
+}
+
+int FileManifest::getBlockSize() const
+{
+    return blockSize;
+}
+
+qint64 FileManifest::getBlockCount() const
+{
+    return checksums.size();
+}
+
+int FileManifest::getTransferBlocksPerBlock() const
+{
+    return blockSize / Constants::FILE_BLOCK_SIZE;
+}
+
+QBitArray FileManifest::toTransferBlocks(const QBitArray &blocks) const
+{
+    if (blocks.isEmpty() || !isValid()) {
+        return QBitArray();
+    }
+
+    QBitArray transferBlocks((fileSize + Constants::FILE_BLOCK_SIZE - 1) / Constants::FILE_BLOCK_SIZE);
+    qint64 perBlock = getTransferBlocksPerBlock();
+    for (qint64 i = 0; i < qMin<qint64>(blocks.size(), getBlockCount()); ++i) {
+        if (blocks.testBit(i)) {
+            transferBlocks.fill(true, i * perBlock, qMin<qint64>((i + 1) * perBlock, transferBlocks.size()));
+        }
+    }
+    return transferBlocks;
+}
+
+QByteArray FileManifest::getMerkleRoot() const
+{
+    return merkleRoot;
+}
+
+quint64 FileManifest::getBlockChecksum(qint64 blockIndex) const
+{
+    return checksums.value(blockIndex);
+}
+
+qint64 FileManifest::expectedBlockLength(qint64 blockIndex) const
+{
+    if (blockIndex < 0 || blockIndex >= checksums.size()) {
+        return -1;
+    }
+    return qMin<qint64>(blockSize, fileSize - blockIndex * blockSize);
+}
+
+bool FileManifest::verifyBlock(qint64 blockIndex, const QByteArray &data) const
+{
+    if (data.size() != expectedBlockLength(blockIndex)) {
+        return false;
+    }
+    return XxHash64::hash(data.constData(), data.size()) == checksums.at(blockIndex);
+}
+
+} // namespace LocalNetworkApp
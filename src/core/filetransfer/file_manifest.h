@@ -0,0 +1,107 @@
+#ifndef FILE_MANIFEST_H
+#define FILE_MANIFEST_H
+
+#include <QByteArray>
+#include <QBitArray>
+#include <QList>
+#include <QString>
+#include <QJsonObject>
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+struct FileBlockHashes;
+
+// 增量构建Merkle树（RFC 6962的树形）
+//
+// 叶子按顺序加入，只保留每层尚未配对的节点，内存占用为O(log n)。
+// 叶子哈希为SHA-256(0x00 | 块数据)，内部节点为SHA-256(0x01 | 左 | 右)。
+class MerkleTreeBuilder {
+public:
+    MerkleTreeBuilder() = default;
+
+    // 加入下一个块的叶子哈希
+    void addLeaf(const QByteArray &leafHash);
+
+    // 已加入的叶子数
+    qint64 leafCount() const;
+
+    // 计算根哈希（没有叶子时为空数据的SHA-256）
+    QByteArray root() const;
+
+    // 计算块数据的叶子哈希
+    static QByteArray leafHash(const char *data, qsizetype length);
+
+    // 计算内部节点哈希
+    static QByteArray nodeHash(const QByteArray &left, const QByteArray &right);
+
+private:
+    struct Node {
+        int level;         // 子树高度
+        QByteArray hash;   // 子树根哈希
+    };
+
+    QList<Node> pending; // 尚未配对的子树（从左到右高度递减）
+    qint64 leaves = 0;   // 已加入的叶子数
+};
+
+// 文件清单
+//
+// 发送方在请求中携带文件大小、块大小、每块的XXH64校验和以及Merkle根。
+// 清单块是传输块的整数倍（默认1MB），请求中的校验和不随文件大小膨胀过快。
+// 接收方凑满一个清单块后用XXH64发现损坏并重新请求其中的传输块，同时用块数据
+// 增量构建Merkle树，最后一块写入后与清单中的根比较，无需重新读取整个文件。
+class FileManifest {
+public:
+    FileManifest() = default;
+    ~FileManifest() = default;
+
+    // 由FileHasher按块计算的结果生成清单
+    static FileManifest fromBlockHashes(const FileBlockHashes &blocks);
+
+    // 从JSON格式创建
+    static FileManifest fromJson(const QJsonObject &json);
+
+    // 转换为JSON格式
+    QJsonObject toJson() const;
+
+    // 是否包含完整的清单
+    bool isValid() const;
+
+    // 文件大小
+    qint64 getFileSize() const;
+
+    // 块大小
+    int getBlockSize() const;
+
+    // 块数
+    qint64 getBlockCount() const;
+
+    // 每个清单块包含的传输块（FILE_BLOCK_SIZE）数
+    int getTransferBlocksPerBlock() const;
+
+    // 把按清单块标记的位图展开为按传输块标记
+    QBitArray toTransferBlocks(const QBitArray &blocks) const;
+
+    // Merkle根
+    QByteArray getMerkleRoot() const;
+
+    // 块的XXH64校验和
+    quint64 getBlockChecksum(qint64 blockIndex) const;
+
+    // 块的期望长度（最后一块可能较短）
+    qint64 expectedBlockLength(qint64 blockIndex) const;
+
+    // 检查块的长度和XXH64校验和
+    bool verifyBlock(qint64 blockIndex, const QByteArray &data) const;
+
+private:
+    qint64 fileSize = 0;         // 文件大小
+    int blockSize = 0;           // 块大小
+    QList<quint64> checksums;    // 每块的XXH64校验和
+    QByteArray merkleRoot;       // Merkle根（SHA-256）
+};
+
+} // namespace LocalNetworkApp
+
+#endif // FILE_MANIFEST_H
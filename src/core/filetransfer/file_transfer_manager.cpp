@@ -1,10 +1,6 @@
 #include "file_transfer_manager.h"
 #include <QFileInfo>
 #include <QDir>
-#include <QSettings>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QDateTime>
 #include "../utils/constants.h"
 #include "../message/message.h"
@@ -19,6 +15,10 @@ FileTransferManager::FileTransferManager(ContactManager *contactManager, Message
 {
     initDownloadDirectory();
     loadTransferHistory();
+    contentIndex.load();
+
+    fileTypePolicy = FileTypePolicy::loadFromLocal();
+    fileTypePolicy.setQuarantineDirectory(getDefaultDownloadDirectory() + "/" + Constants::QUARANTINE_DIR_NAME);
 }
 
 FileTransferManager::~FileTransferManager()
@@ -26,6 +26,16 @@ FileTransferManager::~FileTransferManager()
     // 清理所有活动的传输会话
     qDeleteAll(activeTransfers);
     activeTransfers.clear();
+
+    // 等待正在准备的接收（复制本地文件、计算增量签名），它们完成后会回调本对象
+    preparePool.waitForDone();
+
+    // 取消尚未完成的清单计算（析构时等待工作线程结束）
+    for (FileHasher *hasher : std::as_const(manifestHashers)) {
+        hasher->cancel();
+    }
+    qDeleteAll(manifestHashers);
+    manifestHashers.clear();
 }
 
 bool FileTransferManager::initDownloadDirectory()
@@ -60,36 +70,67 @@ bool FileTransferManager::initiateFileTransfer(QUuid senderId, QUuid receiverId,
 
     // 创建文件传输请求
     FileTransferRequest request(senderId, receiverId, filePath);
-    pendingRequests[request.getRequestId()] = request;
+    QUuid requestId = request.getRequestId();
+
+    // 在后台线程读取文件生成清单（每块的校验和与Merkle根），完成后再发送请求
+    FileHasher *hasher = new FileHasher(this);
+    connect(hasher, &FileHasher::blocksHashed, this, [this, request, requestId](const FileBlockHashes &blocks) mutable {
+        request.setManifest(FileManifest::fromBlockHashes(blocks));
+        pendingRequests[requestId] = request;
+        emit fileTransferRequestSent(request);
+    });
+    connect(hasher, &FileHasher::finished, this, [this, requestId]() {
+        finishManifest(requestId);
+    });
+    connect(hasher, &FileHasher::failed, this, [this, senderId, receiverId, requestId, fileName = fileInfo.fileName()]() {
+        Message message(senderId, receiverId, QString("读取文件失败，无法发送: %1").arg(fileName), MessageType::System);
+        messageManager->receiveMessage(message);
+        finishManifest(requestId);
+    });
+    connect(hasher, &FileHasher::cancelled, this, [this, requestId]() {
+        finishManifest(requestId);
+    });
 
-    // 发送请求
-    emit fileTransferRequestSent(request);
+    if (!hasher->start(filePath, Constants::MANIFEST_BLOCK_SIZE)) {
+        delete hasher;
+        return false;
+    }
+    manifestHashers[requestId] = hasher;
     return true;
 }
 
+void FileTransferManager::finishManifest(QUuid requestId)
+{
+    FileHasher *hasher = manifestHashers.take(requestId);
+    if (hasher) {
+        hasher->deleteLater();
+    }
+}
+
 void FileTransferManager::handleFileTransferRequest(const FileTransferRequest &request)
 {
     QUuid senderId = request.getSenderId();
     QUuid receiverId = request.getReceiverId();
 
-    // 检查发送者是否在黑名单中
-    if (contactManager->isInBlacklist(senderId)) {
-        // 直接拒绝请求
-        FileTransferResponse response(request.getRequestId(), receiverId, false);
-        emit fileTransferResponseSent(response);
-        return;
-    }
-
-    // 检查发送者是否在白名单中
-    if (contactManager->isInWhitelist(senderId)) {
-        // 自动接受请求
-        QString savePath = getDefaultDownloadDirectory() + "/" + request.getFileName();
-        acceptFileTransfer(request, savePath);
-        return;
+    // 一次查找发送者的策略
+    switch (contactManager->getPolicy(senderId)) {
+        case ContactPolicy::Blocked: {
+            // 黑名单：直接拒绝请求
+            FileTransferResponse response(request.getRequestId(), receiverId, false);
+            emit fileTransferResponseSent(response);
+            break;
+        }
+        case ContactPolicy::Trusted: {
+            // 白名单：自动接受请求
+            QString savePath = getDefaultDownloadDirectory() + "/" + request.getFileName();
+            acceptFileTransfer(request, savePath);
+            break;
+        }
+        case ContactPolicy::Normal:
+            // 否则，通知UI显示请求
+            emit fileTransferRequestReceived(request);
+            break;
     }
-
-    // 否则，通知UI显示请求
-    emit fileTransferRequestReceived(request);
 }
 
 void FileTransferManager::handleFileTransferResponse(const FileTransferResponse &response)
@@ -123,6 +164,10 @@ void FileTransferManager::handleFileTransferResponse(const FileTransferResponse
             emit transferStatusChanged(sessionId, status);
         });
 
+        // 接收方本地已有的块不再发送；接收方有旧版本时只发送增量
+        session->setSkippedBlocks(response.getLocalBlocks());
+        session->setDeltaSignature(response.getDeltaSignature());
+
         // 添加到活动会话
         activeTransfers[sessionId] = session;
 
@@ -144,6 +189,15 @@ void FileTransferManager::handleFileData(QUuid sessionId, qint64 blockIndex, con
     session->processDataBlock(blockIndex, data);
 }
 
+void FileTransferManager::handleBlockRequest(QUuid sessionId, qint64 blockIndex)
+{
+    if (!activeTransfers.contains(sessionId)) {
+        return; // 会话不存在
+    }
+
+    activeTransfers[sessionId]->resendBlock(blockIndex);
+}
+
 void FileTransferManager::cancelTransfer(QUuid sessionId)
 {
     if (!activeTransfers.contains(sessionId)) {
@@ -200,18 +254,60 @@ bool FileTransferManager::isIncognitoMode() const
 
 void FileTransferManager::clearAllTransferHistory()
 {
-    // 清除历史记录
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-    settings.remove("fileTransfers/history");
+    // 清除历史记录和已接收文件的内容索引
+    historyStore.clear();
+    contentIndex.clear();
+}
+
+QList<TransferRecord> FileTransferManager::queryTransferHistory(const TransferQuery &query) const
+{
+    return historyStore.query(query);
 }
 
 void FileTransferManager::acceptFileTransfer(const FileTransferRequest &request, const QString &savePath)
 {
-    QUuid receiverId = request.getReceiverId();
+    FileManifest manifest = request.getManifest();
 
-    // 创建响应
-    FileTransferResponse response(request.getRequestId(), receiverId, true, savePath);
-    emit fileTransferResponseSent(response);
+    // 查找本地已有的相同内容（只比较索引中记录的大小和修改时间）
+    QString existing = manifest.isValid() ? contentIndex.findFile(manifest) : QString();
+    bool hasOldVersion = manifest.isValid() && manifest.getFileSize() > 0 && QFileInfo(savePath).isFile();
+    if (existing.isEmpty() && !hasOldVersion) {
+        startReceiving(request, savePath, false, QBitArray(), DeltaSignature());
+        return;
+    }
+
+    // 生成目标文件（没有写时复制时需要完整复制）和计算旧版本的签名都要读取整个文件，
+    // 在后台线程完成后再发送接受响应
+    preparePool.start([this, request, savePath, existing, policy = fileTypePolicy]() {
+        FileManifest manifest = request.getManifest();
+
+        // 整个文件相同时直接生成目标文件；类型不允许的文件不直接生成，按正常接收流程拒绝或隔离
+        bool localCopy = false;
+        if (!existing.isEmpty() && ContentIndex::cloneFile(existing, savePath)) {
+            localCopy = policy.evaluate(FileTypeSniffer::detectFile(savePath)) == FileTypePolicy::Action::Allow;
+            if (!localCopy) {
+                QFile::remove(savePath);
+            }
+        }
+        QBitArray localBitmap = localCopy ? QBitArray(manifest.getBlockCount(), true) : QBitArray();
+
+        // 保存路径上仍有旧版本时以它为基准增量同步
+        DeltaSignature signature;
+        if (!localCopy && manifest.getFileSize() > 0 && QFileInfo(savePath).isFile()) {
+            signature = DeltaSignature::fromFile(savePath);
+        }
+
+        QMetaObject::invokeMethod(this, [this, request, savePath, localCopy, localBitmap, signature]() {
+            startReceiving(request, savePath, localCopy, localBitmap, signature);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileTransferManager::startReceiving(const FileTransferRequest &request, const QString &savePath, bool localCopy,
+                                         QBitArray localBitmap, DeltaSignature deltaSignature)
+{
+    QUuid receiverId = request.getReceiverId();
+    FileManifest manifest = request.getManifest();
 
     // 创建传输会话
     QUuid sessionId = QUuid::createUuid();
@@ -219,16 +315,52 @@ void FileTransferManager::acceptFileTransfer(const FileTransferRequest &request,
         sessionId, request.getSenderId(), request.getReceiverId(),
         savePath, false, this);
 
-    // 设置保存路径
+    // 设置保存路径和用于逐块校验的文件清单
     session->setSavePath(savePath);
+    session->setManifest(manifest);
+    session->setFileTypePolicy(fileTypePolicy);
+
+    // 有旧版本的签名时以它为基准增量同步，否则从内容索引中找出可复用的块
+    if (deltaSignature.isValid() && !session->setDeltaBasis(savePath, deltaSignature.getBlockSize())) {
+        deltaSignature = DeltaSignature();
+    }
+    if (!localCopy && !deltaSignature.isValid() && manifest.isValid()) {
+        // 保存路径上的文件会被覆盖，不能作为块的来源
+        QString target = QFileInfo(savePath).absoluteFilePath();
+        QHash<qint64, LocalBlock> localBlocks = contentIndex.findBlocks(manifest);
+        localBitmap = QBitArray(manifest.getBlockCount());
+        for (auto it = localBlocks.begin(); it != localBlocks.end();) {
+            if (it->filePath == target) {
+                it = localBlocks.erase(it);
+            } else {
+                localBitmap.setBit(it.key());
+                ++it;
+            }
+        }
+        session->setLocalBlocks(localBlocks);
+    }
+
+    // 创建响应
+    // 本地块按清单块查找，发送方按传输块跳过
+    FileTransferResponse response(request.getRequestId(), receiverId, true, savePath);
+    response.setLocalBlocks(manifest.toTransferBlocks(localBitmap));
+    response.setDeltaSignature(deltaSignature);
+    emit fileTransferResponseSent(response);
 
     // 连接信号
     connect(session, &FileTransferSession::sendDataBlock, this, &FileTransferManager::fileDataBlockSent);
+    connect(session, &FileTransferSession::blockRequested, this, &FileTransferManager::fileBlockRequested);
     connect(session, &FileTransferSession::progressChanged, this, [this, sessionId](qint64 bytesTransferred, qint64 totalBytes) {
         emit transferProgress(sessionId, bytesTransferred, totalBytes);
     });
-    connect(session, &FileTransferSession::completed, this, [this, sessionId](bool success) {
-        saveTransferHistory(getTransferSession(sessionId), success);
+    connect(session, &FileTransferSession::completed, this, [this, sessionId, manifest](bool success) {
+        FileTransferSession *completedSession = getTransferSession(sessionId);
+        saveTransferHistory(completedSession, success);
+
+        // 记录已校验的文件，之后收到相同内容时可直接使用（隔离的文件除外）
+        if (success && completedSession && !completedSession->isQuarantined() && !incognitoMode) {
+            contentIndex.addFile(completedSession->getFilePath(), manifest);
+        }
         emit transferCompleted(sessionId, success);
     });
     connect(session, &FileTransferSession::statusChanged, this, [this, sessionId](FileTransferStatus status) {
@@ -239,7 +371,11 @@ void FileTransferManager::acceptFileTransfer(const FileTransferRequest &request,
     activeTransfers[sessionId] = session;
 
     // 开始传输
-    session->start();
+    if (localCopy) {
+        session->completeFromLocalCopy();
+    } else {
+        session->start();
+    }
 }
 
 void FileTransferManager::rejectFileTransfer(const FileTransferRequest &request)
@@ -251,37 +387,40 @@ void FileTransferManager::rejectFileTransfer(const FileTransferRequest &request)
     emit fileTransferResponseSent(response);
 }
 
-void FileTransferManager::saveTransferHistory(const FileTransferSession *session, bool success)
+void FileTransferManager::setFileTypePolicy(const FileTypePolicy &policy)
 {
-    if (incognitoMode || !session) {
-        return; // 无痕模式下不保存
+    QString quarantineDirectory = fileTypePolicy.getQuarantineDirectory();
+    fileTypePolicy = policy;
+    if (fileTypePolicy.getQuarantineDirectory().isEmpty()) {
+        fileTypePolicy.setQuarantineDirectory(quarantineDirectory);
     }
+    fileTypePolicy.saveToLocal();
+}
 
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+FileTypePolicy FileTransferManager::getFileTypePolicy() const
+{
+    return fileTypePolicy;
+}
 
-    // 获取现有历史记录
-    QJsonArray historyArray;
-    if (settings.contains("fileTransfers/history")) {
-        QByteArray jsonData = settings.value("fileTransfers/history").toByteArray();
-        QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-        historyArray = doc.array();
+void FileTransferManager::saveTransferHistory(const FileTransferSession *session, bool success)
+{
+    if (incognitoMode || !session) {
+        return; // 无痕模式下不保存
     }
 
-    // 添加新记录
-    QJsonObject record;
-    record["sessionId"] = session->getSessionId().toString();
-    record["senderId"] = session->getSenderId().toString();
-    record["receiverId"] = session->getReceiverId().toString();
-    record["fileName"] = session->getFileName();
-    record["fileSize"] = static_cast<qint64>(session->getFileSize());
-    record["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    record["success"] = success;
-    record["isSender"] = (session->getSenderId() == contactManager->getContact(session->getSenderId()).id);
-
-    historyArray.append(record);
-
-    // 保存历史记录
-    settings.setValue("fileTransfers/history", QString::fromUtf8(QJsonDocument(historyArray).toJson()));
+    // 追加一条记录，不再读写整个历史
+    TransferRecord record;
+    record.sessionId = session->getSessionId();
+    record.senderId = session->getSenderId();
+    record.receiverId = session->getReceiverId();
+    record.fileName = session->getFileName();
+    record.filePath = session->getFilePath();
+    record.fileSize = session->getFileSize();
+    record.timestamp = QDateTime::currentDateTime();
+    record.success = success;
+    record.isSender = session->isSending();
+
+    historyStore.append(record);
 }
 
 void FileTransferManager::loadTransferHistory()
@@ -290,10 +429,8 @@ void FileTransferManager::loadTransferHistory()
         return; // 无痕模式下不加载
     }
 
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-
-    // 这里可以实现加载历史记录的逻辑
-    // 但由于历史记录主要用于显示，可能不需要在管理器中保留
+    // 加载历史记录并建立索引（首次运行时迁移旧版设置中的记录）
+    historyStore.load();
 }
 
-} // namespace LocalNetworkApp
\ No newline at end of file
+} // namespace LocalNetworkApp
@@ -5,9 +5,16 @@
 #include <QMap>
 #include <QUuid>
 #include <QString>
+#include <QBitArray>
+#include <QThreadPool>
 #include "file_transfer_request.h"
 #include "file_transfer_response.h"
 #include "file_transfer_session.h"
+#include "transfer_history_store.h"
+#include "content_index.h"
+#include "file_type_sniffer.h"
+#include "delta_sync.h"
+#include "../data/file_hasher.h"
 #include "../user/contact_manager.h"
 #include "../message/message_manager.h"
 
@@ -38,6 +45,9 @@ public:
     // 处理文件数据块
     void handleFileData(QUuid sessionId, qint64 blockIndex, const QByteArray &data);
 
+    // 处理接收方对单个数据块的重新请求
+    void handleBlockRequest(QUuid sessionId, qint64 blockIndex);
+
     // 取消文件传输
     void cancelTransfer(QUuid sessionId);
 
@@ -62,6 +72,15 @@ public:
     // 清除所有文件传输历史
     void clearAllTransferHistory();
 
+    // 查询文件传输历史（按对方用户、时间范围和文件名前缀）
+    QList<TransferRecord> queryTransferHistory(const TransferQuery &query) const;
+
+    // 设置接收文件的类型策略并保存
+    void setFileTypePolicy(const FileTypePolicy &policy);
+
+    // 获取接收文件的类型策略
+    FileTypePolicy getFileTypePolicy() const;
+
 signals:
     // 发送文件传输请求
     void fileTransferRequestSent(const FileTransferRequest &request);
@@ -78,6 +97,9 @@ signals:
     // 发送文件数据块
     void fileDataBlockSent(QUuid sessionId, qint64 blockIndex, const QByteArray &data);
 
+    // 请求发送方重新发送校验失败的数据块
+    void fileBlockRequested(QUuid sessionId, qint64 blockIndex);
+
     // 传输进度更新
     void transferProgress(QUuid sessionId, qint64 bytesTransferred, qint64 totalBytes);
 
@@ -97,9 +119,21 @@ public slots:
 private:
     QMap<QUuid, FileTransferSession*> activeTransfers; // 活动的传输会话
     QMap<QUuid, FileTransferRequest> pendingRequests; // 待处理的请求
+    QMap<QUuid, FileHasher*> manifestHashers; // 正在生成清单的请求（按请求ID）
     ContactManager *contactManager; // 联系人管理器
     MessageManager *messageManager; // 消息管理器
     bool incognitoMode; // 无痕模式标志
+    TransferHistoryStore historyStore; // 传输历史存储
+    ContentIndex contentIndex; // 已接收文件的内容索引
+    FileTypePolicy fileTypePolicy; // 接收文件的类型策略
+    QThreadPool preparePool; // 准备接收的线程（复制本地相同内容的文件、计算增量签名）
+
+    // 创建接收会话并发送接受响应（deltaSignature为保存路径上旧版本的签名）
+    void startReceiving(const FileTransferRequest &request, const QString &savePath, bool localCopy,
+                        QBitArray localBitmap, DeltaSignature deltaSignature);
+
+    // 清单生成结束，释放对应的哈希器
+    void finishManifest(QUuid requestId);
 
     // 保存传输历史
     void saveTransferHistory(const FileTransferSession *session, bool success);
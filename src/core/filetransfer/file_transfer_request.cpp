@@ -23,7 +23,8 @@ FileTransferRequest::FileTransferRequest(const QJsonObject &json) :
     filePath(json["filePath"].toString()),
     fileName(json["fileName"].toString()),
     fileSize(json["fileSize"].toVariant().toLongLong()),
-    timestamp(QDateTime::fromString(json["timestamp"].toString(), Qt::ISODate))
+    timestamp(QDateTime::fromString(json["timestamp"].toString(), Qt::ISODate)),
+    manifest(FileManifest::fromJson(json["manifest"].toObject()))
 {
 }
 
@@ -62,6 +63,16 @@ QDateTime FileTransferRequest::getTimestamp() const
     return timestamp;
 }
 
+FileManifest FileTransferRequest::getManifest() const
+{
+    return manifest;
+}
+
+void FileTransferRequest::setManifest(const FileManifest &manifest)
+{
+    this->manifest = manifest;
+}
+
 QJsonObject FileTransferRequest::toJson() const
 {
     QJsonObject json;
@@ -72,6 +83,9 @@ QJsonObject FileTransferRequest::toJson() const
     json["fileName"] = fileName;
     json["fileSize"] = static_cast<qint64>(fileSize);
     json["timestamp"] = timestamp.toString(Qt::ISODate);
+    if (manifest.isValid()) {
+        json["manifest"] = manifest.toJson();
+    }
     return json;
 }
 
@@ -5,6 +5,7 @@
 #include <QString>
 #include <QDateTime>
 #include <QJsonObject>
+#include "file_manifest.h"
 
 namespace LocalNetworkApp {
 
@@ -36,6 +37,12 @@ public:
     // 获取请求时间戳
     QDateTime getTimestamp() const;
 
+    // 获取文件清单（块校验和与Merkle根）
+    FileManifest getManifest() const;
+
+    // 设置文件清单（由FileTransferManager在后台线程计算后填入）
+    void setManifest(const FileManifest &manifest);
+
     // 转换为JSON格式
     QJsonObject toJson() const;
 
@@ -47,6 +54,7 @@ private:
     QString fileName;   // 文件名
     qint64 fileSize;    // 文件大小
     QDateTime timestamp; // 请求时间戳
+    FileManifest manifest; // 文件清单
 };
 
 } // namespace LocalNetworkApp
@@ -16,6 +16,17 @@ FileTransferResponse::FileTransferResponse(const QJsonObject &json) :
     accepted(json["accepted"].toBool()),
     savePath(json["savePath"].toString())
 {
+    // 位图按字节打包后以Base64存放
+    QJsonObject blocks = json["localBlocks"].toObject();
+    qsizetype count = blocks["count"].toInteger();
+    QByteArray bits = QByteArray::fromBase64(blocks["bits"].toString().toLatin1());
+    if (count > 0 && bits.size() == (count + 7) / 8) {
+        localBlocks = QBitArray::fromBits(bits.constData(), count);
+    }
+
+    if (json.contains("deltaSignature")) {
+        deltaSignature = DeltaSignature::fromJson(json["deltaSignature"].toObject());
+    }
 }
 
 QUuid FileTransferResponse::getRequestId() const
@@ -38,6 +49,26 @@ QString FileTransferResponse::getSavePath() const
     return savePath;
 }
 
+void FileTransferResponse::setLocalBlocks(const QBitArray &blocks)
+{
+    localBlocks = blocks;
+}
+
+QBitArray FileTransferResponse::getLocalBlocks() const
+{
+    return localBlocks;
+}
+
+void FileTransferResponse::setDeltaSignature(const DeltaSignature &signature)
+{
+    deltaSignature = signature;
+}
+
+DeltaSignature FileTransferResponse::getDeltaSignature() const
+{
+    return deltaSignature;
+}
+
 QJsonObject FileTransferResponse::toJson() const
 {
     QJsonObject json;
@@ -45,6 +76,15 @@ QJsonObject FileTransferResponse::toJson() const
     json["receiverId"] = receiverId.toString();
     json["accepted"] = accepted;
     json["savePath"] = savePath;
+    if (localBlocks.count(true) > 0) {
+        QJsonObject blocks;
+        blocks["count"] = localBlocks.size();
+        blocks["bits"] = QString::fromLatin1(QByteArray(localBlocks.bits(), (localBlocks.size() + 7) / 8).toBase64());
+        json["localBlocks"] = blocks;
+    }
+    if (deltaSignature.isValid()) {
+        json["deltaSignature"] = deltaSignature.toJson();
+    }
     return json;
 }
 
@@ -4,6 +4,8 @@
 #include <QUuid>
 #include <QString>
 #include <QJsonObject>
+#include <QBitArray>
+#include "delta_sync.h"
 
 namespace LocalNetworkApp {
 
@@ -25,6 +27,18 @@ public:
     // 获取保存路径
     QString getSavePath() const;
 
+    // 设置接收方本地已有的数据块（发送方跳过这些块）
+    void setLocalBlocks(const QBitArray &blocks);
+
+    // 获取接收方本地已有的数据块
+    QBitArray getLocalBlocks() const;
+
+    // 设置接收方已有旧版本的块签名（发送方改为发送增量指令）
+    void setDeltaSignature(const DeltaSignature &signature);
+
+    // 获取接收方已有旧版本的块签名
+    DeltaSignature getDeltaSignature() const;
+
     // 转换为JSON格式
     QJsonObject toJson() const;
 
@@ -33,6 +47,8 @@ private:
     QUuid receiverId;   // 接收者ID
     bool accepted;      // 是否接受传输
     QString savePath;   // 保存路径
+    QBitArray localBlocks; // 接收方本地已有的数据块
+    DeltaSignature deltaSignature; // 接收方已有旧版本的块签名
 };
 
 } // namespace LocalNetworkApp
@@ -17,7 +17,13 @@ FileTransferSession::FileTransferSession(QUuid sessionId, QUuid senderId, QUuid
     status(FileTransferStatus::Pending),
     bytesTransferred(0),
     currentBlockIndex(0),
-    file(nullptr)
+    file(nullptr),
+    localSource(nullptr),
+    deltaEncoder(nullptr),
+    deltaDecoder(nullptr),
+    deltaRequested(false),
+    typeChecked(false),
+    quarantined(false)
 {
     if (isSender) {
         // 发送方：获取文件信息
@@ -84,6 +90,11 @@ FileTransferStatus FileTransferSession::getStatus() const
     return status;
 }
 
+bool FileTransferSession::isSending() const
+{
+    return isSender;
+}
+
 void FileTransferSession::start()
 {
     if (status == FileTransferStatus::Completed || 
@@ -105,9 +116,11 @@ void FileTransferSession::start()
         currentBlockIndex = 0;
         sendNextBlock();
     } else {
-        // 接收方等待接收数据块
+        // 接收方等待接收数据块，本地已有的块直接读取
         if (pendingBlocks.contains(currentBlockIndex)) {
             processDataBlock(currentBlockIndex, pendingBlocks.take(currentBlockIndex));
+        } else if (hasLocalBlock()) {
+            processLocalBlock();
         }
     }
 }
@@ -128,6 +141,8 @@ void FileTransferSession::resume()
             sendNextBlock();
         } else if (pendingBlocks.contains(currentBlockIndex)) {
             processDataBlock(currentBlockIndex, pendingBlocks.take(currentBlockIndex));
+        } else if (hasLocalBlock()) {
+            processLocalBlock();
         }
     }
 }
@@ -140,9 +155,9 @@ void FileTransferSession::cancel()
         updateStatus(FileTransferStatus::Cancelled);
         closeFile();
         
-        // 如果是接收方且文件已部分写入，删除文件
+        // 如果是接收方且文件已部分写入，删除文件（增量模式只删除临时文件，保留旧版本）
         if (!isSender && !savePath.isEmpty()) {
-            QFile::remove(savePath);
+            QFile::remove(writePath());
         }
         
         emit completed(false);
@@ -183,36 +198,137 @@ void FileTransferSession::processDataBlock(qint64 blockIndex, const QByteArray &
         }
     }
 
-    // 写入数据
-    qint64 bytesWritten = file->write(data);
-    if (bytesWritten != data.size()) {
-        updateStatus(FileTransferStatus::Failed);
-        emit error("写入文件失败");
-        return;
+    qint64 nextBlockIndex = currentBlockIndex + 1;
+    if (deltaDecoder) {
+        // 增量模式：数据块是一段增量指令
+        if (!applyDeltaChunk(data)) {
+            return;
+        }
+    } else if (manifest.isValid()) {
+        // 凑满一个清单块后再校验和写入（从本地读出的数据一次就是整个清单块）
+        int perBlock = manifest.getTransferBlocksPerBlock();
+        qint64 manifestIndex = currentBlockIndex / perBlock;
+        blockPending.append(data);
+        if (blockPending.size() < manifest.expectedBlockLength(manifestIndex) && nextBlockIndex % perBlock != 0) {
+            currentBlockIndex = nextBlockIndex;
+            receiveNextBlock();
+            return;
+        }
+        if (!commitManifestBlock(manifestIndex)) {
+            return;
+        }
+        nextBlockIndex = (manifestIndex + 1) * perBlock;
+    } else {
+        // 第一个数据块写入前识别文件类型
+        if (!checkFileType(data)) {
+            return;
+        }
+
+        // 写入数据
+        qint64 bytesWritten = file->write(data);
+        if (bytesWritten != data.size()) {
+            updateStatus(FileTransferStatus::Failed);
+            emit error("写入文件失败");
+            return;
+        }
+        bytesTransferred += data.size();
     }
 
     // 更新进度
-    bytesTransferred += data.size();
     emit progressChanged(bytesTransferred, fileSize);
 
     // 检查是否完成
     if (bytesTransferred >= fileSize) {
-        updateStatus(FileTransferStatus::Completed);
+        // 所有块都通过了校验，再用Merkle根确认整个文件
+        if (manifest.isValid() && receivedTree.root() != manifest.getMerkleRoot()) {
+            failIntegrity("文件完整性校验失败");
+            return;
+        }
+
         closeFile();
+
+        // 增量模式：新版本校验通过后替换旧版本
+        if (!tempPath.isEmpty()) {
+            QFile::remove(savePath);
+            if (!QFile::rename(tempPath, savePath)) {
+                qWarning() << "无法替换旧版本文件:" << savePath;
+                updateStatus(FileTransferStatus::Failed);
+                emit error("无法替换旧版本文件");
+                emit completed(false);
+                return;
+            }
+            tempPath.clear();
+        }
+
+        updateStatus(FileTransferStatus::Completed);
         emit completed(true);
         return;
     }
 
     // 准备接收下一个块
-    currentBlockIndex++;
+    currentBlockIndex = nextBlockIndex;
+    receiveNextBlock();
+}
 
+void FileTransferSession::receiveNextBlock()
+{
     // 检查是否有缓存的下一个块
     if (pendingBlocks.contains(currentBlockIndex)) {
         QByteArray nextData = pendingBlocks.take(currentBlockIndex);
         QTimer::singleShot(0, this, [this, nextData]() {
             processDataBlock(currentBlockIndex, nextData);
         });
+    } else if (hasLocalBlock()) {
+        QTimer::singleShot(0, this, &FileTransferSession::processLocalBlock);
+    }
+}
+
+bool FileTransferSession::hasLocalBlock() const
+{
+    // 本地块按清单块记录，只在清单块的第一个传输块处读取
+    return manifest.isValid() && currentBlockIndex % manifest.getTransferBlocksPerBlock() == 0 &&
+           localBlocks.contains(currentBlockIndex / manifest.getTransferBlocksPerBlock());
+}
+
+bool FileTransferSession::commitManifestBlock(qint64 manifestIndex)
+{
+    QByteArray block = blockPending;
+    blockPending.clear();
+
+    // 损坏的清单块不写入，重新请求其中的每个传输块
+    if (!manifest.verifyBlock(manifestIndex, block)) {
+        int retries = ++blockRetries[manifestIndex];
+        if (retries > Constants::FILE_BLOCK_MAX_RETRIES) {
+            failIntegrity("数据块多次校验失败");
+            return false;
+        }
+        qWarning() << "数据块校验失败，重新请求:" << manifestIndex;
+
+        int perBlock = manifest.getTransferBlocksPerBlock();
+        currentBlockIndex = manifestIndex * perBlock;
+        for (qint64 i = currentBlockIndex; i < (manifestIndex + 1) * perBlock &&
+             i * Constants::FILE_BLOCK_SIZE < fileSize; ++i) {
+            pendingBlocks.remove(i);
+            emit blockRequested(sessionId, i);
+        }
+        return false;
+    }
+
+    // 块已在内存中，顺带计算Merkle叶子，完成后无需重新读取文件
+    receivedTree.addLeaf(MerkleTreeBuilder::leafHash(block.constData(), block.size()));
+
+    // 第一个清单块写入前识别文件类型
+    if (!checkFileType(block)) {
+        return false;
     }
+
+    if (file->write(block) != block.size()) {
+        updateStatus(FileTransferStatus::Failed);
+        emit error("写入文件失败");
+        return false;
+    }
+    bytesTransferred += block.size();
+    return true;
 }
 
 void FileTransferSession::setSavePath(const QString &savePath)
@@ -226,6 +342,153 @@ void FileTransferSession::setSavePath(const QString &savePath)
     }
 }
 
+void FileTransferSession::setManifest(const FileManifest &manifest)
+{
+    if (isSender || !manifest.isValid()) {
+        return;
+    }
+
+    this->manifest = manifest;
+    receivedTree = MerkleTreeBuilder();
+    blockRetries.clear();
+    blockPending.clear();
+
+    // 接收方的文件大小以清单为准
+    fileSize = manifest.getFileSize();
+}
+
+void FileTransferSession::resendBlock(qint64 blockIndex)
+{
+    if (!isSender || status == FileTransferStatus::Cancelled || status == FileTransferStatus::Failed) {
+        return;
+    }
+
+    qint64 blockSize = Constants::FILE_BLOCK_SIZE;
+    qint64 offset = blockIndex * blockSize;
+    if (blockIndex < 0 || offset >= fileSize) {
+        return;
+    }
+
+    // 发送方可能已发完并关闭文件，重新打开读取这一块
+    QFile source(filePath);
+    if (!source.open(QIODevice::ReadOnly) || !source.seek(offset)) {
+        emit error("读取文件失败");
+        return;
+    }
+    QByteArray data = source.read(qMin(blockSize, fileSize - offset));
+
+    emit sendDataBlock(sessionId, blockIndex, data);
+}
+
+void FileTransferSession::setSkippedBlocks(const QBitArray &blocks)
+{
+    if (isSender) {
+        skippedBlocks = blocks;
+    }
+}
+
+void FileTransferSession::setLocalBlocks(const QHash<qint64, LocalBlock> &blocks)
+{
+    // 本地块只有在能按清单校验时才可使用
+    if (!isSender && manifest.isValid()) {
+        localBlocks = blocks;
+    }
+}
+
+void FileTransferSession::completeFromLocalCopy()
+{
+    if (isSender || status == FileTransferStatus::Completed) {
+        return;
+    }
+
+    closeFile();
+    localBlocks.clear();
+    bytesTransferred = fileSize;
+    updateStatus(FileTransferStatus::Completed);
+    emit progressChanged(bytesTransferred, fileSize);
+    emit completed(true);
+}
+
+void FileTransferSession::setDeltaSignature(const DeltaSignature &signature)
+{
+    if (!isSender || !signature.isValid()) {
+        return;
+    }
+
+    // 接收方已按增量模式准备好解码器，编码器无法使用时也不能直接发送原始数据块
+    deltaRequested = true;
+    delete deltaEncoder;
+    deltaEncoder = new DeltaEncoder(signature);
+    if (!deltaEncoder->open(filePath)) {
+        qWarning() << "无法打开增量编码器，改为发送完整数据:" << filePath;
+        delete deltaEncoder;
+        deltaEncoder = nullptr;
+    }
+}
+
+bool FileTransferSession::setDeltaBasis(const QString &basisPath, int blockSize)
+{
+    if (isSender || !manifest.isValid() || file) {
+        return false;
+    }
+
+    delete deltaDecoder;
+    deltaDecoder = new DeltaDecoder();
+    if (!deltaDecoder->open(basisPath, blockSize)) {
+        delete deltaDecoder;
+        deltaDecoder = nullptr;
+        return false;
+    }
+
+    // 基准文件可能就是保存路径上的旧版本，新版本先写入临时文件
+    tempPath = savePath + Constants::DELTA_TEMP_SUFFIX;
+    localBlocks.clear();
+    return true;
+}
+
+void FileTransferSession::setFileTypePolicy(const FileTypePolicy &policy)
+{
+    if (!isSender) {
+        typePolicy = policy;
+    }
+}
+
+bool FileTransferSession::isQuarantined() const
+{
+    return quarantined;
+}
+
+void FileTransferSession::processLocalBlock()
+{
+    if (status != FileTransferStatus::Transferring || !localBlocks.contains(currentBlockIndex)) {
+        return;
+    }
+
+    // 同一来源文件的连续块复用已打开的文件
+    qint64 manifestIndex = currentBlockIndex / manifest.getTransferBlocksPerBlock();
+    LocalBlock block = localBlocks.take(manifestIndex);
+    if (!localSource || localSource->fileName() != block.filePath) {
+        delete localSource;
+        localSource = new QFile(block.filePath);
+        if (!localSource->open(QIODevice::ReadOnly)) {
+            qWarning() << "无法读取本地文件:" << block.filePath << localSource->errorString();
+        }
+    }
+
+    QByteArray data;
+    if (localSource->isOpen() && localSource->seek(block.offset)) {
+        data = localSource->read(manifest.expectedBlockLength(manifestIndex));
+    }
+
+    // 本地块同样按清单校验，不一致时向发送方重新请求；读不全时不再等待后续传输块
+    if (data.size() != manifest.expectedBlockLength(manifestIndex)) {
+        blockPending = data;
+        commitManifestBlock(manifestIndex);
+        return;
+    }
+    processDataBlock(currentBlockIndex, data);
+}
+
 void FileTransferSession::sendNextBlock()
 {
     if (status != FileTransferStatus::Transferring) {
@@ -242,8 +505,45 @@ void FileTransferSession::sendNextBlock()
     qint64 blockSize = Constants::FILE_BLOCK_SIZE;
     qint64 offset = currentBlockIndex * blockSize;
 
+    // 增量模式：每个数据块是一段增量指令，进度按已编码的新文件字节数计算
+    if (deltaEncoder) {
+        QByteArray chunk;
+        if (!deltaEncoder->nextChunk(&chunk)) {
+            updateStatus(FileTransferStatus::Failed);
+            emit error("读取文件失败");
+            return;
+        }
+        if (!chunk.isEmpty()) {
+            emit sendDataBlock(sessionId, currentBlockIndex, chunk);
+            currentBlockIndex++;
+        }
+
+        bytesTransferred = deltaEncoder->position();
+        emit progressChanged(bytesTransferred, fileSize);
+
+        if (deltaEncoder->atEnd()) {
+            qInfo() << "增量发送完成:" << fileName << "复用" << deltaEncoder->matchedBytes() << "/" << fileSize << "字节";
+            updateStatus(FileTransferStatus::Completed);
+            closeFile();
+            emit completed(true);
+            return;
+        }
+
+        QTimer::singleShot(10, this, &FileTransferSession::sendNextBlock);
+        return;
+    }
+
+    // 跳过接收方本地已有的块
+    while (offset < fileSize && currentBlockIndex < skippedBlocks.size() &&
+           skippedBlocks.testBit(currentBlockIndex)) {
+        bytesTransferred += qMin(blockSize, fileSize - offset);
+        currentBlockIndex++;
+        offset += blockSize;
+    }
+
     // 检查是否超出文件大小
     if (offset >= fileSize) {
+        emit progressChanged(bytesTransferred, fileSize);
         updateStatus(FileTransferStatus::Completed);
         closeFile();
         emit completed(true);
@@ -265,8 +565,8 @@ void FileTransferSession::sendNextBlock()
         return;
     }
 
-    // 发送数据块
-    emit sendDataBlock(sessionId, currentBlockIndex, data);
+    // 发送数据块（接收方等待增量指令而编码器无法使用时，按字面量指令发送）
+    emit sendDataBlock(sessionId, currentBlockIndex, deltaRequested ? DeltaEncoder::literalChunk(data) : data);
 
     // 更新进度
     bytesTransferred += data.size();
@@ -311,9 +611,9 @@ bool FileTransferSession::initFile()
             }
         }
 
-        file = new QFile(savePath);
+        file = new QFile(writePath());
         if (!file->open(QIODevice::WriteOnly)) {
-            qWarning() << "无法打开文件进行写入:" << savePath << file->errorString();
+            qWarning() << "无法打开文件进行写入:" << writePath() << file->errorString();
             delete file;
             file = nullptr;
             return false;
@@ -330,6 +630,123 @@ void FileTransferSession::closeFile()
         delete file;
         file = nullptr;
     }
+
+    delete localSource;
+    localSource = nullptr;
+    delete deltaEncoder;
+    deltaEncoder = nullptr;
+    delete deltaDecoder;
+    deltaDecoder = nullptr;
+}
+
+QString FileTransferSession::writePath() const
+{
+    return tempPath.isEmpty() ? savePath : tempPath;
+}
+
+bool FileTransferSession::applyDeltaChunk(const QByteArray &chunk)
+{
+    // 还原的数据不能超出清单中的文件大小
+    QByteArray output;
+    if (!deltaDecoder->apply(chunk, fileSize - bytesTransferred, &output)) {
+        failIntegrity("增量数据无效");
+        return false;
+    }
+
+    // 还原出的数据按清单的块边界逐块校验，并增量构建Merkle树
+    deltaPending.append(output);
+    qsizetype consumed = 0;
+    while (true) {
+        qint64 blockIndex = receivedTree.leafCount();
+        qint64 length = manifest.expectedBlockLength(blockIndex);
+        if (length < 0 || deltaPending.size() - consumed < length) {
+            break;
+        }
+
+        QByteArray block = QByteArray::fromRawData(deltaPending.constData() + consumed, length);
+        if (!manifest.verifyBlock(blockIndex, block)) {
+            failIntegrity("增量还原的数据块校验失败");
+            return false;
+        }
+        receivedTree.addLeaf(MerkleTreeBuilder::leafHash(block.constData(), block.size()));
+        consumed += length;
+    }
+    deltaPending.remove(0, consumed);
+
+    if (!checkFileType(output)) {
+        return false;
+    }
+
+    if (file->write(output) != output.size()) {
+        updateStatus(FileTransferStatus::Failed);
+        emit error("写入文件失败");
+        return false;
+    }
+
+    bytesTransferred += output.size();
+    return true;
+}
+
+bool FileTransferSession::checkFileType(const QByteArray &head)
+{
+    if (isSender || typeChecked || head.isEmpty()) {
+        return true;
+    }
+    typeChecked = true;
+
+    FileType type = FileTypeSniffer::detect(head, fileName);
+    switch (typePolicy.evaluate(type)) {
+        case FileTypePolicy::Action::Allow:
+            return true;
+        case FileTypePolicy::Action::Reject:
+            failIntegrity(QString("不允许接收的文件类型: %1 (%2)")
+                              .arg(type.name, FileTypeSniffer::categoryName(type.category)));
+            return false;
+        case FileTypePolicy::Action::Quarantine:
+            break;
+    }
+
+    QString target = typePolicy.quarantinePath(fileName);
+    if (!QDir().mkpath(QFileInfo(target).absolutePath())) {
+        failIntegrity("无法创建隔离目录");
+        return false;
+    }
+
+    if (tempPath.isEmpty()) {
+        // 还没有写入数据：放弃原保存路径上刚创建的空文件，改为写入隔离目录
+        file->close();
+        delete file;
+        file = nullptr;
+        QFile::remove(savePath);
+        savePath = target;
+        if (!initFile()) {
+            failIntegrity("无法写入隔离目录");
+            return false;
+        }
+    } else {
+        // 增量模式：新版本仍写入临时文件，完成后移入隔离目录，旧版本保持不变
+        savePath = target;
+    }
+
+    filePath = target;
+    quarantined = true;
+    qWarning() << "文件类型不在允许范围内，已隔离:" << fileName << type.name << "->" << target;
+    return true;
+}
+
+void FileTransferSession::failIntegrity(const QString &errorMessage)
+{
+    qWarning() << errorMessage << fileName;
+    updateStatus(FileTransferStatus::Failed);
+    closeFile();
+
+    // 不保留未通过校验的文件（增量模式只删除临时文件，保留旧版本）
+    if (!savePath.isEmpty()) {
+        QFile::remove(writePath());
+    }
+
+    emit error(errorMessage);
+    emit completed(false);
 }
 
 void FileTransferSession::updateStatus(FileTransferStatus newStatus)
@@ -6,8 +6,14 @@
 #include <QFile>
 #include <QMap>
 #include <QByteArray>
+#include <QBitArray>
+#include <QHash>
 #include "../utils/enums.h"
 #include "../utils/constants.h"
+#include "file_manifest.h"
+#include "content_index.h"
+#include "delta_sync.h"
+#include "file_type_sniffer.h"
 
 namespace LocalNetworkApp {
 
@@ -46,6 +52,9 @@ public:
     // 获取传输状态
     FileTransferStatus getStatus() const;
 
+    // 本机是否为发送方
+    bool isSending() const;
+
     // 开始传输
     void start();
 
@@ -64,6 +73,33 @@ public:
     // 设置保存路径（接收方使用）
     void setSavePath(const QString &savePath);
 
+    // 设置文件清单（接收方使用），收到的块按清单逐块校验
+    void setManifest(const FileManifest &manifest);
+
+    // 重新发送一个数据块（发送方使用，响应接收方的重新请求）
+    void resendBlock(qint64 blockIndex);
+
+    // 设置接收方本地已有的数据块（发送方使用），这些块不再发送
+    void setSkippedBlocks(const QBitArray &blocks);
+
+    // 设置可以从本地文件读取的清单块（接收方使用，需先设置清单）
+    void setLocalBlocks(const QHash<qint64, LocalBlock> &blocks);
+
+    // 目标文件已由本地相同内容的文件生成，直接完成传输（接收方使用）
+    void completeFromLocalCopy();
+
+    // 使用增量模式发送（发送方使用）：按接收方旧版本的签名只发送变化的数据
+    void setDeltaSignature(const DeltaSignature &signature);
+
+    // 使用增量模式接收（接收方使用，需先设置清单）：以basisPath的旧版本为基准还原新文件
+    bool setDeltaBasis(const QString &basisPath, int blockSize);
+
+    // 设置文件类型策略（接收方使用）：按第一个数据块识别类型，拒绝或隔离不允许的文件
+    void setFileTypePolicy(const FileTypePolicy &policy);
+
+    // 文件是否因类型不允许而被隔离
+    bool isQuarantined() const;
+
 signals:
     // 传输进度更新
     void progressChanged(qint64 bytesTransferred, qint64 totalBytes);
@@ -80,10 +116,16 @@ signals:
     // 发送数据块（内部信号）
     void sendDataBlock(QUuid sessionId, qint64 blockIndex, const QByteArray &data);
 
+    // 数据块校验失败，请求发送方重新发送（内部信号）
+    void blockRequested(QUuid sessionId, qint64 blockIndex);
+
 private slots:
     // 发送下一个数据块
     void sendNextBlock();
 
+    // 从本地文件读取当前块并按收到的块处理
+    void processLocalBlock();
+
 private:
     QUuid sessionId;              // 会话ID
     QUuid senderId;               // 发送者ID
@@ -98,15 +140,51 @@ private:
     FileTransferStatus status;    // 传输状态
     qint64 currentBlockIndex;     // 当前块索引
     QMap<qint64, QByteArray> pendingBlocks; // 待处理的数据块
+    FileManifest manifest;        // 文件清单（接收方使用）
+    MerkleTreeBuilder receivedTree; // 已写入块的Merkle树
+    QMap<qint64, int> blockRetries; // 每个清单块校验失败的次数
+    QByteArray blockPending;      // 已收到但尚未凑满一个清单块的数据
+    QBitArray skippedBlocks;      // 接收方已有、无需发送的块（发送方使用）
+    QHash<qint64, LocalBlock> localBlocks; // 可从本地文件读取的清单块（接收方使用）
+    QFile *localSource;           // 当前读取本地块的文件
+    DeltaEncoder *deltaEncoder;   // 增量编码器（发送方增量模式）
+    DeltaDecoder *deltaDecoder;   // 增量解码器（接收方增量模式）
+    bool deltaRequested;          // 接收方期望增量指令（发送方使用）
+    QString tempPath;             // 增量模式下写入新版本的临时文件
+    QByteArray deltaPending;      // 已还原但尚未凑满一个清单块的数据
+    FileTypePolicy typePolicy;    // 文件类型策略（接收方使用）
+    bool typeChecked;             // 是否已识别过文件类型
+    bool quarantined;             // 是否已改存到隔离目录
 
     // 初始化文件
     bool initFile();
 
+    // 接收方写入的文件（增量模式下为临时文件）
+    QString writePath() const;
+
+    // 处理缓存或本地已有的下一个块
+    void receiveNextBlock();
+
+    // 当前块是否为可从本地文件读取的清单块的开头
+    bool hasLocalBlock() const;
+
+    // 校验凑满的清单块并写入，损坏时重新请求其中的传输块
+    bool commitManifestBlock(qint64 manifestIndex);
+
+    // 还原一段增量指令，按清单逐块校验后写入
+    bool applyDeltaChunk(const QByteArray &chunk);
+
+    // 按文件头检查类型，拒绝时结束传输并返回false，隔离时改写保存路径
+    bool checkFileType(const QByteArray &head);
+
     // 关闭文件
     void closeFile();
 
     // 更新状态
     void updateStatus(FileTransferStatus newStatus);
+
+    // 完整性校验或类型检查失败：删除已写入的文件并结束传输
+    void failIntegrity(const QString &errorMessage);
 };
 
 } // namespace LocalNetworkApp
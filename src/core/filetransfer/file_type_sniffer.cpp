@@ -0,0 +1,434 @@
+#include "file_type_sniffer.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QList>
+#include <QSettings>
+#include <QStringList>
+#include <QDateTime>
+#include <algorithm>
+#include <cstring>
+#include "../utils/constants.h"
+#include "../utils/persistence_service.h"
+
+namespace LocalNetworkApp {
+
+namespace {
+
+// 签名的一段：在offset处出现的字节序列
+struct Part {
+    int offset;
+    const char *bytes;
+    int length;
+};
+
+// 由字符串字面量构造，长度取数组大小，字面量中可以包含零字节
+template <int N>
+constexpr Part part(int offset, const char (&bytes)[N])
+{
+    return {offset, bytes, N - 1};
+}
+
+// 文件签名：first必须匹配，second可选（用于RIFF、ftyp等容器区分具体格式）
+struct Signature {
+    Part first;
+    Part second;
+    const char *name;
+    FileCategory category;
+};
+
+constexpr Part NONE = {0, nullptr, 0};
+
+// 十六进制转义后紧跟十六进制字符时需要拆开字面量，如"\x7f" "ELF"
+const Signature SIGNATURES[] = {
+    // 可执行文件
+    {part(0, "MZ"), NONE, "PE", FileCategory::Executable},
+    {part(0, "\x7f" "ELF"), NONE, "ELF", FileCategory::Executable},
+    {part(0, "\xfe\xed\xfa\xce"), NONE, "Mach-O", FileCategory::Executable},
+    {part(0, "\xfe\xed\xfa\xcf"), NONE, "Mach-O", FileCategory::Executable},
+    {part(0, "\xce\xfa\xed\xfe"), NONE, "Mach-O", FileCategory::Executable},
+    {part(0, "\xcf\xfa\xed\xfe"), NONE, "Mach-O", FileCategory::Executable},
+    {part(0, "\xca\xfe\xba\xbe"), NONE, "Mach-O/Java class", FileCategory::Executable},
+    {part(0, "dex\n"), NONE, "DEX", FileCategory::Executable},
+    {part(0, "\x00" "asm"), NONE, "WebAssembly", FileCategory::Executable},
+    {part(0, "#!"), NONE, "Script", FileCategory::Executable},
+    {part(0, "L\x00\x00\x00\x01\x14\x02\x00"), NONE, "Windows shortcut", FileCategory::Executable},
+    // MSI安装包也是OLE复合文档，文件头无法与Office 97-2003文档区分，按可执行文件处理
+    {part(0, "\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1"), NONE, "OLE (MSI/Office 97-2003)", FileCategory::Executable},
+
+    // 压缩包
+    {part(0, "PK\x03\x04"), NONE, "ZIP", FileCategory::Archive},
+    {part(0, "PK\x05\x06"), NONE, "ZIP", FileCategory::Archive},
+    {part(0, "PK\x07\x08"), NONE, "ZIP", FileCategory::Archive},
+    {part(0, "Rar!\x1a\x07"), NONE, "RAR", FileCategory::Archive},
+    {part(0, "7z\xbc\xaf\x27\x1c"), NONE, "7z", FileCategory::Archive},
+    {part(0, "\x1f\x8b"), NONE, "gzip", FileCategory::Archive},
+    {part(0, "BZh"), NONE, "bzip2", FileCategory::Archive},
+    {part(0, "\xfd" "7zXZ\x00"), NONE, "xz", FileCategory::Archive},
+    {part(0, "\x28\xb5\x2f\xfd"), NONE, "zstd", FileCategory::Archive},
+    {part(0, "\x04\x22\x4d\x18"), NONE, "LZ4", FileCategory::Archive},
+    {part(0, "MSCF"), NONE, "CAB", FileCategory::Archive},
+    {part(257, "ustar"), NONE, "tar", FileCategory::Archive},
+
+    // 文档
+    {part(0, "%PDF-"), NONE, "PDF", FileCategory::Document},
+    {part(0, "{\\rtf"), NONE, "RTF", FileCategory::Document},
+
+    // 图片
+    {part(0, "\x89PNG\r\n\x1a\n"), NONE, "PNG", FileCategory::Image},
+    {part(0, "\xff\xd8\xff"), NONE, "JPEG", FileCategory::Image},
+    {part(0, "GIF87a"), NONE, "GIF", FileCategory::Image},
+    {part(0, "GIF89a"), NONE, "GIF", FileCategory::Image},
+    {part(0, "RIFF"), part(8, "WEBP"), "WebP", FileCategory::Image},
+    {part(0, "II*\x00"), NONE, "TIFF", FileCategory::Image},
+    {part(0, "MM\x00*"), NONE, "TIFF", FileCategory::Image},
+    {part(0, "BM"), part(6, "\x00\x00\x00\x00"), "BMP", FileCategory::Image},
+    {part(0, "8BPS"), NONE, "PSD", FileCategory::Image},
+    {part(0, "\x00\x00\x01\x00"), NONE, "ICO", FileCategory::Image},
+    {part(4, "ftyp"), part(8, "heic"), "HEIC", FileCategory::Image},
+    {part(4, "ftyp"), part(8, "mif1"), "HEIF", FileCategory::Image},
+    {part(4, "ftyp"), part(8, "avif"), "AVIF", FileCategory::Image},
+
+    // 音频
+    {part(0, "ID3"), NONE, "MP3", FileCategory::Audio},
+    {part(0, "\xff\xfb"), NONE, "MP3", FileCategory::Audio},
+    {part(0, "\xff\xf3"), NONE, "MP3", FileCategory::Audio},
+    {part(0, "\xff\xf2"), NONE, "MP3", FileCategory::Audio},
+    {part(0, "fLaC"), NONE, "FLAC", FileCategory::Audio},
+    {part(0, "OggS"), NONE, "Ogg", FileCategory::Audio},
+    {part(0, "RIFF"), part(8, "WAVE"), "WAV", FileCategory::Audio},
+    {part(0, "MThd"), NONE, "MIDI", FileCategory::Audio},
+    {part(4, "ftyp"), part(8, "M4A "), "M4A", FileCategory::Audio},
+
+    // 视频（其余ftyp容器按MP4/MOV处理）
+    {part(0, "RIFF"), part(8, "AVI "), "AVI", FileCategory::Video},
+    {part(0, "\x1a\x45\xdf\xa3"), NONE, "Matroska/WebM", FileCategory::Video},
+    {part(0, "FLV\x01"), NONE, "FLV", FileCategory::Video},
+    {part(0, "\x00\x00\x01\xba"), NONE, "MPEG-PS", FileCategory::Video},
+    {part(0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11"), NONE, "ASF/WMV", FileCategory::Video},
+    {part(4, "ftyp"), NONE, "MP4", FileCategory::Video},
+};
+
+// 编译后的签名表
+//
+// 首段在文件开头的签名按首字节分桶，识别时只比较一个桶；其余签名单独列出。
+// 每个列表按签名总长度从长到短排列，较具体的签名（如ftyp加品牌）优先匹配。
+struct SignatureTable {
+    QList<const Signature *> byFirstByte[256];
+    QList<const Signature *> atOffset;
+
+    SignatureTable()
+    {
+        for (const Signature &signature : SIGNATURES) {
+            if (signature.first.offset == 0) {
+                byFirstByte[static_cast<uchar>(signature.first.bytes[0])].append(&signature);
+            } else {
+                atOffset.append(&signature);
+            }
+        }
+
+        auto longerFirst = [](const Signature *a, const Signature *b) {
+            return a->first.length + a->second.length > b->first.length + b->second.length;
+        };
+        for (QList<const Signature *> &bucket : byFirstByte) {
+            std::stable_sort(bucket.begin(), bucket.end(), longerFirst);
+        }
+        std::stable_sort(atOffset.begin(), atOffset.end(), longerFirst);
+    }
+};
+
+const SignatureTable &signatureTable()
+{
+    static const SignatureTable table;
+    return table;
+}
+
+bool matches(const Part &part, const char *data, qsizetype length)
+{
+    if (!part.bytes) {
+        return true;
+    }
+    return part.offset + part.length <= length &&
+           std::memcmp(data + part.offset, part.bytes, part.length) == 0;
+}
+
+bool matches(const Signature &signature, const char *data, qsizetype length)
+{
+    return matches(signature.first, data, length) && matches(signature.second, data, length);
+}
+
+// 没有固定文件头、由系统按扩展名直接执行的文件（脚本、快捷方式等）
+const char *const EXECUTABLE_EXTENSIONS[] = {
+    "bat", "cmd", "com", "scr", "pif", "cpl", "msi", "msp", "ps1", "psm1",
+    "vbs", "vbe", "js", "jse", "wsf", "wsh", "hta", "lnk", "url", "reg",
+};
+
+bool hasExecutableExtension(const QString &fileName)
+{
+    int dot = fileName.lastIndexOf('.');
+    if (dot < 0) {
+        return false;
+    }
+    QString suffix = fileName.mid(dot + 1).toLower();
+    for (const char *extension : EXECUTABLE_EXTENSIONS) {
+        if (suffix == QLatin1String(extension)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint16 readLe16(const char *data)
+{
+    return static_cast<quint16>(static_cast<uchar>(data[0]) | (static_cast<uchar>(data[1]) << 8));
+}
+
+// 按ZIP第一个条目的文件名细分：OOXML、ODF、EPUB为文档，JAR、APK为可执行文件
+FileType refineZip(const char *data, qsizetype length, const FileType &zip)
+{
+    // 本地文件头：文件名长度位于26，扩展字段长度位于28，文件名从30开始
+    if (length < 30) {
+        return zip;
+    }
+    qsizetype nameLength = readLe16(data + 26);
+    qsizetype extraLength = readLe16(data + 28);
+    if (30 + nameLength > length) {
+        return zip;
+    }
+    QByteArray name = QByteArray::fromRawData(data + 30, nameLength);
+
+    if (name == "[Content_Types].xml" || name.startsWith("_rels/") || name.startsWith("word/") ||
+        name.startsWith("xl/") || name.startsWith("ppt/")) {
+        return {"Office Open XML", FileCategory::Document};
+    }
+    if (name == "AndroidManifest.xml" || name == "classes.dex" || name == "resources.arsc") {
+        return {"APK", FileCategory::Executable};
+    }
+    if (name.startsWith("META-INF/")) {
+        return {"JAR", FileCategory::Executable};
+    }
+    if (name == "mimetype") {
+        // ODF和EPUB的第一个条目是未压缩的mimetype
+        qsizetype contentOffset = 30 + nameLength + extraLength;
+        if (contentOffset < length) {
+            QByteArray mimeType = QByteArray::fromRawData(data + contentOffset, length - contentOffset);
+            if (mimeType.startsWith("application/vnd.oasis.opendocument")) {
+                return {"OpenDocument", FileCategory::Document};
+            }
+            if (mimeType.startsWith("application/epub+zip")) {
+                return {"EPUB", FileCategory::Document};
+            }
+        }
+    }
+    return zip;
+}
+
+// 设置文件中的类别名
+const char *categoryKey(FileCategory category)
+{
+    switch (category) {
+        case FileCategory::Executable: return "executable";
+        case FileCategory::Archive: return "archive";
+        case FileCategory::Document: return "document";
+        case FileCategory::Image: return "image";
+        case FileCategory::Audio: return "audio";
+        case FileCategory::Video: return "video";
+        case FileCategory::Other: break;
+    }
+    return "other";
+}
+
+const FileCategory ALL_CATEGORIES[] = {
+    FileCategory::Other, FileCategory::Executable, FileCategory::Archive, FileCategory::Document,
+    FileCategory::Image, FileCategory::Audio, FileCategory::Video,
+};
+
+} // namespace
+
+FileType FileTypeSniffer::detect(const char *data, qsizetype length)
+{
+    if (!data || length <= 0) {
+        return FileType();
+    }
+
+    const SignatureTable &table = signatureTable();
+    const Signature *found = nullptr;
+    for (const Signature *signature : table.byFirstByte[static_cast<uchar>(data[0])]) {
+        if (matches(*signature, data, length)) {
+            found = signature;
+            break;
+        }
+    }
+    if (!found) {
+        for (const Signature *signature : table.atOffset) {
+            if (matches(*signature, data, length)) {
+                found = signature;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        return FileType();
+    }
+
+    // 只有本地文件头（PK\x03\x04）后面是第一个条目的文件名；较短的签名不能按4字节比较
+    FileType type{QString::fromLatin1(found->name), found->category};
+    if (found->first.length == 4 && std::memcmp(found->first.bytes, "PK\x03\x04", 4) == 0) {
+        return refineZip(data, length, type);
+    }
+    return type;
+}
+
+FileType FileTypeSniffer::detect(const QByteArray &data)
+{
+    return detect(data.constData(), data.size());
+}
+
+FileType FileTypeSniffer::detect(const QByteArray &data, const QString &fileName)
+{
+    // 系统按扩展名执行，扩展名危险时不论内容都按可执行文件处理
+    FileType type = detect(data);
+    if (type.category != FileCategory::Executable && hasExecutableExtension(fileName)) {
+        return {"Script/Shortcut", FileCategory::Executable};
+    }
+    return type;
+}
+
+FileType FileTypeSniffer::detectFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return FileType();
+    }
+    return detect(file.read(Constants::FILE_TYPE_SNIFF_SIZE), QFileInfo(filePath).fileName());
+}
+
+QString FileTypeSniffer::categoryName(FileCategory category)
+{
+    switch (category) {
+        case FileCategory::Executable: return "可执行文件";
+        case FileCategory::Archive: return "压缩包";
+        case FileCategory::Document: return "文档";
+        case FileCategory::Image: return "图片";
+        case FileCategory::Audio: return "音频";
+        case FileCategory::Video: return "视频";
+        case FileCategory::Other: break;
+    }
+    return "其他";
+}
+
+FileTypePolicy::FileTypePolicy() :
+    enabled(true),
+    allowedMask(0),
+    blockedAction(Action::Quarantine)
+{
+    // 默认只拦截可执行文件
+    for (FileCategory category : ALL_CATEGORIES) {
+        setAllowed(category, category != FileCategory::Executable);
+    }
+}
+
+FileTypePolicy FileTypePolicy::loadFromLocal()
+{
+    FileTypePolicy policy;
+    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+
+    policy.enabled = settings.value("fileFilter/enabled", policy.enabled).toBool();
+
+    if (settings.contains("fileFilter/allowedCategories")) {
+        QStringList allowed = settings.value("fileFilter/allowedCategories").toStringList();
+        for (FileCategory category : ALL_CATEGORIES) {
+            policy.setAllowed(category, allowed.contains(QString::fromLatin1(categoryKey(category))));
+        }
+    }
+
+    if (settings.contains("fileFilter/blockedAction")) {
+        QString action = settings.value("fileFilter/blockedAction").toString();
+        policy.blockedAction = action == "reject" ? Action::Reject : Action::Quarantine;
+    }
+
+    return policy;
+}
+
+void FileTypePolicy::saveToLocal() const
+{
+    QStringList allowed;
+    for (FileCategory category : ALL_CATEGORIES) {
+        if (isAllowed(category)) {
+            allowed.append(QString::fromLatin1(categoryKey(category)));
+        }
+    }
+
+    PersistenceService *persistence = PersistenceService::instance();
+    persistence->setValue("fileFilter/enabled", enabled);
+    persistence->setValue("fileFilter/allowedCategories", allowed);
+    persistence->setValue("fileFilter/blockedAction",
+                          QString(blockedAction == Action::Reject ? "reject" : "quarantine"));
+}
+
+bool FileTypePolicy::isEnabled() const
+{
+    return enabled;
+}
+
+void FileTypePolicy::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+bool FileTypePolicy::isAllowed(FileCategory category) const
+{
+    return allowedMask & categoryBit(category);
+}
+
+void FileTypePolicy::setAllowed(FileCategory category, bool allowed)
+{
+    if (allowed) {
+        allowedMask |= categoryBit(category);
+    } else {
+        allowedMask &= ~categoryBit(category);
+    }
+}
+
+FileTypePolicy::Action FileTypePolicy::getBlockedAction() const
+{
+    return blockedAction;
+}
+
+void FileTypePolicy::setBlockedAction(Action action)
+{
+    // 不在白名单中的文件只能拒绝或隔离
+    blockedAction = action == Action::Reject ? Action::Reject : Action::Quarantine;
+}
+
+QString FileTypePolicy::getQuarantineDirectory() const
+{
+    return quarantineDirectory;
+}
+
+void FileTypePolicy::setQuarantineDirectory(const QString &directory)
+{
+    quarantineDirectory = directory;
+}
+
+FileTypePolicy::Action FileTypePolicy::evaluate(const FileType &type) const
+{
+    if (!enabled || isAllowed(type.category)) {
+        return Action::Allow;
+    }
+
+    // 未设置隔离目录时无法隔离，改为拒绝
+    if (blockedAction == Action::Quarantine && quarantineDirectory.isEmpty()) {
+        return Action::Reject;
+    }
+    return blockedAction;
+}
+
+QString FileTypePolicy::quarantinePath(const QString &fileName) const
+{
+    // 加上时间戳避免重名，加上后缀避免被直接双击运行
+    return QDir(quarantineDirectory).filePath(
+        QString("%1_%2%3").arg(QDateTime::currentMSecsSinceEpoch()).arg(fileName, Constants::QUARANTINE_SUFFIX));
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,96 @@
+#ifndef FILE_TYPE_SNIFFER_H
+#define FILE_TYPE_SNIFFER_H
+
+#include <QString>
+#include <QByteArray>
+#include "../utils/enums.h"
+
+namespace LocalNetworkApp {
+
+// 按文件头识别出的文件类型
+struct FileType {
+    QString name;                                // 类型名称，如"PNG图片"
+    FileCategory category = FileCategory::Other; // 类别
+};
+
+// 按魔术字节识别文件类型
+//
+// 签名表在首次使用时编译为按首字节分派的查找表，每次识别只比较首字节相同的
+// 少数签名（较长的签名优先）；不在文件开头的签名（如tar、MP4）单独检查。
+// ZIP格式再按第一个条目的文件名区分Office文档、Java包和安卓安装包。
+// 内容识别与文件名无关，改了扩展名的可执行文件同样会被识别出来；给出文件名时，
+// 没有固定文件头的脚本和快捷方式（.bat、.ps1、.vbs、.js、.lnk等）按扩展名识别为可执行文件。
+class FileTypeSniffer {
+public:
+    FileTypeSniffer() = delete;
+    ~FileTypeSniffer() = delete;
+
+    // 识别文件头（通常为收到的第一个数据块）
+    static FileType detect(const char *data, qsizetype length);
+    static FileType detect(const QByteArray &data);
+
+    // 识别文件头，并按保存的文件名检查由系统直接执行的扩展名
+    static FileType detect(const QByteArray &data, const QString &fileName);
+
+    // 识别本地文件（含扩展名检查）
+    static FileType detectFile(const QString &filePath);
+
+    // 类别名称
+    static QString categoryName(FileCategory category);
+};
+
+// 接收文件的类型策略
+//
+// 以类别白名单决定允许接收的文件，不在白名单中的文件按设置拒绝或隔离：
+// 拒绝时在写入任何数据前结束传输，隔离时改存到下载目录的隔离子目录并加上后缀。
+class FileTypePolicy {
+public:
+    enum class Action {
+        Allow,      // 正常接收
+        Reject,     // 拒绝并结束传输
+        Quarantine  // 接收到隔离目录
+    };
+
+    FileTypePolicy();
+    ~FileTypePolicy() = default;
+
+    // 从设置文件加载
+    static FileTypePolicy loadFromLocal();
+
+    // 保存到设置文件
+    void saveToLocal() const;
+
+    // 是否启用类型过滤
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    // 类别是否在白名单中
+    bool isAllowed(FileCategory category) const;
+    void setAllowed(FileCategory category, bool allowed);
+
+    // 不在白名单中的文件的处理方式（拒绝或隔离）
+    Action getBlockedAction() const;
+    void setBlockedAction(Action action);
+
+    // 隔离目录
+    QString getQuarantineDirectory() const;
+    void setQuarantineDirectory(const QString &directory);
+
+    // 判断识别出的类型应如何处理
+    Action evaluate(const FileType &type) const;
+
+    // 文件隔离后的保存路径
+    QString quarantinePath(const QString &fileName) const;
+
+private:
+    bool enabled;              // 是否启用
+    quint32 allowedMask;       // 允许的类别（按FileCategory取值的位）
+    Action blockedAction;      // 不允许的类别的处理方式
+    QString quarantineDirectory; // 隔离目录
+
+    static quint32 categoryBit(FileCategory category) { return 1u << static_cast<int>(category); }
+};
+
+} // namespace LocalNetworkApp
+
+#endif // FILE_TYPE_SNIFFER_H
@@ -0,0 +1,471 @@
+#include "transfer_history_store.h"
+#include <QDataStream>
+#include <QSaveFile>
+#include <QSettings>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+namespace LocalNetworkApp {
+
+QUuid TransferRecord::peerId() const
+{
+    return isSender ? receiverId : senderId;
+}
+
+QJsonObject TransferRecord::toJson() const
+{
+    QJsonObject json;
+    json["sessionId"] = sessionId.toString();
+    json["senderId"] = senderId.toString();
+    json["receiverId"] = receiverId.toString();
+    json["fileName"] = fileName;
+    json["filePath"] = filePath;
+    json["fileSize"] = fileSize;
+    json["timestamp"] = timestamp.toString(Qt::ISODate);
+    json["success"] = success;
+    json["isSender"] = isSender;
+    return json;
+}
+
+TransferRecord TransferRecord::fromJson(const QJsonObject &json)
+{
+    TransferRecord record;
+    record.sessionId = QUuid(json["sessionId"].toString());
+    record.senderId = QUuid(json["senderId"].toString());
+    record.receiverId = QUuid(json["receiverId"].toString());
+    record.fileName = json["fileName"].toString();
+    record.filePath = json["filePath"].toString();
+    record.fileSize = json["fileSize"].toInteger();
+    record.timestamp = QDateTime::fromString(json["timestamp"].toString(), Qt::ISODate);
+    record.success = json["success"].toBool();
+    record.isSender = json["isSender"].toBool();
+    return record;
+}
+
+TransferHistoryStore::TransferHistoryStore(const QString &filePath) :
+    filePath(filePath),
+    deadRecords(0),
+    logSize(0),
+    readOnly(false)
+{
+}
+
+TransferHistoryStore::~TransferHistoryStore()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool TransferHistoryStore::load()
+{
+    records.clear();
+    deadRecords = 0;
+    logSize = 0;
+    readOnly = false;
+    bool needsCompact = false;
+
+    QFile input(filePath);
+    if (input.open(QIODevice::ReadOnly)) {
+        QDataStream header(&input);
+        quint32 magic = 0;
+        quint16 version = 0;
+        header >> magic >> version;
+
+        if (magic == LOG_MAGIC && version == LOG_VERSION) {
+            qint64 headerSize = input.pos();
+            QByteArray data = input.readAll();
+
+            // 逐条读取长度前缀的记录；遇到损坏的记录时向后查找下一条有效记录，
+            // 之后再也没有有效记录时才视为写入中断的尾部
+            qint64 position = 0;
+            qint64 validEnd = 0;
+            int skipped = 0;
+            while (position < data.size()) {
+                qint64 next = findNextRecord(data, position);
+                if (next < 0) {
+                    break;
+                }
+                if (next != position) {
+                    skipped++;
+                }
+
+                quint32 length = qFromBigEndian<quint32>(data.constData() + next);
+                TransferRecord record;
+                decodeRecord(data.mid(next + 4, length), &record);
+                records.append(record);
+                position = next + 4 + length;
+                validEnd = position;
+            }
+            logSize = headerSize + validEnd;
+
+            if (skipped > 0) {
+                // 日志中间有损坏：先保留原文件，再由压缩重写为只含有效记录的日志
+                qWarning() << "传输历史中有" << skipped << "处损坏的记录已跳过:" << filePath;
+                input.close();
+                if (!backupCorruptLog()) {
+                    readOnly = true;
+                    return false;
+                }
+                needsCompact = true;
+            }
+        } else if (magic == LOG_MAGIC && version > LOG_VERSION) {
+            // 新版本写入的日志：只读不写，避免旧版本覆盖用户的历史
+            qWarning() << "传输历史由更新的版本写入，本次不会记录新的传输:" << filePath << version;
+            readOnly = true;
+            return false;
+        } else if (input.size() > 0) {
+            input.close();
+            if (!backupUnrecognizedLog()) {
+                readOnly = true;
+                return false;
+            }
+        }
+        input.close();
+    }
+
+    // 丢弃过期记录并建立索引
+    int expired = applyRetention();
+    deadRecords += expired;
+    rebuildIndexes();
+
+    migrateFromSettings();
+
+    // 跳过了损坏的记录或失效记录超过有效记录时压缩日志，否则直接续写
+    if (needsCompact || (deadRecords > Constants::TRANSFER_HISTORY_COMPACT_MIN &&
+                         deadRecords > records.size())) {
+        return compact();
+    }
+    return openForAppend();
+}
+
+bool TransferHistoryStore::append(const TransferRecord &record)
+{
+    if (readOnly) {
+        return false;
+    }
+
+    if (!file.isOpen() && !openForAppend()) {
+        return false;
+    }
+
+    QByteArray data = encodeRecord(record);
+    if (file.write(data) != data.size() || !file.flush()) {
+        qWarning() << "写入传输历史失败:" << filePath << file.errorString();
+        return false;
+    }
+
+    logSize += data.size();
+    records.append(record);
+    indexRecord(records.size() - 1);
+
+    // 超过条数上限一定比例后再批量丢弃最旧的记录，避免每次追加都重建索引
+    if (records.size() > Constants::TRANSFER_HISTORY_MAX_RECORDS + Constants::TRANSFER_HISTORY_MAX_RECORDS / 10) {
+        deadRecords += applyRetention();
+        rebuildIndexes();
+        if (deadRecords > records.size()) {
+            compact();
+        }
+    }
+    return true;
+}
+
+QList<TransferRecord> TransferHistoryStore::query(const TransferQuery &query) const
+{
+    qint64 fromMs = query.from.isValid() ? query.from.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    qint64 toMs = query.to.isValid() ? query.to.toMSecsSinceEpoch() : std::numeric_limits<qint64>::max();
+    QString prefix = query.namePrefix.toCaseFolded();
+
+    // 从最有选择性的索引取候选记录，再用其余条件过滤
+    QList<int> candidates;
+    if (!query.peerId.isNull()) {
+        candidates = peerIndex.value(query.peerId);
+    } else if (!prefix.isEmpty()) {
+        for (auto it = nameIndex.lowerBound(prefix); it != nameIndex.constEnd() && it.key().startsWith(prefix); ++it) {
+            candidates.append(it.value());
+        }
+    } else {
+        for (auto it = timeIndex.lowerBound(fromMs); it != timeIndex.constEnd() && it.key() < toMs; ++it) {
+            candidates.append(it.value());
+        }
+    }
+
+    QList<int> matched;
+    for (int position : std::as_const(candidates)) {
+        const TransferRecord &record = records.at(position);
+        qint64 timestampMs = record.timestamp.toMSecsSinceEpoch();
+        if (timestampMs < fromMs || timestampMs >= toMs) {
+            continue;
+        }
+        if (!query.peerId.isNull() && record.peerId() != query.peerId) {
+            continue;
+        }
+        if (!prefix.isEmpty() && !record.fileName.toCaseFolded().startsWith(prefix)) {
+            continue;
+        }
+        matched.append(position);
+    }
+
+    std::sort(matched.begin(), matched.end(), [this](int a, int b) {
+        return records.at(a).timestamp > records.at(b).timestamp;
+    });
+    if (query.limit >= 0 && matched.size() > query.limit) {
+        matched.resize(query.limit);
+    }
+
+    QList<TransferRecord> result;
+    result.reserve(matched.size());
+    for (int position : std::as_const(matched)) {
+        result.append(records.at(position));
+    }
+    return result;
+}
+
+int TransferHistoryStore::count() const
+{
+    return records.size();
+}
+
+int TransferHistoryStore::removeOlderThan(const QDateTime &time)
+{
+    qint64 limitMs = time.toMSecsSinceEpoch();
+    int before = records.size();
+    records.removeIf([limitMs](const TransferRecord &record) {
+        return record.timestamp.toMSecsSinceEpoch() < limitMs;
+    });
+
+    int removed = before - records.size();
+    if (removed > 0) {
+        rebuildIndexes();
+        deadRecords += removed;
+        compact();
+    }
+    return removed;
+}
+
+bool TransferHistoryStore::clear()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+
+    records.clear();
+    deadRecords = 0;
+    logSize = 0;
+    readOnly = false;
+    rebuildIndexes();
+
+    return !QFile::exists(filePath) || QFile::remove(filePath);
+}
+
+bool TransferHistoryStore::compact()
+{
+    if (readOnly) {
+        return false;
+    }
+
+    if (file.isOpen()) {
+        file.close();
+    }
+
+    // 写入临时文件后原子替换
+    QSaveFile output(filePath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法压缩传输历史:" << filePath << output.errorString();
+        return false;
+    }
+
+    QDataStream header(&output);
+    header << LOG_MAGIC << LOG_VERSION;
+    qint64 size = sizeof(LOG_MAGIC) + sizeof(LOG_VERSION);
+    for (const TransferRecord &record : std::as_const(records)) {
+        QByteArray data = encodeRecord(record);
+        output.write(data);
+        size += data.size();
+    }
+
+    if (!output.commit()) {
+        qWarning() << "无法压缩传输历史:" << filePath << output.errorString();
+        return false;
+    }
+
+    logSize = size;
+    deadRecords = 0;
+    return openForAppend();
+}
+
+void TransferHistoryStore::indexRecord(int position)
+{
+    const TransferRecord &record = records.at(position);
+    peerIndex[record.peerId()].append(position);
+    timeIndex.insert(record.timestamp.toMSecsSinceEpoch(), position);
+    nameIndex[record.fileName.toCaseFolded()].append(position);
+}
+
+void TransferHistoryStore::rebuildIndexes()
+{
+    peerIndex.clear();
+    timeIndex.clear();
+    nameIndex.clear();
+
+    for (int i = 0; i < records.size(); ++i) {
+        indexRecord(i);
+    }
+}
+
+int TransferHistoryStore::applyRetention()
+{
+    int before = records.size();
+
+    QDateTime oldest = QDateTime::currentDateTime().addDays(-Constants::TRANSFER_HISTORY_RETENTION_DAYS);
+    records.removeIf([&oldest](const TransferRecord &record) {
+        return record.timestamp < oldest;
+    });
+
+    // 只保留最近的记录（日志按完成顺序追加，越靠前越旧）
+    int excess = records.size() - Constants::TRANSFER_HISTORY_MAX_RECORDS;
+    if (excess > 0) {
+        records.remove(0, excess);
+    }
+
+    return before - records.size();
+}
+
+QByteArray TransferHistoryStore::encodeRecord(const TransferRecord &record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << record.sessionId << record.senderId << record.receiverId
+           << record.fileName << record.filePath << record.fileSize
+           << record.timestamp.toMSecsSinceEpoch() << record.success << record.isSender;
+
+    QByteArray data(4, 0);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), data.data());
+    data.append(payload);
+    return data;
+}
+
+bool TransferHistoryStore::decodeRecord(const QByteArray &payload, TransferRecord *record)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_6_5);
+    qint64 timestampMs = 0;
+    stream >> record->sessionId >> record->senderId >> record->receiverId
+           >> record->fileName >> record->filePath >> record->fileSize
+           >> timestampMs >> record->success >> record->isSender;
+    record->timestamp = QDateTime::fromMSecsSinceEpoch(timestampMs);
+
+    // 记录必须恰好占满长度前缀给出的长度
+    return stream.status() == QDataStream::Ok && stream.atEnd();
+}
+
+qint64 TransferHistoryStore::findNextRecord(const QByteArray &data, qint64 from)
+{
+    for (qint64 position = from; data.size() - position >= 4; ++position) {
+        quint32 length = qFromBigEndian<quint32>(data.constData() + position);
+        if (length == 0 || position + 4 + length > data.size()) {
+            continue;
+        }
+
+        TransferRecord record;
+        if (decodeRecord(data.mid(position + 4, length), &record) && !record.sessionId.isNull()) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+bool TransferHistoryStore::backupCorruptLog()
+{
+    QString backupPath = filePath + Constants::UNRECOGNIZED_FILE_SUFFIX + "." +
+                         QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
+    if (!QFile::copy(filePath, backupPath)) {
+        qWarning() << "传输历史已损坏且无法备份，本次不会修改日志:" << filePath;
+        return false;
+    }
+
+    qWarning() << "传输历史已损坏，原文件已备份为:" << backupPath;
+    return true;
+}
+
+bool TransferHistoryStore::backupUnrecognizedLog()
+{
+    QString backupPath = filePath + Constants::UNRECOGNIZED_FILE_SUFFIX + "." +
+                         QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
+    if (!QFile::rename(filePath, backupPath)) {
+        qWarning() << "传输历史格式无效且无法改名保留，本次不会记录新的传输:" << filePath;
+        return false;
+    }
+
+    qWarning() << "传输历史格式无效，已改名保留为:" << backupPath;
+    return true;
+}
+
+bool TransferHistoryStore::openForAppend()
+{
+    if (readOnly) {
+        return false;
+    }
+
+    if (file.isOpen()) {
+        return true;
+    }
+
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开传输历史:" << filePath << file.errorString();
+        return false;
+    }
+
+    if (logSize == 0) {
+        // 新文件（格式无效的文件已在加载时改名保留）：从文件头重新开始
+        file.resize(0);
+        QDataStream header(&file);
+        header << LOG_MAGIC << LOG_VERSION;
+        logSize = file.size();
+    } else if (file.size() > logSize) {
+        // 截断最后一条有效记录之后写入中断的尾部（中间的损坏已在加载时备份并压缩），
+        // 保证新记录紧接在有效记录之后
+        file.resize(logSize);
+    }
+
+    file.seek(file.size());
+    return true;
+}
+
+void TransferHistoryStore::migrateFromSettings()
+{
+    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+    if (!settings.contains("fileTransfers/history")) {
+        return;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(settings.value("fileTransfers/history").toByteArray());
+    const QJsonArray historyArray = doc.array();
+
+    // 旧版记录先合并到内存，随后由压缩一次性写入日志
+    QList<TransferRecord> migrated;
+    for (const QJsonValue &value : historyArray) {
+        migrated.append(TransferRecord::fromJson(value.toObject()));
+    }
+    std::stable_sort(migrated.begin(), migrated.end(), [](const TransferRecord &a, const TransferRecord &b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    records = migrated + records;
+    applyRetention();
+    rebuildIndexes();
+
+    if (compact()) {
+        settings.remove("fileTransfers/history");
+        qInfo() << "已将" << migrated.size() << "条传输记录从旧版设置迁移到传输历史";
+    }
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,125 @@
+#ifndef TRANSFER_HISTORY_STORE_H
+#define TRANSFER_HISTORY_STORE_H
+
+#include <QUuid>
+#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonObject>
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 一条文件传输历史记录
+struct TransferRecord {
+    QUuid sessionId;     // 会话ID
+    QUuid senderId;      // 发送者ID
+    QUuid receiverId;    // 接收者ID
+    QString fileName;    // 文件名
+    QString filePath;    // 本地文件路径（发送方为源文件，接收方为保存位置）
+    qint64 fileSize = 0; // 文件大小
+    QDateTime timestamp; // 完成时间
+    bool success = false;  // 是否成功
+    bool isSender = false; // 本机是否为发送方
+
+    // 对方用户ID
+    QUuid peerId() const;
+
+    // 转换为JSON格式
+    QJsonObject toJson() const;
+
+    // 从JSON格式解析
+    static TransferRecord fromJson(const QJsonObject &json);
+};
+
+// 传输历史查询条件（未设置的条件不限制）
+struct TransferQuery {
+    QUuid peerId;        // 对方用户
+    QDateTime from;      // 起始时间（含）
+    QDateTime to;        // 结束时间（不含）
+    QString namePrefix;  // 文件名前缀（不区分大小写）
+    int limit = -1;      // 最多返回条数，-1为不限制
+};
+
+// 文件传输历史存储
+//
+// 记录以长度前缀的形式追加写入日志文件，启动时重放到内存，
+// 并按对方用户、时间和文件名建立索引。超过保留期限或条数上限的记录
+// 在加载时丢弃，失效记录过多时重写日志进行压缩。
+class TransferHistoryStore {
+public:
+    TransferHistoryStore(const QString &filePath = Constants::TRANSFER_HISTORY_FILE);
+    ~TransferHistoryStore();
+
+    // 加载历史记录（并迁移旧版QSettings中的记录）
+    bool load();
+
+    // 追加一条记录
+    bool append(const TransferRecord &record);
+
+    // 按条件查询，结果按时间从新到旧排列
+    QList<TransferRecord> query(const TransferQuery &query) const;
+
+    // 记录总数
+    int count() const;
+
+    // 删除早于指定时间的记录
+    int removeOlderThan(const QDateTime &time);
+
+    // 清空全部记录
+    bool clear();
+
+    // 重写日志，只保留有效记录
+    bool compact();
+
+private:
+    QString filePath;                        // 日志文件路径
+    QFile file;                              // 追加写入的日志文件
+    QList<TransferRecord> records;           // 有效记录（按追加顺序）
+    QHash<QUuid, QList<int>> peerIndex;      // 对方用户 -> 记录下标
+    QMultiMap<qint64, int> timeIndex;        // 完成时间 -> 记录下标
+    QMap<QString, QList<int>> nameIndex;     // 文件名（统一大小写） -> 记录下标
+    int deadRecords;                         // 日志中已失效的记录数
+    qint64 logSize;                          // 日志中有效内容的长度
+    bool readOnly;                           // 日志由更新的版本写入，不能修改
+
+    static const quint32 LOG_MAGIC = 0x4C4E5448; // "LNTH"
+    static const quint16 LOG_VERSION = 1;
+
+    // 把记录加入内存索引
+    void indexRecord(int position);
+
+    // 重建全部索引
+    void rebuildIndexes();
+
+    // 丢弃超过保留期限和条数上限的记录，返回丢弃的条数
+    int applyRetention();
+
+    // 编码一条记录（含长度前缀）
+    static QByteArray encodeRecord(const TransferRecord &record);
+
+    // 打开日志文件用于追加，必要时写入文件头
+    bool openForAppend();
+
+    // 把无法识别的日志改名保留，之后从新日志开始
+    bool backupUnrecognizedLog();
+
+    // 复制一份中间有损坏记录的日志，之后压缩为只含有效记录的日志
+    bool backupCorruptLog();
+
+    // 解码一条记录的内容（不含长度前缀），内容不完整或有多余数据时返回false
+    static bool decodeRecord(const QByteArray &payload, TransferRecord *record);
+
+    // 在data中从from开始查找下一条可以完整解码的记录，找不到时返回-1
+    static qint64 findNextRecord(const QByteArray &data, qint64 from);
+
+    // 迁移旧版QSettings中的历史记录
+    void migrateFromSettings();
+};
+
+} // namespace LocalNetworkApp
+
+#endif // TRANSFER_HISTORY_STORE_H
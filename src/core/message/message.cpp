@@ -1,4 +1,6 @@
 #include "message.h"
+#include <QJsonDocument>
+#include "../utils/binary_codec.h"
 
 namespace LocalNetworkApp {
 
@@ -13,6 +15,12 @@ Message::Message(QUuid senderId, QUuid receiverId, const QString &content, Messa
 {
 }
 
+Message::Message() :
+    type(MessageType::Text),
+    read(false)
+{
+}
+
 Message::Message(const QJsonObject &json) :
     messageId(QUuid(json["messageId"].toString())),
     senderId(QUuid(json["senderId"].toString())),
@@ -77,4 +85,52 @@ QJsonObject Message::toJson() const
     return json;
 }
 
+QByteArray Message::toBinary() const
+{
+    QByteArray data;
+    data.reserve(1 + 16 * 3 + 1 + 8 + 1 + 4 + content.size() * 3);
+
+    BinaryWriter writer(&data);
+    writer.writeUInt8(BINARY_VERSION);
+    writer.writeUuid(messageId);
+    writer.writeUuid(senderId);
+    writer.writeUuid(receiverId);
+    writer.writeUInt8(static_cast<quint8>(type));
+    writer.writeDateTime(timestamp);
+    writer.writeUInt8(read ? 1 : 0);
+    writer.writeString(content);
+    return data;
+}
+
+Message Message::fromBinary(const QByteArray &data, bool *ok)
+{
+    // 旧版记录是JSON对象，以'{'开头
+    if (data.startsWith('{')) {
+        QJsonDocument doc = QJsonDocument::fromJson(data);
+        if (ok) {
+            *ok = doc.isObject();
+        }
+        return doc.isObject() ? Message(doc.object()) : Message();
+    }
+
+    Message message;
+    BinaryReader reader(data);
+    bool valid = reader.readUInt8() == BINARY_VERSION;
+    if (valid) {
+        message.messageId = reader.readUuid();
+        message.senderId = reader.readUuid();
+        message.receiverId = reader.readUuid();
+        message.type = static_cast<MessageType>(reader.readUInt8());
+        message.timestamp = reader.readDateTime();
+        message.read = reader.readUInt8() != 0;
+        message.content = reader.readString();
+        valid = reader.isOk();
+    }
+
+    if (ok) {
+        *ok = valid;
+    }
+    return valid ? message : Message();
+}
+
 } // namespace LocalNetworkApp
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <QString>
 #include <QDateTime>
 #include <QJsonObject>
+#include <QByteArray>
 #include "../utils/enums.h"
 
 namespace LocalNetworkApp {
@@ -42,7 +43,17 @@ public:
     // 转换为JSON格式
     QJsonObject toJson() const;
 
+    // 转换为紧凑二进制格式
+    QByteArray toBinary() const;
+
+    // 从二进制格式解析，同时兼容旧版JSON格式；ok返回是否解析成功
+    static Message fromBinary(const QByteArray &data, bool *ok = nullptr);
+
 private:
+    Message();
+
+    static const quint8 BINARY_VERSION = 1; // 二进制格式版本
+
     QUuid messageId;    // 消息唯一标识符
     QUuid senderId;     // 发送者ID
     QUuid receiverId;   // 接收者ID
@@ -0,0 +1,113 @@
+#include "message_cache.h"
+
+namespace LocalNetworkApp {
+
+MessageCache::MessageCache(qint64 budgetBytes) :
+    pages(budgetBytes),
+    hits(0),
+    misses(0)
+{
+}
+
+void MessageCache::setBudget(qint64 budgetBytes)
+{
+    pages.setMaxCost(qMax<qint64>(budgetBytes, 0));
+}
+
+qint64 MessageCache::budget() const
+{
+    return pages.maxCost();
+}
+
+QList<StoredMessage> MessageCache::readRange(MessageStore &store, QUuid contactId, int first, int count)
+{
+    QList<StoredMessage> result;
+    if (first < 0 || count <= 0) {
+        return result;
+    }
+
+    // 按索引中的消息条数确定会话末尾，损坏记录造成的短页不代表历史已读完
+    const int pageSize = Constants::MESSAGE_CACHE_PAGE_SIZE;
+    int end = qMin(first + count, store.count(contactId));
+    if (first >= end) {
+        return result;
+    }
+    result.reserve(end - first);
+
+    for (int page = first / pageSize; page <= (end - 1) / pageSize; ++page) {
+        PageKey key{contactId, page};
+
+        // object()会把命中的页移到最近使用的位置
+        QList<StoredMessage> messages;
+        if (const QList<StoredMessage> *cached = pages.object(key)) {
+            messages = *cached;
+            hits++;
+        } else {
+            messages = store.readRange(contactId, page * pageSize, pageSize);
+            misses++;
+
+            // 开销超过预算的页不会被缓存，QCache会直接释放
+            pages.insert(key, new QList<StoredMessage>(messages), estimateCost(messages));
+        }
+
+        // 取出与请求区间重叠的部分（损坏的记录不在页中，按位置而不是下标判断）
+        for (const StoredMessage &item : std::as_const(messages)) {
+            if (item.position >= first && item.position < end) {
+                result.append(item);
+            }
+        }
+    }
+
+    return result;
+}
+
+void MessageCache::invalidate(QUuid contactId, int position)
+{
+    if (position >= 0) {
+        pages.remove(PageKey{contactId, position / Constants::MESSAGE_CACHE_PAGE_SIZE});
+    }
+}
+
+void MessageCache::invalidateContact(QUuid contactId)
+{
+    const QList<PageKey> keys = pages.keys();
+    for (const PageKey &key : keys) {
+        if (key.contactId == contactId) {
+            pages.remove(key);
+        }
+    }
+}
+
+void MessageCache::clear()
+{
+    pages.clear();
+}
+
+MessageCacheStats MessageCache::stats() const
+{
+    MessageCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.residentBytes = pages.totalCost();
+    stats.budgetBytes = pages.maxCost();
+    stats.pages = pages.count();
+    return stats;
+}
+
+void MessageCache::resetStats()
+{
+    hits = 0;
+    misses = 0;
+}
+
+qint64 MessageCache::estimateCost(const QList<StoredMessage> &messages)
+{
+    // 消息对象本身、字符串和时间的堆数据头，以及内容的UTF-16字符
+    qint64 cost = sizeof(QList<StoredMessage>);
+    for (const StoredMessage &item : messages) {
+        cost += sizeof(StoredMessage) + 64 + item.message.getContent().size() * sizeof(QChar);
+    }
+    return cost;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,87 @@
+#ifndef MESSAGE_CACHE_H
+#define MESSAGE_CACHE_H
+
+#include <QUuid>
+#include <QList>
+#include <QCache>
+#include <QHashFunctions>
+#include "message.h"
+#include "message_store.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 消息缓存的统计信息
+struct MessageCacheStats {
+    qint64 hits = 0;          // 命中的页数
+    qint64 misses = 0;        // 未命中、从磁盘读取的页数
+    qint64 residentBytes = 0; // 当前缓存的估算内存占用
+    qint64 budgetBytes = 0;   // 内存占用上限
+    int pages = 0;            // 当前缓存的页数
+
+    // 命中率（0到1，尚无访问时为0）
+    double hitRate() const { return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0; }
+};
+
+// 会话消息页的LRU缓存
+//
+// 每个联系人的消息按固定条数分页，页在首次读取时从消息日志加载，
+// 按估算的内存占用计入预算，超出预算时淘汰最久未使用的页。
+// 消息追加或标志变化时，调用方负责使受影响的页失效。
+class MessageCache {
+public:
+    MessageCache(qint64 budgetBytes = Constants::MESSAGE_CACHE_BUDGET_BYTES);
+    ~MessageCache() = default;
+
+    // 设置内存占用上限（字节），超出部分立即淘汰
+    void setBudget(qint64 budgetBytes);
+
+    // 获取内存占用上限
+    qint64 budget() const;
+
+    // 读取从first开始的最多count条消息（带日志位置），未缓存的页从store加载
+    QList<StoredMessage> readRange(MessageStore &store, QUuid contactId, int first, int count);
+
+    // 使包含position的页失效
+    void invalidate(QUuid contactId, int position);
+
+    // 使该联系人的全部页失效
+    void invalidateContact(QUuid contactId);
+
+    // 清空缓存
+    void clear();
+
+    // 获取统计信息
+    MessageCacheStats stats() const;
+
+    // 重置命中统计
+    void resetStats();
+
+private:
+    // 缓存页的键
+    struct PageKey {
+        QUuid contactId; // 联系人
+        int page;        // 页号（第一条消息的位置除以页大小）
+
+        bool operator==(const PageKey &other) const
+        {
+            return page == other.page && contactId == other.contactId;
+        }
+
+        friend size_t qHash(const PageKey &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.contactId, key.page);
+        }
+    };
+
+    QCache<PageKey, QList<StoredMessage>> pages; // 缓存页（总开销为估算的字节数）
+    qint64 hits;                           // 命中次数
+    qint64 misses;                         // 未命中次数
+
+    // 估算一页消息的内存占用
+    static qint64 estimateCost(const QList<StoredMessage> &messages);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // MESSAGE_CACHE_H
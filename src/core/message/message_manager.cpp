@@ -1,8 +1,6 @@
 #include "message_manager.h"
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QSettings>
 #include <QDateTime>
+#include <QDebug>
 #include "../utils/constants.h"
 
 namespace LocalNetworkApp {
@@ -10,9 +8,26 @@ namespace LocalNetworkApp {
 MessageManager::MessageManager(QObject *parent) :
     QObject(parent),
     incognitoMode(false),
-    unreadCount(0)
+    unreadCount(0),
+    searchCatchingUp(false)
 {
+    readReceiptTimer = new QTimer(this);
+    readReceiptTimer->setSingleShot(true);
+    connect(readReceiptTimer, &QTimer::timeout, this, &MessageManager::flushReadReceipts);
+
     loadMessageHistory();
+
+    // 全文索引在后台线程加载，完成后分批补齐尚未索引的消息
+    searchIndex.loadAsync(this, [this](bool ok) {
+        if (ok) {
+            catchUpSearchIndex();
+        }
+    });
+}
+
+MessageManager::~MessageManager()
+{
+    flushReadReceipts();
 }
 
 void MessageManager::setIncognitoMode(bool enabled)
@@ -40,9 +55,11 @@ bool MessageManager::sendMessage(const Message &message, const UserStatus &recei
 
     // 检查是否在无痕模式下
     if (!incognitoMode) {
-        // 保存消息到历史记录
-        messageHistory[message.getReceiverId()].append(message);
-        saveMessageHistory();
+        // 保存消息到历史记录（追加到日志，批量刷盘）
+        if (messageStore.append(message.getReceiverId(), message, true)) {
+            historyCache.invalidate(message.getReceiverId(), messageStore.count(message.getReceiverId()) - 1);
+            indexMessage(message.getReceiverId(), message);
+        }
     }
 
     emit messageSent(message);
@@ -51,10 +68,22 @@ bool MessageManager::sendMessage(const Message &message, const UserStatus &recei
 
 void MessageManager::receiveMessage(const Message &message)
 {
+    // 对方未收到送达确认时会重发：按最近收到的ID去重（无痕模式下不写日志，只能靠它）。
+    // 发送方第一次来消息时先从日志末尾补入它最近的消息ID，重启后的重发也能识别
+    if (!incognitoMode) {
+        seedReceivedIds(message.getSenderId());
+    }
+    if (!rememberReceived(message.getMessageId())) {
+        return;
+    }
+
     // 检查是否在无痕模式下
     if (!incognitoMode) {
-        // 保存消息到历史记录
-        messageHistory[message.getSenderId()].append(message);
+        // 保存消息到历史记录（追加到日志，批量刷盘）
+        if (messageStore.append(message.getSenderId(), message, false)) {
+            historyCache.invalidate(message.getSenderId(), messageStore.count(message.getSenderId()) - 1);
+            indexMessage(message.getSenderId(), message);
+        }
         
         // 如果消息未读，增加未读计数
         if (!message.isRead()) {
@@ -62,68 +91,79 @@ void MessageManager::receiveMessage(const Message &message)
             contactUnreadCount[message.getSenderId()]++;
             emit unreadMessageCountChanged(unreadCount);
         }
-        
-        saveMessageHistory();
     }
 
     emit messageReceived(message);
 }
 
-QList<Message> MessageManager::getMessageHistory(QUuid contactId) const
+QList<Message> MessageManager::getMessageHistory(QUuid contactId)
+{
+    return messageStore.readAll(contactId);
+}
+
+MessagePage MessageManager::getMessagePage(QUuid contactId, int before, int limit)
 {
-    return messageHistory.value(contactId);
+    MessagePage page;
+    int total = messageStore.count(contactId);
+    if (before < 0 || before > total) {
+        before = total;
+    }
+
+    // 只读取游标之前的limit条消息
+    int first = qMax(0, before - qMax(limit, 0));
+    const QList<StoredMessage> stored = historyCache.readRange(messageStore, contactId, first, before - first);
+    page.messages.reserve(stored.size());
+    for (const StoredMessage &item : stored) {
+        page.messages.append(item.message);
+    }
+    page.cursor = first;
+    page.end = before;
+    page.hasMore = first > 0;
+    return page;
 }
 
 void MessageManager::clearMessageHistory(QUuid contactId)
 {
-    if (messageHistory.contains(contactId)) {
+    if (messageStore.count(contactId) > 0) {
         // 减去该联系人的未读消息数
         unreadCount -= contactUnreadCount.value(contactId, 0);
         contactUnreadCount.remove(contactId);
         emit unreadMessageCountChanged(unreadCount);
-        
-        messageHistory.remove(contactId);
-        saveMessageHistory();
+
+        historyCache.invalidateContact(contactId);
+        messageStore.removeContact(contactId);
+        searchIndex.removeContact(contactId);
+        searchCatchUp.remove(contactId);
     }
 }
 
 void MessageManager::clearAllMessageHistory()
 {
-    messageHistory.clear();
+    pendingReadIds.clear();
     unreadCount = 0;
     contactUnreadCount.clear();
     emit unreadMessageCountChanged(unreadCount);
-    saveMessageHistory();
+    historyCache.clear();
+    messageStore.clear();
+    searchIndex.clear();
+    searchCatchUp.clear();
 }
 
-bool MessageManager::saveMessageHistory() const
+bool MessageManager::saveMessageHistory()
 {
     if (incognitoMode) {
         return true; // 无痕模式下不保存
     }
 
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-    QJsonObject root;
-    
-    // 保存每个联系人的消息历史
-    for (auto it = messageHistory.constBegin(); it != messageHistory.constEnd(); ++it) {
-        QJsonArray messagesArray;
-        for (const auto &message : it.value()) {
-            messagesArray.append(message.toJson());
-        }
-        root[it.key().toString()] = messagesArray;
-    }
-    
-    // 保存未读消息计数
-    QJsonObject unreadObj;
-    for (auto it = contactUnreadCount.constBegin(); it != contactUnreadCount.constEnd(); ++it) {
-        unreadObj[it.key().toString()] = it.value();
-    }
-    root["unreadCount"] = unreadObj;
-    root["totalUnread"] = unreadCount;
-    
-    settings.setValue("messages/history", QString::fromUtf8(QJsonDocument(root).toJson()));
-    return settings.status() == QSettings::NoError;
+    // 消息在收发时已追加到日志，这里只需把已读回执和批量刷盘提前
+    flushReadReceipts();
+    messageStore.sync();
+
+    MessageCacheStats stats = historyCache.stats();
+    qInfo() << "消息页缓存命中率:" << QString::number(stats.hitRate() * 100, 'f', 1) + "%"
+            << "缓存页数:" << stats.pages
+            << "内存占用:" << stats.residentBytes / 1024 << "KB /" << stats.budgetBytes / 1024 << "KB";
+    return true;
 }
 
 bool MessageManager::loadMessageHistory()
@@ -132,83 +172,140 @@ bool MessageManager::loadMessageHistory()
         return true; // 无痕模式下不加载
     }
 
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-    
-    if (!settings.contains("messages/history")) {
-        return false;
-    }
-    
-    QByteArray jsonData = settings.value("messages/history").toByteArray();
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-    QJsonObject root = doc.object();
-    
-    messageHistory.clear();
+    // 旧版本把全部历史保存在QSettings中，首次启动时迁移到消息日志
+    messageStore.migrateFromSettings();
+
     contactUnreadCount.clear();
     unreadCount = 0;
-    
-    // 加载每个联系人的消息历史
-    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
-        if (it.key() == "unreadCount" || it.key() == "totalUnread") {
-            continue; // 跳过特殊字段
-        }
-        
-        QUuid contactId(it.key());
-        QJsonArray messagesArray = it.value().toArray();
-        QList<Message> messages;
-        
-        for (const auto &value : messagesArray) {
-            Message message(value.toObject());
-            messages.append(message);
+
+    // 启动时只读取各联系人的未读计数，消息内容在打开会话时按页读取
+    const QList<QUuid> contacts = messageStore.contacts();
+    for (const QUuid &contactId : contacts) {
+        int count = messageStore.unreadCount(contactId);
+        if (count > 0) {
+            contactUnreadCount[contactId] = count;
+            unreadCount += count;
         }
-        
-        messageHistory[contactId] = messages;
-    }
-    
-    // 加载未读消息计数
-    if (root.contains("unreadCount")) {
-        QJsonObject unreadObj = root["unreadCount"].toObject();
-        for (auto it = unreadObj.constBegin(); it != unreadObj.constEnd(); ++it) {
-            contactUnreadCount[QUuid(it.key())] = it.value().toInt();
+    }
+
+    // 关闭加载过程中打开的日志文件
+    messageStore.sync();
+
+    emit unreadMessageCountChanged(unreadCount);
+    return !contacts.isEmpty();
+}
+
+QList<SearchHit> MessageManager::searchMessages(const QString &query, int limit)
+{
+    return searchIndex.search(query, limit);
+}
+
+void MessageManager::markAsRead(QUuid messageId)
+{
+    markAsRead(QList<QUuid>{messageId});
+}
+
+void MessageManager::markAsRead(const QList<QUuid> &messageIds)
+{
+    if (incognitoMode) {
+        return;
+    }
+
+    for (const QUuid &messageId : messageIds) {
+        pendingReadIds.insert(messageId);
+    }
+
+    // 翻阅会话时会连续产生大量回执，合并后按联系人批量写入
+    if (!pendingReadIds.isEmpty() && !readReceiptTimer->isActive()) {
+        readReceiptTimer->start(Constants::READ_RECEIPT_BATCH_MS);
+    }
+}
+
+void MessageManager::markAllReadUpTo(QUuid contactId, int end)
+{
+    if (incognitoMode || contactUnreadCount.value(contactId, 0) == 0) {
+        return;
+    }
+
+    int cleared = messageStore.markReadUpTo(contactId, end);
+    if (cleared > 0) {
+        historyCache.invalidateContact(contactId);
+    }
+    reduceUnreadCount(contactId, cleared);
+}
+
+void MessageManager::flushReadReceipts()
+{
+    readReceiptTimer->stop();
+    if (pendingReadIds.isEmpty()) {
+        return;
+    }
+
+    // 通过消息ID索引定位，按联系人分组
+    QMap<QUuid, QList<int>> positions;
+    for (const QUuid &messageId : std::as_const(pendingReadIds)) {
+        MessageLocation location;
+        if (messageStore.locate(messageId, &location)) {
+            positions[location.contactId].append(location.position);
         }
     }
-    
-    if (root.contains("totalUnread")) {
-        unreadCount = root["totalUnread"].toInt();
-    } else {
-        // 如果没有保存总未读数，重新计算
-        unreadCount = 0;
-        for (int count : contactUnreadCount) {
-            unreadCount += count;
+    pendingReadIds.clear();
+
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+        for (int position : it.value()) {
+            historyCache.invalidate(it.key(), position);
         }
+        reduceUnreadCount(it.key(), messageStore.markRead(it.key(), it.value()));
+    }
+}
+
+bool MessageManager::rememberReceived(QUuid messageId)
+{
+    if (recentIds.contains(messageId)) {
+        return false;
+    }
+
+    recentIds.insert(messageId);
+    recentOrder.enqueue(messageId);
+    if (recentOrder.size() > Constants::RECEIVED_ID_CACHE_SIZE) {
+        recentIds.remove(recentOrder.dequeue());
     }
-    
-    emit unreadMessageCountChanged(unreadCount);
     return true;
 }
 
-void MessageManager::markAsRead(QUuid messageId)
+void MessageManager::seedReceivedIds(QUuid contactId)
 {
-    for (auto it = messageHistory.begin(); it != messageHistory.end(); ++it) {
-        QList<Message> &messages = it.value();
-        for (int i = 0; i < messages.size(); ++i) {
-            if (messages[i].getMessageId() == messageId && !messages[i].isRead()) {
-                messages[i].setRead(true);
-                
-                // 更新未读计数
-                unreadCount--;
-                contactUnreadCount[it.key()]--;
-                if (contactUnreadCount[it.key()] <= 0) {
-                    contactUnreadCount.remove(it.key());
-                }
-                
-                emit unreadMessageCountChanged(unreadCount);
-                saveMessageHistory();
-                return;
-            }
+    if (seededContacts.contains(contactId)) {
+        return;
+    }
+    seededContacts.insert(contactId);
+
+    // 只读索引末尾定长的一段，不加载整个联系人的索引
+    int total = messageStore.count(contactId);
+    int first = qMax(0, total - Constants::RECEIVED_ID_SEED_COUNT);
+    const QList<MessageIndexEntry> entries = messageStore.readIndex(contactId, first);
+    for (const MessageIndexEntry &entry : entries) {
+        if (!(entry.flags & MessageIndexEntry::Outgoing)) {
+            rememberReceived(entry.messageId);
         }
     }
 }
 
+void MessageManager::reduceUnreadCount(QUuid contactId, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    unreadCount = qMax(0, unreadCount - count);
+    contactUnreadCount[contactId] -= count;
+    if (contactUnreadCount[contactId] <= 0) {
+        contactUnreadCount.remove(contactId);
+    }
+
+    emit unreadMessageCountChanged(unreadCount);
+}
+
 int MessageManager::getUnreadMessageCount() const
 {
     return unreadCount;
@@ -219,4 +316,57 @@ int MessageManager::getUnreadMessageCount(QUuid contactId) const
     return contactUnreadCount.value(contactId, 0);
 }
 
-} // namespace LocalNetworkApp
\ No newline at end of file
+void MessageManager::setHistoryCacheBudget(qint64 budgetBytes)
+{
+    historyCache.setBudget(budgetBytes);
+}
+
+MessageCacheStats MessageManager::getHistoryCacheStats() const
+{
+    return historyCache.stats();
+}
+
+void MessageManager::indexMessage(QUuid contactId, const Message &message)
+{
+    // 索引尚未加载或正在补齐时跳过，补齐时会读到这条消息
+    if (!searchIndex.isLoaded() || searchCatchingUp) {
+        return;
+    }
+
+    int position = messageStore.count(contactId) - 1;
+    if (searchIndex.indexedCount(contactId) <= position) {
+        searchIndex.addMessage(contactId, position, message);
+    }
+}
+
+void MessageManager::catchUpSearchIndex()
+{
+    // 补齐索引文件缺失的消息（首次使用、索引损坏或上次退出前未写入）；
+    // 每次只读取一批，不长时间占用界面线程
+    searchCatchingUp = true;
+    const QList<QUuid> contacts = messageStore.contacts();
+    for (const QUuid &contactId : contacts) {
+        int first = qMax(searchCatchUp.value(contactId, 0), searchIndex.indexedCount(contactId));
+        if (first >= messageStore.count(contactId)) {
+            continue;
+        }
+
+        // 损坏的记录不在结果中，按返回的位置建立索引
+        const QList<StoredMessage> messages = messageStore.readRange(contactId, first, Constants::SEARCH_CATCH_UP_BATCH);
+        for (const StoredMessage &item : messages) {
+            searchIndex.addMessage(contactId, item.position, item.message);
+        }
+        searchCatchUp[contactId] = first + Constants::SEARCH_CATCH_UP_BATCH;
+
+        QTimer::singleShot(0, this, &MessageManager::catchUpSearchIndex);
+        return;
+    }
+
+    searchCatchUp.clear();
+    searchCatchingUp = false;
+
+    // 关闭补齐过程中打开的日志文件
+    messageStore.sync();
+}
+
+} // namespace LocalNetworkApp
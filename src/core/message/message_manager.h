@@ -5,17 +5,32 @@
 #include <QMap>
 #include <QList>
 #include <QUuid>
+#include <QSet>
+#include <QHash>
+#include <QQueue>
+#include <QTimer>
 #include "message.h"
+#include "message_store.h"
+#include "message_search_index.h"
+#include "message_cache.h"
 #include "../user/user_status.h"
 
 namespace LocalNetworkApp {
 
+// 一页消息历史
+struct MessagePage {
+    QList<Message> messages; // 本页消息，按时间先后排列
+    int cursor = 0;          // 本页第一条消息的位置，作为请求更早一页的游标
+    int end = 0;             // 本页覆盖到的位置（不含），其中损坏而无法读取的消息不在messages中
+    bool hasMore = false;    // 是否还有更早的消息
+};
+
 class MessageManager : public QObject {
     Q_OBJECT
 
 public:
     MessageManager(QObject *parent = nullptr);
-    ~MessageManager() = default;
+    ~MessageManager();
 
     // 设置是否启用无痕模式
     void setIncognitoMode(bool enabled);
@@ -29,8 +44,11 @@ public:
     // 接收消息
     void receiveMessage(const Message &message);
 
-    // 获取与特定联系人的消息历史
-    QList<Message> getMessageHistory(QUuid contactId) const;
+    // 获取与特定联系人的全部消息历史（会读取整个会话，界面显示应使用分页接口）
+    QList<Message> getMessageHistory(QUuid contactId);
+
+    // 获取游标before之前的最多limit条消息（before为-1时从最新消息开始）
+    MessagePage getMessagePage(QUuid contactId, int before = -1, int limit = Constants::MESSAGE_PAGE_SIZE);
 
     // 清除与特定联系人的消息历史
     void clearMessageHistory(QUuid contactId);
@@ -38,21 +56,36 @@ public:
     // 清除所有消息历史
     void clearAllMessageHistory();
 
-    // 保存消息历史到本地
-    bool saveMessageHistory() const;
+    // 把尚未落盘的消息历史写入磁盘
+    bool saveMessageHistory();
 
     // 从本地加载消息历史
     bool loadMessageHistory();
 
-    // 设置消息为已读
+    // 搜索聊天记录（索引在后台加载和补齐，完成前只返回已索引的消息）
+    QList<SearchHit> searchMessages(const QString &query, int limit = Constants::SEARCH_RESULT_LIMIT);
+
+    // 设置消息为已读（短时间内的多次调用合并为一次写入）
     void markAsRead(QUuid messageId);
 
+    // 设置一批消息为已读
+    void markAsRead(const QList<QUuid> &messageIds);
+
+    // 把与联系人的会话中位置在end之前的消息全部设为已读（end为已显示的最后一条之后的位置）
+    void markAllReadUpTo(QUuid contactId, int end);
+
     // 获取未读消息数量
     int getUnreadMessageCount() const;
 
     // 获取与特定联系人的未读消息数量
     int getUnreadMessageCount(QUuid contactId) const;
 
+    // 设置消息页缓存的内存占用上限（字节）
+    void setHistoryCacheBudget(qint64 budgetBytes);
+
+    // 获取消息页缓存的命中率和内存占用
+    MessageCacheStats getHistoryCacheStats() const;
+
 signals:
     // 当收到新消息时发出
     void messageReceived(const Message &message);
@@ -66,11 +99,39 @@ signals:
     // 当未读消息数量变化时发出
     void unreadMessageCountChanged(int count);
 
+private slots:
+    // 写入积攒的已读回执
+    void flushReadReceipts();
+
 private:
-    QMap<QUuid, QList<Message>> messageHistory; // 消息历史，按联系人ID组织
+    MessageStore messageStore; // 追加式消息日志（消息历史按联系人分页读取）
+    MessageSearchIndex searchIndex; // 聊天记录全文索引
+    MessageCache historyCache; // 最近读取的消息页（LRU，按内存预算淘汰）
     bool incognitoMode; // 无痕模式标志
     int unreadCount; // 未读消息总数
     QMap<QUuid, int> contactUnreadCount; // 每个联系人的未读消息数
+    QSet<QUuid> pendingReadIds; // 等待写入的已读消息ID
+    QSet<QUuid> recentIds; // 最近收到的消息ID（无痕模式下也用于去重）
+    QQueue<QUuid> recentOrder; // recentIds的加入顺序，超出上限时淘汰最早的
+    QSet<QUuid> seededContacts; // 已从日志补入最近消息ID的联系人
+    QTimer *readReceiptTimer; // 已读回执合并定时器
+    QHash<QUuid, int> searchCatchUp; // 补齐全文索引时每个联系人下一批的起始位置
+    bool searchCatchingUp; // 是否正在补齐全文索引
+
+    // 记录收到的消息ID，已经收到过时返回false
+    bool rememberReceived(QUuid messageId);
+
+    // 联系人第一次来消息时，把日志末尾该联系人发来的消息ID加入recentIds
+    void seedReceivedIds(QUuid contactId);
+
+    // 按联系人调整未读计数
+    void reduceUnreadCount(QUuid contactId, int count);
+
+    // 把刚追加的消息加入全文索引
+    void indexMessage(QUuid contactId, const Message &message);
+
+    // 补齐一批尚未索引的消息，还有剩余时在下一轮事件循环继续
+    void catchUpSearchIndex();
 };
 
 } // namespace LocalNetworkApp
@@ -0,0 +1,547 @@
+#include "message_search_index.h"
+#include <QDataStream>
+#include <QThreadPool>
+#include <QPromise>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include "../data/security_manager.h"
+
+namespace LocalNetworkApp {
+
+MessageSearchIndex::MessageSearchIndex(const QString &filePath) :
+    filePath(filePath),
+    loaded(false),
+    generation(0)
+{
+    file.setKey(SecurityManager::storageKey());
+}
+
+MessageSearchIndex::~MessageSearchIndex()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool MessageSearchIndex::load()
+{
+    if (loaded) {
+        return true;
+    }
+
+    generation++;
+    discardPlainIndex();
+    return adopt(replay(filePath, file.isEncrypted() ? SecurityManager::storageKey() : QByteArray()));
+}
+
+void MessageSearchIndex::loadAsync(QObject *context, std::function<void(bool)> callback)
+{
+    if (loaded) {
+        QMetaObject::invokeMethod(context, [callback]() { callback(true); }, Qt::QueuedConnection);
+        return;
+    }
+
+    discardPlainIndex();
+
+    auto promise = std::make_shared<QPromise<Replay>>();
+    auto *watcher = new QFutureWatcher<Replay>(context);
+    int started = generation;
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context, [this, watcher, started, callback]() {
+        Replay result = watcher->result();
+        watcher->deleteLater();
+
+        // 等待期间已同步加载时直接使用；被清空时后台结果已过期，重新加载（文件已删除，无需重放）
+        if (loaded) {
+            callback(true);
+        } else if (generation != started) {
+            callback(load());
+        } else {
+            callback(adopt(std::move(result)));
+        }
+    });
+    watcher->setFuture(promise->future());
+
+    // 重放只读取文件，索引文件在接管结果之前不会被写入
+    QString path = filePath;
+    QByteArray key = file.isEncrypted() ? SecurityManager::storageKey() : QByteArray();
+    QThreadPool::globalInstance()->start([promise, path, key]() {
+        promise->start();
+        promise->addResult(replay(path, key));
+        promise->finish();
+    });
+}
+
+void MessageSearchIndex::discardPlainIndex()
+{
+    // 索引可以重建，旧版明文索引不做转换
+    if (file.isEncrypted() && QFile::exists(filePath) && !PagedFile::isEncryptedFile(filePath)) {
+        qInfo() << "搜索索引将以加密格式重建:" << filePath;
+        QFile::remove(filePath);
+    }
+}
+
+MessageSearchIndex::Replay MessageSearchIndex::replay(const QString &filePath, const QByteArray &key)
+{
+    Replay result;
+    PagedFile input(filePath, key);
+    if (!QFile::exists(filePath) || !input.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+
+    QDataStream stream(&input);
+    stream.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    if (input.size() > 0) {
+        stream >> magic >> version;
+    }
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        if (input.size() > 0) {
+            qWarning() << "搜索索引格式无效，将重建:" << filePath;
+        }
+        return result;
+    }
+
+    result.recognized = true;
+    result.validSize = input.pos();
+    while (!stream.atEnd()) {
+        quint8 type = 0;
+        stream >> type;
+
+        if (type == AddRecord) {
+            Document document;
+            quint32 termCount = 0;
+            stream >> document.contactId >> document.messageId >> document.position
+                   >> document.timestamp >> termCount;
+
+            QMap<QString, QList<quint16>> terms;
+            for (quint32 i = 0; i < termCount && stream.status() == QDataStream::Ok; ++i) {
+                QString term;
+                QList<quint16> positions;
+                stream >> term >> positions;
+                terms.insert(term, positions);
+            }
+
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+            result.contents.indexDocument(document, terms);
+        } else if (type == RemoveRecord) {
+            QUuid contactId;
+            stream >> contactId;
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+            result.contents.removeContact(contactId);
+        } else {
+            break;
+        }
+
+        result.validSize = input.pos();
+    }
+    return result;
+}
+
+bool MessageSearchIndex::adopt(Replay result)
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开搜索索引:" << filePath << file.errorString();
+        return false;
+    }
+
+    if (!result.recognized) {
+        // 新文件或无法识别的格式：重建索引（由调用方补齐消息）
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_6_5);
+        file.resize(0);
+        file.seek(0);
+        stream << INDEX_MAGIC << INDEX_VERSION;
+        file.flush();
+        contents = Contents();
+        loaded = true;
+        return true;
+    }
+
+    // 丢弃崩溃时只写了一部分的记录
+    if (result.validSize < file.size()) {
+        qWarning() << "搜索索引尾部不完整，已截断:" << filePath;
+        file.resize(result.validSize);
+    }
+    file.seek(file.size());
+
+    contents = std::move(result.contents);
+    loaded = true;
+    return true;
+}
+
+bool MessageSearchIndex::isLoaded() const
+{
+    return loaded;
+}
+
+void MessageSearchIndex::addMessage(QUuid contactId, int position, const Message &message)
+{
+    if (!loaded) {
+        return;
+    }
+
+    // 统计每个词的出现位置，位置超出上限的部分不再索引
+    QList<int> positions;
+    const QStringList tokens = tokenize(message.getContent(), false, &positions);
+    QMap<QString, QList<quint16>> terms;
+    for (int i = 0; i < tokens.size(); ++i) {
+        if (positions.at(i) > std::numeric_limits<quint16>::max()) {
+            break;
+        }
+        terms[tokens.at(i)].append(static_cast<quint16>(positions.at(i)));
+    }
+
+    Document document;
+    document.contactId = contactId;
+    document.messageId = message.getMessageId();
+    document.position = position;
+    document.timestamp = message.getTimestamp().toMSecsSinceEpoch();
+    contents.indexDocument(document, terms);
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << static_cast<quint8>(AddRecord) << document.contactId << document.messageId
+           << document.position << document.timestamp << static_cast<quint32>(terms.size());
+    for (auto it = terms.constBegin(); it != terms.constEnd(); ++it) {
+        stream << it.key() << it.value();
+    }
+    appendRecord(record);
+}
+
+int MessageSearchIndex::indexedCount(QUuid contactId) const
+{
+    return contents.contactIndexed.value(contactId, 0);
+}
+
+void MessageSearchIndex::removeContact(QUuid contactId)
+{
+    // 未加载时也要先加载，否则重放时已删除的消息会重新出现
+    if (!load()) {
+        return;
+    }
+
+    contents.removeContact(contactId);
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << static_cast<quint8>(RemoveRecord) << contactId;
+    appendRecord(record);
+}
+
+void MessageSearchIndex::clear()
+{
+    contents = Contents();
+    generation++;
+
+    if (file.isOpen()) {
+        file.close();
+    }
+    QFile::remove(filePath);
+
+    // 已加载时重新创建空索引，继续接收新消息；正在后台加载的结果随之作废
+    if (loaded) {
+        loaded = false;
+        load();
+    }
+}
+
+QList<SearchHit> MessageSearchIndex::search(const QString &query, int limit) const
+{
+    QList<SearchHit> hits;
+    if (!loaded) {
+        return hits;
+    }
+
+    const QList<QueryGroup> groups = parseQuery(query);
+    if (groups.isEmpty()) {
+        return hits;
+    }
+
+    // 各组条件同时满足：求文档集合的交集
+    QSet<quint32> matched;
+    for (int i = 0; i < groups.size(); ++i) {
+        const QMap<quint32, QList<quint16>> groupMatches = matchGroup(groups.at(i));
+        QSet<quint32> documentsInGroup;
+        for (auto it = groupMatches.constBegin(); it != groupMatches.constEnd(); ++it) {
+            if (i == 0 || matched.contains(it.key())) {
+                documentsInGroup.insert(it.key());
+            }
+        }
+
+        matched = documentsInGroup;
+        if (matched.isEmpty()) {
+            return hits;
+        }
+    }
+
+    QList<quint32> ordered;
+    ordered.reserve(matched.size());
+    for (quint32 document : std::as_const(matched)) {
+        if (!contents.documents.at(document).removed) {
+            ordered.append(document);
+        }
+    }
+
+    std::sort(ordered.begin(), ordered.end(), [this](quint32 a, quint32 b) {
+        return contents.documents.at(a).timestamp > contents.documents.at(b).timestamp;
+    });
+    if (limit >= 0 && ordered.size() > limit) {
+        ordered.resize(limit);
+    }
+
+    for (quint32 document : std::as_const(ordered)) {
+        const Document &entry = contents.documents.at(document);
+        SearchHit hit;
+        hit.contactId = entry.contactId;
+        hit.messageId = entry.messageId;
+        hit.position = entry.position;
+        hit.timestamp = QDateTime::fromMSecsSinceEpoch(entry.timestamp);
+        hits.append(hit);
+    }
+
+    return hits;
+}
+
+QStringList MessageSearchIndex::tokenize(const QString &text, bool query, QList<int> *positions)
+{
+    QStringList tokens;
+    QString word;       // 当前的字母数字串
+    QStringList run;    // 当前连续的中日韩文字（每项一个字）
+    int position = 0;   // 下一个词的位置
+
+    auto emitToken = [&tokens, positions](const QString &term, int termPosition) {
+        tokens.append(term);
+        if (positions) {
+            positions->append(termPosition);
+        }
+    };
+
+    auto flushWord = [&word, &position, &emitToken]() {
+        if (!word.isEmpty()) {
+            emitToken(word, position++);
+            word.clear();
+        }
+    };
+
+    auto flushRun = [&run, &position, &emitToken, query]() {
+        if (run.size() == 1) {
+            emitToken(run.first(), position++);
+        } else if (run.size() > 1) {
+            for (int i = 0; i + 1 < run.size(); ++i) {
+                emitToken(run.at(i) + run.at(i + 1), position++);
+            }
+            // 段末的字不是任何二元组的首字，单独索引以便单字前缀查询命中；
+            // 与最后一个二元组共用位置，不影响跨段的短语匹配
+            if (!query) {
+                emitToken(run.last(), position - 1);
+            }
+        }
+        run.clear();
+    };
+
+    for (int i = 0; i < text.size();) {
+        // 按码点遍历，正确处理代理对
+        char32_t codePoint = text.at(i).unicode();
+        int length = 1;
+        if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            codePoint = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            length = 2;
+        }
+        QString character = text.mid(i, length);
+        i += length;
+
+        if (isCjk(codePoint)) {
+            flushWord();
+            run.append(character);
+        } else if (QChar::isLetterOrNumber(codePoint)) {
+            flushRun();
+            word.append(character.toCaseFolded());
+        } else {
+            flushWord();
+            flushRun();
+        }
+    }
+
+    flushWord();
+    flushRun();
+    return tokens;
+}
+
+void MessageSearchIndex::Contents::indexDocument(const Document &document, const QMap<QString, QList<quint16>> &terms)
+{
+    quint32 documentNumber = static_cast<quint32>(documents.size());
+    documents.append(document);
+
+    // 文档号递增，每个倒排表天然按文档号有序
+    for (auto it = terms.constBegin(); it != terms.constEnd(); ++it) {
+        postings[it.key()].append(Posting{documentNumber, it.value()});
+    }
+
+    int &indexed = contactIndexed[document.contactId];
+    indexed = qMax(indexed, document.position + 1);
+}
+
+void MessageSearchIndex::Contents::removeContact(QUuid contactId)
+{
+    QSet<quint32> removed;
+    for (int i = 0; i < documents.size(); ++i) {
+        Document &document = documents[i];
+        if (!document.removed && document.contactId == contactId) {
+            document.removed = true;
+            removed.insert(static_cast<quint32>(i));
+        }
+    }
+    contactIndexed.remove(contactId);
+
+    if (removed.isEmpty()) {
+        return;
+    }
+
+    // 从倒排表中删除，文档号保持不变
+    for (auto it = postings.begin(); it != postings.end();) {
+        QList<Posting> &list = it.value();
+        list.removeIf([&removed](const Posting &posting) {
+            return removed.contains(posting.document);
+        });
+
+        if (list.isEmpty()) {
+            it = postings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void MessageSearchIndex::appendRecord(const QByteArray &record)
+{
+    if (!file.isOpen()) {
+        return;
+    }
+
+    // 索引可由消息日志重建，只需交给系统缓存，不单独刷盘
+    if (file.write(record) != record.size()) {
+        qWarning() << "写入搜索索引失败:" << filePath << file.errorString();
+    }
+    file.flush();
+}
+
+QList<MessageSearchIndex::QueryGroup> MessageSearchIndex::parseQuery(const QString &query)
+{
+    QList<QueryGroup> groups;
+
+    // 引号外的部分按空白分词，引号内的部分整体作为短语
+    const QStringList parts = query.split('"');
+    for (int i = 0; i < parts.size(); ++i) {
+        if (i % 2 == 1) {
+            QueryGroup group;
+            group.terms = tokenize(parts.at(i), true);
+            if (!group.terms.isEmpty()) {
+                groups.append(group);
+            }
+            continue;
+        }
+
+        const QStringList words = parts.at(i).split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+        for (const QString &word : words) {
+            QueryGroup group;
+            group.terms = tokenize(word, true);
+            group.prefixLast = true;
+            if (!group.terms.isEmpty()) {
+                groups.append(group);
+            }
+        }
+    }
+
+    return groups;
+}
+
+QMap<quint32, QList<quint16>> MessageSearchIndex::matchGroup(const QueryGroup &group) const
+{
+    int last = group.terms.size() - 1;
+    QMap<quint32, QList<quint16>> current = lookup(group.terms.first(), group.prefixLast && last == 0);
+
+    // 第i个词必须出现在起始位置之后第i个位置
+    for (int i = 1; i <= last && !current.isEmpty(); ++i) {
+        const QMap<quint32, QList<quint16>> next = lookup(group.terms.at(i), group.prefixLast && i == last);
+        QMap<quint32, QList<quint16>> matched;
+
+        for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+            auto found = next.constFind(it.key());
+            if (found == next.constEnd()) {
+                continue;
+            }
+
+            QList<quint16> starts;
+            for (quint16 start : it.value()) {
+                if (std::binary_search(found->constBegin(), found->constEnd(), static_cast<quint16>(start + i))) {
+                    starts.append(start);
+                }
+            }
+
+            if (!starts.isEmpty()) {
+                matched.insert(it.key(), starts);
+            }
+        }
+
+        current = matched;
+    }
+
+    return current;
+}
+
+QMap<quint32, QList<quint16>> MessageSearchIndex::lookup(const QString &term, bool prefix) const
+{
+    QMap<quint32, QList<quint16>> result;
+
+    if (!prefix) {
+        auto it = contents.postings.constFind(term);
+        if (it != contents.postings.constEnd()) {
+            for (const Posting &posting : it.value()) {
+                result.insert(posting.document, posting.positions);
+            }
+        }
+        return result;
+    }
+
+    // 词表有序，以该前缀开头的词位于lowerBound之后的连续区间
+    for (auto it = contents.postings.lowerBound(term);
+         it != contents.postings.constEnd() && it.key().startsWith(term); ++it) {
+        for (const Posting &posting : it.value()) {
+            result[posting.document].append(posting.positions);
+        }
+    }
+
+    for (auto it = result.begin(); it != result.end(); ++it) {
+        std::sort(it.value().begin(), it.value().end());
+    }
+    return result;
+}
+
+bool MessageSearchIndex::isCjk(char32_t codePoint)
+{
+    switch (QChar::script(codePoint)) {
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Hangul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace LocalNetworkApp
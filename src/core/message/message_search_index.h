@@ -0,0 +1,152 @@
+#ifndef MESSAGE_SEARCH_INDEX_H
+#define MESSAGE_SEARCH_INDEX_H
+
+#include <QUuid>
+#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QObject>
+#include <functional>
+#include "message.h"
+#include "../data/paged_file.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 一条搜索结果
+struct SearchHit {
+    QUuid contactId;     // 所属联系人
+    QUuid messageId;     // 消息ID
+    int position = -1;   // 在该联系人消息日志中的序号
+    QDateTime timestamp; // 消息时间
+};
+
+// 聊天记录全文索引（倒排索引）
+//
+// 中日韩文字按相邻两字切分（二元组），每段末尾的单字也以相同位置单独索引；
+// 其他文字按字母数字连续串切分并统一大小写。每个词记录出现位置，
+// 用于短语查询；词表按字典序保存，前缀查询只需定位到区间起点。
+// 索引以追加日志的形式保存到磁盘，启动时在后台线程重放；有存储密钥时按页加密，
+// 旧版明文索引直接丢弃并由消息日志重建。
+class MessageSearchIndex {
+public:
+    MessageSearchIndex(const QString &filePath = Constants::SEARCH_INDEX_FILE);
+    ~MessageSearchIndex();
+
+    // 从磁盘加载索引（在调用线程重放索引日志）
+    bool load();
+
+    // 在后台线程重放索引日志，完成后在context所在线程接管结果并调用callback；
+    // 期间已同步加载或清空时丢弃后台结果
+    void loadAsync(QObject *context, std::function<void(bool)> callback);
+
+    // 索引是否已加载
+    bool isLoaded() const;
+
+    // 索引一条消息
+    void addMessage(QUuid contactId, int position, const Message &message);
+
+    // 已索引的该联系人消息条数（用于补齐未索引的消息）
+    int indexedCount(QUuid contactId) const;
+
+    // 移除与联系人的全部消息
+    void removeContact(QUuid contactId);
+
+    // 清空索引
+    void clear();
+
+    // 搜索：空格分隔的词同时出现，引号内为短语，每个未加引号的词的末尾按前缀匹配；
+    // 结果按时间从新到旧排列
+    QList<SearchHit> search(const QString &query, int limit = Constants::SEARCH_RESULT_LIMIT) const;
+
+    // 切分文本；query为true时不生成文档专用的段末单字。
+    // positions返回每个词的位置，段末单字与最后一个二元组位置相同
+    static QStringList tokenize(const QString &text, bool query, QList<int> *positions = nullptr);
+
+private:
+    // 一个词在一条消息中的出现位置
+    struct Posting {
+        quint32 document;          // 文档号
+        QList<quint16> positions;  // 出现位置（升序）
+    };
+
+    // 已索引的消息
+    struct Document {
+        QUuid contactId;       // 所属联系人
+        QUuid messageId;       // 消息ID
+        qint32 position = -1;  // 在联系人日志中的序号
+        qint64 timestamp = 0;  // 消息时间（毫秒）
+        bool removed = false;  // 是否已删除
+    };
+
+    // 查询中需要连续出现的一组词
+    struct QueryGroup {
+        QStringList terms;       // 依次相邻的词
+        bool prefixLast = false; // 最后一个词是否按前缀匹配
+    };
+
+    enum RecordType : quint8 {
+        AddRecord = 1,     // 新增消息
+        RemoveRecord = 2   // 删除联系人
+    };
+
+    // 内存中的索引内容
+    struct Contents {
+        QMap<QString, QList<Posting>> postings;  // 倒排表（按词排序，支持前缀查询）
+        QList<Document> documents;               // 文档表，下标为文档号
+        QHash<QUuid, int> contactIndexed;        // 每个联系人已索引到的消息条数
+
+        // 把一条消息及其词的出现位置加入索引
+        void indexDocument(const Document &document, const QMap<QString, QList<quint16>> &terms);
+
+        // 移除联系人
+        void removeContact(QUuid contactId);
+    };
+
+    // 重放索引日志的结果
+    struct Replay {
+        Contents contents;        // 重放得到的内容
+        bool recognized = false;  // 文件格式是否可识别（否则重建）
+        qint64 validSize = 0;     // 最后一条完整记录的末尾
+    };
+
+    QString filePath;          // 索引文件路径
+    PagedFile file;            // 追加写入的索引文件
+    bool loaded;               // 是否已加载
+    int generation;            // 每次同步加载或清空时递增，用于丢弃过期的后台结果
+    Contents contents;         // 索引内容
+
+    static const quint32 INDEX_MAGIC = 0x4C4E5349; // "LNSI"
+    static const quint16 INDEX_VERSION = 1;
+
+    // 删除旧版明文索引（有存储密钥时）
+    void discardPlainIndex();
+
+    // 读取并重放索引日志（可在任意线程调用，只读取文件）
+    static Replay replay(const QString &filePath, const QByteArray &key);
+
+    // 接管重放结果：打开索引文件用于追加，截断不完整的尾部或为无法识别的文件重建文件头
+    bool adopt(Replay result);
+
+    // 追加一条记录到索引文件
+    void appendRecord(const QByteArray &record);
+
+    // 解析查询
+    static QList<QueryGroup> parseQuery(const QString &query);
+
+    // 查找满足一组连续词的文档及其起始位置
+    QMap<quint32, QList<quint16>> matchGroup(const QueryGroup &group) const;
+
+    // 获取一个词（或前缀）的出现位置
+    QMap<quint32, QList<quint16>> lookup(const QString &term, bool prefix) const;
+
+    // 是否为按二元组切分的文字
+    static bool isCjk(char32_t codePoint);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // MESSAGE_SEARCH_INDEX_H
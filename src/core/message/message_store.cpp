@@ -0,0 +1,783 @@
+#include "message_store.h"
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSettings>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include "../data/security_manager.h"
+
+namespace LocalNetworkApp {
+
+MessageStore::MessageStore(const QString &rootPath, QObject *parent) :
+    QObject(parent),
+    rootPath(rootPath),
+    storageKey(SecurityManager::storageKey()),
+    idIndexLoaded(false)
+{
+    syncTimer = new QTimer(this);
+    syncTimer->setSingleShot(true);
+    connect(syncTimer, &QTimer::timeout, this, &MessageStore::sync);
+}
+
+MessageStore::~MessageStore()
+{
+    sync();
+    qDeleteAll(logs);
+}
+
+bool MessageStore::append(QUuid contactId, const Message &message, bool outgoing)
+{
+    ContactLog *log = openLog(contactId, true);
+    if (!log) {
+        return false;
+    }
+
+    QByteArray payload = encodeRecord(message, outgoing);
+
+    // 当前段写满后切换到新段，旧段从此只读
+    qint64 offset = log->segmentSize;
+    if (offset > 0 && offset + RECORD_HEADER_SIZE + payload.size() > Constants::MESSAGE_SEGMENT_MAX_BYTES) {
+        if (!openSegment(contactId, log, log->segment + 1, true)) {
+            return false;
+        }
+        offset = 0;
+    }
+
+    QByteArray record(RECORD_HEADER_SIZE, 0);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), record.data());
+    record.append(payload);
+
+    if (!log->segmentFile.seek(offset) || log->segmentFile.write(record) != record.size()) {
+        qWarning() << "写入消息记录失败:" << log->segmentFile.fileName() << log->segmentFile.errorString();
+        return false;
+    }
+    log->segmentSize = offset + record.size();
+
+    // 先写记录再写索引，崩溃时最多留下一条可恢复的未索引记录
+    MessageIndexEntry entry;
+    entry.segment = log->segment;
+    entry.offset = static_cast<quint32>(offset);
+    entry.length = static_cast<quint32>(payload.size());
+    entry.flags = (message.isRead() ? MessageIndexEntry::Read : 0) |
+                  (outgoing ? MessageIndexEntry::Outgoing : 0);
+    entry.timestamp = message.getTimestamp().toMSecsSinceEpoch();
+    entry.messageId = message.getMessageId();
+
+    if (!appendIndexEntry(log, entry)) {
+        return false;
+    }
+
+    if (idIndexLoaded) {
+        idIndex.insert(entry.messageId, MessageLocation{contactId, log->entryCount - 1});
+    }
+
+    markDirty(log);
+    return true;
+}
+
+QList<Message> MessageStore::readAll(QUuid contactId)
+{
+    QList<Message> messages;
+    const QList<StoredMessage> stored = readRange(contactId, 0, count(contactId));
+    messages.reserve(stored.size());
+    for (const StoredMessage &item : stored) {
+        messages.append(item.message);
+    }
+    return messages;
+}
+
+QList<StoredMessage> MessageStore::readRange(QUuid contactId, int first, int count)
+{
+    QList<StoredMessage> messages;
+    const QList<MessageIndexEntry> entries = readIndex(contactId, first, count);
+    if (entries.isEmpty()) {
+        return messages;
+    }
+
+    messages.reserve(entries.size());
+    PagedFile segmentFile;
+    segmentFile.setKey(storageKey);
+    quint32 openedSegment = 0;
+
+    for (int i = 0; i < entries.size(); ++i) {
+        const MessageIndexEntry &entry = entries.at(i);
+        if (openedSegment != entry.segment) {
+            segmentFile.close();
+            segmentFile.setFileName(segmentPath(contactId, entry.segment));
+            if (!segmentFile.open(QIODevice::ReadOnly)) {
+                qWarning() << "无法读取消息段文件:" << segmentFile.fileName();
+                openedSegment = 0;
+                continue;
+            }
+            openedSegment = entry.segment;
+        }
+
+        if (!segmentFile.seek(entry.offset + RECORD_HEADER_SIZE)) {
+            continue;
+        }
+
+        bool ok = false;
+        Message message = decodeRecord(segmentFile.read(entry.length), nullptr, &ok);
+        if (!ok) {
+            qWarning() << "消息记录已损坏:" << segmentFile.fileName() << entry.offset;
+            continue;
+        }
+
+        message.setRead(entry.flags & MessageIndexEntry::Read);
+        messages.append(StoredMessage{first + i, message});
+    }
+
+    return messages;
+}
+
+QList<MessageIndexEntry> MessageStore::readIndex(QUuid contactId, int first, int count)
+{
+    QList<MessageIndexEntry> entries;
+    ContactLog *log = openLog(contactId, false);
+    if (!log || first < 0 || first >= log->entryCount) {
+        return entries;
+    }
+
+    if (count < 0 || first + count > log->entryCount) {
+        count = log->entryCount - first;
+    }
+    if (count == 0) {
+        return entries;
+    }
+
+    // 读取前把本进程尚在缓冲区中的写入交给系统
+    log->segmentFile.flush();
+
+    // 索引条目定长，直接定位到第first条
+    if (!log->indexFile.seek(INDEX_HEADER_SIZE + static_cast<qint64>(first) * INDEX_ENTRY_SIZE)) {
+        return entries;
+    }
+
+    QByteArray data = log->indexFile.read(static_cast<qint64>(count) * INDEX_ENTRY_SIZE);
+    int available = data.size() / INDEX_ENTRY_SIZE;
+    entries.reserve(available);
+    for (int i = 0; i < available; ++i) {
+        entries.append(decodeIndexEntry(data.constData() + i * INDEX_ENTRY_SIZE));
+    }
+
+    return entries;
+}
+
+bool MessageStore::setFlags(QUuid contactId, int position, quint32 flags)
+{
+    ContactLog *log = openLog(contactId, false);
+    if (!log || position < 0 || position >= log->entryCount) {
+        return false;
+    }
+
+    quint32 oldFlags = 0;
+    if (!readFlags(log, position, &oldFlags)) {
+        return false;
+    }
+    if (oldFlags == flags) {
+        return true;
+    }
+
+    if (!writeFlags(log, position, flags)) {
+        return false;
+    }
+
+    if (isUnread(oldFlags) != isUnread(flags)) {
+        log->unreadCount += isUnread(flags) ? 1 : -1;
+        writeUnreadCount(log);
+    }
+
+    markDirty(log);
+    return true;
+}
+
+int MessageStore::markRead(QUuid contactId, const QList<int> &positions)
+{
+    ContactLog *log = openLog(contactId, false);
+    if (!log) {
+        return 0;
+    }
+
+    int changed = 0;
+    int cleared = 0;
+    for (int position : positions) {
+        quint32 flags = 0;
+        if (position < 0 || position >= log->entryCount ||
+            !readFlags(log, position, &flags) || (flags & MessageIndexEntry::Read)) {
+            continue;
+        }
+
+        if (writeFlags(log, position, flags | MessageIndexEntry::Read)) {
+            changed++;
+            if (isUnread(flags)) {
+                cleared++;
+            }
+        }
+    }
+
+    // 一批已读回执只更新一次未读计数
+    if (cleared > 0) {
+        log->unreadCount -= cleared;
+        writeUnreadCount(log);
+    }
+    if (changed > 0) {
+        markDirty(log);
+    }
+    return cleared;
+}
+
+int MessageStore::markReadUpTo(QUuid contactId, int end)
+{
+    ContactLog *log = openLog(contactId, false);
+    if (!log || log->unreadCount == 0 || end <= 0) {
+        return 0;
+    }
+
+    // 按日志位置判断，不依赖对方设备的时钟；只扫描定长索引，不读取消息内容
+    QList<int> positions;
+    const QList<MessageIndexEntry> entries = readIndex(contactId, 0, end);
+    for (int i = 0; i < entries.size(); ++i) {
+        if (isUnread(entries.at(i).flags)) {
+            positions.append(i);
+        }
+    }
+
+    return markRead(contactId, positions);
+}
+
+bool MessageStore::locate(QUuid messageId, MessageLocation *location)
+{
+    loadIdIndex();
+
+    auto it = idIndex.constFind(messageId);
+    if (it == idIndex.constEnd()) {
+        return false;
+    }
+
+    if (location) {
+        *location = it.value();
+    }
+    return true;
+}
+
+int MessageStore::count(QUuid contactId)
+{
+    ContactLog *log = openLog(contactId, false);
+    return log ? log->entryCount : 0;
+}
+
+int MessageStore::unreadCount(QUuid contactId)
+{
+    ContactLog *log = openLog(contactId, false);
+    return log ? log->unreadCount : 0;
+}
+
+QList<QUuid> MessageStore::contacts() const
+{
+    QList<QUuid> result;
+    const QStringList names = QDir(rootPath).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &name : names) {
+        QUuid contactId(name);
+        if (!contactId.isNull()) {
+            result.append(contactId);
+        }
+    }
+    return result;
+}
+
+bool MessageStore::removeContact(QUuid contactId)
+{
+    closeLog(contactId);
+
+    // 移除该联系人的消息ID索引
+    for (auto it = idIndex.begin(); it != idIndex.end();) {
+        if (it.value().contactId == contactId) {
+            it = idIndex.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QDir dir(contactPath(contactId));
+    return !dir.exists() || dir.removeRecursively();
+}
+
+bool MessageStore::clear()
+{
+    const QList<QUuid> opened = logs.keys();
+    for (const QUuid &contactId : opened) {
+        closeLog(contactId);
+    }
+    syncTimer->stop();
+    idIndex.clear();
+
+    QDir dir(rootPath);
+    return !dir.exists() || dir.removeRecursively();
+}
+
+void MessageStore::sync()
+{
+    syncTimer->stop();
+
+    QList<QUuid> idle;
+    for (auto it = logs.begin(); it != logs.end(); ++it) {
+        ContactLog *log = it.value();
+        if (log->dirty) {
+            // 先落盘记录再落盘索引，保证索引不会指向未写入的记录
+            log->segmentFile.sync();
+            log->indexFile.sync();
+            log->dirty = false;
+        }
+
+        // 关闭一个刷盘周期内没有写入的日志，限制打开的文件数
+        if (!log->active) {
+            idle.append(it.key());
+        }
+        log->active = false;
+    }
+
+    for (const QUuid &contactId : idle) {
+        closeLog(contactId);
+    }
+}
+
+bool MessageStore::migrateFromSettings()
+{
+    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+    if (!settings.contains("messages/history")) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(settings.value("messages/history").toByteArray());
+    QJsonObject root = doc.object();
+
+    int migrated = 0;
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        if (it.key() == "unreadCount" || it.key() == "totalUnread") {
+            continue; // 未读计数由各条消息的已读标志重新计算
+        }
+
+        QUuid contactId(it.key());
+        if (contactId.isNull()) {
+            continue;
+        }
+
+        const QJsonArray messagesArray = it.value().toArray();
+        for (const QJsonValue &value : messagesArray) {
+            Message message(value.toObject());
+            if (append(contactId, message, message.getSenderId() != contactId)) {
+                migrated++;
+            }
+        }
+    }
+
+    // 确认新存储已落盘后再删除旧数据
+    sync();
+    settings.remove("messages/history");
+
+    qInfo() << "已将" << migrated << "条消息从旧版历史记录迁移到消息日志";
+    return true;
+}
+
+QString MessageStore::contactPath(QUuid contactId) const
+{
+    return rootPath + "/" + contactId.toString(QUuid::WithoutBraces);
+}
+
+QString MessageStore::indexPath(QUuid contactId) const
+{
+    return contactPath(contactId) + "/index.idx";
+}
+
+QString MessageStore::segmentPath(QUuid contactId, quint32 segment) const
+{
+    return contactPath(contactId) + QString("/%1.seg").arg(segment, 6, 10, QChar('0'));
+}
+
+MessageStore::ContactLog *MessageStore::openLog(QUuid contactId, bool create)
+{
+    ContactLog *log = logs.value(contactId, nullptr);
+    if (log) {
+        return log;
+    }
+
+    QDir dir(contactPath(contactId));
+    if (!dir.exists()) {
+        if (!create || !dir.mkpath(".")) {
+            return nullptr;
+        }
+    }
+
+    if (!storageKey.isEmpty() && QFile::exists(indexPath(contactId)) &&
+        !PagedFile::isEncryptedFile(indexPath(contactId)) && !encryptContact(contactId)) {
+        qWarning() << "无法加密消息日志:" << contactPath(contactId);
+        return nullptr;
+    }
+
+    log = new ContactLog;
+    log->indexFile.setKey(storageKey);
+    log->segmentFile.setKey(storageKey);
+    log->indexFile.setFileName(indexPath(contactId));
+    if (!log->indexFile.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开消息索引:" << log->indexFile.fileName() << log->indexFile.errorString();
+        delete log;
+        return nullptr;
+    }
+
+    qint64 size = log->indexFile.size();
+    if (size < INDEX_HEADER_SIZE) {
+        // 新建索引（或只写了一半的文件头）
+        QByteArray header(INDEX_HEADER_SIZE, 0);
+        qToBigEndian<quint32>(INDEX_MAGIC, header.data());
+        qToBigEndian<quint16>(INDEX_VERSION, header.data() + 4);
+        log->indexFile.resize(0);
+        if (log->indexFile.write(header) != header.size()) {
+            qWarning() << "无法写入消息索引:" << log->indexFile.fileName();
+            delete log;
+            return nullptr;
+        }
+        size = INDEX_HEADER_SIZE;
+    } else {
+        QByteArray header = log->indexFile.read(INDEX_HEADER_SIZE);
+        if (qFromBigEndian<quint32>(header.constData()) != INDEX_MAGIC ||
+            qFromBigEndian<quint16>(header.constData() + 4) > INDEX_VERSION) {
+            qWarning() << "消息索引格式无效:" << log->indexFile.fileName();
+            delete log;
+            return nullptr;
+        }
+        log->unreadCount = qFromBigEndian<qint32>(header.constData() + 8);
+    }
+
+    // 丢弃崩溃时只写了一部分的索引条目
+    log->entryCount = static_cast<int>((size - INDEX_HEADER_SIZE) / INDEX_ENTRY_SIZE);
+    qint64 alignedSize = INDEX_HEADER_SIZE + static_cast<qint64>(log->entryCount) * INDEX_ENTRY_SIZE;
+    if (alignedSize != size) {
+        log->indexFile.resize(alignedSize);
+    }
+
+    quint32 segment = 1;
+    qint64 indexedEnd = 0;
+    if (log->entryCount > 0) {
+        log->indexFile.seek(alignedSize - INDEX_ENTRY_SIZE);
+        QByteArray last = log->indexFile.read(INDEX_ENTRY_SIZE);
+        if (last.size() == INDEX_ENTRY_SIZE) {
+            MessageIndexEntry entry = decodeIndexEntry(last.constData());
+            segment = entry.segment;
+            indexedEnd = static_cast<qint64>(entry.offset) + RECORD_HEADER_SIZE + entry.length;
+        }
+    }
+
+    if (!openSegment(contactId, log, segment, false) || !recoverTail(log, indexedEnd)) {
+        delete log;
+        return nullptr;
+    }
+
+    logs.insert(contactId, log);
+    return log;
+}
+
+bool MessageStore::encryptContact(QUuid contactId)
+{
+    // 先转换段文件，最后转换索引：索引仍为明文说明转换未完成，下次打开时继续
+    QDir dir(contactPath(contactId));
+    const QStringList segments = dir.entryList({"*.seg"}, QDir::Files);
+    for (const QString &name : segments) {
+        if (!PagedFile::encryptFile(dir.filePath(name), storageKey)) {
+            return false;
+        }
+    }
+
+    if (!PagedFile::encryptFile(indexPath(contactId), storageKey)) {
+        return false;
+    }
+    qInfo() << "已将消息日志转换为加密格式:" << contactPath(contactId);
+    return true;
+}
+
+void MessageStore::closeLog(QUuid contactId)
+{
+    ContactLog *log = logs.take(contactId);
+    if (!log) {
+        return;
+    }
+
+    if (log->dirty) {
+        log->segmentFile.sync();
+        log->indexFile.sync();
+    }
+    delete log;
+}
+
+bool MessageStore::openSegment(QUuid contactId, ContactLog *log, quint32 segment, bool truncate)
+{
+    if (log->segmentFile.isOpen()) {
+        // 旧段切换前落盘，此后不再写入
+        log->segmentFile.sync();
+        log->segmentFile.close();
+    }
+
+    log->segmentFile.setFileName(segmentPath(contactId, segment));
+    QIODevice::OpenMode mode = QIODevice::ReadWrite;
+    if (truncate) {
+        mode |= QIODevice::Truncate;
+    }
+
+    if (!log->segmentFile.open(mode)) {
+        qWarning() << "无法打开消息段文件:" << log->segmentFile.fileName() << log->segmentFile.errorString();
+        return false;
+    }
+
+    log->segment = segment;
+    log->segmentSize = log->segmentFile.size();
+    return true;
+}
+
+bool MessageStore::recoverTail(ContactLog *log, qint64 indexedEnd)
+{
+    if (log->segmentSize <= indexedEnd) {
+        return true;
+    }
+
+    // 未索引的部分最多是一个段文件的尾部，一次读入后在内存中查找记录
+    log->segmentFile.seek(indexedEnd);
+    QByteArray tail = log->segmentFile.read(log->segmentSize - indexedEnd);
+
+    qint64 position = 0;
+    qint64 validEnd = 0;
+    int recovered = 0;
+    int skipped = 0;
+
+    while (tail.size() - position >= RECORD_HEADER_SIZE) {
+        qint64 next = findNextRecord(tail, position);
+        if (next < 0) {
+            break;
+        }
+        if (next != position) {
+            skipped++;
+        }
+
+        quint32 length = qFromBigEndian<quint32>(tail.constData() + next);
+        bool outgoing = false;
+        Message message = decodeRecord(tail.mid(next + RECORD_HEADER_SIZE, length), &outgoing, nullptr);
+
+        MessageIndexEntry entry;
+        entry.segment = log->segment;
+        entry.offset = static_cast<quint32>(indexedEnd + next);
+        entry.length = length;
+        entry.flags = (message.isRead() ? MessageIndexEntry::Read : 0) |
+                      (outgoing ? MessageIndexEntry::Outgoing : 0);
+        entry.timestamp = message.getTimestamp().toMSecsSinceEpoch();
+        entry.messageId = message.getMessageId();
+
+        if (!appendIndexEntry(log, entry)) {
+            return false;
+        }
+
+        position = next + RECORD_HEADER_SIZE + length;
+        validEnd = position;
+        recovered++;
+    }
+
+    // 截断最后一条有效记录之后的不完整尾部，后续追加从这里开始；
+    // 中间跳过的损坏数据留在段文件中，索引不会指向它们
+    if (indexedEnd + validEnd < log->segmentSize) {
+        log->segmentFile.resize(indexedEnd + validEnd);
+        log->segmentSize = indexedEnd + validEnd;
+    }
+
+    if (skipped > 0) {
+        qWarning() << "消息日志中有" << skipped << "处损坏的记录已跳过:" << log->segmentFile.fileName();
+    }
+    if (recovered > 0) {
+        qInfo() << "消息日志恢复了" << recovered << "条未索引的记录:" << log->segmentFile.fileName();
+        log->dirty = true;
+    }
+
+    return true;
+}
+
+qint64 MessageStore::findNextRecord(const QByteArray &data, qint64 from)
+{
+    // 逐字节尝试：长度前缀落在数据内、内容以记录类型开头且能完整解码才算有效
+    for (qint64 position = from; data.size() - position >= RECORD_HEADER_SIZE; ++position) {
+        quint32 length = qFromBigEndian<quint32>(data.constData() + position);
+        if (length == 0 || position + RECORD_HEADER_SIZE + length > data.size()) {
+            continue;
+        }
+
+        char kind = data.at(position + RECORD_HEADER_SIZE);
+        if (kind != '{' && static_cast<quint8>(kind) != RECORD_BINARY) {
+            continue;
+        }
+
+        bool ok = false;
+        decodeRecord(data.mid(position + RECORD_HEADER_SIZE, length), nullptr, &ok);
+        if (ok) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+bool MessageStore::appendIndexEntry(ContactLog *log, const MessageIndexEntry &entry)
+{
+    QByteArray data = encodeIndexEntry(entry);
+    qint64 offset = INDEX_HEADER_SIZE + static_cast<qint64>(log->entryCount) * INDEX_ENTRY_SIZE;
+    if (!log->indexFile.seek(offset) || log->indexFile.write(data) != data.size()) {
+        qWarning() << "写入消息索引失败:" << log->indexFile.fileName() << log->indexFile.errorString();
+        return false;
+    }
+
+    log->entryCount++;
+
+    if (isUnread(entry.flags)) {
+        log->unreadCount++;
+        return writeUnreadCount(log);
+    }
+    return true;
+}
+
+bool MessageStore::writeUnreadCount(ContactLog *log)
+{
+    // 文件头布局：魔术数字(4) 版本(2) 保留(2) 未读计数(4) 保留(4)
+    char data[4];
+    qToBigEndian<qint32>(qMax(log->unreadCount, 0), data);
+    if (!log->indexFile.seek(8) || log->indexFile.write(data, sizeof(data)) != sizeof(data)) {
+        qWarning() << "更新未读计数失败:" << log->indexFile.fileName();
+        return false;
+    }
+    return true;
+}
+
+bool MessageStore::readFlags(ContactLog *log, int position, quint32 *flags)
+{
+    // 标志位于索引条目的第12字节
+    qint64 offset = INDEX_HEADER_SIZE + static_cast<qint64>(position) * INDEX_ENTRY_SIZE + 12;
+    char data[4];
+    if (!log->indexFile.seek(offset) || log->indexFile.read(data, sizeof(data)) != sizeof(data)) {
+        return false;
+    }
+
+    *flags = qFromBigEndian<quint32>(data);
+    return true;
+}
+
+bool MessageStore::writeFlags(ContactLog *log, int position, quint32 flags)
+{
+    // 索引条目定长，直接覆盖标志字段
+    qint64 offset = INDEX_HEADER_SIZE + static_cast<qint64>(position) * INDEX_ENTRY_SIZE + 12;
+    char data[4];
+    qToBigEndian<quint32>(flags, data);
+    if (!log->indexFile.seek(offset) || log->indexFile.write(data, sizeof(data)) != sizeof(data)) {
+        qWarning() << "更新消息标志失败:" << log->indexFile.fileName();
+        return false;
+    }
+    return true;
+}
+
+void MessageStore::markDirty(ContactLog *log)
+{
+    log->dirty = true;
+    log->active = true;
+
+    // 合并一段时间内的写入统一刷盘
+    if (!syncTimer->isActive()) {
+        syncTimer->start(Constants::MESSAGE_STORE_SYNC_INTERVAL_MS);
+    }
+}
+
+void MessageStore::loadIdIndex()
+{
+    if (idIndexLoaded) {
+        return;
+    }
+
+    // 首次按ID查找时读取各联系人的定长索引建立哈希表，之后随追加增量维护
+    const QList<QUuid> contactIds = contacts();
+    for (const QUuid &contactId : contactIds) {
+        bool wasOpen = logs.contains(contactId);
+        const QList<MessageIndexEntry> entries = readIndex(contactId);
+        for (int i = 0; i < entries.size(); ++i) {
+            idIndex.insert(entries.at(i).messageId, MessageLocation{contactId, i});
+        }
+
+        if (!wasOpen) {
+            closeLog(contactId);
+        }
+    }
+
+    idIndexLoaded = true;
+}
+
+bool MessageStore::isUnread(quint32 flags)
+{
+    return !(flags & MessageIndexEntry::Read) && !(flags & MessageIndexEntry::Outgoing);
+}
+
+QByteArray MessageStore::encodeRecord(const Message &message, bool outgoing)
+{
+    QByteArray payload;
+    payload.append(static_cast<char>(RECORD_BINARY));
+    payload.append(static_cast<char>(outgoing ? RECORD_OUTGOING : 0));
+    payload.append(message.toBinary());
+    return payload;
+}
+
+Message MessageStore::decodeRecord(const QByteArray &payload, bool *outgoing, bool *ok)
+{
+    if (payload.startsWith('{')) {
+        // 旧版JSON记录，发送方向保存在"outgoing"字段中
+        QJsonObject json = QJsonDocument::fromJson(payload).object();
+        if (outgoing) {
+            *outgoing = json["outgoing"].toBool();
+        }
+        if (ok) {
+            *ok = !json.isEmpty();
+        }
+        return Message(json);
+    }
+
+    bool binary = payload.size() > 2 && static_cast<quint8>(payload[0]) == RECORD_BINARY;
+    if (outgoing) {
+        *outgoing = binary && (static_cast<quint8>(payload[1]) & RECORD_OUTGOING);
+    }
+
+    bool valid = false;
+    Message message = Message::fromBinary(binary ? payload.sliced(2) : QByteArray(), &valid);
+    if (ok) {
+        *ok = binary && valid;
+    }
+    return message;
+}
+
+QByteArray MessageStore::encodeIndexEntry(const MessageIndexEntry &entry)
+{
+    // 布局：段号(4) 偏移(4) 长度(4) 标志(4) 时间(8) 消息ID(16) 保留(8)
+    QByteArray data(INDEX_ENTRY_SIZE, 0);
+    char *p = data.data();
+    qToBigEndian<quint32>(entry.segment, p);
+    qToBigEndian<quint32>(entry.offset, p + 4);
+    qToBigEndian<quint32>(entry.length, p + 8);
+    qToBigEndian<quint32>(entry.flags, p + 12);
+    qToBigEndian<qint64>(entry.timestamp, p + 16);
+    QByteArray id = entry.messageId.toRfc4122();
+    memcpy(p + 24, id.constData(), 16);
+    return data;
+}
+
+MessageIndexEntry MessageStore::decodeIndexEntry(const char *data)
+{
+    MessageIndexEntry entry;
+    entry.segment = qFromBigEndian<quint32>(data);
+    entry.offset = qFromBigEndian<quint32>(data + 4);
+    entry.length = qFromBigEndian<quint32>(data + 8);
+    entry.flags = qFromBigEndian<quint32>(data + 12);
+    entry.timestamp = qFromBigEndian<qint64>(data + 16);
+    entry.messageId = QUuid::fromRfc4122(QByteArrayView(data + 24, 16));
+    return entry;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,187 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <QObject>
+#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QUuid>
+#include <QTimer>
+#include <QDateTime>
+#include "message.h"
+#include "../data/paged_file.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 索引条目：每条消息在索引文件中占用固定长度，可按序号直接定位和原地修改
+struct MessageIndexEntry {
+    enum Flag : quint32 {
+        Read = 0x1,     // 已读
+        Outgoing = 0x2  // 本机发出的消息
+    };
+
+    quint32 segment = 0;   // 所在段文件编号
+    quint32 offset = 0;    // 记录在段文件中的偏移
+    quint32 length = 0;    // 记录内容长度（不含长度前缀）
+    quint32 flags = 0;     // 消息标志
+    qint64 timestamp = 0;  // 消息时间（毫秒）
+    QUuid messageId;       // 消息ID
+};
+
+// 消息在日志中的位置
+struct MessageLocation {
+    QUuid contactId;   // 所属联系人
+    int position = -1; // 在该联系人日志中的序号
+};
+
+// 读出的消息及其日志位置
+struct StoredMessage {
+    int position = -1; // 在该联系人日志中的序号
+    Message message;   // 消息内容（已读状态以索引中的标志为准）
+};
+
+// 按联系人分段存储的追加式消息日志
+//
+// 目录结构：<根目录>/<联系人ID>/index.idx 与 000001.seg、000002.seg ...
+// 段文件中每条记录为4字节长度前缀加消息内容（二进制格式，旧版为JSON），只追加不修改；
+// 索引文件头部（含未读计数）之后是定长条目，记录每条消息的位置和标志。
+// 写入先进入系统缓存，由定时器批量刷盘（fsync）。
+// 有存储密钥时索引和段文件都按页加密（见PagedFile），偏移均为明文偏移，
+// 读取一条消息只解密它所在的页；旧版明文日志在首次打开时转换为加密格式。
+class MessageStore : public QObject {
+    Q_OBJECT
+
+public:
+    MessageStore(const QString &rootPath = Constants::MESSAGE_STORE_DIR, QObject *parent = nullptr);
+    ~MessageStore();
+
+    // 追加一条消息，outgoing表示本机发出
+    bool append(QUuid contactId, const Message &message, bool outgoing);
+
+    // 读取与联系人的全部消息（已读状态以索引中的标志为准）
+    QList<Message> readAll(QUuid contactId);
+
+    // 读取从第first条开始的最多count条消息，只访问这些消息所在的位置；
+    // 无法读取的记录被跳过，调用方按返回的位置判断缺失了哪些
+    QList<StoredMessage> readRange(QUuid contactId, int first, int count);
+
+    // 读取从第first条开始的count条索引条目（count为-1时读到末尾）
+    QList<MessageIndexEntry> readIndex(QUuid contactId, int first = 0, int count = -1);
+
+    // 修改第position条消息的标志
+    bool setFlags(QUuid contactId, int position, quint32 flags);
+
+    // 把一批消息标记为已读，返回其中原本未读的对方消息数
+    int markRead(QUuid contactId, const QList<int> &positions);
+
+    // 把位置在end之前的未读消息全部标记为已读，返回标记的条数
+    int markReadUpTo(QUuid contactId, int end);
+
+    // 按消息ID查找消息位置（首次调用时建立索引）
+    bool locate(QUuid messageId, MessageLocation *location);
+
+    // 与联系人的消息数量
+    int count(QUuid contactId);
+
+    // 与联系人的未读消息数量（保存在索引文件头中，无需扫描消息）
+    int unreadCount(QUuid contactId);
+
+    // 已有消息记录的联系人
+    QList<QUuid> contacts() const;
+
+    // 删除与联系人的全部消息
+    bool removeContact(QUuid contactId);
+
+    // 删除全部消息
+    bool clear();
+
+    // 立即把所有未落盘的写入刷到磁盘
+    void sync();
+
+    // 从旧版QSettings中的消息历史迁移（只执行一次，成功后删除旧数据）
+    bool migrateFromSettings();
+
+private:
+    // 单个联系人的打开状态
+    struct ContactLog {
+        PagedFile indexFile;    // 索引文件
+        PagedFile segmentFile;  // 当前写入的段文件
+        quint32 segment = 0;    // 当前段编号
+        qint64 segmentSize = 0; // 当前段已写入的长度
+        int entryCount = 0;     // 索引条目数
+        int unreadCount = 0;    // 对方发来的未读消息数
+        bool dirty = false;     // 是否有未刷盘的写入
+        bool active = false;    // 本个刷盘周期内是否有写入
+    };
+
+    QString rootPath;                     // 存储根目录
+    QByteArray storageKey;                // 本地数据加密密钥（为空时明文存储）
+    QMap<QUuid, ContactLog*> logs;        // 已打开的联系人日志
+    QTimer *syncTimer;                    // 批量刷盘定时器
+    QHash<QUuid, MessageLocation> idIndex; // 消息ID到位置的索引
+    bool idIndexLoaded;                   // 消息ID索引是否已建立
+
+    static const quint32 INDEX_MAGIC = 0x4C4E4D49;  // "LNMI"
+    static const quint16 INDEX_VERSION = 1;
+    static const int INDEX_HEADER_SIZE = 16;
+    static const int INDEX_ENTRY_SIZE = 48;
+    static const int RECORD_HEADER_SIZE = 4;
+    static const quint8 RECORD_BINARY = 1;        // 二进制记录的首字节（JSON记录以'{'开头）
+    static const quint8 RECORD_OUTGOING = 0x01;   // 二进制记录标志：本机发出
+
+    // 联系人目录、索引文件、段文件路径
+    QString contactPath(QUuid contactId) const;
+    QString indexPath(QUuid contactId) const;
+    QString segmentPath(QUuid contactId, quint32 segment) const;
+
+    // 打开联系人日志（不存在时按需创建），并修复崩溃留下的不完整尾部
+    ContactLog *openLog(QUuid contactId, bool create);
+
+    // 把联系人的明文日志转换为加密格式
+    bool encryptContact(QUuid contactId);
+
+    // 关闭联系人日志
+    void closeLog(QUuid contactId);
+
+    // 切换到新的段文件
+    bool openSegment(QUuid contactId, ContactLog *log, quint32 segment, bool truncate);
+
+    // 把段文件中已写入但未进入索引的完整记录补入索引；遇到损坏的记录时向后查找
+    // 下一条有效记录继续恢复，只截断最后一条有效记录之后的不完整尾部
+    bool recoverTail(ContactLog *log, qint64 indexedEnd);
+
+    // 在data中从from开始查找下一条可以完整解码的记录，找不到时返回-1
+    static qint64 findNextRecord(const QByteArray &data, qint64 from);
+
+    // 追加一个索引条目
+    bool appendIndexEntry(ContactLog *log, const MessageIndexEntry &entry);
+
+    // 读写第position条索引条目的标志
+    bool readFlags(ContactLog *log, int position, quint32 *flags);
+    bool writeFlags(ContactLog *log, int position, quint32 flags);
+
+    // 标记日志有未落盘的写入并安排批量刷盘
+    void markDirty(ContactLog *log);
+
+    // 建立消息ID索引
+    void loadIdIndex();
+
+    // 把未读计数写回索引文件头
+    bool writeUnreadCount(ContactLog *log);
+
+    // 标志是否表示一条对方发来的未读消息
+    static bool isUnread(quint32 flags);
+
+    // 编解码段文件中的消息记录（不含长度前缀），兼容旧版JSON记录
+    static QByteArray encodeRecord(const Message &message, bool outgoing);
+    static Message decodeRecord(const QByteArray &payload, bool *outgoing, bool *ok);
+
+    // 编解码索引条目
+    static QByteArray encodeIndexEntry(const MessageIndexEntry &entry);
+    static MessageIndexEntry decodeIndexEntry(const char *data);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // MESSAGE_STORE_H
@@ -8,6 +8,7 @@
 #include <QUuid>
 #include <QtNetwork/QHostAddress>
 #include "message_protocol.h"
+#include "secure_session.h"
 #include "../user/user_status.h"
 #include "../user/contact_manager.h"
 #include "core/utils/constants.h"
@@ -54,6 +55,8 @@ private:
     QTcpSocket *socket;       // 客户端Socket
     QUuid clientId;           // 客户端ID
     QByteArray buffer;        // 数据缓冲区
+    SecureSession session;    // 连接的加密会话
+    QList<MessageProtocol::NetworkMessage> pendingMessages; // 会话建立前待发送的消息
 };
 
 class Server : public QObject {
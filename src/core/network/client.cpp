@@ -4,6 +4,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include "../utils/constants.h"
+#include "../utils/network_utils.h"
 
 namespace LocalNetworkApp {
 
@@ -11,7 +12,9 @@ Client::Client(const UserIdentity &userIdentity, QObject *parent) :
     QObject(parent),
     userIdentity(userIdentity),
     serverPort(Constants::DEFAULT_TCP_PORT),
-    reconnecting(false)
+    reconnecting(false),
+    nextCandidate(0),
+    session(SecureSession::Role::Initiator)
 {
     initSocket();
 }
@@ -23,12 +26,23 @@ Client::~Client()
 }
 
 bool Client::connectToServer(const QHostAddress &serverAddress, quint16 serverPort)
+{
+    return connectToServer(QList<QHostAddress>{serverAddress}, serverPort);
+}
+
+bool Client::connectToServer(const QList<QHostAddress> &serverAddresses, quint16 serverPort)
 {
     if (isConnected()) {
         return true;
     }
 
-    this->serverAddress = serverAddress;
+    QList<QHostAddress> candidates = sortAddressesForRace(serverAddresses);
+    if (candidates.isEmpty()) {
+        return false;
+    }
+
+    this->serverAddresses = candidates;
+    this->serverAddress = candidates.first();
     this->serverPort = serverPort;
 
     // 停止重连定时器
@@ -39,7 +53,7 @@ bool Client::connectToServer(const QHostAddress &serverAddress, quint16 serverPo
     reconnecting = false;
 
     // 连接到服务器
-    tcpSocket->connectToHost(serverAddress, serverPort);
+    startConnectionRace();
 
     return true;
 }
@@ -51,6 +65,7 @@ void Client::disconnectFromServer()
     }
 
     stopTimers();
+    abortConnectionRace();
 
     if (tcpSocket->state() == QAbstractSocket::ConnectedState ||
         tcpSocket->state() == QAbstractSocket::ConnectingState) {
@@ -66,8 +81,13 @@ void Client::sendMessage(const MessageProtocol::NetworkMessage &message)
         return;
     }
 
-    QByteArray data = MessageProtocol::serializeMessage(message);
-    tcpSocket->write(data);
+    // 密钥交换完成前先排队
+    if (!session.isEstablished()) {
+        pendingMessages.append(message);
+        return;
+    }
+
+    tcpSocket->write(session.sealMessage(message));
     tcpSocket->flush();
 }
 
@@ -102,6 +122,11 @@ void Client::onConnected()
 {
     qInfo() << "已连接到服务器:" << serverAddress.toString() << ":" << serverPort;
 
+    // 每个连接使用新的临时密钥，先以明文发送密钥交换消息
+    session.restart();
+    pendingMessages.clear();
+    tcpSocket->write(MessageProtocol::serializeMessage(session.createHandshakeMessage(userIdentity.getUuid())));
+
     // 发送用户身份信息
     QJsonObject identityObj;
     identityObj["uuid"] = userIdentity.getUuid().toString();
@@ -178,7 +203,9 @@ void Client::onReadyRead()
         headerStream >> header.magic >> header.version >> header.contentSize;
 
         // 检查魔术数字和版本
-        if (header.magic != MessageProtocol::MAGIC_NUMBER || header.version != MessageProtocol::PROTOCOL_VERSION) {
+        if (header.magic != MessageProtocol::MAGIC_NUMBER ||
+            (header.version != MessageProtocol::PROTOCOL_VERSION &&
+             header.version != MessageProtocol::SECURE_PROTOCOL_VERSION)) {
             // 无效消息，清空缓冲区
             buffer.clear();
             return;
@@ -194,8 +221,20 @@ void Client::onReadyRead()
         QByteArray messageData = buffer.left(sizeof(MessageProtocol::MessageHeader) + header.contentSize);
         buffer.remove(0, sizeof(MessageProtocol::MessageHeader) + header.contentSize);
 
-        // 解析消息
-        MessageProtocol::NetworkMessage message = MessageProtocol::deserializeMessage(messageData);
+        // 解密消息或处理密钥交换
+        MessageProtocol::NetworkMessage message;
+        SecureSession::FrameResult result = session.processFrame(messageData, &message);
+        if (result == SecureSession::FrameResult::Rejected) {
+            // 认证失败说明数据被篡改或会话不同步，断开连接
+            qWarning() << "收到无效的加密帧，断开连接:" << serverAddress.toString();
+            buffer.clear();
+            tcpSocket->disconnectFromHost();
+            return;
+        }
+        if (result == SecureSession::FrameResult::Handshake) {
+            flushPendingMessages();
+            continue;
+        }
 
         // 处理心跳消息
         if (message.type == NetworkMessageType::Heartbeat) {
@@ -224,7 +263,32 @@ void Client::attemptReconnect()
     }
 
     qInfo() << "尝试重新连接到服务器:" << serverAddress.toString() << ":" << serverPort;
-    tcpSocket->connectToHost(serverAddress, serverPort);
+    startConnectionRace();
+}
+
+void Client::startNextCandidate()
+{
+    if (nextCandidate >= serverAddresses.size()) {
+        return;
+    }
+
+    QHostAddress address = serverAddresses.at(nextCandidate++);
+    QTcpSocket *candidate = new QTcpSocket(this);
+    pendingSockets.append(candidate);
+
+    connect(candidate, &QTcpSocket::connected, this, [this, candidate, address]() {
+        onCandidateConnected(candidate, address);
+    });
+    connect(candidate, &QTcpSocket::errorOccurred, this, [this, candidate](QAbstractSocket::SocketError) {
+        onCandidateFailed(candidate);
+    });
+
+    candidate->connectToHost(address, serverPort);
+
+    // 当前地址迟迟未连通时，不等待其超时，延迟片刻后并行尝试下一个地址
+    if (nextCandidate < serverAddresses.size()) {
+        raceTimer->start(Constants::HAPPY_EYEBALLS_DELAY_MS);
+    }
 }
 
 void Client::initSocket()
@@ -242,6 +306,10 @@ void Client::initSocket()
 
     reconnectTimer = new QTimer(this);
     connect(reconnectTimer, &QTimer::timeout, this, &Client::attemptReconnect);
+
+    raceTimer = new QTimer(this);
+    raceTimer->setSingleShot(true);
+    connect(raceTimer, &QTimer::timeout, this, &Client::startNextCandidate);
 }
 
 void Client::stopTimers()
@@ -262,4 +330,133 @@ void Client::startTimers()
     }
 }
 
+void Client::startConnectionRace()
+{
+    abortConnectionRace();
+
+    if (tcpSocket->state() != QAbstractSocket::UnconnectedState) {
+        tcpSocket->abort();
+    }
+
+    nextCandidate = 0;
+    lastRaceError.clear();
+    startNextCandidate();
+}
+
+void Client::abortConnectionRace()
+{
+    if (raceTimer) {
+        raceTimer->stop();
+    }
+
+    for (QTcpSocket *candidate : std::as_const(pendingSockets)) {
+        candidate->disconnect(this);
+        candidate->abort();
+        candidate->deleteLater();
+    }
+    pendingSockets.clear();
+}
+
+void Client::onCandidateConnected(QTcpSocket *candidate, const QHostAddress &address)
+{
+    // 胜出的连接移出竞速列表，其余连接全部中止
+    pendingSockets.removeOne(candidate);
+    candidate->disconnect(this);
+    abortConnectionRace();
+
+    if (reconnectTimer) {
+        reconnectTimer->stop();
+    }
+
+    serverAddress = address;
+    adoptSocket(candidate);
+    onConnected();
+}
+
+void Client::onCandidateFailed(QTcpSocket *candidate)
+{
+    if (!pendingSockets.removeOne(candidate)) {
+        return;
+    }
+
+    lastRaceError = candidate->errorString();
+    qInfo() << "连接候选地址失败:" << lastRaceError;
+    candidate->disconnect(this);
+    candidate->deleteLater();
+
+    // 当前地址已失败，无需等待延迟，立即尝试下一个地址
+    if (nextCandidate < serverAddresses.size()) {
+        raceTimer->stop();
+        startNextCandidate();
+        return;
+    }
+
+    if (!pendingSockets.isEmpty()) {
+        return;
+    }
+
+    // 所有地址均失败
+    qWarning() << "连接错误:" << lastRaceError;
+    emit connectionError(lastRaceError);
+
+    if (!reconnecting) {
+        reconnecting = true;
+        reconnectTimer->start(5000); // 5秒后尝试重连
+    }
+}
+
+void Client::flushPendingMessages()
+{
+    QList<MessageProtocol::NetworkMessage> messages;
+    messages.swap(pendingMessages);
+    for (const MessageProtocol::NetworkMessage &message : std::as_const(messages)) {
+        sendMessage(message);
+    }
+}
+
+void Client::adoptSocket(QTcpSocket *socket)
+{
+    if (tcpSocket) {
+        tcpSocket->disconnect(this);
+        tcpSocket->abort();
+        tcpSocket->deleteLater();
+    }
+
+    tcpSocket = socket;
+    buffer.clear();
+
+    connect(tcpSocket, &QTcpSocket::disconnected, this, &Client::onDisconnected);
+    connect(tcpSocket, &QTcpSocket::errorOccurred, this, &Client::onError);
+    connect(tcpSocket, &QTcpSocket::readyRead, this, &Client::onReadyRead);
+}
+
+QList<QHostAddress> Client::sortAddressesForRace(const QList<QHostAddress> &addresses)
+{
+    QList<QHostAddress> ipv6;
+    QList<QHostAddress> ipv4;
+
+    for (const QHostAddress &address : addresses) {
+        if (address.isNull()) {
+            continue;
+        }
+
+        QHostAddress normalized = NetworkUtils::normalizeAddress(address);
+        QList<QHostAddress> &family = normalized.protocol() == QAbstractSocket::IPv6Protocol ? ipv6 : ipv4;
+        if (!family.contains(normalized)) {
+            family.append(normalized);
+        }
+    }
+
+    QList<QHostAddress> sorted;
+    for (int i = 0; i < qMax(ipv6.size(), ipv4.size()); ++i) {
+        if (i < ipv6.size()) {
+            sorted.append(ipv6.at(i));
+        }
+        if (i < ipv4.size()) {
+            sorted.append(ipv4.at(i));
+        }
+    }
+    return sorted;
+}
+
 } // namespace LocalNetworkApp
\ No newline at end of file
@@ -6,7 +6,9 @@
 #include <QUuid>
 #include <QTimer>
 #include <QtNetwork/QHostAddress>
+#include <QList>
 #include "message_protocol.h"
+#include "secure_session.h"
 #include "../user/user_status.h"
 #include "../user/userIdentity.h"
 #include "core/utils/constants.h"
@@ -23,6 +25,9 @@ public:
     // 连接到服务器
     bool connectToServer(const QHostAddress &serverAddress, quint16 serverPort = Constants::DEFAULT_TCP_PORT);
 
+    // 连接到有多个地址的服务器，各地址交错竞速，最先建立的连接胜出
+    bool connectToServer(const QList<QHostAddress> &serverAddresses, quint16 serverPort = Constants::DEFAULT_TCP_PORT);
+
     // 断开连接
     void disconnectFromServer();
 
@@ -79,15 +84,25 @@ private slots:
     // 尝试重连
     void attemptReconnect();
 
+    // 启动下一个候选地址的连接
+    void startNextCandidate();
+
 private:
     QTcpSocket *tcpSocket;               // TCP Socket
     UserIdentity userIdentity;           // 用户身份
-    QHostAddress serverAddress;          // 服务器地址
+    QHostAddress serverAddress;          // 服务器地址（竞速胜出的地址）
+    QList<QHostAddress> serverAddresses; // 服务器的全部候选地址（竞速顺序）
+    QList<QTcpSocket*> pendingSockets;   // 正在竞速的连接
+    QTimer *raceTimer;                   // 启动下一个候选地址的定时器
+    int nextCandidate;                   // 下一个候选地址的下标
+    QString lastRaceError;               // 竞速中最后一个失败原因
     quint16 serverPort;                  // 服务器端口
     QByteArray buffer;                   // 数据缓冲区
     QTimer *heartbeatTimer;              // 心跳定时器
     QTimer *reconnectTimer;              // 重连定时器
     bool reconnecting;                   // 是否正在重连
+    SecureSession session;               // 当前连接的加密会话
+    QList<MessageProtocol::NetworkMessage> pendingMessages; // 会话建立前待发送的消息
 
     // 初始化Socket
     void initSocket();
@@ -97,6 +112,27 @@ private:
 
     // 启动定时器
     void startTimers();
+
+    // 从第一个候选地址开始新一轮连接竞速
+    void startConnectionRace();
+
+    // 中止所有未完成的竞速连接
+    void abortConnectionRace();
+
+    // 候选连接建立成功
+    void onCandidateConnected(QTcpSocket *candidate, const QHostAddress &address);
+
+    // 候选连接失败
+    void onCandidateFailed(QTcpSocket *candidate);
+
+    // 会话建立后发送排队的消息
+    void flushPendingMessages();
+
+    // 采用竞速胜出的Socket作为当前连接
+    void adoptSocket(QTcpSocket *socket);
+
+    // 按RFC 8305排列候选地址：去重后IPv6与IPv4交替，IPv6优先
+    static QList<QHostAddress> sortAddressesForRace(const QList<QHostAddress> &addresses);
 };
 
 } // namespace LocalNetworkApp
@@ -0,0 +1,447 @@
+#include "message_outbox.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QDebug>
+#include "../utils/binary_codec.h"
+#include "../data/paged_file.h"
+#include "../data/security_manager.h"
+
+namespace LocalNetworkApp {
+
+MessageOutbox::MessageOutbox(const UserIdentity &userIdentity, UserDiscovery *userDiscovery, Server *server,
+                             QObject *parent) :
+    QObject(parent),
+    userIdentity(userIdentity),
+    userDiscovery(userDiscovery),
+    server(server),
+    liveCount(0),
+    deadRecords(0)
+{
+    loadFromLocal();
+
+    connect(userDiscovery, &UserDiscovery::userDiscovered, this, &MessageOutbox::onUserDiscovered);
+    connect(userDiscovery, &UserDiscovery::userStateChanged, this, &MessageOutbox::onUserStateChanged);
+    connect(userDiscovery, &UserDiscovery::userLost, this, &MessageOutbox::onUserLost);
+    connect(server, &Server::messageReceived, this, &MessageOutbox::onServerMessageReceived);
+
+    retryTimer = new QTimer(this);
+    connect(retryTimer, &QTimer::timeout, this, &MessageOutbox::retryPending);
+    retryTimer->start(Constants::OUTBOX_RETRY_INTERVAL_MS);
+}
+
+MessageOutbox::~MessageOutbox()
+{
+    const QList<QUuid> peers = links.keys();
+    for (const QUuid &peerId : peers) {
+        closeLink(peerId);
+    }
+}
+
+void MessageOutbox::enqueue(const Message &message)
+{
+    QUuid peerId = message.getReceiverId();
+    queues[peerId].append(message);
+    liveCount++;
+
+    QByteArray record;
+    BinaryWriter writer(&record);
+    writer.writeUInt8(RECORD_ENQUEUE);
+    writer.writeUuid(peerId);
+    writer.writeBytes(message.toBinary());
+    appendRecord(record);
+
+    drain(peerId);
+}
+
+void MessageOutbox::drain(QUuid peerId)
+{
+    if (queues.value(peerId).isEmpty()) {
+        return;
+    }
+
+    // 已有连接时直接发送，连接尚未建立时等待connected信号
+    auto it = links.find(peerId);
+    if (it != links.end()) {
+        sendNextBatch(peerId);
+        return;
+    }
+
+    // 只向已确认在线的用户发起连接，缓存中的用户可能已经离线
+    DiscoveredUser user = userDiscovery->getDiscoveredUser(peerId);
+    if (user.userId.isNull() || user.cached || user.port == 0) {
+        return;
+    }
+
+    QList<QHostAddress> addresses = user.addresses;
+    if (addresses.isEmpty() && !user.address.isNull()) {
+        addresses.append(user.address);
+    }
+    if (addresses.isEmpty()) {
+        return;
+    }
+
+    Client *client = new Client(userIdentity, this);
+    links[peerId].client = client;
+
+    connect(client, &Client::connected, this, [this, peerId]() {
+        sendNextBatch(peerId);
+    });
+    connect(client, &Client::reconnected, this, [this, peerId]() {
+        sendNextBatch(peerId);
+    });
+    connect(client, &Client::disconnected, this, [this, peerId]() {
+        // 未确认的批次在重连后重新发送
+        auto link = links.find(peerId);
+        if (link != links.end()) {
+            link->inFlight.clear();
+        }
+    });
+    connect(client, &Client::messageReceived, this, [this, peerId](const MessageProtocol::NetworkMessage &message) {
+        if (message.type == NetworkMessageType::MessageAck) {
+            handleAck(peerId, message.content);
+        }
+    });
+
+    client->connectToServer(addresses, user.port);
+}
+
+QList<Message> MessageOutbox::pendingMessages(QUuid peerId) const
+{
+    return queues.value(peerId);
+}
+
+int MessageOutbox::pendingCount(QUuid peerId) const
+{
+    return queues.value(peerId).size();
+}
+
+void MessageOutbox::onUserDiscovered(const DiscoveredUser &user)
+{
+    drain(user.userId);
+}
+
+void MessageOutbox::onUserStateChanged(QUuid userId, UserState state)
+{
+    Q_UNUSED(state);
+    drain(userId);
+}
+
+void MessageOutbox::onUserLost(QUuid userId)
+{
+    // 队列保留，待对方再次上线后补发
+    closeLink(userId);
+}
+
+void MessageOutbox::onServerMessageReceived(const MessageProtocol::NetworkMessage &message, QUuid senderId)
+{
+    switch (message.type) {
+        case NetworkMessageType::ChatBatch:
+            handleIncoming(senderId, message.content["messages"].toArray());
+            break;
+        case NetworkMessageType::ChatMessage:
+            // 单条聊天消息按只有一条消息的批次处理
+            handleIncoming(senderId, QJsonArray{message.content});
+            break;
+        default:
+            break;
+    }
+}
+
+void MessageOutbox::retryPending()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    const QList<QUuid> peers = queues.keys();
+
+    for (const QUuid &peerId : peers) {
+        auto it = links.find(peerId);
+        if (it != links.end() && !it->inFlight.isEmpty() &&
+            it->sentAt.msecsTo(now) > Constants::OUTBOX_ACK_TIMEOUT_MS) {
+            // 确认超时：丢弃当前连接，重新连接后重发
+            qWarning() << "等待送达确认超时，重新发送:" << peerId.toString();
+            closeLink(peerId);
+        }
+
+        drain(peerId);
+    }
+}
+
+void MessageOutbox::sendNextBatch(QUuid peerId)
+{
+    auto it = links.find(peerId);
+    if (it == links.end() || !it->client->isConnected() || !it->inFlight.isEmpty()) {
+        return;
+    }
+
+    const QList<Message> queue = queues.value(peerId);
+    if (queue.isEmpty()) {
+        // 队列已发完，释放连接
+        closeLink(peerId);
+        return;
+    }
+
+    // 把队首的多条消息合并为一个批次
+    QJsonArray messages;
+    int batchSize = qMin(queue.size(), Constants::OUTBOX_BATCH_SIZE);
+    for (int i = 0; i < batchSize; ++i) {
+        messages.append(queue.at(i).toJson());
+        it->inFlight.append(queue.at(i).getMessageId());
+    }
+
+    QJsonObject content;
+    content["messages"] = messages;
+    it->sentAt = QDateTime::currentDateTime();
+    it->client->sendMessage(MessageProtocol::createChatBatchMessage(userIdentity.getUuid(), content));
+}
+
+void MessageOutbox::handleAck(QUuid peerId, const QJsonObject &content)
+{
+    QSet<QUuid> acked;
+    const QJsonArray ids = content["ids"].toArray();
+    for (const QJsonValue &value : ids) {
+        acked.insert(QUuid(value.toString()));
+    }
+
+    // 逐条删除已确认的消息
+    QList<QUuid> delivered;
+    auto queue = queues.find(peerId);
+    if (queue != queues.end()) {
+        queue->removeIf([&acked, &delivered](const Message &message) {
+            if (acked.contains(message.getMessageId())) {
+                delivered.append(message.getMessageId());
+                return true;
+            }
+            return false;
+        });
+        if (queue->isEmpty()) {
+            queues.erase(queue);
+        }
+    }
+
+    auto link = links.find(peerId);
+    if (link != links.end()) {
+        link->inFlight.removeIf([&acked](const QUuid &messageId) {
+            return acked.contains(messageId);
+        });
+    }
+
+    if (!delivered.isEmpty()) {
+        // 一批确认记为一条日志记录
+        QByteArray record;
+        BinaryWriter writer(&record);
+        writer.writeUInt8(RECORD_ACK);
+        writer.writeUuid(peerId);
+        writer.writeUInt32(static_cast<quint32>(delivered.size()));
+        for (const QUuid &messageId : std::as_const(delivered)) {
+            writer.writeUuid(messageId);
+        }
+        appendRecord(record);
+
+        liveCount -= delivered.size();
+        deadRecords += delivered.size() + 1;
+        compactIfNeeded();
+
+        for (const QUuid &messageId : std::as_const(delivered)) {
+            emit messageDelivered(messageId);
+        }
+    }
+
+    // 当前批次全部确认后发送下一批
+    sendNextBatch(peerId);
+}
+
+void MessageOutbox::handleIncoming(QUuid senderId, const QJsonArray &messages)
+{
+    QJsonArray ids;
+    for (const QJsonValue &value : messages) {
+        Message message(value.toObject());
+
+        // 只接受发送者本人的消息
+        if (message.getMessageId().isNull() || message.getSenderId() != senderId) {
+            continue;
+        }
+
+        emit messageReceived(message);
+        ids.append(message.getMessageId().toString());
+    }
+
+    if (!ids.isEmpty()) {
+        QJsonObject content;
+        content["ids"] = ids;
+        server->sendMessageToClient(senderId, MessageProtocol::createMessageAckMessage(userIdentity.getUuid(), content));
+    }
+}
+
+void MessageOutbox::closeLink(QUuid peerId)
+{
+    auto it = links.find(peerId);
+    if (it == links.end()) {
+        return;
+    }
+
+    Client *client = it->client;
+    links.erase(it);
+
+    // 先断开信号，避免断开连接时回调已删除的链路
+    client->disconnect(this);
+    client->disconnectFromServer();
+    client->deleteLater();
+}
+
+bool MessageOutbox::appendRecord(const QByteArray &record)
+{
+    if (!journal.isOpen()) {
+        return false;
+    }
+
+    QByteArray data;
+    BinaryWriter writer(&data);
+    writer.writeBytes(record);
+    if (!journal.seek(journal.size()) || journal.write(data) != data.size() || !journal.flush()) {
+        qWarning() << "写入发件箱失败:" << Constants::OUTBOX_FILE << journal.errorString();
+        return false;
+    }
+    return true;
+}
+
+void MessageOutbox::compactIfNeeded()
+{
+    // 日志未能打开（如无法解密）时不重写，避免覆盖原文件
+    if (!journal.isOpen()) {
+        return;
+    }
+
+    // 队列清空时日志只剩文件头，重写的代价很小
+    if ((queues.isEmpty() && deadRecords > 0) ||
+        (deadRecords > Constants::OUTBOX_COMPACT_MIN_RECORDS && deadRecords > liveCount)) {
+        compactJournal();
+    }
+}
+
+bool MessageOutbox::compactJournal()
+{
+    QByteArray data;
+    BinaryWriter writer(&data);
+    writer.writeUInt32(OUTBOX_MAGIC);
+    writer.writeUInt16(OUTBOX_VERSION);
+    for (auto it = queues.constBegin(); it != queues.constEnd(); ++it) {
+        for (const Message &message : it.value()) {
+            QByteArray record;
+            BinaryWriter recordWriter(&record);
+            recordWriter.writeUInt8(RECORD_ENQUEUE);
+            recordWriter.writeUuid(it.key());
+            recordWriter.writeBytes(message.toBinary());
+            writer.writeBytes(record);
+        }
+    }
+
+    // 写入临时文件后原子替换，待发送的消息内容与聊天记录一样加密保存
+    journal.close();
+    QByteArray encrypted = PagedFile::encryptBuffer(data, SecurityManager::storageKey());
+    QSaveFile output(Constants::OUTBOX_FILE);
+    bool ok = output.open(QIODevice::WriteOnly) && output.write(encrypted) == encrypted.size() && output.commit();
+    if (!ok) {
+        qWarning() << "无法压缩发件箱:" << Constants::OUTBOX_FILE << output.errorString();
+    } else {
+        deadRecords = 0;
+    }
+
+    journal.setFileName(Constants::OUTBOX_FILE);
+    journal.setKey(SecurityManager::storageKey());
+    if (!journal.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开发件箱:" << Constants::OUTBOX_FILE << journal.errorString();
+        return false;
+    }
+    return ok;
+}
+
+void MessageOutbox::loadFromLocal()
+{
+    QByteArray key = SecurityManager::storageKey();
+    if (!key.isEmpty() && QFile::exists(Constants::OUTBOX_FILE) && !PagedFile::encryptFile(Constants::OUTBOX_FILE, key)) {
+        qWarning() << "发件箱无法加密，本次只在内存中保存待发送的消息:" << Constants::OUTBOX_FILE;
+        return;
+    }
+
+    journal.setFileName(Constants::OUTBOX_FILE);
+    journal.setKey(key);
+    if (!journal.open(QIODevice::ReadWrite)) {
+        qWarning() << "无法打开发件箱，本次只在内存中保存待发送的消息:" << Constants::OUTBOX_FILE << journal.errorString();
+        return;
+    }
+
+    QByteArray data = journal.readAll();
+    if (data.isEmpty()) {
+        compactJournal();
+        return;
+    }
+
+    BinaryReader reader(data);
+    quint32 magic = reader.readUInt32();
+    quint16 version = reader.readUInt16();
+    if (magic == OUTBOX_MAGIC && version == OUTBOX_VERSION) {
+        // 重放日志：入队记录按顺序加入队列，最后去掉已确认的消息
+        QSet<QUuid> acked;
+        qint64 validSize = HEADER_SIZE;
+        int records = 0;
+        while (!reader.atEnd()) {
+            QByteArray record = reader.readBytes();
+            if (!reader.isOk()) {
+                break; // 写入中断的尾部
+            }
+
+            BinaryReader fields(record);
+            quint8 type = fields.readUInt8();
+            QUuid peerId = fields.readUuid();
+            if (type == RECORD_ENQUEUE) {
+                bool ok = false;
+                Message message = Message::fromBinary(fields.readBytes(), &ok);
+                if (ok) {
+                    queues[peerId].append(message);
+                }
+            } else if (type == RECORD_ACK) {
+                quint32 count = fields.readUInt32();
+                for (quint32 i = 0; i < count && fields.isOk(); ++i) {
+                    acked.insert(fields.readUuid());
+                }
+            }
+            validSize += 4 + record.size();
+            records++;
+        }
+
+        for (auto it = queues.begin(); it != queues.end();) {
+            it->removeIf([&acked](const Message &message) {
+                return acked.contains(message.getMessageId());
+            });
+            it = it->isEmpty() ? queues.erase(it) : std::next(it);
+        }
+        for (const QList<Message> &queue : std::as_const(queues)) {
+            liveCount += queue.size();
+        }
+        deadRecords = records - liveCount;
+
+        // 截掉写入中断的尾部，新记录紧接在有效记录之后
+        if (journal.size() > validSize) {
+            journal.resize(validSize);
+        }
+        compactIfNeeded();
+    } else {
+        // 无法识别的文件：改名保留后从空日志开始
+        journal.close();
+        QString backupPath = Constants::OUTBOX_FILE + Constants::UNRECOGNIZED_FILE_SUFFIX + "." +
+                             QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
+        if (!QFile::rename(Constants::OUTBOX_FILE, backupPath)) {
+            qWarning() << "发件箱格式无效且无法改名保留，本次只在内存中保存待发送的消息:" << Constants::OUTBOX_FILE;
+            return;
+        }
+        qWarning() << "发件箱格式无效，已改名保留为:" << backupPath;
+        compactJournal();
+        return;
+    }
+
+    if (liveCount > 0) {
+        qInfo() << "发件箱中有" << liveCount << "条待发送的消息";
+    }
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,127 @@
+#ifndef MESSAGE_OUTBOX_H
+#define MESSAGE_OUTBOX_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QUuid>
+#include <QTimer>
+#include <QDateTime>
+#include <QJsonArray>
+#include "client.h"
+#include "Server.h"
+#include "user_discovery.h"
+#include "message_protocol.h"
+#include "../message/message.h"
+#include "../user/userIdentity.h"
+#include "../utils/constants.h"
+#include "../data/paged_file.h"
+
+namespace LocalNetworkApp {
+
+// 离线消息发件箱（存储转发）
+//
+// 发出的聊天消息先进入按对方用户划分的持久化队列，对方在线时建立连接，
+// 把队列中的消息合并成批次发送，收到对方逐条的送达确认后才从队列中删除。
+// 对方离线、连接断开或确认超时时消息保留在队列中，待对方再次上线后补发。
+// 接收方按消息ID去重，因此重发不会产生重复消息。
+//
+// 队列以追加日志的形式保存：入队和送达确认各追加一条记录，不重写整个文件；
+// 启动时重放日志，失效记录过多时压缩。
+class MessageOutbox : public QObject {
+    Q_OBJECT
+
+public:
+    MessageOutbox(const UserIdentity &userIdentity, UserDiscovery *userDiscovery, Server *server,
+                  QObject *parent = nullptr);
+    ~MessageOutbox();
+
+    // 把一条发出的消息加入发送队列，对方在线时立即发送
+    void enqueue(const Message &message);
+
+    // 尝试把发往该用户的消息全部发出
+    void drain(QUuid peerId);
+
+    // 发往该用户且尚未确认送达的消息
+    QList<Message> pendingMessages(QUuid peerId) const;
+
+    // 发往该用户且尚未确认送达的消息条数
+    int pendingCount(QUuid peerId) const;
+
+signals:
+    // 消息已送达对方
+    void messageDelivered(QUuid messageId);
+
+    // 收到对方发来的聊天消息
+    void messageReceived(const Message &message);
+
+private slots:
+    // 发现用户或用户信息变化
+    void onUserDiscovered(const DiscoveredUser &user);
+
+    // 用户状态变化
+    void onUserStateChanged(QUuid userId, UserState state);
+
+    // 用户离线
+    void onUserLost(QUuid userId);
+
+    // 处理其他用户通过本机服务器发来的消息
+    void onServerMessageReceived(const MessageProtocol::NetworkMessage &message, QUuid senderId);
+
+    // 定期检查确认超时并重试发送
+    void retryPending();
+
+private:
+    // 发往一个用户的连接状态
+    struct PeerLink {
+        Client *client = nullptr;  // 到对方服务器的连接
+        QList<QUuid> inFlight;     // 已发出、等待确认的消息ID
+        QDateTime sentAt;          // 最近一个批次的发送时间
+    };
+
+    UserIdentity userIdentity;             // 本机用户身份
+    UserDiscovery *userDiscovery;          // 用户发现服务（查询对方地址）
+    Server *server;                        // 本机服务器（回复送达确认）
+    QMap<QUuid, QList<Message>> queues;    // 每个用户的待发送消息（按发送顺序）
+    QMap<QUuid, PeerLink> links;           // 正在发送的连接
+    QTimer *retryTimer;                    // 重试定时器
+    PagedFile journal;                     // 发件箱日志（有存储密钥时按页加密）
+    int liveCount;                         // 队列中的消息条数
+    int deadRecords;                       // 日志中已失效的记录数
+
+    static const quint32 OUTBOX_MAGIC = 0x4C4E4F42; // "LNOB"
+    static const quint16 OUTBOX_VERSION = 1;
+    static const int HEADER_SIZE = 6;
+
+    // 日志记录类型
+    static const quint8 RECORD_ENQUEUE = 1; // 入队：对方ID、消息
+    static const quint8 RECORD_ACK = 2;     // 送达确认：对方ID、消息ID列表
+
+    // 连接建立或收到确认后发送下一个批次
+    void sendNextBatch(QUuid peerId);
+
+    // 处理对方的送达确认
+    void handleAck(QUuid peerId, const QJsonObject &content);
+
+    // 处理收到的一批聊天消息并回复确认
+    void handleIncoming(QUuid senderId, const QJsonArray &messages);
+
+    // 关闭到该用户的连接
+    void closeLink(QUuid peerId);
+
+    // 追加一条日志记录
+    bool appendRecord(const QByteArray &record);
+
+    // 失效记录过多或队列已清空时压缩日志
+    void compactIfNeeded();
+
+    // 按当前队列重写日志（原子替换）并重新打开
+    bool compactJournal();
+
+    // 打开日志并重放
+    void loadFromLocal();
+};
+
+} // namespace LocalNetworkApp
+
+#endif // MESSAGE_OUTBOX_H
@@ -6,6 +6,15 @@
 namespace LocalNetworkApp {
 
 QByteArray MessageProtocol::serializeMessage(const NetworkMessage &message)
+{
+    // 序列化消息内容
+    QByteArray contentData = encodeBody(message);
+
+    // 组合消息头和消息内容
+    return encodeHeader(PROTOCOL_VERSION, static_cast<quint32>(contentData.size())) + contentData;
+}
+
+QByteArray MessageProtocol::encodeBody(const NetworkMessage &message)
 {
     // 创建消息内容
     QJsonObject messageObj;
@@ -15,24 +24,24 @@ QByteArray MessageProtocol::serializeMessage(const NetworkMessage &message)
     messageObj["timestamp"] = message.timestamp.toString(Qt::ISODate);
     messageObj["content"] = message.content;
 
-    // 序列化消息内容
     QJsonDocument doc(messageObj);
-    QByteArray contentData = doc.toJson(QJsonDocument::Compact);
+    return doc.toJson(QJsonDocument::Compact);
+}
 
+QByteArray MessageProtocol::encodeHeader(quint32 version, quint32 contentSize)
+{
     // 创建消息头
     MessageHeader header;
     header.magic = MAGIC_NUMBER;
-    header.version = PROTOCOL_VERSION;
-    header.contentSize = static_cast<quint32>(contentData.size());
+    header.version = version;
+    header.contentSize = contentSize;
 
     // 序列化消息头
     QByteArray headerData;
     QDataStream headerStream(&headerData, QIODevice::WriteOnly);
     headerStream.setByteOrder(QDataStream::BigEndian);
     headerStream << header.magic << header.version << header.contentSize;
-
-    // 组合消息头和消息内容
-    return headerData + contentData;
+    return headerData;
 }
 
 MessageProtocol::NetworkMessage MessageProtocol::deserializeMessage(const QByteArray &data)
@@ -76,8 +85,13 @@ MessageProtocol::NetworkMessage MessageProtocol::deserializeMessage(const QByteA
     }
 
     // 解析消息内容
-    QByteArray contentData = data.mid(sizeof(MessageHeader), header.contentSize);
-    QJsonDocument doc = QJsonDocument::fromJson(contentData);
+    return decodeBody(data.mid(sizeof(MessageHeader), header.contentSize));
+}
+
+MessageProtocol::NetworkMessage MessageProtocol::decodeBody(const QByteArray &body)
+{
+    NetworkMessage message;
+    QJsonDocument doc = QJsonDocument::fromJson(body);
     QJsonObject messageObj = doc.object();
 
     // 提取消息字段
@@ -167,4 +181,37 @@ MessageProtocol::NetworkMessage MessageProtocol::createHeartbeatMessage(QUuid se
     return message;
 }
 
-} // namespace LocalNetworkApp
+MessageProtocol::NetworkMessage MessageProtocol::createChatBatchMessage(QUuid senderId, const QJsonObject &batchContent)
+{
+    NetworkMessage message;
+    message.type = NetworkMessageType::ChatBatch;
+    message.messageId = QUuid::createUuid();
+    message.senderId = senderId;
+    message.timestamp = QDateTime::currentDateTime();
+    message.content = batchContent;
+    return message;
+}
+
+MessageProtocol::NetworkMessage MessageProtocol::createMessageAckMessage(QUuid senderId, const QJsonObject &ackContent)
+{
+    NetworkMessage message;
+    message.type = NetworkMessageType::MessageAck;
+    message.messageId = QUuid::createUuid();
+    message.senderId = senderId;
+    message.timestamp = QDateTime::currentDateTime();
+    message.content = ackContent;
+    return message;
+}
+
+MessageProtocol::NetworkMessage MessageProtocol::createKeyExchangeMessage(QUuid senderId, const QJsonObject &keyContent)
+{
+    NetworkMessage message;
+    message.type = NetworkMessageType::KeyExchange;
+    message.messageId = QUuid::createUuid();
+    message.senderId = senderId;
+    message.timestamp = QDateTime::currentDateTime();
+    message.content = keyContent;
+    return message;
+}
+
+} // namespace LocalNetworkApp
\ No newline at end of file
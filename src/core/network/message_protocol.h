@@ -31,12 +31,22 @@ public:
 
     static const quint32 MAGIC_NUMBER = 0x4C4E4150; // "LANP" 的ASCII码
     static const quint32 PROTOCOL_VERSION = 1;
+    static const quint32 SECURE_PROTOCOL_VERSION = 2; // 加密帧：消息头后为密文和认证标签
     // 序列化网络消息
     static QByteArray serializeMessage(const NetworkMessage &message);
 
     // 反序列化网络消息
     static NetworkMessage deserializeMessage(const QByteArray &data);
 
+    // 序列化消息内容（不含消息头）
+    static QByteArray encodeBody(const NetworkMessage &message);
+
+    // 反序列化消息内容（不含消息头）
+    static NetworkMessage decodeBody(const QByteArray &body);
+
+    // 序列化消息头
+    static QByteArray encodeHeader(quint32 version, quint32 contentSize);
+
     // 创建用户状态消息
     static NetworkMessage createUserStatusMessage(QUuid senderId, const QJsonObject &statusContent);
 
@@ -58,6 +68,15 @@ public:
     // 创建心跳消息
     static NetworkMessage createHeartbeatMessage(QUuid senderId);
 
+    // 创建聊天消息批次（content中"messages"为消息数组）
+    static NetworkMessage createChatBatchMessage(QUuid senderId, const QJsonObject &batchContent);
+
+    // 创建消息送达确认（content中"ids"为已收到的消息ID数组）
+    static NetworkMessage createMessageAckMessage(QUuid senderId, const QJsonObject &ackContent);
+
+    // 创建会话密钥交换消息
+    static NetworkMessage createKeyExchangeMessage(QUuid senderId, const QJsonObject &keyContent);
+
 private:
 
 
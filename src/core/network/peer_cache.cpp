@@ -0,0 +1,100 @@
+#include "peer_cache.h"
+#include <QFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+#include "../utils/persistence_service.h"
+
+namespace LocalNetworkApp {
+
+bool PeerCache::saveToLocal(const QMap<QUuid, DiscoveredUser> &peers, const QString &filePath)
+{
+    // 按最后在线时间排序，只保留最近的条目
+    QList<DiscoveredUser> entries = peers.values();
+    std::sort(entries.begin(), entries.end(), [](const DiscoveredUser &a, const DiscoveredUser &b) {
+        return a.lastSeen > b.lastSeen;
+    });
+    if (entries.size() > Constants::PEER_CACHE_MAX_ENTRIES) {
+        entries.resize(Constants::PEER_CACHE_MAX_ENTRIES);
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_5);
+    stream << CACHE_MAGIC << CACHE_VERSION << static_cast<quint32>(entries.size());
+
+    for (const DiscoveredUser &user : entries) {
+        stream << user.userId
+               << user.nickname
+               << user.address
+               << user.addresses
+               << user.port
+               << static_cast<qint32>(user.state)
+               << user.lastSeen.toMSecsSinceEpoch();
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "无法写入用户缓存:" << filePath;
+        return false;
+    }
+
+    // 由后台线程写入临时文件后原子替换，避免写到一半时崩溃损坏缓存
+    PersistenceService::instance()->writeFile(filePath, data);
+    return true;
+}
+
+QMap<QUuid, DiscoveredUser> PeerCache::loadFromLocal(const QString &filePath)
+{
+    QMap<QUuid, DiscoveredUser> peers;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return peers;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if (magic != CACHE_MAGIC || version == 0 || version > CACHE_VERSION) {
+        qWarning() << "用户缓存格式无效，已忽略:" << filePath;
+        return peers;
+    }
+
+    QDateTime oldest = QDateTime::currentDateTime().addDays(-Constants::PEER_CACHE_MAX_AGE_DAYS);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        DiscoveredUser user;
+        qint32 state = 0;
+        qint64 lastSeenMs = 0;
+        stream >> user.userId >> user.nickname >> user.address;
+        if (version >= 2) {
+            stream >> user.addresses;
+        } else {
+            user.addresses.append(user.address);
+        }
+        stream >> user.port >> state >> lastSeenMs;
+
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        user.state = static_cast<UserState>(state);
+        user.lastSeen = QDateTime::fromMSecsSinceEpoch(lastSeenMs);
+        user.cached = true;
+
+        // 丢弃过期条目
+        if (user.userId.isNull() || user.lastSeen < oldest) {
+            continue;
+        }
+
+        peers[user.userId] = user;
+    }
+
+    return peers;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,31 @@
+#ifndef PEER_CACHE_H
+#define PEER_CACHE_H
+
+#include <QMap>
+#include <QUuid>
+#include <QString>
+#include "peer_directory.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+class PeerCache {
+public:
+    PeerCache() = delete;
+    ~PeerCache() = delete;
+
+    // 保存已知用户（地址、端口、状态）到本地缓存文件
+    static bool saveToLocal(const QMap<QUuid, DiscoveredUser> &peers,
+                            const QString &filePath = Constants::PEER_CACHE_FILE);
+
+    // 从本地缓存文件加载已知用户，过期条目会被丢弃
+    static QMap<QUuid, DiscoveredUser> loadFromLocal(const QString &filePath = Constants::PEER_CACHE_FILE);
+
+private:
+    static const quint32 CACHE_MAGIC = 0x4C4E5043; // "LNPC"
+    static const quint16 CACHE_VERSION = 2; // 版本2增加地址列表
+};
+
+} // namespace LocalNetworkApp
+
+#endif // PEER_CACHE_H
@@ -0,0 +1,117 @@
+#include "peer_directory.h"
+
+namespace LocalNetworkApp {
+
+PeerDirectory::PeerDirectory(int maxChangeLog) :
+    currentSequence(0),
+    logStartSequence(0),
+    maxChangeLog(maxChangeLog)
+{
+}
+
+bool PeerDirectory::upsert(const DiscoveredUser &user)
+{
+    auto it = peers.find(user.userId);
+    if (it == peers.end()) {
+        peers.insert(user.userId, user);
+        appendChange(PeerChange::Added, user);
+        return true;
+    }
+
+    DiscoveredUser &existing = it.value();
+    bool visibleChange = existing.nickname != user.nickname ||
+                         existing.address != user.address ||
+                         existing.addresses != user.addresses ||
+                         existing.port != user.port ||
+                         existing.state != user.state ||
+                         existing.cached != user.cached;
+
+    // 仅刷新在线时间不算变更，避免每次广播都推进序号
+    existing = user;
+    if (visibleChange) {
+        appendChange(PeerChange::Updated, user);
+    }
+    return visibleChange;
+}
+
+bool PeerDirectory::remove(QUuid userId)
+{
+    auto it = peers.find(userId);
+    if (it == peers.end()) {
+        return false;
+    }
+
+    DiscoveredUser user;
+    user.userId = userId;
+    user.port = 0;
+    user.state = UserState::Invisible;
+    peers.erase(it);
+    appendChange(PeerChange::Removed, user);
+    return true;
+}
+
+void PeerDirectory::clear()
+{
+    peers.clear();
+    changeLog.clear();
+    currentSequence++;
+    logStartSequence = currentSequence;
+}
+
+bool PeerDirectory::contains(QUuid userId) const
+{
+    return peers.contains(userId);
+}
+
+DiscoveredUser PeerDirectory::value(QUuid userId) const
+{
+    return peers.value(userId);
+}
+
+const QMap<QUuid, DiscoveredUser> &PeerDirectory::users() const
+{
+    return peers;
+}
+
+quint64 PeerDirectory::sequence() const
+{
+    return currentSequence;
+}
+
+PeerSnapshot PeerDirectory::snapshot() const
+{
+    PeerSnapshot snap;
+    snap.sequence = currentSequence;
+    snap.users = peers; // 隐式共享，下次修改时才会复制
+    return snap;
+}
+
+bool PeerDirectory::changesSince(quint64 since, QList<PeerChange> *changes) const
+{
+    if (since > currentSequence || since < logStartSequence) {
+        return false;
+    }
+
+    // 变更记录按序号递增，序号连续，可直接定位
+    qsizetype first = static_cast<qsizetype>(since - logStartSequence);
+    changes->clear();
+    for (qsizetype i = first; i < changeLog.size(); ++i) {
+        changes->append(changeLog.at(i));
+    }
+    return true;
+}
+
+void PeerDirectory::appendChange(PeerChange::Kind kind, const DiscoveredUser &user)
+{
+    currentSequence++;
+    changeLog.append({kind, currentSequence, user});
+
+    // 超出保留条数时丢弃最旧的记录
+    if (changeLog.size() > maxChangeLog) {
+        qsizetype drop = changeLog.size() - maxChangeLog;
+        changeLog.remove(0, drop);
+        logStartSequence += static_cast<quint64>(drop);
+    }
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,91 @@
+#ifndef PEER_DIRECTORY_H
+#define PEER_DIRECTORY_H
+
+#include <QUuid>
+#include <QMap>
+#include <QList>
+#include <QString>
+#include <QDateTime>
+#include <QtNetwork/QHostAddress>
+#include "../utils/enums.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+struct DiscoveredUser {
+    QUuid userId;              // 用户ID
+    QString nickname;          // 用户昵称
+    QHostAddress address;      // 用户首选地址（用于显示）
+    QList<QHostAddress> addresses; // 已知的全部地址（每种协议一个，IPv6在前）
+    quint16 port;              // 用户端口
+    UserState state;           // 用户状态
+    QDateTime lastSeen;        // 最后在线时间
+    int timeoutMs = Constants::USER_TIMEOUT_MS; // 超时时间（随对方广播间隔变化）
+    bool cached = false;       // 来自本地缓存，尚未被对方确认
+};
+
+// 用户目录的一次变更
+struct PeerChange {
+    enum Kind {
+        Added,   // 新用户
+        Updated, // 昵称、地址或状态变化
+        Removed  // 用户离线（仅userId有效）
+    };
+
+    Kind kind;           // 变更类型
+    quint64 sequence;    // 变更序号
+    DiscoveredUser user; // 变更后的用户信息
+};
+
+// 用户目录快照（隐式共享，持有期间不受后续修改影响）
+struct PeerSnapshot {
+    quint64 sequence = 0;                // 快照对应的序号
+    QMap<QUuid, DiscoveredUser> users;   // 快照中的用户
+};
+
+class PeerDirectory {
+public:
+    PeerDirectory(int maxChangeLog = 1024);
+    ~PeerDirectory() = default;
+
+    // 插入或更新用户，仅在可见信息变化时生成变更记录（返回是否产生了变更）
+    bool upsert(const DiscoveredUser &user);
+
+    // 移除用户
+    bool remove(QUuid userId);
+
+    // 清空目录（之前的序号全部失效）
+    void clear();
+
+    // 是否包含用户
+    bool contains(QUuid userId) const;
+
+    // 获取用户信息
+    DiscoveredUser value(QUuid userId) const;
+
+    // 获取当前用户表（只读）
+    const QMap<QUuid, DiscoveredUser> &users() const;
+
+    // 当前序号
+    quint64 sequence() const;
+
+    // 获取快照，复制成本为O(1)
+    PeerSnapshot snapshot() const;
+
+    // 获取某序号之后的变更；序号过旧时返回false，调用方应改用快照重建
+    bool changesSince(quint64 since, QList<PeerChange> *changes) const;
+
+private:
+    QMap<QUuid, DiscoveredUser> peers; // 用户表
+    QList<PeerChange> changeLog;       // 最近的变更记录
+    quint64 currentSequence;           // 当前序号
+    quint64 logStartSequence;          // 变更记录中最早可增量获取的起点
+    int maxChangeLog;                  // 变更记录保留条数
+
+    // 记录一次变更
+    void appendChange(PeerChange::Kind kind, const DiscoveredUser &user);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // PEER_DIRECTORY_H
@@ -0,0 +1,232 @@
+#include "rendezvous_registry.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QDebug>
+#include "../utils/network_utils.h"
+
+namespace LocalNetworkApp {
+
+RendezvousRegistry::RendezvousRegistry(QObject *parent) :
+    QObject(parent)
+{
+    udpSocket = new QUdpSocket(this);
+    connect(udpSocket, &QUdpSocket::readyRead, this, &RendezvousRegistry::processPendingDatagrams);
+
+    expireTimer = new QTimer(this);
+    connect(expireTimer, &QTimer::timeout, this, &RendezvousRegistry::expireRegistrations);
+}
+
+RendezvousRegistry::~RendezvousRegistry()
+{
+    stop();
+}
+
+bool RendezvousRegistry::start(quint16 port)
+{
+    if (udpSocket->isOpen()) {
+        return true;
+    }
+
+    if (!udpSocket->bind(QHostAddress::Any, port)) {
+        qWarning() << "注册中心无法绑定到端口:" << port << udpSocket->errorString();
+        return false;
+    }
+
+    expireTimer->start(Constants::RENDEZVOUS_SYNC_INTERVAL_MS / 3);
+    qInfo() << "注册中心已启动，监听端口:" << port;
+    return true;
+}
+
+void RendezvousRegistry::stop()
+{
+    expireTimer->stop();
+
+    if (udpSocket->isOpen()) {
+        udpSocket->close();
+    }
+
+    registrations.clear();
+}
+
+bool RendezvousRegistry::isRunning() const
+{
+    return udpSocket->isOpen();
+}
+
+int RendezvousRegistry::getRegisteredCount() const
+{
+    return registrations.users().size();
+}
+
+QJsonObject RendezvousRegistry::peerToJson(const DiscoveredUser &user)
+{
+    QJsonObject json;
+    json["userId"] = user.userId.toString();
+    json["nickname"] = user.nickname;
+    json["address"] = user.address.toString();
+    json["tcpPort"] = user.port;
+    json["state"] = static_cast<int>(user.state);
+    return json;
+}
+
+DiscoveredUser RendezvousRegistry::peerFromJson(const QJsonObject &json)
+{
+    DiscoveredUser user;
+    user.userId = QUuid(json["userId"].toString());
+    user.nickname = json["nickname"].toString();
+    user.address = QHostAddress(json["address"].toString());
+    user.addresses.append(user.address);
+    user.port = static_cast<quint16>(json["tcpPort"].toInt(Constants::DEFAULT_TCP_PORT));
+    user.state = static_cast<UserState>(json["state"].toInt());
+    return user;
+}
+
+void RendezvousRegistry::processPendingDatagrams()
+{
+    while (udpSocket->hasPendingDatagrams()) {
+        QByteArray datagram;
+        datagram.resize(udpSocket->pendingDatagramSize());
+
+        QHostAddress senderAddress;
+        quint16 senderPort;
+
+        udpSocket->readDatagram(datagram.data(), datagram.size(), &senderAddress, &senderPort);
+
+        QJsonDocument doc = QJsonDocument::fromJson(datagram);
+        if (!doc.isObject()) {
+            continue;
+        }
+
+        QJsonObject request = doc.object();
+        QString op = request["op"].toString();
+
+        if (op == "register") {
+            handleRegister(request, senderAddress, senderPort);
+        } else if (op == "unregister") {
+            handleUnregister(request);
+        } else if (op == "query") {
+            handleQuery(request, senderAddress, senderPort);
+        }
+    }
+}
+
+void RendezvousRegistry::expireRegistrations()
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QList<QUuid> toRemove;
+
+    const QMap<QUuid, DiscoveredUser> &users = registrations.users();
+    for (auto it = users.constBegin(); it != users.constEnd(); ++it) {
+        if (it.value().lastSeen.msecsTo(now) >= it.value().timeoutMs) {
+            toRemove.append(it.key());
+        }
+    }
+
+    for (const QUuid &userId : toRemove) {
+        registrations.remove(userId);
+        emit peerExpired(userId);
+    }
+}
+
+void RendezvousRegistry::handleRegister(const QJsonObject &request, const QHostAddress &address, quint16 port)
+{
+    DiscoveredUser user = peerFromJson(request);
+    if (user.userId.isNull()) {
+        return;
+    }
+
+    // 以注册中心看到的来源地址为准
+    user.address = NetworkUtils::normalizeAddress(address);
+    user.addresses = {user.address};
+    user.lastSeen = QDateTime::currentDateTime();
+    user.timeoutMs = qMax(Constants::USER_TIMEOUT_MS, request["ttl"].toInt());
+
+    bool isNewUser = !registrations.contains(user.userId);
+    registrations.upsert(user);
+    if (isNewUser) {
+        emit peerRegistered(user.userId);
+    }
+
+    QJsonObject reply;
+    reply["op"] = "registered";
+    reply["ttl"] = user.timeoutMs;
+    sendReply(reply, address, port);
+}
+
+void RendezvousRegistry::handleUnregister(const QJsonObject &request)
+{
+    QUuid userId(request["userId"].toString());
+    if (registrations.remove(userId)) {
+        emit peerExpired(userId);
+    }
+}
+
+void RendezvousRegistry::handleQuery(const QJsonObject &request, const QHostAddress &address, quint16 port)
+{
+    QJsonObject reply;
+    reply["op"] = "directory";
+
+    quint64 since = static_cast<quint64>(request["since"].toInteger());
+    bool continuing = request.contains("after");
+    QList<PeerChange> changes;
+
+    if (!continuing && registrations.changesSince(since, &changes)) {
+        // 增量同步：只发送请求序号之后的变更
+        QJsonArray peersArray;
+        QJsonArray removedArray;
+        quint64 sequence = since;
+        int count = 0;
+
+        for (const PeerChange &change : changes) {
+            if (count >= Constants::RENDEZVOUS_PAGE_SIZE) {
+                break;
+            }
+
+            if (change.kind == PeerChange::Removed) {
+                removedArray.append(change.user.userId.toString());
+            } else {
+                peersArray.append(peerToJson(change.user));
+            }
+
+            sequence = change.sequence;
+            count++;
+        }
+
+        reply["sequence"] = static_cast<qint64>(sequence);
+        reply["peers"] = peersArray;
+        reply["removed"] = removedArray;
+        reply["more"] = count < changes.size();
+    } else {
+        // 全量同步：按用户ID顺序分页，客户端用after继续请求
+        quint64 snapshotSequence = continuing ? static_cast<quint64>(request["snapshot"].toInteger())
+                                              : registrations.sequence();
+        const QMap<QUuid, DiscoveredUser> &users = registrations.users();
+        auto it = continuing ? users.upperBound(QUuid(request["after"].toString())) : users.constBegin();
+
+        QJsonArray peersArray;
+        QUuid lastUserId;
+        for (int count = 0; it != users.constEnd() && count < Constants::RENDEZVOUS_PAGE_SIZE; ++it, ++count) {
+            peersArray.append(peerToJson(it.value()));
+            lastUserId = it.key();
+        }
+
+        reply["reset"] = true;
+        reply["sequence"] = static_cast<qint64>(snapshotSequence);
+        reply["peers"] = peersArray;
+        reply["more"] = it != users.constEnd();
+        if (it != users.constEnd()) {
+            reply["after"] = lastUserId.toString();
+        }
+    }
+
+    sendReply(reply, address, port);
+}
+
+void RendezvousRegistry::sendReply(const QJsonObject &reply, const QHostAddress &address, quint16 port)
+{
+    QJsonDocument doc(reply);
+    udpSocket->writeDatagram(doc.toJson(QJsonDocument::Compact), address, port);
+}
+
+} // namespace LocalNetworkApp
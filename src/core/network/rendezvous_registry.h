@@ -0,0 +1,72 @@
+#ifndef RENDEZVOUS_REGISTRY_H
+#define RENDEZVOUS_REGISTRY_H
+
+#include <QObject>
+#include <QtNetwork/QUdpSocket>
+#include <QtNetwork/QHostAddress>
+#include <QTimer>
+#include <QJsonObject>
+#include "peer_directory.h"
+#include "../utils/constants.h"
+
+namespace LocalNetworkApp {
+
+// 跨网段发现注册中心：各实例定期注册自身并按序号增量同步用户目录
+class RendezvousRegistry : public QObject {
+    Q_OBJECT
+
+public:
+    RendezvousRegistry(QObject *parent = nullptr);
+    ~RendezvousRegistry();
+
+    // 启动注册中心
+    bool start(quint16 port = Constants::DEFAULT_RENDEZVOUS_PORT);
+
+    // 停止注册中心
+    void stop();
+
+    // 是否正在运行
+    bool isRunning() const;
+
+    // 获取当前注册的用户数量
+    int getRegisteredCount() const;
+
+    // 用户信息与JSON互转（注册中心与客户端共用）
+    static QJsonObject peerToJson(const DiscoveredUser &user);
+    static DiscoveredUser peerFromJson(const QJsonObject &json);
+
+signals:
+    // 用户注册
+    void peerRegistered(QUuid userId);
+
+    // 用户注册过期或注销
+    void peerExpired(QUuid userId);
+
+private slots:
+    // 处理接收到的数据
+    void processPendingDatagrams();
+
+    // 清理过期注册
+    void expireRegistrations();
+
+private:
+    QUdpSocket *udpSocket;         // UDP Socket
+    QTimer *expireTimer;           // 过期清理定时器
+    PeerDirectory registrations;   // 已注册的用户
+
+    // 处理注册请求
+    void handleRegister(const QJsonObject &request, const QHostAddress &address, quint16 port);
+
+    // 处理注销请求
+    void handleUnregister(const QJsonObject &request);
+
+    // 处理目录查询请求
+    void handleQuery(const QJsonObject &request, const QHostAddress &address, quint16 port);
+
+    // 发送应答
+    void sendReply(const QJsonObject &reply, const QHostAddress &address, quint16 port);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // RENDEZVOUS_REGISTRY_H
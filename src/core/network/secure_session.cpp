@@ -0,0 +1,210 @@
+#include "secure_session.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include "../data/x25519.h"
+#include "../data/security_manager.h"
+
+namespace LocalNetworkApp {
+
+namespace {
+
+const char SESSION_KEY_INFO[] = "LANP session v1";
+
+// 由计数器构造nonce（每个方向密钥不同，前缀固定为0）
+void counterNonce(quint64 counter, quint8 *nonce)
+{
+    qToBigEndian<quint32>(0, nonce);
+    qToBigEndian<quint64>(counter, nonce + 4);
+}
+
+bool isKnownAlgorithm(int value)
+{
+    return value == static_cast<int>(AeadCipher::Algorithm::Aes256Gcm) ||
+           value == static_cast<int>(AeadCipher::Algorithm::ChaCha20Poly1305);
+}
+
+} // namespace
+
+SecureSession::SecureSession(Role role) :
+    role(role),
+    localAlgorithm(AeadCipher::preferredAlgorithm()),
+    sendCounter(0),
+    receiveCounter(0)
+{
+    restart();
+}
+
+SecureSession::~SecureSession() = default;
+
+void SecureSession::restart()
+{
+    privateKey = X25519::generatePrivateKey();
+    publicKey = X25519::publicKey(privateKey);
+    sendCipher.reset();
+    receiveCipher.reset();
+    sendCounter = 0;
+    receiveCounter = 0;
+}
+
+MessageProtocol::NetworkMessage SecureSession::createHandshakeMessage(QUuid senderId) const
+{
+    QJsonObject content;
+    content["publicKey"] = QString::fromLatin1(publicKey.toBase64());
+    content["cipher"] = static_cast<int>(localAlgorithm);
+    return MessageProtocol::createKeyExchangeMessage(senderId, content);
+}
+
+bool SecureSession::isEstablished() const
+{
+    return sendCipher && receiveCipher;
+}
+
+QByteArray SecureSession::sealMessage(const MessageProtocol::NetworkMessage &message)
+{
+    if (!isEstablished()) {
+        return QByteArray();
+    }
+
+    // 帧只分配一次，消息体复制进去后在帧缓冲区中原地加密
+    QByteArray body = MessageProtocol::encodeBody(message);
+    QByteArray frame(frameSize(body.size()), Qt::Uninitialized);
+    sealTo(std::as_bytes(std::span(body.constData(), body.size())),
+           std::as_writable_bytes(std::span(frame.data(), frame.size())));
+    return frame;
+}
+
+qsizetype SecureSession::frameSize(qsizetype bodySize)
+{
+    return sizeof(MessageProtocol::MessageHeader) + bodySize + AeadCipher::TAG_SIZE;
+}
+
+qsizetype SecureSession::sealTo(std::span<const std::byte> body, std::span<std::byte> frame)
+{
+    const qsizetype headerSize = sizeof(MessageProtocol::MessageHeader);
+    const qsizetype bodySize = body.size();
+    const qsizetype total = frameSize(bodySize);
+    if (!isEstablished() || static_cast<qsizetype>(frame.size()) < total) {
+        return -1;
+    }
+
+    // 消息头直接写入帧，作为附加数据参与认证
+    quint8 *out = reinterpret_cast<quint8 *>(frame.data());
+    qToBigEndian<quint32>(MessageProtocol::MAGIC_NUMBER, out);
+    qToBigEndian<quint32>(MessageProtocol::SECURE_PROTOCOL_VERSION, out + 4);
+    qToBigEndian<quint32>(static_cast<quint32>(bodySize + AeadCipher::TAG_SIZE), out + 8);
+
+    std::byte *payload = frame.data() + headerSize;
+    if (payload != body.data()) {
+        memmove(payload, body.data(), bodySize);
+    }
+
+    quint8 nonce[AeadCipher::NONCE_SIZE];
+    counterNonce(sendCounter++, nonce);
+    sendCipher->encrypt(nonce, out, headerSize, out + headerSize, bodySize, out + headerSize + bodySize);
+    return total;
+}
+
+std::span<std::byte> SecureSession::openInPlace(std::span<std::byte> frame)
+{
+    const qsizetype headerSize = sizeof(MessageProtocol::MessageHeader);
+    const qsizetype bodySize = static_cast<qsizetype>(frame.size()) - headerSize - AeadCipher::TAG_SIZE;
+    if (!isEstablished() || bodySize < 0) {
+        return {};
+    }
+
+    quint8 nonce[AeadCipher::NONCE_SIZE];
+    counterNonce(receiveCounter, nonce);
+    quint8 *in = reinterpret_cast<quint8 *>(frame.data());
+    if (!receiveCipher->decrypt(nonce, in, headerSize, in + headerSize, bodySize, in + headerSize + bodySize)) {
+        return {};
+    }
+    receiveCounter++;
+    return frame.subspan(headerSize, bodySize);
+}
+
+SecureSession::FrameResult SecureSession::processFrame(QByteArray &frame, MessageProtocol::NetworkMessage *message)
+{
+    const int headerSize = sizeof(MessageProtocol::MessageHeader);
+    if (frame.size() < headerSize) {
+        return FrameResult::Rejected;
+    }
+
+    quint32 version = qFromBigEndian<quint32>(frame.constData() + 4);
+    if (version == MessageProtocol::SECURE_PROTOCOL_VERSION) {
+        if (!isEstablished() || !openFrame(frame, message)) {
+            return FrameResult::Rejected;
+        }
+        return FrameResult::Message;
+    }
+
+    // 明文帧只允许会话建立前的密钥交换
+    if (version != MessageProtocol::PROTOCOL_VERSION || isEstablished()) {
+        return FrameResult::Rejected;
+    }
+    MessageProtocol::NetworkMessage handshake = MessageProtocol::deserializeMessage(frame);
+    if (handshake.type != NetworkMessageType::KeyExchange || !acceptHandshake(handshake.content)) {
+        return FrameResult::Rejected;
+    }
+    return FrameResult::Handshake;
+}
+
+bool SecureSession::acceptHandshake(const QJsonObject &content)
+{
+    QByteArray peerKey = QByteArray::fromBase64(content["publicKey"].toString().toLatin1());
+    int peerAlgorithm = content["cipher"].toInt();
+    if (!isKnownAlgorithm(peerAlgorithm) || privateKey.isEmpty()) {
+        qWarning() << "无效的密钥交换消息";
+        return false;
+    }
+
+    QByteArray shared = X25519::sharedSecret(privateKey, peerKey);
+    if (shared.isEmpty()) {
+        qWarning() << "密钥交换失败：对方公钥无效";
+        return false;
+    }
+
+    // 盐为双方公钥，info包含双方选择的算法，派生两个方向各自的密钥
+    bool initiator = role == Role::Initiator;
+    QByteArray initiatorKey = initiator ? publicKey : peerKey;
+    QByteArray responderKey = initiator ? peerKey : publicKey;
+    quint8 initiatorAlgorithm = initiator ? static_cast<quint8>(localAlgorithm) : static_cast<quint8>(peerAlgorithm);
+    quint8 responderAlgorithm = initiator ? static_cast<quint8>(peerAlgorithm) : static_cast<quint8>(localAlgorithm);
+
+    QByteArray info(SESSION_KEY_INFO);
+    info.append(static_cast<char>(initiatorAlgorithm));
+    info.append(static_cast<char>(responderAlgorithm));
+    QByteArray keys = SecurityManager::hkdfSha256(shared, initiatorKey + responderKey, info,
+                                                  2 * AeadCipher::KEY_SIZE);
+    QByteArray initiatorToResponder = keys.left(AeadCipher::KEY_SIZE);
+    QByteArray responderToInitiator = keys.mid(AeadCipher::KEY_SIZE);
+
+    sendCipher = std::make_unique<AeadCipher>(localAlgorithm,
+                                              initiator ? initiatorToResponder : responderToInitiator);
+    receiveCipher = std::make_unique<AeadCipher>(static_cast<AeadCipher::Algorithm>(peerAlgorithm),
+                                                 initiator ? responderToInitiator : initiatorToResponder);
+    sendCounter = 0;
+    receiveCounter = 0;
+
+    // 会话密钥已派生，丢弃临时私钥
+    shared.fill('\0');
+    keys.fill('\0');
+    privateKey.fill('\0');
+    privateKey.clear();
+    return true;
+}
+
+bool SecureSession::openFrame(QByteArray &frame, MessageProtocol::NetworkMessage *message)
+{
+    // 在帧缓冲区中原地解密，消息体直接引用解密后的数据
+    std::span<std::byte> body = openInPlace(std::as_writable_bytes(std::span(frame.data(), frame.size())));
+    if (body.empty()) {
+        return false;
+    }
+
+    *message = MessageProtocol::decodeBody(
+        QByteArray::fromRawData(reinterpret_cast<const char *>(body.data()), body.size()));
+    return true;
+}
+
+} // namespace LocalNetworkApp
@@ -0,0 +1,81 @@
+#ifndef SECURE_SESSION_H
+#define SECURE_SESSION_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QUuid>
+#include <memory>
+#include <span>
+#include <cstddef>
+#include "message_protocol.h"
+#include "../data/aead_cipher.h"
+
+namespace LocalNetworkApp {
+
+// 连接的加密会话
+//
+// 连接建立后双方各发送一条明文KeyExchange消息，携带临时X25519公钥和本端首选的
+// AEAD算法；双方用X25519和HKDF派生出两个方向各自的密钥，此后每条消息只加密一次，
+// 使用预先展开的密钥和按方向递增的nonce计数器。TCP保证顺序，因此接收计数器无需传输。
+// 临时密钥只防止被动窃听，不验证对方身份。
+class SecureSession {
+public:
+    enum class Role {
+        Initiator, // 发起连接的一方（Client）
+        Responder  // 接受连接的一方（ClientConnection）
+    };
+
+    enum class FrameResult {
+        Message,   // 解出一条消息
+        Handshake, // 处理了对方的密钥交换，会话已建立
+        Rejected   // 无效帧：认证失败、重复握手或会话建立前的非握手消息
+    };
+
+    explicit SecureSession(Role role);
+    ~SecureSession();
+
+    // 生成新的临时密钥并丢弃会话密钥（每次建立连接时调用）
+    void restart();
+
+    // 创建本端的密钥交换消息
+    MessageProtocol::NetworkMessage createHandshakeMessage(QUuid senderId) const;
+
+    // 会话密钥是否已建立
+    bool isEstablished() const;
+
+    // 把消息加密为完整的帧（消息头 + 密文 + 认证标签）
+    QByteArray sealMessage(const MessageProtocol::NetworkMessage &message);
+
+    // 消息体为bodySize字节时的帧长度
+    static qsizetype frameSize(qsizetype bodySize);
+
+    // 把消息体加密为帧写入调用方提供的缓冲区（至少frameSize字节），返回帧长度；
+    // 消息体已位于消息头之后的位置时不复制。会话未建立或缓冲区不足时返回-1
+    qsizetype sealTo(std::span<const std::byte> body, std::span<std::byte> frame);
+
+    // 原地解密完整的加密帧，成功时返回frame内的消息体区间，失败时返回空区间
+    std::span<std::byte> openInPlace(std::span<std::byte> frame);
+
+    // 处理收到的完整帧（含消息头）；加密帧在frame中原地解密，不另外分配缓冲区
+    FrameResult processFrame(QByteArray &frame, MessageProtocol::NetworkMessage *message);
+
+private:
+    Role role;                                  // 本端角色
+    QByteArray privateKey;                      // 临时私钥
+    QByteArray publicKey;                       // 临时公钥
+    AeadCipher::Algorithm localAlgorithm;       // 本端发送使用的算法
+    std::unique_ptr<AeadCipher> sendCipher;     // 发送方向的密钥
+    std::unique_ptr<AeadCipher> receiveCipher;  // 接收方向的密钥
+    quint64 sendCounter;                        // 发送nonce计数器
+    quint64 receiveCounter;                     // 接收nonce计数器
+
+    // 处理对方的密钥交换消息并派生会话密钥
+    bool acceptHandshake(const QJsonObject &content);
+
+    // 原地解密加密帧
+    bool openFrame(QByteArray &frame, MessageProtocol::NetworkMessage *message);
+};
+
+} // namespace LocalNetworkApp
+
+#endif // SECURE_SESSION_H
@@ -4,16 +4,21 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include "../utils/constants.h"
+#include "../utils/network_utils.h"
 
 namespace LocalNetworkApp {
 
 ClientConnection::ClientConnection(QTcpSocket *socket, QUuid clientId, QObject *parent) :
     QObject(parent),
     socket(socket),
-    clientId(clientId)
+    clientId(clientId),
+    session(SecureSession::Role::Responder)
 {
     connect(socket, &QTcpSocket::readyRead, this, &ClientConnection::onReadyRead);
     connect(socket, &QTcpSocket::disconnected, this, &ClientConnection::onDisconnected);
+
+    // 连接已建立，立即以明文发送本端的密钥交换消息
+    socket->write(MessageProtocol::serializeMessage(session.createHandshakeMessage(QUuid())));
 }
 
 ClientConnection::~ClientConnection()
@@ -31,7 +36,7 @@ QUuid ClientConnection::getClientId() const
 
 QHostAddress ClientConnection::getClientAddress() const
 {
-    return socket->peerAddress();
+    return NetworkUtils::normalizeAddress(socket->peerAddress());
 }
 
 quint16 ClientConnection::getClientPort() const
@@ -45,8 +50,13 @@ void ClientConnection::sendMessage(const MessageProtocol::NetworkMessage &messag
         return;
     }
 
-    QByteArray data = MessageProtocol::serializeMessage(message);
-    socket->write(data);
+    // 密钥交换完成前先排队
+    if (!session.isEstablished()) {
+        pendingMessages.append(message);
+        return;
+    }
+
+    socket->write(session.sealMessage(message));
     socket->flush();
 }
 
@@ -75,7 +85,9 @@ void ClientConnection::onReadyRead()
         headerStream >> header.magic >> header.version >> header.contentSize;
 
         // 检查魔术数字和版本
-        if (header.magic != MessageProtocol::MAGIC_NUMBER || header.version != MessageProtocol::PROTOCOL_VERSION) {
+        if (header.magic != MessageProtocol::MAGIC_NUMBER ||
+            (header.version != MessageProtocol::PROTOCOL_VERSION &&
+             header.version != MessageProtocol::SECURE_PROTOCOL_VERSION)) {
             // 无效消息，清空缓冲区
             buffer.clear();
             return;
@@ -91,8 +103,25 @@ void ClientConnection::onReadyRead()
         QByteArray messageData = buffer.left(sizeof(MessageProtocol::MessageHeader) + header.contentSize);
         buffer.remove(0, sizeof(MessageProtocol::MessageHeader) + header.contentSize);
 
-        // 解析消息
-        MessageProtocol::NetworkMessage message = MessageProtocol::deserializeMessage(messageData);
+        // 解密消息或处理密钥交换
+        MessageProtocol::NetworkMessage message;
+        SecureSession::FrameResult result = session.processFrame(messageData, &message);
+        if (result == SecureSession::FrameResult::Rejected) {
+            // 认证失败说明数据被篡改或会话不同步，断开连接
+            qWarning() << "收到无效的加密帧，断开连接:" << getClientAddress().toString();
+            buffer.clear();
+            close();
+            return;
+        }
+        if (result == SecureSession::FrameResult::Handshake) {
+            // 发送排队的消息
+            QList<MessageProtocol::NetworkMessage> messages;
+            messages.swap(pendingMessages);
+            for (const MessageProtocol::NetworkMessage &pending : std::as_const(messages)) {
+                sendMessage(pending);
+            }
+            continue;
+        }
 
         // 发送信号
         emit messageReceived(message);
@@ -125,9 +154,14 @@ bool Server::start(quint16 port)
         return true;
     }
 
+    // QHostAddress::Any为双栈监听（IPv6 Socket并接受v4映射连接）；
+    // 系统禁用IPv6时回退到仅IPv4
     if (!tcpServer->listen(QHostAddress::Any, port)) {
-        qWarning() << "服务器启动失败:" << tcpServer->errorString();
-        return false;
+        qWarning() << "双栈监听失败，回退到IPv4:" << tcpServer->errorString();
+        if (!tcpServer->listen(QHostAddress::AnyIPv4, port)) {
+            qWarning() << "服务器启动失败:" << tcpServer->errorString();
+            return false;
+        }
     }
 
     qInfo() << "服务器已启动，监听端口:" << port;
@@ -203,7 +237,7 @@ void Server::onNewConnection()
 
     clients[tempId] = connection;
 
-    qInfo() << "新客户端连接:" << socket->peerAddress().toString() << ":" << socket->peerPort();
+    qInfo() << "新客户端连接:" << NetworkUtils::normalizeAddress(socket->peerAddress()).toString() << ":" << socket->peerPort();
 }
 
 void Server::onClientDisconnected(QUuid clientId)
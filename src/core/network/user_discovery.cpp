@@ -4,13 +4,23 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QtNetwork/QNetworkInterface>
+#include <QJsonArray>
+#include "peer_cache.h"
+#include "rendezvous_registry.h"
+#include "../utils/network_utils.h"
 
 namespace LocalNetworkApp {
 
 UserDiscovery::UserDiscovery(const UserIdentity &userIdentity, QObject *parent) :
     QObject(parent),
     userIdentity(userIdentity),
-    currentState(UserState::Online)
+    currentState(UserState::Online),
+    beaconInterval(Constants::BEACON_MIN_INTERVAL_MS),
+    probeBeaconsLeft(0),
+    rendezvousPort(Constants::DEFAULT_RENDEZVOUS_PORT),
+    rendezvousSequence(0),
+    rendezvousResyncing(false),
+    ipv6Enabled(false)
 {
     initSocket();
 }
@@ -27,18 +37,35 @@ bool UserDiscovery::startDiscovery(quint16 port)
         return true;
     }
 
-    // 绑定到指定端口
-    if (!udpSocket->bind(port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+    // 绑定到双栈地址，同时接收IPv4广播和IPv6组播；系统禁用IPv6时回退到仅IPv4
+    ipv6Enabled = udpSocket->bind(QHostAddress::Any, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
+    if (!ipv6Enabled &&
+        !udpSocket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
         qWarning() << "无法绑定到端口:" << port << udpSocket->errorString();
         return false;
     }
 
-    // 启动定时器
-    startTimers();
+    // IPv6没有广播，在每个接口上加入链路本地组播组
+    if (ipv6Enabled) {
+        joinIPv6Group();
+    }
+
+    // 启动阶段使用最短间隔并请求对方回复，之后逐步退避
+    resetBroadcastBackoff();
+    probeBeaconsLeft = Constants::BEACON_PROBE_COUNT;
+
+    // 先用缓存填充用户列表，再通过定向探测确认
+    loadPeerCache();
 
-    // 发送初始广播
+    // 发送初始广播（同时安排下一次广播）
     sendBroadcast();
 
+    // 配置了注册中心时同时进行跨网段发现
+    if (!rendezvousAddress.isNull()) {
+        rendezvousTimer->start(Constants::RENDEZVOUS_SYNC_INTERVAL_MS);
+        syncWithRendezvous();
+    }
+
     qInfo() << "用户发现服务已启动，监听端口:" << port;
     return true;
 }
@@ -47,11 +74,33 @@ void UserDiscovery::stopDiscovery()
 {
     stopTimers();
 
+    if (!knownPeers.isEmpty()) {
+        savePeerCache();
+    }
+
     if (udpSocket->isOpen()) {
+        // 主动注销，其他网段的用户无需等待注册过期
+        if (!rendezvousAddress.isNull()) {
+            QJsonObject request;
+            request["op"] = "unregister";
+            request["userId"] = userIdentity.getUuid().toString();
+            udpSocket->writeDatagram(QJsonDocument(request).toJson(QJsonDocument::Compact),
+                                     rendezvousAddress, rendezvousPort);
+        }
+
         udpSocket->close();
     }
 
-    discoveredUsers.clear();
+    ipv6Enabled = false;
+
+    rendezvousPeers.clear();
+    rendezvousSequence = 0;
+    rendezvousResyncing = false;
+
+    if (!discoveredUsers.users().isEmpty()) {
+        discoveredUsers.clear();
+        emit peersChanged(discoveredUsers.sequence());
+    }
 }
 
 QList<DiscoveredUser> UserDiscovery::getDiscoveredUsers() const
@@ -59,7 +108,7 @@ QList<DiscoveredUser> UserDiscovery::getDiscoveredUsers() const
     QList<DiscoveredUser> users;
 
     // 只返回在线状态的用户
-    for (const auto &user : discoveredUsers) {
+    for (const auto &user : discoveredUsers.users()) {
         if (user.state != UserState::Invisible) {
             users.append(user);
         }
@@ -79,16 +128,25 @@ bool UserDiscovery::isUserOnline(QUuid userId) const
         return false;
     }
 
-    const DiscoveredUser &user = discoveredUsers[userId];
+    const DiscoveredUser user = discoveredUsers.value(userId);
     return user.state != UserState::Invisible && 
-           user.lastSeen.secsTo(QDateTime::currentDateTime()) < Constants::USER_TIMEOUT_MS / 1000;
+           user.lastSeen.msecsTo(QDateTime::currentDateTime()) < user.timeoutMs;
 }
 
 void UserDiscovery::setUserState(UserState state)
 {
     if (currentState != state) {
         currentState = state;
-        sendBroadcast();
+
+        // 状态变更后立即快速广播，随后重新退避
+        if (udpSocket->isOpen()) {
+            resetBroadcastBackoff();
+            sendBroadcast();
+
+            if (!rendezvousAddress.isNull()) {
+                syncWithRendezvous();
+            }
+        }
     }
 }
 
@@ -97,17 +155,56 @@ UserState UserDiscovery::getUserState() const
     return currentState;
 }
 
+PeerSnapshot UserDiscovery::getPeerSnapshot() const
+{
+    return discoveredUsers.snapshot();
+}
+
+bool UserDiscovery::getPeerChanges(quint64 since, QList<PeerChange> *changes) const
+{
+    return discoveredUsers.changesSince(since, changes);
+}
+
+quint64 UserDiscovery::getPeerSequence() const
+{
+    return discoveredUsers.sequence();
+}
+
+void UserDiscovery::setRendezvousServer(const QHostAddress &address, quint16 port)
+{
+    rendezvousAddress = address;
+    rendezvousPort = port;
+    rendezvousSequence = 0;
+    rendezvousResyncing = false;
+
+    if (udpSocket->isOpen()) {
+        rendezvousTimer->start(Constants::RENDEZVOUS_SYNC_INTERVAL_MS);
+        syncWithRendezvous();
+    }
+}
+
+void UserDiscovery::clearRendezvousServer()
+{
+    rendezvousAddress.clear();
+    rendezvousTimer->stop();
+
+    // 移除仅通过注册中心发现的用户
+    const QSet<QUuid> peers = rendezvousPeers;
+    for (const QUuid &userId : peers) {
+        removeRendezvousPeer(userId);
+    }
+}
+
 void UserDiscovery::sendBroadcast()
 {
-    // 创建用户发现消息
-    QJsonObject discoveryObj;
-    discoveryObj["userId"] = userIdentity.getUuid().toString();
-    discoveryObj["nickname"] = userIdentity.getNickname();
-    discoveryObj["state"] = static_cast<int>(currentState);
-    discoveryObj["tcpPort"] = Constants::DEFAULT_TCP_PORT;
+    // 本次广播承诺的下一次广播间隔，接收方据此计算超时时间
+    int interval = beaconInterval;
 
-    QJsonDocument doc(discoveryObj);
-    QByteArray data = doc.toJson(QJsonDocument::Compact);
+    // 创建用户发现消息
+    QByteArray data = createDiscoveryMessage(interval, probeBeaconsLeft > 0);
+    if (probeBeaconsLeft > 0) {
+        probeBeaconsLeft--;
+    }
 
     // 发送到广播地址
     udpSocket->writeDatagram(data, QHostAddress::Broadcast, Constants::DEFAULT_UDP_PORT);
@@ -119,15 +216,27 @@ void UserDiscovery::sendBroadcast()
             interface.flags() & QNetworkInterface::IsRunning && 
             !(interface.flags() & QNetworkInterface::IsLoopBack)) {
             
+            bool hasIPv6 = false;
             const QList<QNetworkAddressEntry> entries = interface.addressEntries();
             for (const QNetworkAddressEntry &entry : entries) {
                 QHostAddress broadcastAddress = entry.broadcast();
                 if (!broadcastAddress.isNull()) {
                     udpSocket->writeDatagram(data, broadcastAddress, Constants::DEFAULT_UDP_PORT);
                 }
+                hasIPv6 = hasIPv6 || entry.ip().protocol() == QAbstractSocket::IPv6Protocol;
+            }
+
+            // 组播只在指定的出接口上发送，需逐个接口发送到发现组
+            if (ipv6Enabled && hasIPv6 && interface.flags() & QNetworkInterface::CanMulticast) {
+                udpSocket->setMulticastInterface(interface);
+                udpSocket->writeDatagram(data, QHostAddress(Constants::DISCOVERY_IPV6_GROUP), Constants::DEFAULT_UDP_PORT);
             }
         }
     }
+
+    // 安排下一次广播，网络无变化时间隔指数增长直到上限
+    broadcastTimer->start(interval);
+    beaconInterval = qMin(interval * 2, Constants::BEACON_MAX_INTERVAL_MS);
 }
 
 void UserDiscovery::processPendingDatagrams()
@@ -141,6 +250,9 @@ void UserDiscovery::processPendingDatagrams()
 
         udpSocket->readDatagram(datagram.data(), datagram.size(), &senderAddress, &senderPort);
 
+        // 双栈Socket上的IPv4来源以v4映射地址出现
+        senderAddress = NetworkUtils::normalizeAddress(senderAddress);
+
         // 解析消息
         QJsonDocument doc = QJsonDocument::fromJson(datagram);
         if (!doc.isObject()) {
@@ -149,6 +261,12 @@ void UserDiscovery::processPendingDatagrams()
 
         QJsonObject discoveryObj = doc.object();
 
+        // 注册中心的应答
+        if (discoveryObj.contains("op")) {
+            processRendezvousReply(discoveryObj, senderAddress);
+            continue;
+        }
+
         // 检查必要字段
         if (!discoveryObj.contains("userId") || 
             !discoveryObj.contains("nickname") || 
@@ -168,31 +286,29 @@ void UserDiscovery::processPendingDatagrams()
         DiscoveredUser user;
         user.userId = userId;
         user.nickname = discoveryObj["nickname"].toString();
-        user.address = senderAddress;
+        // 同一用户可能同时从IPv4广播和IPv6组播到达，分别记录两个协议的地址
+        QList<QHostAddress> knownAddresses;
+        if (discoveredUsers.contains(userId)) {
+            knownAddresses = discoveredUsers.value(userId).addresses;
+        }
+        user.addresses = NetworkUtils::mergeAddress(knownAddresses, senderAddress);
+        user.address = NetworkUtils::preferredAddress(user.addresses);
         user.port = discoveryObj["tcpPort"].toInt();
         user.state = static_cast<UserState>(discoveryObj["state"].toInt());
         user.lastSeen = QDateTime::currentDateTime();
 
-        bool isNewUser = !discoveredUsers.contains(userId);
-        bool stateChanged = false;
-
-        if (!isNewUser) {
-            const DiscoveredUser &oldUser = discoveredUsers[userId];
-            stateChanged = (oldUser.state != user.state);
-        }
+        // 对方广播间隔越长，允许的静默时间越长（旧版本没有该字段，使用默认超时）
+        int interval = discoveryObj["interval"].toInt(0);
+        user.timeoutMs = qMax(Constants::USER_TIMEOUT_MS, interval * Constants::BEACON_TIMEOUT_FACTOR);
 
-        // 更新用户列表
-        discoveredUsers[userId] = user;
+        // 直接收到对方广播后不再依赖注册中心的信息
+        rendezvousPeers.remove(userId);
+        bool isNewUser = updateDiscoveredUser(user);
 
-        // 发送信号
-        if (isNewUser) {
-            emit userDiscovered(user);
-        } else if (stateChanged) {
-            emit userStateChanged(userId, user.state);
+        // 仅在对方首次出现或请求探测时回复，避免双方互相回复形成广播风暴
+        if (isNewUser || discoveryObj["probe"].toBool()) {
+            sendUserDiscoveryMessage(senderAddress, senderPort);
         }
-
-        // 回复自己的信息
-        sendUserDiscoveryMessage(senderAddress, senderPort);
     }
 }
 
@@ -201,17 +317,26 @@ void UserDiscovery::cleanupTimeoutUsers()
     QDateTime now = QDateTime::currentDateTime();
     QList<QUuid> toRemove;
 
-    for (auto it = discoveredUsers.constBegin(); it != discoveredUsers.constEnd(); ++it) {
+    const QMap<QUuid, DiscoveredUser> &users = discoveredUsers.users();
+    for (auto it = users.constBegin(); it != users.constEnd(); ++it) {
         const DiscoveredUser &user = it.value();
-        if (user.lastSeen.secsTo(now) > Constants::USER_TIMEOUT_MS / 1000) {
+        if (user.lastSeen.msecsTo(now) >= user.timeoutMs) {
             toRemove.append(it.key());
         }
     }
 
     for (const QUuid &userId : toRemove) {
         discoveredUsers.remove(userId);
+        rendezvousPeers.remove(userId);
         emit userLost(userId);
     }
+
+    if (!toRemove.isEmpty()) {
+        emit peersChanged(discoveredUsers.sequence());
+        onPeerChurn();
+    }
+
+    scheduleCleanup();
 }
 
 void UserDiscovery::initSocket()
@@ -222,10 +347,19 @@ void UserDiscovery::initSocket()
 
     // 创建定时器
     broadcastTimer = new QTimer(this);
+    broadcastTimer->setSingleShot(true);
     connect(broadcastTimer, &QTimer::timeout, this, &UserDiscovery::sendBroadcast);
 
     cleanupTimer = new QTimer(this);
+    cleanupTimer->setSingleShot(true);
     connect(cleanupTimer, &QTimer::timeout, this, &UserDiscovery::cleanupTimeoutUsers);
+
+    cacheSaveTimer = new QTimer(this);
+    cacheSaveTimer->setSingleShot(true);
+    connect(cacheSaveTimer, &QTimer::timeout, this, &UserDiscovery::savePeerCache);
+
+    rendezvousTimer = new QTimer(this);
+    connect(rendezvousTimer, &QTimer::timeout, this, &UserDiscovery::syncWithRendezvous);
 }
 
 void UserDiscovery::stopTimers()
@@ -237,33 +371,300 @@ void UserDiscovery::stopTimers()
     if (cleanupTimer) {
         cleanupTimer->stop();
     }
+
+    if (cacheSaveTimer) {
+        cacheSaveTimer->stop();
+    }
+
+    if (rendezvousTimer) {
+        rendezvousTimer->stop();
+    }
 }
 
-void UserDiscovery::startTimers()
+void UserDiscovery::joinIPv6Group()
 {
-    if (broadcastTimer) {
-        broadcastTimer->start(Constants::HEARTBEAT_INTERVAL_MS);
+    QHostAddress group(Constants::DISCOVERY_IPV6_GROUP);
+    int joined = 0;
+
+    const QList<QNetworkInterface> interfaces = QNetworkInterface::allInterfaces();
+    for (const QNetworkInterface &interface : interfaces) {
+        if (!(interface.flags() & QNetworkInterface::IsUp) ||
+            !(interface.flags() & QNetworkInterface::CanMulticast) ||
+            interface.flags() & QNetworkInterface::IsLoopBack) {
+            continue;
+        }
+
+        if (udpSocket->joinMulticastGroup(group, interface)) {
+            joined++;
+        }
     }
 
-    if (cleanupTimer) {
-        cleanupTimer->start(Constants::USER_TIMEOUT_MS / 2);
+    if (joined == 0) {
+        qWarning() << "未能在任何接口上加入IPv6发现组播组:" << udpSocket->errorString();
     }
 }
 
 void UserDiscovery::sendUserDiscoveryMessage(const QHostAddress &address, quint16 port)
 {
-    // 创建用户发现消息
+    // 回复消息不请求对方再次回复，承诺的间隔为当前广播周期
+    int interval = broadcastTimer->isActive() ? broadcastTimer->interval() : beaconInterval;
+    QByteArray data = createDiscoveryMessage(interval, false);
+
+    // 发送到指定地址
+    udpSocket->writeDatagram(data, address, port);
+}
+
+QByteArray UserDiscovery::createDiscoveryMessage(int interval, bool probe) const
+{
     QJsonObject discoveryObj;
     discoveryObj["userId"] = userIdentity.getUuid().toString();
     discoveryObj["nickname"] = userIdentity.getNickname();
     discoveryObj["state"] = static_cast<int>(currentState);
     discoveryObj["tcpPort"] = Constants::DEFAULT_TCP_PORT;
+    discoveryObj["interval"] = interval;
+    if (probe) {
+        discoveryObj["probe"] = true;
+    }
 
     QJsonDocument doc(discoveryObj);
-    QByteArray data = doc.toJson(QJsonDocument::Compact);
+    return doc.toJson(QJsonDocument::Compact);
+}
 
-    // 发送到指定地址
-    udpSocket->writeDatagram(data, address, port);
+void UserDiscovery::resetBroadcastBackoff()
+{
+    beaconInterval = Constants::BEACON_MIN_INTERVAL_MS;
+}
+
+void UserDiscovery::onPeerChurn()
+{
+    // 有用户上下线时把广播间隔压回心跳间隔，降低丢包对收敛速度的影响
+    beaconInterval = qMin(beaconInterval, Constants::HEARTBEAT_INTERVAL_MS);
+    if (broadcastTimer->isActive() && broadcastTimer->remainingTime() > Constants::HEARTBEAT_INTERVAL_MS) {
+        broadcastTimer->start(Constants::HEARTBEAT_INTERVAL_MS);
+    }
+}
+
+void UserDiscovery::scheduleCleanup()
+{
+    if (discoveredUsers.users().isEmpty()) {
+        cleanupTimer->stop();
+        return;
+    }
+
+    // 计算距离最早超时用户的剩余时间
+    QDateTime now = QDateTime::currentDateTime();
+    qint64 nextCheck = static_cast<qint64>(Constants::BEACON_MAX_INTERVAL_MS) * Constants::BEACON_TIMEOUT_FACTOR;
+    for (const auto &user : discoveredUsers.users()) {
+        nextCheck = qMin(nextCheck, user.timeoutMs - user.lastSeen.msecsTo(now));
+    }
+
+    cleanupTimer->start(static_cast<int>(qMax<qint64>(nextCheck, 0)));
+}
+
+void UserDiscovery::loadPeerCache()
+{
+    knownPeers = PeerCache::loadFromLocal();
+    knownPeers.remove(userIdentity.getUuid());
+    if (knownPeers.isEmpty()) {
+        return;
+    }
+
+    QByteArray probe = createDiscoveryMessage(beaconInterval, true);
+    QDateTime now = QDateTime::currentDateTime();
+
+    for (const DiscoveredUser &cachedUser : std::as_const(knownPeers)) {
+        // 缓存用户立即显示，若在确认时间内没有回复则按超时移除
+        DiscoveredUser user = cachedUser;
+        user.lastSeen = now;
+        user.timeoutMs = Constants::PEER_CACHE_VERIFY_MS;
+        user.cached = true;
+
+        if (discoveredUsers.upsert(user)) {
+            emit userDiscovered(user);
+        }
+
+        // 定向探测上次已知的地址，不必等待广播轮次
+        const QList<QHostAddress> addresses = user.addresses.isEmpty() ? QList<QHostAddress>{user.address} : user.addresses;
+        for (const QHostAddress &address : addresses) {
+            if (ipv6Enabled || address.protocol() == QAbstractSocket::IPv4Protocol) {
+                udpSocket->writeDatagram(probe, address, Constants::DEFAULT_UDP_PORT);
+            }
+        }
+    }
+
+    emit peersChanged(discoveredUsers.sequence());
+    scheduleCleanup();
+
+    qInfo() << "已从缓存加载" << knownPeers.size() << "个用户";
+}
+
+void UserDiscovery::savePeerCache()
+{
+    PeerCache::saveToLocal(knownPeers);
+}
+
+bool UserDiscovery::updateDiscoveredUser(const DiscoveredUser &user)
+{
+    bool isNewUser = !discoveredUsers.contains(user.userId);
+    bool stateChanged = false;
+
+    if (!isNewUser) {
+        stateChanged = (discoveredUsers.value(user.userId).state != user.state);
+    }
+
+    // 更新用户列表
+    bool directoryChanged = discoveredUsers.upsert(user);
+    knownPeers[user.userId] = user;
+
+    // 确保清理定时器不晚于该用户的超时时间
+    if (!cleanupTimer->isActive() || cleanupTimer->remainingTime() > user.timeoutMs) {
+        cleanupTimer->start(user.timeoutMs);
+    }
+
+    // 发送信号
+    if (isNewUser) {
+        emit userDiscovered(user);
+        onPeerChurn();
+    } else if (stateChanged) {
+        emit userStateChanged(user.userId, user.state);
+    }
+
+    if (directoryChanged) {
+        emit peersChanged(discoveredUsers.sequence());
+
+        // 合并短时间内的多次变化，延迟写入缓存
+        if (!cacheSaveTimer->isActive()) {
+            cacheSaveTimer->start(Constants::PEER_CACHE_SAVE_DELAY_MS);
+        }
+    }
+
+    return isNewUser;
+}
+
+void UserDiscovery::syncWithRendezvous()
+{
+    if (rendezvousAddress.isNull() || !udpSocket->isOpen()) {
+        return;
+    }
+
+    // 续约注册，有效期覆盖若干个同步周期
+    QJsonObject registerObj;
+    registerObj["op"] = "register";
+    registerObj["userId"] = userIdentity.getUuid().toString();
+    registerObj["nickname"] = userIdentity.getNickname();
+    registerObj["state"] = static_cast<int>(currentState);
+    registerObj["tcpPort"] = Constants::DEFAULT_TCP_PORT;
+    registerObj["ttl"] = Constants::RENDEZVOUS_SYNC_INTERVAL_MS * Constants::RENDEZVOUS_TTL_FACTOR;
+    udpSocket->writeDatagram(QJsonDocument(registerObj).toJson(QJsonDocument::Compact),
+                             rendezvousAddress, rendezvousPort);
+
+    // 请求上次同步之后的目录变更
+    sendRendezvousQuery(QJsonObject());
+}
+
+void UserDiscovery::sendRendezvousQuery(const QJsonObject &continuation)
+{
+    QJsonObject query = continuation;
+    query["op"] = "query";
+    query["since"] = static_cast<qint64>(rendezvousSequence);
+    udpSocket->writeDatagram(QJsonDocument(query).toJson(QJsonDocument::Compact),
+                             rendezvousAddress, rendezvousPort);
+}
+
+void UserDiscovery::processRendezvousReply(const QJsonObject &reply, const QHostAddress &senderAddress)
+{
+    // 只接受已配置的注册中心发来的目录
+    if (rendezvousAddress.isNull() ||
+        !senderAddress.isEqual(rendezvousAddress, QHostAddress::TolerantConversion) ||
+        reply["op"].toString() != "directory") {
+        return;
+    }
+
+    bool reset = reply["reset"].toBool();
+    bool more = reply["more"].toBool();
+    quint64 sequence = static_cast<quint64>(reply["sequence"].toInteger());
+
+    // 全量同步的第一页：记录本轮出现的用户，结束后移除未出现的
+    if (reset && !rendezvousResyncing) {
+        rendezvousResyncing = true;
+        rendezvousResyncSeen.clear();
+    }
+
+    // 注册中心仍在维护这些用户，刷新其在线时间
+    QDateTime now = QDateTime::currentDateTime();
+    for (const QUuid &userId : std::as_const(rendezvousPeers)) {
+        DiscoveredUser user = discoveredUsers.value(userId);
+        user.lastSeen = now;
+        discoveredUsers.upsert(user);
+    }
+
+    const QJsonArray peersArray = reply["peers"].toArray();
+    for (const QJsonValue &value : peersArray) {
+        DiscoveredUser user = RendezvousRegistry::peerFromJson(value.toObject());
+        if (user.userId.isNull() || user.userId == userIdentity.getUuid()) {
+            continue;
+        }
+
+        if (reset) {
+            rendezvousResyncSeen.insert(user.userId);
+        }
+
+        // 同一网段内直接收到广播的用户以广播信息为准
+        if (discoveredUsers.contains(user.userId) && !rendezvousPeers.contains(user.userId) &&
+            !discoveredUsers.value(user.userId).cached) {
+            continue;
+        }
+
+        user.lastSeen = now;
+        user.timeoutMs = Constants::RENDEZVOUS_SYNC_INTERVAL_MS * Constants::RENDEZVOUS_TTL_FACTOR;
+        rendezvousPeers.insert(user.userId);
+        updateDiscoveredUser(user);
+    }
+
+    const QJsonArray removedArray = reply["removed"].toArray();
+    for (const QJsonValue &value : removedArray) {
+        removeRendezvousPeer(QUuid(value.toString()));
+    }
+
+    if (reset) {
+        if (more) {
+            // 继续请求下一页
+            QJsonObject continuation;
+            continuation["after"] = reply["after"];
+            continuation["snapshot"] = reply["sequence"];
+            sendRendezvousQuery(continuation);
+            return;
+        }
+
+        // 全量同步结束，移除已不在注册中心的用户
+        const QSet<QUuid> peers = rendezvousPeers;
+        for (const QUuid &userId : peers) {
+            if (!rendezvousResyncSeen.contains(userId)) {
+                removeRendezvousPeer(userId);
+            }
+        }
+        rendezvousResyncing = false;
+        rendezvousResyncSeen.clear();
+    }
+
+    rendezvousSequence = sequence;
+
+    // 增量变更未发送完时立即继续请求
+    if (more) {
+        sendRendezvousQuery(QJsonObject());
+    }
+}
+
+void UserDiscovery::removeRendezvousPeer(QUuid userId)
+{
+    if (!rendezvousPeers.remove(userId)) {
+        return;
+    }
+
+    if (discoveredUsers.remove(userId)) {
+        emit userLost(userId);
+        emit peersChanged(discoveredUsers.sequence());
+    }
 }
 
 } // namespace LocalNetworkApp
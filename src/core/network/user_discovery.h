@@ -6,22 +6,16 @@
 #include <QTimer>
 #include <QtNetwork/QHostAddress>
 #include <QMap>
+#include <QSet>
+#include <QJsonObject>
 #include <QDateTime>
 #include "../user/userIdentity.h"
 #include "../user/user_status.h"
 #include "../utils/constants.h"
+#include "peer_directory.h"
 
 namespace LocalNetworkApp {
 
-struct DiscoveredUser {
-    QUuid userId;              // 用户ID
-    QString nickname;          // 用户昵称
-    QHostAddress address;      // 用户地址
-    quint16 port;              // 用户端口
-    UserState state;           // 用户状态
-    QDateTime lastSeen;        // 最后在线时间
-};
-
 class UserDiscovery : public QObject {
     Q_OBJECT
 
@@ -41,6 +35,21 @@ public:
     // 获取特定用户信息
     DiscoveredUser getDiscoveredUser(QUuid userId) const;
 
+    // 获取用户目录快照（共享数据，不复制）
+    PeerSnapshot getPeerSnapshot() const;
+
+    // 获取某序号之后的用户变更；返回false时应改用快照重建
+    bool getPeerChanges(quint64 since, QList<PeerChange> *changes) const;
+
+    // 获取用户目录当前序号
+    quint64 getPeerSequence() const;
+
+    // 设置跨网段发现的注册中心地址（启用注册中心模式）
+    void setRendezvousServer(const QHostAddress &address, quint16 port = Constants::DEFAULT_RENDEZVOUS_PORT);
+
+    // 关闭注册中心模式
+    void clearRendezvousServer();
+
     // 检查用户是否在线
     bool isUserOnline(QUuid userId) const;
 
@@ -60,6 +69,9 @@ signals:
     // 用户状态变更
     void userStateChanged(QUuid userId, UserState state);
 
+    // 用户目录发生变化
+    void peersChanged(quint64 sequence);
+
 private slots:
     // 发送广播
     void sendBroadcast();
@@ -70,13 +82,31 @@ private slots:
     // 清理超时用户
     void cleanupTimeoutUsers();
 
+    // 保存已知用户缓存
+    void savePeerCache();
+
+    // 向注册中心续约并同步目录
+    void syncWithRendezvous();
+
 private:
     QUdpSocket *udpSocket;                     // UDP Socket
     UserIdentity userIdentity;                 // 用户身份
     QTimer *broadcastTimer;                    // 广播定时器
     QTimer *cleanupTimer;                      // 清理定时器
-    QMap<QUuid, DiscoveredUser> discoveredUsers; // 已发现的用户
+    QTimer *cacheSaveTimer;                    // 用户缓存延迟保存定时器
+    QTimer *rendezvousTimer;                   // 注册中心同步定时器
+    PeerDirectory discoveredUsers;             // 已发现的用户
+    QMap<QUuid, DiscoveredUser> knownPeers;    // 曾经发现过的用户（持久化到缓存）
     UserState currentState;                    // 当前用户状态
+    int beaconInterval;                        // 下一次广播间隔（指数退避）
+    int probeBeaconsLeft;                      // 剩余的探测广播次数
+    QHostAddress rendezvousAddress;            // 注册中心地址（为空表示未启用）
+    quint16 rendezvousPort;                    // 注册中心端口
+    quint64 rendezvousSequence;                // 已同步到的注册中心目录序号
+    bool rendezvousResyncing;                  // 是否正在进行全量同步
+    QSet<QUuid> rendezvousPeers;               // 仅通过注册中心发现的用户
+    QSet<QUuid> rendezvousResyncSeen;          // 本轮全量同步中出现的用户
+    bool ipv6Enabled;                          // 是否以双栈方式绑定（可收发IPv6组播）
 
     // 初始化Socket
     void initSocket();
@@ -84,11 +114,38 @@ private:
     // 停止定时器
     void stopTimers();
 
-    // 启动定时器
-    void startTimers();
+    // 在所有可组播的接口上加入IPv6发现组
+    void joinIPv6Group();
 
     // 发送用户发现消息
     void sendUserDiscoveryMessage(const QHostAddress &address, quint16 port);
+
+    // 创建用户发现消息
+    QByteArray createDiscoveryMessage(int interval, bool probe) const;
+
+    // 重置广播退避，从最短间隔重新开始
+    void resetBroadcastBackoff();
+
+    // 网络中有用户上下线时缩短广播间隔
+    void onPeerChurn();
+
+    // 按最早的超时时间安排下一次清理
+    void scheduleCleanup();
+
+    // 加载用户缓存并向缓存中的地址发送定向探测
+    void loadPeerCache();
+
+    // 更新已发现用户并发送相应信号，返回是否为新用户
+    bool updateDiscoveredUser(const DiscoveredUser &user);
+
+    // 发送目录查询请求（continuation为全量同步的分页参数）
+    void sendRendezvousQuery(const QJsonObject &continuation);
+
+    // 处理注册中心的应答
+    void processRendezvousReply(const QJsonObject &reply, const QHostAddress &senderAddress);
+
+    // 移除通过注册中心发现的用户
+    void removeRendezvousPeer(QUuid userId);
 };
 
 } // namespace LocalNetworkApp
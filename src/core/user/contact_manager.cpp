@@ -2,8 +2,14 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QSettings>
+#include <QFile>
 #include <QDateTime>
+#include <QDebug>
 #include "../utils/constants.h"
+#include "../utils/persistence_service.h"
+#include "../utils/binary_codec.h"
+#include "../data/paged_file.h"
+#include "../data/security_manager.h"
 
 namespace LocalNetworkApp {
 
@@ -13,6 +19,7 @@ QJsonObject ContactInfo::toJson() const
     json["id"] = id.toString();
     json["nickname"] = nickname;
     json["remark"] = remark;
+    json["group"] = group;
     json["state"] = static_cast<int>(state);
     json["lastSeen"] = lastSeen.toString(Qt::ISODate);
     return json;
@@ -24,25 +31,104 @@ ContactInfo ContactInfo::fromJson(const QJsonObject &json)
     info.id = QUuid(json["id"].toString());
     info.nickname = json["nickname"].toString();
     info.remark = json["remark"].toString();
+    info.group = json["group"].toString();
     info.state = static_cast<UserState>(json["state"].toInt());
     info.lastSeen = QDateTime::fromString(json["lastSeen"].toString(), Qt::ISODate);
     return info;
 }
 
+QByteArray ContactInfo::toBinary() const
+{
+    QByteArray data;
+    BinaryWriter writer(&data);
+    writer.writeUInt8(BINARY_VERSION);
+    writer.writeUuid(id);
+    writer.writeString(nickname);
+    writer.writeString(remark);
+    writer.writeString(group);
+    writer.writeUInt8(static_cast<quint8>(state));
+    writer.writeDateTime(lastSeen);
+    return data;
+}
+
+ContactInfo ContactInfo::fromBinary(const QByteArray &data, bool *ok)
+{
+    // 兼容JSON格式
+    if (data.startsWith('{')) {
+        QJsonObject json = QJsonDocument::fromJson(data).object();
+        if (ok) {
+            *ok = !json.isEmpty();
+        }
+        return fromJson(json);
+    }
+
+    ContactInfo info;
+    BinaryReader reader(data);
+    quint8 version = reader.readUInt8();
+    bool valid = version >= 1 && version <= BINARY_VERSION;
+    if (valid) {
+        info.id = reader.readUuid();
+        info.nickname = reader.readString();
+        info.remark = reader.readString();
+        if (version >= 2) {
+            info.group = reader.readString();
+        }
+        info.state = static_cast<UserState>(reader.readUInt8());
+        info.lastSeen = reader.readDateTime();
+        valid = reader.isOk();
+    }
+
+    if (ok) {
+        *ok = valid;
+    }
+    return info;
+}
+
 ContactManager::ContactManager()
 {
 }
 
 void ContactManager::addContact(const ContactInfo &contact)
 {
+    auto it = contacts.find(contact.id);
+    if (it != contacts.end()) {
+        unindexContact(it.value());
+    }
     contacts[contact.id] = contact;
+    indexContact(contact);
+}
+
+int ContactManager::addContacts(const QList<ContactInfo> &newContacts)
+{
+    // 导入量大于现有联系人时先全部写入再一次性重建索引，否则逐个更新索引
+    bool rebuild = newContacts.size() > contacts.size();
+    for (const ContactInfo &contact : newContacts) {
+        if (rebuild) {
+            contacts[contact.id] = contact;
+        } else {
+            addContact(contact);
+        }
+    }
+
+    if (rebuild) {
+        rebuildIndexes();
+    }
+    return newContacts.size();
 }
 
 void ContactManager::removeContact(QUuid contactId)
 {
-    contacts.remove(contactId);
-    blacklist.remove(contactId);
-    whitelist.remove(contactId);
+    auto it = contacts.find(contactId);
+    if (it != contacts.end()) {
+        unindexContact(it.value());
+        contacts.erase(it);
+    }
+    policies.remove(contactId);
+}
+
+bool ContactManager::contains(QUuid contactId) const
+{
+    return contacts.contains(contactId);
 }
 
 ContactInfo ContactManager::getContact(QUuid contactId) const
@@ -55,85 +141,175 @@ QList<ContactInfo> ContactManager::getAllContacts() const
     return contacts.values();
 }
 
+void ContactManager::forEachContact(const std::function<void(const ContactInfo &)> &visitor) const
+{
+    for (const ContactInfo &contact : contacts) {
+        visitor(contact);
+    }
+}
+
+int ContactManager::contactCount() const
+{
+    return contacts.size();
+}
+
+QList<ContactInfo> ContactManager::findContacts(const QString &prefix, int limit) const
+{
+    QList<ContactInfo> result;
+    QSet<QUuid> seen;
+    QString key = prefix.toCaseFolded();
+
+    // 索引按字典序排列，前缀相同的词连续存放
+    for (auto it = nameIndex.lowerBound(key); it != nameIndex.constEnd() && it.key().startsWith(key); ++it) {
+        for (const QUuid &id : it.value()) {
+            if (seen.contains(id)) {
+                continue;
+            }
+            seen.insert(id);
+            result.append(contacts.value(id));
+            if (limit >= 0 && result.size() >= limit) {
+                return result;
+            }
+        }
+    }
+    return result;
+}
+
+QList<ContactInfo> ContactManager::getContactsInGroup(const QString &group) const
+{
+    return contactsFor(groupIndex.value(group));
+}
+
+QStringList ContactManager::getGroups() const
+{
+    return groupIndex.keys();
+}
+
+QList<ContactInfo> ContactManager::getContactsByState(UserState state) const
+{
+    return contactsFor(stateIndex.value(state));
+}
+
 void ContactManager::setContactRemark(QUuid contactId, const QString &remark)
 {
-    if (contacts.contains(contactId)) {
-        contacts[contactId].remark = remark;
+    auto it = contacts.find(contactId);
+    if (it != contacts.end()) {
+        unindexContact(it.value());
+        it->remark = remark;
+        indexContact(it.value());
+    }
+}
+
+void ContactManager::setContactGroup(QUuid contactId, const QString &group)
+{
+    auto it = contacts.find(contactId);
+    if (it != contacts.end()) {
+        unindexContact(it.value());
+        it->group = group;
+        indexContact(it.value());
     }
 }
 
 void ContactManager::updateContactState(QUuid contactId, UserState state)
 {
-    if (contacts.contains(contactId)) {
-        contacts[contactId].state = state;
+    auto it = contacts.find(contactId);
+    if (it != contacts.end()) {
+        if (it->state != state) {
+            stateIndex[it->state].remove(contactId);
+            if (stateIndex[it->state].isEmpty()) {
+                stateIndex.remove(it->state);
+            }
+            stateIndex[state].insert(contactId);
+            it->state = state;
+        }
         if (state != UserState::Invisible) {
-            contacts[contactId].lastSeen = QDateTime::currentDateTime();
+            it->lastSeen = QDateTime::currentDateTime();
         }
     }
 }
 
+ContactPolicy ContactManager::getPolicy(QUuid contactId) const
+{
+    return policies.value(contactId, ContactPolicy::Normal);
+}
+
 void ContactManager::addToBlacklist(QUuid contactId)
 {
-    blacklist.insert(contactId);
-    whitelist.remove(contactId); // 从白名单中移除
+    setPolicy(contactId, ContactPolicy::Blocked); // 同时从白名单中移除
 }
 
 void ContactManager::removeFromBlacklist(QUuid contactId)
 {
-    blacklist.remove(contactId);
+    if (getPolicy(contactId) == ContactPolicy::Blocked) {
+        setPolicy(contactId, ContactPolicy::Normal);
+    }
 }
 
 bool ContactManager::isInBlacklist(QUuid contactId) const
 {
-    return blacklist.contains(contactId);
+    return getPolicy(contactId) == ContactPolicy::Blocked;
 }
 
 void ContactManager::addToWhitelist(QUuid contactId)
 {
-    whitelist.insert(contactId);
-    blacklist.remove(contactId); // 从黑名单中移除
+    setPolicy(contactId, ContactPolicy::Trusted); // 同时从黑名单中移除
 }
 
 void ContactManager::removeFromWhitelist(QUuid contactId)
 {
-    whitelist.remove(contactId);
+    if (getPolicy(contactId) == ContactPolicy::Trusted) {
+        setPolicy(contactId, ContactPolicy::Normal);
+    }
 }
 
 bool ContactManager::isInWhitelist(QUuid contactId) const
 {
-    return whitelist.contains(contactId);
+    return getPolicy(contactId) == ContactPolicy::Trusted;
 }
 
 bool ContactManager::saveToLocal() const
 {
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-    
-    // 保存联系人列表
-    QJsonArray contactsArray;
-    for (const auto &contact : contacts) {
-        contactsArray.append(contact.toJson());
+    // 存储密钥不对或文件损坏时保留原文件，密钥恢复后仍可读取
+    if (readOnly) {
+        qWarning() << "联系人文件无法读取，本次的修改不会保存:" << Constants::CONTACTS_FILE;
+        return false;
     }
-    settings.setValue("contacts/list", QString::fromUtf8(QJsonDocument(contactsArray).toJson()));
-    
-    // 保存黑名单
-    QJsonArray blacklistArray;
-    for (const auto &id : blacklist) {
-        blacklistArray.append(id.toString());
-    }
-    settings.setValue("contacts/blacklist", QString::fromUtf8(QJsonDocument(blacklistArray).toJson()));
-    
-    // 保存白名单
-    QJsonArray whitelistArray;
-    for (const auto &id : whitelist) {
-        whitelistArray.append(id.toString());
-    }
-    settings.setValue("contacts/whitelist", QString::fromUtf8(QJsonDocument(whitelistArray).toJson()));
-    
-    return settings.status() == QSettings::NoError;
+
+    // 由后台线程写入联系人文件，界面操作不等待磁盘；有存储密钥时按页加密
+    PersistenceService::instance()->writeFile(Constants::CONTACTS_FILE,
+                                              PagedFile::encryptBuffer(toBinary(), SecurityManager::storageKey()));
+    return true;
 }
 
 ContactManager ContactManager::loadFromLocal()
 {
+    // 优先读取二进制联系人文件
+    QFile file(Constants::CONTACTS_FILE);
+    if (file.open(QIODevice::ReadOnly)) {
+        // 旧版明文文件照常读取，下次保存时加密
+        bool ok = true;
+        QByteArray data = file.readAll();
+        if (PagedFile::isEncryptedData(data)) {
+            data = PagedFile::decryptBuffer(data, SecurityManager::storageKey(), &ok);
+        }
+
+        ContactManager manager = ok ? fromBinary(data, &ok) : ContactManager();
+        if (ok) {
+            // 联系人文件已生效，删除旧版保存在设置文件中的数据
+            QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+            if (settings.contains("contacts/list")) {
+                PersistenceService *persistence = PersistenceService::instance();
+                persistence->remove("contacts/list");
+                persistence->remove("contacts/blacklist");
+                persistence->remove("contacts/whitelist");
+            }
+            return manager;
+        }
+        qWarning() << "联系人文件无法解密或已损坏，保留原文件并尝试读取旧版数据:" << Constants::CONTACTS_FILE;
+    }
+    bool readOnly = file.exists();
+
+    // 旧版本把联系人以JSON保存在设置文件中
     ContactManager manager;
     QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
     
@@ -157,7 +333,7 @@ ContactManager ContactManager::loadFromLocal()
         QJsonArray blacklistArray = doc.array();
         
         for (const auto &value : blacklistArray) {
-            manager.blacklist.insert(QUuid(value.toString()));
+            manager.setPolicy(QUuid(value.toString()), ContactPolicy::Blocked);
         }
     }
     
@@ -168,13 +344,20 @@ ContactManager ContactManager::loadFromLocal()
         QJsonArray whitelistArray = doc.array();
         
         for (const auto &value : whitelistArray) {
-            manager.whitelist.insert(QUuid(value.toString()));
+            manager.setPolicy(QUuid(value.toString()), ContactPolicy::Trusted);
         }
     }
     
+    manager.rebuildIndexes();
+    manager.readOnly = readOnly;
     return manager;
 }
 
+bool ContactManager::isReadOnly() const
+{
+    return readOnly;
+}
+
 QJsonObject ContactManager::toJson() const
 {
     QJsonObject json;
@@ -186,18 +369,17 @@ QJsonObject ContactManager::toJson() const
     }
     json["contacts"] = contactsArray;
     
-    // 保存黑名单
+    // 保存黑名单和白名单
     QJsonArray blacklistArray;
-    for (const auto &id : blacklist) {
-        blacklistArray.append(id.toString());
-    }
-    json["blacklist"] = blacklistArray;
-    
-    // 保存白名单
     QJsonArray whitelistArray;
-    for (const auto &id : whitelist) {
-        whitelistArray.append(id.toString());
+    for (auto it = policies.constBegin(); it != policies.constEnd(); ++it) {
+        if (it.value() == ContactPolicy::Blocked) {
+            blacklistArray.append(it.key().toString());
+        } else if (it.value() == ContactPolicy::Trusted) {
+            whitelistArray.append(it.key().toString());
+        }
     }
+    json["blacklist"] = blacklistArray;
     json["whitelist"] = whitelistArray;
     
     return json;
@@ -221,7 +403,7 @@ ContactManager ContactManager::fromJson(const QJsonObject &json)
     if (json.contains("blacklist")) {
         QJsonArray blacklistArray = json["blacklist"].toArray();
         for (const auto &value : blacklistArray) {
-            manager.blacklist.insert(QUuid(value.toString()));
+            manager.setPolicy(QUuid(value.toString()), ContactPolicy::Blocked);
         }
     }
     
@@ -229,11 +411,182 @@ ContactManager ContactManager::fromJson(const QJsonObject &json)
     if (json.contains("whitelist")) {
         QJsonArray whitelistArray = json["whitelist"].toArray();
         for (const auto &value : whitelistArray) {
-            manager.whitelist.insert(QUuid(value.toString()));
+            manager.setPolicy(QUuid(value.toString()), ContactPolicy::Trusted);
         }
     }
     
+    manager.rebuildIndexes();
+    return manager;
+}
+
+QByteArray ContactManager::toBinary() const
+{
+    QByteArray data;
+    BinaryWriter writer(&data);
+    writer.writeUInt32(FILE_MAGIC);
+    writer.writeUInt16(FILE_VERSION);
+
+    // 联系人列表
+    writer.writeUInt32(static_cast<quint32>(contacts.size()));
+    for (const auto &contact : contacts) {
+        writer.writeBytes(contact.toBinary());
+    }
+
+    // 黑名单和白名单
+    QList<QUuid> blacklist;
+    QList<QUuid> whitelist;
+    for (auto it = policies.constBegin(); it != policies.constEnd(); ++it) {
+        if (it.value() == ContactPolicy::Blocked) {
+            blacklist.append(it.key());
+        } else if (it.value() == ContactPolicy::Trusted) {
+            whitelist.append(it.key());
+        }
+    }
+
+    writer.writeUInt32(static_cast<quint32>(blacklist.size()));
+    for (const auto &id : std::as_const(blacklist)) {
+        writer.writeUuid(id);
+    }
+
+    writer.writeUInt32(static_cast<quint32>(whitelist.size()));
+    for (const auto &id : std::as_const(whitelist)) {
+        writer.writeUuid(id);
+    }
+
+    return data;
+}
+
+ContactManager ContactManager::fromBinary(const QByteArray &data, bool *ok)
+{
+    ContactManager manager;
+    BinaryReader reader(data);
+    bool valid = reader.readUInt32() == FILE_MAGIC && reader.readUInt16() == FILE_VERSION;
+
+    // 加载联系人列表
+    quint32 count = valid ? reader.readUInt32() : 0;
+    for (quint32 i = 0; i < count && reader.isOk(); ++i) {
+        bool contactOk = false;
+        ContactInfo contact = ContactInfo::fromBinary(reader.readBytes(), &contactOk);
+        if (contactOk) {
+            manager.contacts[contact.id] = contact;
+        }
+    }
+
+    // 加载黑名单
+    quint32 blacklistCount = valid ? reader.readUInt32() : 0;
+    for (quint32 i = 0; i < blacklistCount && reader.isOk(); ++i) {
+        manager.setPolicy(reader.readUuid(), ContactPolicy::Blocked);
+    }
+
+    // 加载白名单
+    quint32 whitelistCount = valid ? reader.readUInt32() : 0;
+    for (quint32 i = 0; i < whitelistCount && reader.isOk(); ++i) {
+        manager.setPolicy(reader.readUuid(), ContactPolicy::Trusted);
+    }
+
+    if (ok) {
+        *ok = valid && reader.isOk();
+    }
+    manager.rebuildIndexes();
     return manager;
 }
 
+QByteArray ContactManager::exportContacts() const
+{
+    return toBinary();
+}
+
+int ContactManager::importContacts(const QByteArray &data)
+{
+    bool ok = false;
+    ContactManager imported;
+
+    // 同时接受JSON导出格式
+    if (data.startsWith('{')) {
+        QJsonDocument doc = QJsonDocument::fromJson(data);
+        ok = doc.isObject();
+        imported = fromJson(doc.object());
+    } else {
+        imported = fromBinary(data, &ok);
+    }
+
+    if (!ok) {
+        qWarning() << "无法导入联系人：数据格式无效";
+        return -1;
+    }
+    return merge(imported);
+}
+
+void ContactManager::setPolicy(QUuid contactId, ContactPolicy policy)
+{
+    if (policy == ContactPolicy::Normal) {
+        policies.remove(contactId);
+    } else {
+        policies[contactId] = policy;
+    }
+}
+
+void ContactManager::indexContact(const ContactInfo &contact)
+{
+    if (!contact.nickname.isEmpty()) {
+        nameIndex[contact.nickname.toCaseFolded()].insert(contact.id);
+    }
+    if (!contact.remark.isEmpty()) {
+        nameIndex[contact.remark.toCaseFolded()].insert(contact.id);
+    }
+    if (!contact.group.isEmpty()) {
+        groupIndex[contact.group].insert(contact.id);
+    }
+    stateIndex[contact.state].insert(contact.id);
+}
+
+void ContactManager::unindexContact(const ContactInfo &contact)
+{
+    // 从集合中移除ID，集合为空时删除整个键
+    auto removeFrom = [&contact](auto &index, const auto &key) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->remove(contact.id);
+            if (it->isEmpty()) {
+                index.erase(it);
+            }
+        }
+    };
+
+    removeFrom(nameIndex, contact.nickname.toCaseFolded());
+    removeFrom(nameIndex, contact.remark.toCaseFolded());
+    removeFrom(groupIndex, contact.group);
+    removeFrom(stateIndex, contact.state);
+}
+
+QList<ContactInfo> ContactManager::contactsFor(const QSet<QUuid> &ids) const
+{
+    QList<ContactInfo> result;
+    result.reserve(ids.size());
+    for (const QUuid &id : ids) {
+        result.append(contacts.value(id));
+    }
+    return result;
+}
+
+int ContactManager::merge(const ContactManager &other)
+{
+    int count = addContacts(other.contacts.values());
+    for (auto it = other.policies.constBegin(); it != other.policies.constEnd(); ++it) {
+        setPolicy(it.key(), it.value());
+    }
+    return count;
+}
+
+void ContactManager::rebuildIndexes()
+{
+    nameIndex.clear();
+    groupIndex.clear();
+    stateIndex.clear();
+
+    for (const ContactInfo &contact : std::as_const(contacts)) {
+        indexContact(contact);
+    }
+}
+
 } // namespace LocalNetworkApp
\ No newline at end of file
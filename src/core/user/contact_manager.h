@@ -3,9 +3,14 @@
 
 #include <QUuid>
 #include <QMap>
+#include <QHash>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QJsonObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <functional>
 #include "core/utils/enums.h"
 namespace LocalNetworkApp {
 
@@ -13,7 +18,8 @@ struct ContactInfo {
     QUuid id;          // 联系人ID
     QString nickname;  // 联系人昵称
     QString remark;    // 备注名称
-    UserState state;   // 联系人状态
+    QString group;     // 所属分组（空为未分组）
+    UserState state = UserState::Invisible; // 联系人状态
     QDateTime lastSeen; // 最后在线时间
 
     // 转换为JSON格式
@@ -21,8 +27,20 @@ struct ContactInfo {
 
     // 从JSON格式创建
     static ContactInfo fromJson(const QJsonObject &json);
+
+    // 转换为紧凑二进制格式
+    QByteArray toBinary() const;
+
+    // 从二进制格式创建，同时兼容JSON格式；ok返回是否解析成功
+    static ContactInfo fromBinary(const QByteArray &data, bool *ok = nullptr);
+
+    static const quint8 BINARY_VERSION = 2; // 二进制格式版本（版本2增加分组）
 };
 
+// 联系人目录
+//
+// 联系人按ID保存，并维护按昵称/备注前缀、分组和在线状态的二级索引，
+// 黑白名单合并为按ID的策略表，一次查找即可决定如何处理对方的请求。
 class ContactManager {
 public:
     ContactManager();
@@ -31,21 +49,51 @@ public:
     // 添加联系人
     void addContact(const ContactInfo &contact);
 
+    // 批量添加联系人（已存在的联系人被覆盖），返回添加的数量
+    int addContacts(const QList<ContactInfo> &contacts);
+
     // 删除联系人
     void removeContact(QUuid contactId);
 
+    // 是否为联系人
+    bool contains(QUuid contactId) const;
+
     // 获取联系人信息
     ContactInfo getContact(QUuid contactId) const;
 
     // 获取所有联系人
     QList<ContactInfo> getAllContacts() const;
 
+    // 逐个访问联系人（不复制）
+    void forEachContact(const std::function<void(const ContactInfo &)> &visitor) const;
+
+    // 联系人数量
+    int contactCount() const;
+
+    // 按昵称或备注前缀查找（不区分大小写），limit为-1时不限制数量
+    QList<ContactInfo> findContacts(const QString &prefix, int limit = -1) const;
+
+    // 获取分组中的联系人
+    QList<ContactInfo> getContactsInGroup(const QString &group) const;
+
+    // 获取所有分组名
+    QStringList getGroups() const;
+
+    // 获取处于指定状态的联系人
+    QList<ContactInfo> getContactsByState(UserState state) const;
+
     // 设置联系人备注
     void setContactRemark(QUuid contactId, const QString &remark);
 
+    // 设置联系人分组
+    void setContactGroup(QUuid contactId, const QString &group);
+
     // 更新联系人状态
     void updateContactState(QUuid contactId, UserState state);
 
+    // 获取对联系人的处理策略
+    ContactPolicy getPolicy(QUuid contactId) const;
+
     // 添加到黑名单
     void addToBlacklist(QUuid contactId);
 
@@ -64,9 +112,12 @@ public:
     // 检查是否在白名单中
     bool isInWhitelist(QUuid contactId) const;
 
-    // 保存到本地
+    // 保存到本地（由后台线程写入，写入失败时PersistenceService发出writeFailed）；只读时返回false
     bool saveToLocal() const;
 
+    // 联系人文件无法解密或解析时为只读，保存时不覆盖原文件
+    bool isReadOnly() const;
+
     // 从本地加载
     static ContactManager loadFromLocal();
 
@@ -76,10 +127,44 @@ public:
     // 从JSON格式创建
     static ContactManager fromJson(const QJsonObject &json);
 
+    // 转换为二进制格式
+    QByteArray toBinary() const;
+
+    // 从二进制格式创建，ok返回是否解析成功
+    static ContactManager fromBinary(const QByteArray &data, bool *ok = nullptr);
+
+    // 导出全部联系人和黑白名单（二进制格式）
+    QByteArray exportContacts() const;
+
+    // 导入导出的数据（二进制或JSON格式）并与现有联系人合并，返回导入的联系人数量，失败时返回-1
+    int importContacts(const QByteArray &data);
+
 private:
-    QMap<QUuid, ContactInfo> contacts;  // 联系人列表
-    QSet<QUuid> blacklist;              // 黑名单
-    QSet<QUuid> whitelist;              // 白名单
+    static const quint32 FILE_MAGIC = 0x4C4E4354; // "LNCT"
+    static const quint16 FILE_VERSION = 1;
+
+    QMap<QUuid, ContactInfo> contacts;            // 联系人列表
+    QHash<QUuid, ContactPolicy> policies;         // 黑白名单（不在表中为普通）
+    QMap<QString, QSet<QUuid>> nameIndex;         // 昵称和备注（统一大小写） -> 联系人
+    QMap<QString, QSet<QUuid>> groupIndex;        // 分组 -> 联系人
+    QMap<UserState, QSet<QUuid>> stateIndex;      // 状态 -> 联系人
+    bool readOnly = false;                        // 联系人文件无法读取，不再写入
+
+    // 设置策略（Normal时从策略表中删除）
+    void setPolicy(QUuid contactId, ContactPolicy policy);
+
+    // 把联系人加入/移出二级索引
+    void indexContact(const ContactInfo &contact);
+    void unindexContact(const ContactInfo &contact);
+
+    // 按ID列表取联系人
+    QList<ContactInfo> contactsFor(const QSet<QUuid> &ids) const;
+
+    // 合并另一个目录中的联系人和策略
+    int merge(const ContactManager &other);
+
+    // 重建全部二级索引
+    void rebuildIndexes();
 };
 
 } // namespace LocalNetworkApp
@@ -5,6 +5,7 @@
 #include <QDir>
 #include <QHostInfo>
 #include "../utils/constants.h"
+#include "../utils/persistence_service.h"
 
 namespace LocalNetworkApp {
 
@@ -43,11 +44,12 @@ QUuid UserIdentity::generateUuidFromDevice()
 
 bool UserIdentity::saveToLocal() const
 {
-    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
-    settings.setValue("user/uuid", uuid.toString());
-    settings.setValue("user/nickname", nickname);
-    settings.setValue("user/deviceInfo", deviceInfo);
-    return settings.status() == QSettings::NoError;
+    // 交给后台线程写入设置文件
+    PersistenceService *persistence = PersistenceService::instance();
+    persistence->setValue("user/uuid", uuid.toString());
+    persistence->setValue("user/nickname", nickname);
+    persistence->setValue("user/deviceInfo", deviceInfo);
+    return true;
 }
 
 UserIdentity UserIdentity::loadFromLocal()
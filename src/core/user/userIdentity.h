@@ -26,7 +26,7 @@ public:
     // 从设备信息生成UUID
     static QUuid generateUuidFromDevice();
 
-    // 保存用户信息到本地
+    // 保存用户信息到本地（由后台线程写入，写入失败时PersistenceService发出writeFailed）
     bool saveToLocal() const;
 
     // 从本地加载用户信息
@@ -0,0 +1,148 @@
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QUuid>
+#include <QDateTime>
+#include <QtEndian>
+#include <limits>
+
+namespace LocalNetworkApp {
+
+// 紧凑二进制记录的写入器
+//
+// 整数按大端序写入，UUID写入16字节原始值，时间写入自纪元起的毫秒数
+// （无效时间写入最小值），字符串写入4字节长度加UTF-8内容。
+class BinaryWriter {
+public:
+    explicit BinaryWriter(QByteArray *buffer) : buffer(buffer) {}
+
+    void writeUInt8(quint8 value) { buffer->append(static_cast<char>(value)); }
+    void writeUInt16(quint16 value) { writeBigEndian(value); }
+    void writeUInt32(quint32 value) { writeBigEndian(value); }
+    void writeInt64(qint64 value) { writeBigEndian(value); }
+
+    void writeUuid(const QUuid &uuid) { buffer->append(uuid.toRfc4122()); }
+
+    void writeDateTime(const QDateTime &time)
+    {
+        writeInt64(time.isValid() ? time.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min());
+    }
+
+    void writeString(const QString &text) { writeBytes(text.toUtf8()); }
+
+    void writeBytes(const QByteArray &bytes)
+    {
+        writeUInt32(static_cast<quint32>(bytes.size()));
+        buffer->append(bytes);
+    }
+
+private:
+    QByteArray *buffer; // 输出缓冲区
+
+    template <typename T>
+    void writeBigEndian(T value)
+    {
+        char data[sizeof(T)];
+        qToBigEndian<T>(value, data);
+        buffer->append(data, sizeof(T));
+    }
+};
+
+// 紧凑二进制记录的读取器（格式见BinaryWriter）
+//
+// 读取越界后isOk()返回false，之后的读取都返回默认值。
+// 读取器不复制数据，使用期间data必须保持有效。
+class BinaryReader {
+public:
+    explicit BinaryReader(const QByteArray &data) :
+        data(data.constData()), size(data.size()), position(0), ok(true) {}
+
+    bool isOk() const { return ok; }
+    bool atEnd() const { return position >= size; }
+
+    quint8 readUInt8()
+    {
+        if (!require(1)) {
+            return 0;
+        }
+        return static_cast<quint8>(data[position++]);
+    }
+
+    quint16 readUInt16() { return readBigEndian<quint16>(); }
+    quint32 readUInt32() { return readBigEndian<quint32>(); }
+    qint64 readInt64() { return readBigEndian<qint64>(); }
+
+    QUuid readUuid()
+    {
+        if (!require(16)) {
+            return QUuid();
+        }
+        QUuid uuid = QUuid::fromRfc4122(QByteArrayView(data + position, 16));
+        position += 16;
+        return uuid;
+    }
+
+    QDateTime readDateTime()
+    {
+        qint64 ms = readInt64();
+        if (!ok || ms == std::numeric_limits<qint64>::min()) {
+            return QDateTime();
+        }
+        return QDateTime::fromMSecsSinceEpoch(ms);
+    }
+
+    QString readString()
+    {
+        quint32 length = readUInt32();
+        if (!require(length)) {
+            return QString();
+        }
+        QString text = QString::fromUtf8(data + position, length);
+        position += length;
+        return text;
+    }
+
+    QByteArray readBytes()
+    {
+        quint32 length = readUInt32();
+        if (!require(length)) {
+            return QByteArray();
+        }
+        QByteArray bytes(data + position, length);
+        position += length;
+        return bytes;
+    }
+
+private:
+    const char *data; // 输入数据
+    qint64 size;      // 输入长度
+    qint64 position;  // 当前读取位置
+    bool ok;          // 是否未越界
+
+    bool require(qint64 length)
+    {
+        if (!ok || size - position < length) {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    T readBigEndian()
+    {
+        if (!require(sizeof(T))) {
+            return T();
+        }
+        T value = qFromBigEndian<T>(data + position);
+        position += sizeof(T);
+        return value;
+    }
+};
+
+} // namespace LocalNetworkApp
+
+#endif // BINARY_CODEC_H
@@ -9,12 +9,75 @@ namespace Constants {
 // 网络相关常量
 constexpr quint16 DEFAULT_TCP_PORT = 8888;
 constexpr quint16 DEFAULT_UDP_PORT = 8889;
+constexpr quint16 DEFAULT_RENDEZVOUS_PORT = 8890; // 跨网段发现注册中心端口
 constexpr int HEARTBEAT_INTERVAL_MS = 5000; // 心跳间隔，单位毫秒
 constexpr int USER_TIMEOUT_MS = 15000; // 用户超时时间，单位毫秒
 
+// 用户发现广播相关常量
+constexpr int BEACON_MIN_INTERVAL_MS = 250;   // 启动或状态变更后的初始广播间隔
+constexpr int BEACON_MAX_INTERVAL_MS = 60000; // 网络无变化时的最长广播间隔
+constexpr int BEACON_PROBE_COUNT = 3;         // 启动时要求对方立即回复的广播次数
+constexpr int BEACON_TIMEOUT_FACTOR = 3;      // 连续错过多少个广播周期判定用户离线
+
+// 用户缓存相关常量
+constexpr int PEER_CACHE_VERIFY_MS = 3000;      // 缓存用户等待探测回复的时间
+constexpr int PEER_CACHE_SAVE_DELAY_MS = 10000; // 用户目录变化后延迟写入缓存的时间
+constexpr int PEER_CACHE_MAX_AGE_DAYS = 30;     // 缓存用户的最长保留天数
+constexpr int PEER_CACHE_MAX_ENTRIES = 512;     // 缓存用户的最大数量
+
+// 跨网段发现（注册中心）相关常量
+constexpr int RENDEZVOUS_SYNC_INTERVAL_MS = 15000; // 向注册中心续约并同步目录的间隔
+constexpr int RENDEZVOUS_TTL_FACTOR = 3;           // 注册有效期为同步间隔的倍数
+constexpr int RENDEZVOUS_PAGE_SIZE = 32;           // 每个应答数据报携带的最大用户数
+
+// IPv6双栈相关常量
+const QString DISCOVERY_IPV6_GROUP = "ff02::4c4e:4150"; // 链路本地范围的发现组播地址
+constexpr int HAPPY_EYEBALLS_DELAY_MS = 250;           // 连接竞速中启动下一个地址前的等待时间
+
 // 文件传输相关常量
 constexpr int FILE_BLOCK_SIZE = 8192; // 文件块大小，8KB
+constexpr int MANIFEST_BLOCK_SIZE = 1024 * 1024; // 文件清单中每个校验和覆盖的长度（FILE_BLOCK_SIZE的整数倍），1MB
 constexpr int MAX_PENDING_BLOCKS = 100; // 最大待处理块数
+constexpr int FILE_BLOCK_MAX_RETRIES = 3; // 数据块校验失败后的最大重新请求次数
+constexpr int CONTENT_INDEX_MAX_FILES = 4096;            // 内容索引记录的最大文件数
+constexpr int CONTENT_INDEX_MAX_BLOCKS = 4 * 1024 * 1024; // 内容索引中块索引的最大条目数
+constexpr int CONTENT_INDEX_SAVE_DELAY_MS = 5000;        // 内容索引变化后延迟写入的时间
+constexpr int DELTA_MIN_BLOCK_SIZE = 2048;               // 增量同步签名的最小块大小
+constexpr int DELTA_MAX_BLOCK_SIZE = 128 * 1024;         // 增量同步签名的最大块大小
+constexpr int DELTA_CHUNK_SIZE = 64 * 1024;              // 增量指令每段输出的大致长度
+constexpr qint64 DELTA_CHUNK_MAX_INPUT = 16 * 1024 * 1024; // 增量编码每段最多读取的新文件字节数
+constexpr int DELTA_READ_SIZE = 1024 * 1024;             // 增量同步每次读取文件的长度
+constexpr qint64 HASH_CHUNK_SIZE = 4 * 1024 * 1024;        // 文件哈希的分块大小，每块一次读取并可并行计算
+constexpr int HASH_PROGRESS_INTERVAL_MS = 100;              // 文件哈希进度报告间隔
+constexpr qint64 HASH_BENCHMARK_BYTES = 256 * 1024 * 1024;  // 文件哈希吞吐量测试的默认数据量
+constexpr int FILE_TYPE_SNIFF_SIZE = 512;                   // 识别本地文件类型时读取的文件头长度
+
+// 消息存储相关常量
+constexpr qint64 MESSAGE_SEGMENT_MAX_BYTES = 4 * 1024 * 1024; // 单个消息段文件的最大长度
+constexpr int MESSAGE_STORE_SYNC_INTERVAL_MS = 1000;          // 消息日志批量刷盘间隔
+constexpr int MESSAGE_PAGE_SIZE = 50;                         // 打开会话或向上翻页时读取的消息条数
+constexpr int READ_RECEIPT_BATCH_MS = 200;                    // 合并已读回执写入的等待时间
+constexpr int RECEIVED_ID_CACHE_SIZE = 10000;                 // 内存中记住的最近收到的消息ID数（用于去重）
+constexpr int RECEIVED_ID_SEED_COUNT = 1000;                  // 联系人第一次来消息时从日志末尾补入的消息条数
+constexpr qint64 MESSAGE_CACHE_BUDGET_BYTES = 16 * 1024 * 1024; // 内存中缓存的消息页默认占用上限
+constexpr int MESSAGE_CACHE_PAGE_SIZE = 64;                   // 缓存页包含的消息条数
+constexpr int RECORD_BENCHMARK_COUNT = 100000;                // 记录格式测试（JSON与二进制）的默认记录数
+constexpr int SEARCH_RESULT_LIMIT = 100;                      // 聊天记录搜索默认返回的最大条数
+constexpr int SEARCH_CATCH_UP_BATCH = 1000;                   // 补齐搜索索引时每批读取的消息条数
+
+// 离线消息相关常量
+constexpr int OUTBOX_BATCH_SIZE = 50;              // 一个批次最多包含的消息条数
+constexpr int OUTBOX_ACK_TIMEOUT_MS = 10000;       // 等待送达确认的时间，超时后重连重发
+constexpr int OUTBOX_RETRY_INTERVAL_MS = 15000;    // 检查待发送队列的间隔
+constexpr int OUTBOX_COMPACT_MIN_RECORDS = 256;    // 发件箱日志中失效记录超过该数量且多于有效消息时压缩
+
+// 传输历史相关常量
+constexpr int TRANSFER_HISTORY_RETENTION_DAYS = 365;  // 传输记录保留天数
+constexpr int TRANSFER_HISTORY_MAX_RECORDS = 100000;  // 传输记录最大条数
+constexpr int TRANSFER_HISTORY_COMPACT_MIN = 1000;    // 失效记录达到该数量后才考虑压缩
+
+// 持久化相关常量
+constexpr int PERSISTENCE_DEBOUNCE_MS = 500; // 合并重复保存的等待时间，窗口内的多次保存只写一次磁盘
 
 // 数据库相关常量
 const QString DATABASE_NAME = "local_network_app.db";
@@ -26,6 +89,19 @@ const QString PASSWORDS_TABLE = "passwords";
 
 // 设置相关常量
 const QString SETTINGS_FILE = "settings.ini";
+const QString PEER_CACHE_FILE = "peers.cache";
+const QString CONTACTS_FILE = "contacts.dat";
+const QString OUTBOX_FILE = "outbox.dat";
+const QString MESSAGE_STORE_DIR = "messages";
+const QString SEARCH_INDEX_FILE = "message_search.idx";
+const QString TRANSFER_HISTORY_FILE = "transfers.log";
+const QString CONTENT_INDEX_FILE = "content_index.dat";
+const QString STORAGE_KEY_FILE = "storage.key";
+const QString STORAGE_KEY_DIR_NAME = "LocalNetworkApp"; // 用户配置目录下存放存储密钥的子目录
+const QString DELTA_TEMP_SUFFIX = ".lanpart"; // 增量同步时写入新版本的临时文件后缀
+const QString QUARANTINE_DIR_NAME = "quarantine";  // 下载目录中存放被隔离文件的子目录
+const QString QUARANTINE_SUFFIX = ".quarantine";   // 被隔离文件的后缀，避免被直接打开
+const QString UNRECOGNIZED_FILE_SUFFIX = ".unrecognized"; // 无法识别的数据文件改名保留时的后缀
 const QString DEFAULT_NICKNAME = "用户";
 const QString DEFAULT_DOWNLOAD_PATH = "./downloads";
 
@@ -36,6 +112,14 @@ const int MIN_WINDOW_HEIGHT = 600;
 // 安全相关常量
 const int MAX_PASSWORD_LENGTH = 50;
 const int MIN_PASSWORD_LENGTH = 6;
+const int PASSWORD_HASH_TARGET_MS = 250;        // 校准密码哈希时的目标耗时（解锁一次的派生时间）
+const int PASSWORD_MIN_ITERATIONS = 100000;     // PBKDF2的最少迭代次数
+const int PASSWORD_MAX_ITERATIONS = 10000000;   // PBKDF2的最多迭代次数
+const int PASSWORD_SALT_SIZE = 16;              // 密码哈希的盐值长度
+const int PASSWORD_TOKEN_TTL_MS = 30 * 60 * 1000; // 验证通过的密码在内存中免重新派生的时间
+const int STORAGE_PAGE_SIZE = 4096;             // 本地数据加密的页大小，读取一页只解密这一页
+const int STORAGE_MAX_PAGE_SIZE = 1024 * 1024;  // 加密文件头中允许的最大页大小
+const int STORAGE_KEY_SIZE = 32;                // 本地数据加密密钥长度
 
 } // namespace Constants
 } // namespace LocalNetworkApp
@@ -26,7 +26,17 @@ enum class NetworkMessageType {
     FileTransferResponse, // 文件传输响应
     FileData,            // 文件数据块
     UserDiscovery,       // 用户发现广播
-    Heartbeat            // 心跳包
+    Heartbeat,           // 心跳包
+    ChatBatch,           // 一批聊天消息（离线消息补发）
+    MessageAck,          // 消息送达确认
+    KeyExchange          // 会话密钥交换（连接建立时的唯一明文消息）
+};
+
+// 联系人策略枚举
+enum class ContactPolicy {
+    Normal,  // 普通联系人
+    Blocked, // 黑名单：拒绝消息和文件
+    Trusted  // 白名单：自动接受文件
 };
 
 // 文件传输状态枚举
@@ -41,6 +51,17 @@ enum class FileTransferStatus {
     Cancelled   // 已取消
 };
 
+// 文件内容类别枚举（按文件头识别）
+enum class FileCategory {
+    Other,      // 无法识别（纯文本等）
+    Executable, // 可执行文件、安装包和脚本
+    Archive,    // 压缩包
+    Document,   // 文档
+    Image,      // 图片
+    Audio,      // 音频
+    Video       // 视频
+};
+
 } // namespace LocalNetworkApp
 
 #endif // ENUMS_H
@@ -0,0 +1,55 @@
+#ifndef NETWORK_UTILS_H
+#define NETWORK_UTILS_H
+
+#include <QList>
+#include <algorithm>
+#include <QtNetwork/QHostAddress>
+
+namespace LocalNetworkApp {
+namespace NetworkUtils {
+
+// 双栈Socket收到的IPv4地址以v4映射形式（::ffff:a.b.c.d）出现，统一转换回IPv4
+inline QHostAddress normalizeAddress(const QHostAddress &address)
+{
+    bool isV4 = false;
+    quint32 ipv4 = address.toIPv4Address(&isV4);
+    if (isV4 && address.protocol() == QAbstractSocket::IPv6Protocol) {
+        return QHostAddress(ipv4);
+    }
+    return address;
+}
+
+// 按协议合并地址：每种协议只保留最新的一个，IPv6排在前面
+inline QList<QHostAddress> mergeAddress(const QList<QHostAddress> &addresses, const QHostAddress &address)
+{
+    QHostAddress normalized = normalizeAddress(address);
+    QList<QHostAddress> merged;
+    merged.append(normalized);
+
+    for (const QHostAddress &existing : addresses) {
+        if (existing.protocol() != normalized.protocol()) {
+            merged.append(existing);
+        }
+    }
+
+    std::stable_sort(merged.begin(), merged.end(), [](const QHostAddress &a, const QHostAddress &b) {
+        return a.protocol() == QAbstractSocket::IPv6Protocol && b.protocol() != QAbstractSocket::IPv6Protocol;
+    });
+    return merged;
+}
+
+// 同一连接的首选地址：有IPv4时使用IPv4（界面显示稳定），否则使用IPv6
+inline QHostAddress preferredAddress(const QList<QHostAddress> &addresses)
+{
+    for (const QHostAddress &address : addresses) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+            return address;
+        }
+    }
+    return addresses.isEmpty() ? QHostAddress() : addresses.first();
+}
+
+} // namespace NetworkUtils
+} // namespace LocalNetworkApp
+
+#endif // NETWORK_UTILS_H
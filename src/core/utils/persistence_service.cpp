@@ -0,0 +1,161 @@
+#include "persistence_service.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace LocalNetworkApp {
+
+PersistenceService *PersistenceService::instance()
+{
+    static PersistenceService service;
+    return &service;
+}
+
+PersistenceService::PersistenceService() :
+    writeScheduled(false)
+{
+    debounceTimer = new QTimer(this);
+    debounceTimer->setSingleShot(true);
+    debounceTimer->setInterval(Constants::PERSISTENCE_DEBOUNCE_MS);
+    connect(debounceTimer, &QTimer::timeout, this, &PersistenceService::writePending);
+
+    // 程序退出前在主线程中写完所有待保存的内容
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &PersistenceService::shutdown, Qt::DirectConnection);
+    }
+
+    // 定时器随对象一起移入后台线程，写入都在后台线程中进行
+    workerThread.setObjectName("PersistenceService");
+    moveToThread(&workerThread);
+    workerThread.start();
+}
+
+PersistenceService::~PersistenceService()
+{
+    shutdown();
+}
+
+void PersistenceService::setValue(const QString &key, const QVariant &value)
+{
+    {
+        QMutexLocker locker(&mutex);
+        pendingValues.insert(key, value);
+    }
+    scheduleWrite();
+}
+
+void PersistenceService::remove(const QString &key)
+{
+    setValue(key, QVariant());
+}
+
+void PersistenceService::writeFile(const QString &filePath, const QByteArray &data)
+{
+    {
+        QMutexLocker locker(&mutex);
+        pendingFiles.insert(filePath, data);
+    }
+    scheduleWrite();
+}
+
+bool PersistenceService::flush()
+{
+    if (QThread::currentThread() == &workerThread || !workerThread.isRunning()) {
+        return writePending();
+    }
+
+    bool ok = false;
+    QMetaObject::invokeMethod(this, &PersistenceService::writePending, Qt::BlockingQueuedConnection, &ok);
+    return ok;
+}
+
+void PersistenceService::shutdown()
+{
+    if (!workerThread.isRunning()) {
+        return;
+    }
+
+    flush();
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void PersistenceService::startDebounce()
+{
+    // 窗口从第一次保存开始计时，持续保存时也能在一个窗口内写入
+    if (!debounceTimer->isActive()) {
+        debounceTimer->start();
+    }
+}
+
+bool PersistenceService::writePending()
+{
+    QMap<QString, QVariant> values;
+    QMap<QString, QByteArray> files;
+    {
+        QMutexLocker locker(&mutex);
+        values.swap(pendingValues);
+        files.swap(pendingFiles);
+        writeScheduled = false;
+    }
+
+    if (debounceTimer->isActive()) {
+        debounceTimer->stop();
+    }
+
+    bool ok = true;
+
+    // 先写文件再写设置项，设置项中可能有依赖于新文件的删除操作
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        // 写入临时文件后原子替换
+        QSaveFile file(it.key());
+        if (!file.open(QIODevice::WriteOnly) ||
+            file.write(it.value()) != it.value().size() ||
+            !file.commit()) {
+            qWarning() << "写入文件失败:" << it.key() << file.errorString();
+            ok = false;
+            emit writeFailed(it.key());
+        }
+    }
+
+    // 合并后的设置项一次写入，QSettings通过临时文件原子替换设置文件
+    if (!values.isEmpty()) {
+        QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            if (it.value().isValid()) {
+                settings.setValue(it.key(), it.value());
+            } else {
+                settings.remove(it.key());
+            }
+        }
+
+        settings.sync();
+        if (settings.status() != QSettings::NoError) {
+            qWarning() << "写入设置失败:" << Constants::SETTINGS_FILE;
+            ok = false;
+            emit writeFailed(Constants::SETTINGS_FILE);
+        }
+    }
+
+    return ok;
+}
+
+void PersistenceService::scheduleWrite()
+{
+    if (!workerThread.isRunning()) {
+        writePending();
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (writeScheduled) {
+        return;
+    }
+    writeScheduled = true;
+    QMetaObject::invokeMethod(this, &PersistenceService::startDebounce, Qt::QueuedConnection);
+}
+
+} // namespace LocalNetworkApp
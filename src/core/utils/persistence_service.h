@@ -0,0 +1,72 @@
+#ifndef PERSISTENCE_SERVICE_H
+#define PERSISTENCE_SERVICE_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QMap>
+#include <QString>
+#include <QVariant>
+#include <QByteArray>
+#include "constants.h"
+
+namespace LocalNetworkApp {
+
+// 后台持久化服务
+//
+// 各模块把要保存的设置项或文件内容交给本服务后立即返回，
+// 由后台线程在合并窗口结束后统一写入磁盘。窗口内对同一设置项或文件的
+// 重复保存只保留最后一次的内容；设置文件和独立文件都通过临时文件原子替换，
+// 写到一半时崩溃不会损坏原有数据。程序退出时会写完所有待保存的内容。
+class PersistenceService : public QObject {
+    Q_OBJECT
+
+public:
+    // 获取全局实例
+    static PersistenceService *instance();
+
+    // 保存设置项（写入Constants::SETTINGS_FILE），value无效时删除该项
+    void setValue(const QString &key, const QVariant &value);
+
+    // 删除设置项
+    void remove(const QString &key);
+
+    // 保存整个文件的内容
+    void writeFile(const QString &filePath, const QByteArray &data);
+
+    // 立即写入所有待保存的内容并等待完成，返回是否全部写入成功
+    bool flush();
+
+    // 写入所有待保存的内容并停止后台线程，之后的保存将同步写入
+    void shutdown();
+
+signals:
+    // 写入失败（target为设置项所在的设置文件或文件路径）
+    void writeFailed(const QString &target);
+
+private slots:
+    // 在后台线程中启动合并窗口
+    void startDebounce();
+
+    // 写入所有待保存的内容
+    bool writePending();
+
+private:
+    PersistenceService();
+    ~PersistenceService();
+
+    QThread workerThread;                  // 后台写入线程
+    QTimer *debounceTimer;                 // 合并窗口定时器（属于后台线程）
+    QMutex mutex;                          // 保护以下待保存内容
+    QMap<QString, QVariant> pendingValues; // 待保存的设置项
+    QMap<QString, QByteArray> pendingFiles; // 待保存的文件
+    bool writeScheduled;                   // 是否已安排写入
+
+    // 有新内容待保存时安排一次写入；后台线程已停止时直接同步写入
+    void scheduleWrite();
+};
+
+} // namespace LocalNetworkApp
+
+#endif // PERSISTENCE_SERVICE_H
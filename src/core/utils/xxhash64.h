@@ -0,0 +1,99 @@
+#ifndef XXHASH64_H
+#define XXHASH64_H
+
+#include <QtGlobal>
+#include <QtEndian>
+
+namespace LocalNetworkApp {
+
+// XXH64非加密哈希
+//
+// 每周期处理32字节，速度接近内存带宽，用于检测传输和存储中的意外损坏；
+// 不能抵御有意篡改，完整性校验仍需配合SHA-256。
+class XxHash64 {
+public:
+    XxHash64() = delete;
+    ~XxHash64() = delete;
+
+    static quint64 hash(const void *input, qsizetype length, quint64 seed = 0)
+    {
+        const uchar *p = static_cast<const uchar *>(input);
+        const uchar *end = p + length;
+        quint64 h;
+
+        if (length >= 32) {
+            quint64 v1 = seed + PRIME1 + PRIME2;
+            quint64 v2 = seed + PRIME2;
+            quint64 v3 = seed;
+            quint64 v4 = seed - PRIME1;
+            const uchar *limit = end - 32;
+            do {
+                v1 = round(v1, qFromLittleEndian<quint64>(p));
+                v2 = round(v2, qFromLittleEndian<quint64>(p + 8));
+                v3 = round(v3, qFromLittleEndian<quint64>(p + 16));
+                v4 = round(v4, qFromLittleEndian<quint64>(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        } else {
+            h = seed + PRIME5;
+        }
+
+        h += static_cast<quint64>(length);
+
+        while (p + 8 <= end) {
+            h ^= round(0, qFromLittleEndian<quint64>(p));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+            p += 8;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<quint64>(qFromLittleEndian<quint32>(p)) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        while (p < end) {
+            h ^= (*p) * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+            ++p;
+        }
+
+        // 雪崩
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr quint64 PRIME1 = 0x9E3779B185EBCA87ULL;
+    static constexpr quint64 PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr quint64 PRIME3 = 0x165667B19E3779F9ULL;
+    static constexpr quint64 PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr quint64 PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    static quint64 rotl(quint64 value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    static quint64 round(quint64 acc, quint64 input)
+    {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static quint64 mergeRound(quint64 acc, quint64 value)
+    {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+};
+
+} // namespace LocalNetworkApp
+
+#endif // XXHASH64_H
@@ -2,11 +2,20 @@
 #include <QFile>
 #include <QFont>
 #include "new_ui/home.h"
+#include "core/data/record_format_benchmark.h"
+#include "core/data/file_hasher.h"
 // #include "new_ui/appinit.h"
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    //性能测试：输出到日志后退出，不启动界面
+    if (a.arguments().contains("--benchmark")) {
+        LocalNetworkApp::RecordFormatBenchmark::run();
+        LocalNetworkApp::FileHasher::benchmark();
+        return 0;
+    }
+
     //加载样式表
     // QFile file(":/pic/css/index.css");
     // if (file.open(QFile::ReadOnly)) {
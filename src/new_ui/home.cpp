@@ -16,6 +16,7 @@ Home::Home(QWidget *parent)
     , trayIcon(nullptr)
     , isAppLocked(false)
     , incognitoMode(false)
+    , peerSequence(0)
 {
     ui->setupUi(this);
     InitUi();
@@ -404,6 +405,13 @@ void Home::on_btn_home_clicked()
 
 void Home::updateUserList()
 {
+    if (!userDiscovery) {
+        return;
+    }
+
+    // 获取用户目录快照（共享数据，不复制）
+    PeerSnapshot snapshot = userDiscovery->getPeerSnapshot();
+
     // 清除现有的卡片
     QLayout* layout = ui->user_list_widget->layout();
     if (!layout) {
@@ -411,11 +419,14 @@ void Home::updateUserList()
         QGridLayout* gridLayout = new QGridLayout(ui->user_list_widget);
         layout = gridLayout;
         ui->user_list_widget->setLayout(layout);
+    } else if (snapshot.sequence == peerSequence) {
+        // 用户目录没有变化，无需重建卡片
+        return;
     }
     // 清除现有卡片
     clearUserCards();
-    // 获取已发现的用户
-    QList<DiscoveredUser> users = userDiscovery->getDiscoveredUsers();
+    peerSequence = snapshot.sequence;
+    const QMap<QUuid, DiscoveredUser> &users = snapshot.users;
 
     int row = 0;
     int col = 0;
@@ -76,6 +76,7 @@ private:
     QUuid currentContactId;                  // 当前选中的联系人ID
     bool isAppLocked;                        // 程序是否锁定
     bool incognitoMode;                      // 无痕模式
+    quint64 peerSequence;                    // 用户卡片对应的用户目录序号
     void InitUi();          //Ui界面初始化函数
     void InitMember();      //成员变量初始化函数
     void LittleShow();      //最小化显示函数
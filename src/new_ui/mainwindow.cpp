@@ -11,7 +11,12 @@
 #include <QInputDialog>
 #include <QFileDialog>
 #include <QStyle>
+#include <QSettings>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
 #include "core/utils/constants.h"
+#include "core/utils/persistence_service.h"
 
 namespace LocalNetworkApp {
 
@@ -21,9 +26,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     , server(nullptr)
     , client(nullptr)
     , userDiscovery(nullptr)
+    , rendezvousRegistry(nullptr)
+    , messageOutbox(nullptr)
     , trayIcon(nullptr)
+    , historyCursor(0)
+    , historyHasMore(false)
     , isAppLocked(false)
     , incognitoMode(false)
+    , saveWarningVisible(false)
 {
     ui->setupUi(this);
     initUI();
@@ -31,12 +41,21 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 
 MainWindow::~MainWindow()
 {
-    // 停止网络服务
+    // 停止网络服务（发件箱依赖用户发现和服务器，先释放）
+    if (messageOutbox) {
+        delete messageOutbox;
+    }
+
     if (userDiscovery) {
         userDiscovery->stopDiscovery();
         delete userDiscovery;
     }
 
+    if (rendezvousRegistry) {
+        rendezvousRegistry->stop();
+        delete rendezvousRegistry;
+    }
+
     if (server) {
         server->stop();
         delete server;
@@ -74,6 +93,10 @@ void MainWindow::initialize()
 
     // 加载联系人管理器
     contactManager = ContactManager::loadFromLocal();
+    if (contactManager.isReadOnly()) {
+        QMessageBox::warning(this, tr("联系人无法读取"),
+            tr("联系人文件无法解密或已损坏（存储密钥可能已更改）。\n原文件将保持不变，本次对联系人的修改不会保存。"));
+    }
 
     // 初始化网络服务
     initNetwork();
@@ -109,18 +132,21 @@ void MainWindow::lockApp()
     }
 }
 
-bool MainWindow::unlockApp(const QString &password)
+void MainWindow::unlockApp(const QString &password)
 {
-    if (passwordManager.verifyPassword(password)) {
-        isAppLocked = false;
-        ui->centralwidget->setEnabled(true);
-        ui->menubar->setEnabled(true);
-        return true;
-    } else {
-        QMessageBox::warning(this, tr("密码错误"), tr("输入的密码不正确，请重试！"));
-        lockApp();
-        return false;
-    }
+    // 派生密码哈希较慢，放到后台线程，界面保持响应
+    ui->statusbar->showMessage(tr("正在验证密码..."));
+    passwordManager.verifyPasswordAsync(password, this, [this](bool verified) {
+        ui->statusbar->clearMessage();
+        if (verified) {
+            isAppLocked = false;
+            ui->centralwidget->setEnabled(true);
+            ui->menubar->setEnabled(true);
+        } else {
+            QMessageBox::warning(this, tr("密码错误"), tr("输入的密码不正确，请重试！"));
+            lockApp();
+        }
+    });
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent *event)
@@ -231,10 +257,20 @@ void MainWindow::on_actionExit_triggered()
         QMessageBox::Yes | QMessageBox::No);
 
     if (ret == QMessageBox::Yes) {
-        // 保存数据
+        // 保存数据，等待后台写入完成后再退出
         userIdentity.saveToLocal();
         contactManager.saveToLocal();
         messageManager.saveMessageHistory();
+        if (!PersistenceService::instance()->flush()) {
+            saveWarningVisible = true;
+            ret = QMessageBox::warning(this, tr("保存失败"),
+                tr("部分数据未能写入磁盘（磁盘已满或没有写入权限），退出后这些修改将丢失。\n仍要退出吗？"),
+                QMessageBox::Yes | QMessageBox::No);
+            saveWarningVisible = false;
+            if (ret != QMessageBox::Yes) {
+                return;
+            }
+        }
 
         // 退出程序
         qApp->quit();
@@ -271,21 +307,37 @@ void MainWindow::onContactSelected(QUuid contactId)
 
     currentContactId = contactId;
 
-    // 加载聊天历史
-    QList<Message> history = messageManager.getMessageHistory(contactId);
-    for(const auto& message : history)
-    {
+    // 加载聊天历史：先显示最新一页，向上滚动时再加载更早的消息
+    historyHasMore = false;
+    ui->messageDisplayWidget->clear();
+    MessagePage page = messageManager.getMessagePage(contactId);
+    int loadedEnd = page.end;
+    for (const auto &message : page.messages) {
         ui->messageDisplayWidget->append(message.getContent());
     }
+    historyCursor = page.cursor;
+    historyHasMore = page.hasMore;
+    fillMessageViewport();
 
-    // 清除未读计数
-    messageManager.markAsRead(contactId);
+    // 清除未读计数：只标记已加载的最后一条及之前的消息，不比较对方设置的时间戳
+    messageManager.markAllReadUpTo(contactId, loadedEnd);
 
     // 更新UI
     ContactInfo contact = contactManager.getContact(contactId);
     ui->lblCurrentContact->setText(contact.remark.isEmpty() ? contact.nickname : contact.remark);
 }
 
+void MainWindow::onMessageScrollChanged(int value)
+{
+    QScrollBar *scrollBar = ui->messageDisplayWidget->verticalScrollBar();
+    if (value != scrollBar->minimum() || !historyHasMore || currentContactId.isNull()) {
+        return;
+    }
+
+    prependMessagePage(messageManager.getMessagePage(currentContactId, historyCursor));
+    fillMessageViewport();
+}
+
 void MainWindow::onContactContextMenu(const QPoint &pos)
 {
     if (isAppLocked) return;
@@ -500,11 +552,29 @@ void MainWindow::initUI()
     // 消息管理器信号
     connect(&messageManager, &MessageManager::messageReceived, this, &MainWindow::onMessageReceived);
     connect(&messageManager, &MessageManager::unreadMessageCountChanged, this, &MainWindow::onUnreadCountChanged);
+    connect(ui->messageDisplayWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::onMessageScrollChanged);
 
     // 文件传输管理器信号
     connect(&fileTransferManager, &FileTransferManager::fileTransferRequestReceived, this, &MainWindow::onFileTransferRequestReceived);
     connect(&fileTransferManager, &FileTransferManager::transferProgress, this, &MainWindow::onFileTransferProgress);
     connect(&fileTransferManager, &FileTransferManager::transferCompleted, this, &MainWindow::onFileTransferCompleted);
+
+    // 后台保存失败信号（来自持久化线程，排队到界面线程处理）
+    connect(PersistenceService::instance(), &PersistenceService::writeFailed, this, &MainWindow::onPersistenceWriteFailed);
+}
+
+void MainWindow::onPersistenceWriteFailed(const QString &target)
+{
+    ui->statusbar->showMessage(tr("保存失败：%1").arg(target), 5000);
+
+    // 连续失败时只保留一个提示框
+    if (saveWarningVisible) {
+        return;
+    }
+    saveWarningVisible = true;
+    QMessageBox::warning(this, tr("保存失败"),
+        tr("无法写入 %1，请检查磁盘空间和文件权限。\n在问题解决前所做的修改可能会丢失。").arg(target));
+    saveWarningVisible = false;
 }
 
 void MainWindow::initNetwork()
@@ -514,6 +584,21 @@ void MainWindow::initNetwork()
     connect(userDiscovery, &UserDiscovery::userDiscovered, this, &MainWindow::onUserDiscovered);
     connect(userDiscovery, &UserDiscovery::userLost, this, &MainWindow::onUserLost);
     connect(userDiscovery, &UserDiscovery::userStateChanged, this, &MainWindow::onUserStateChanged);
+
+    // 跨网段发现：可选地作为注册中心，或向指定的注册中心注册
+    QSettings settings(Constants::SETTINGS_FILE, QSettings::IniFormat);
+    if (settings.value("discovery/rendezvousServer", false).toBool()) {
+        rendezvousRegistry = new RendezvousRegistry(this);
+        rendezvousRegistry->start(Constants::DEFAULT_RENDEZVOUS_PORT);
+    }
+
+    QHostAddress rendezvousAddress(settings.value("discovery/rendezvousHost").toString());
+    if (!rendezvousAddress.isNull()) {
+        quint16 rendezvousPort = static_cast<quint16>(
+            settings.value("discovery/rendezvousPort", Constants::DEFAULT_RENDEZVOUS_PORT).toUInt());
+        userDiscovery->setRendezvousServer(rendezvousAddress, rendezvousPort);
+    }
+
     userDiscovery->startDiscovery();
 
     // 启动TCP服务器
@@ -522,6 +607,16 @@ void MainWindow::initNetwork()
 
     // 初始化客户端（用于连接其他用户）
     client = new Client(userIdentity, this);
+
+    // 发出的消息经发件箱送达，对方离线时在其上线后补发
+    messageOutbox = new MessageOutbox(userIdentity, userDiscovery, server, this);
+    connect(&messageManager, &MessageManager::messageSent, messageOutbox, &MessageOutbox::enqueue);
+    connect(messageOutbox, &MessageOutbox::messageReceived, this, [this](const Message &message) {
+        if (contactManager.isInBlacklist(message.getSenderId())) {
+            return;
+        }
+        messageManager.receiveMessage(message);
+    });
 }
 
 void MainWindow::initTrayIcon()
@@ -550,14 +645,11 @@ void MainWindow::initTrayIcon()
 
 void MainWindow::updateContactList()
 {
-    // 获取所有联系人
-    QList<ContactInfo> contacts = contactManager.getAllContacts();
-    for(const auto& info : contacts)
-    {
+    // 逐个访问联系人，不复制整个列表
+    contactManager.forEachContact([this](const ContactInfo &info) {
         // 更新联系人列表控件
         ui->contactListWidget->addItem(info.nickname);
-
-    }
+    });
 
     // 更新未读计数显示
     // ui->contactListWidget->setUnreadCounts(messageManager.getUnreadMessageCount());
@@ -688,4 +780,47 @@ void MainWindow::loadStylesheet()
     setStyleSheet(styleSheet);
 }
 
+void MainWindow::prependMessagePage(const MessagePage &page)
+{
+    historyCursor = page.cursor;
+    historyHasMore = page.hasMore;
+    if (page.messages.isEmpty()) {
+        return;
+    }
+
+    // 在顶部插入后保持当前可见内容的位置不变
+    QScrollBar *scrollBar = ui->messageDisplayWidget->verticalScrollBar();
+    int distanceFromBottom = scrollBar->maximum() - scrollBar->value();
+
+    QTextCursor cursor(ui->messageDisplayWidget->document());
+    cursor.movePosition(QTextCursor::Start);
+    cursor.beginEditBlock();
+    for (const auto &message : page.messages) {
+        cursor.insertText(message.getContent());
+        cursor.insertBlock();
+    }
+    cursor.endEditBlock();
+
+    scrollBar->setValue(scrollBar->maximum() - distanceFromBottom);
+}
+
+void MainWindow::fillMessageViewport()
+{
+    // 没有滚动条时valueChanged不会触发，只能在这里继续加载
+    QScrollBar *scrollBar = ui->messageDisplayWidget->verticalScrollBar();
+    while (historyHasMore && !currentContactId.isNull()) {
+        // 读取文档高度会完成排版并更新滚动条范围
+        ui->messageDisplayWidget->document()->size();
+        if (scrollBar->maximum() > 0) {
+            break;
+        }
+
+        int previousCursor = historyCursor;
+        prependMessagePage(messageManager.getMessagePage(currentContactId, historyCursor));
+        if (historyCursor == previousCursor) {
+            break;
+        }
+    }
+}
+
 } // namespace LocalNetworkApp
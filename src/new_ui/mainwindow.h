@@ -12,6 +12,8 @@
 #include "core/network/server.h"
 #include "core/network/client.h"
 #include "core/network/user_discovery.h"
+#include "core/network/rendezvous_registry.h"
+#include "core/network/message_outbox.h"
 #include "core/data/password_manager.h"
 
 QT_BEGIN_NAMESPACE
@@ -31,9 +33,9 @@ public:
     // 初始化程序
     void initialize();
 
-    // 锁定/解锁程序
+    // 锁定/解锁程序（解锁时在后台线程验证密码）
     void lockApp();
-    bool unlockApp(const QString &password);
+    void unlockApp(const QString &password);
 
 protected:
     // 重写拖拽事件
@@ -66,6 +68,9 @@ private slots:
     void onMessageReceived(const Message &message);
     void onUnreadCountChanged(int count);
 
+    // 聊天记录滚动到顶部时加载更早的消息
+    void onMessageScrollChanged(int value);
+
     // 文件传输相关
     void onFileTransferRequestReceived(const FileTransferRequest &request);
     void onFileTransferProgress(QUuid sessionId, qint64 bytesTransferred, qint64 totalBytes);
@@ -79,6 +84,9 @@ private slots:
     // 托盘图标操作
     void onTrayIconActivated(QSystemTrayIcon::ActivationReason reason);
 
+    // 后台保存失败时提示用户
+    void onPersistenceWriteFailed(const QString &target);
+
 private:
     Ui::MainWindow *ui;
     UserIdentity userIdentity;               // 当前用户身份
@@ -88,11 +96,16 @@ private:
     Server *server;                          // TCP服务器
     Client *client;                          // TCP客户端
     UserDiscovery *userDiscovery;            // 用户发现服务
+    RendezvousRegistry *rendezvousRegistry;  // 跨网段发现注册中心（可选）
+    MessageOutbox *messageOutbox;            // 离线消息发件箱
     PasswordManager passwordManager;         // 密码管理器
     QSystemTrayIcon *trayIcon;               // 系统托盘图标
     QUuid currentContactId;                  // 当前选中的联系人ID
+    int historyCursor;                       // 已显示的最早一条消息的位置
+    bool historyHasMore;                     // 是否还有更早的消息未显示
     bool isAppLocked;                        // 程序是否锁定
     bool incognitoMode;                      // 无痕模式
+    bool saveWarningVisible;                 // 是否正在显示保存失败的提示
 
     // 初始化UI
     void initUI();
@@ -114,6 +127,12 @@ private:
 
     // 加载样式表
     void loadStylesheet();
+
+    // 在聊天记录顶部插入一页更早的消息
+    void prependMessagePage(const MessagePage &page);
+
+    // 已显示的消息不足一屏（没有滚动条）时继续加载更早的消息
+    void fillMessageViewport();
 };
 
 } // namespace LocalNetworkApp
@@ -11,6 +11,7 @@ UserRadarDialog::UserRadarDialog(UserDiscovery &userDiscovery, ContactManager &c
     , ui(new Ui::UserRadarDialog)
     , userDiscovery(userDiscovery)
     , contactManager(contactManager)
+    , peerSequence(0)
 {
     ui->setupUi(this);
     setWindowTitle(tr("用户雷达"));
@@ -19,10 +20,8 @@ UserRadarDialog::UserRadarDialog(UserDiscovery &userDiscovery, ContactManager &c
     // 初始刷新
     refreshUI();
 
-    // 定时刷新
-    QTimer *timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &UserRadarDialog::updateUserList);
-    timer->start(2000);
+    // 用户目录变化时增量刷新
+    connect(&userDiscovery, &UserDiscovery::peersChanged, this, &UserRadarDialog::applyPeerChanges);
 
     // 连接信号
     connect(ui->btnRefresh, &QPushButton::clicked, this, &UserRadarDialog::refreshUI);
@@ -36,11 +35,12 @@ UserRadarDialog::~UserRadarDialog()
 void UserRadarDialog::updateUserList()
 {
     ui->listUsers->clear();
+    userItems.clear();
 
-    // 获取已发现的用户
-    QList<DiscoveredUser> users = userDiscovery.getDiscoveredUsers();
+    // 获取用户目录快照（共享数据，不复制）
+    PeerSnapshot snapshot = userDiscovery.getPeerSnapshot();
 
-    for (const DiscoveredUser &user : users) {
+    for (const DiscoveredUser &user : snapshot.users) {
         // 跳过隐身用户
         if (user.state == UserState::Invisible) {
             continue;
@@ -48,52 +48,98 @@ void UserRadarDialog::updateUserList()
 
         // 创建列表项
         QListWidgetItem *item = new QListWidgetItem();
+        fillUserItem(item, user);
+        ui->listUsers->addItem(item);
+        userItems[user.userId] = item;
+    }
 
-        // 设置显示文本
-        QString statusText;
-        switch (user.state) {
-            case UserState::Online:
-                statusText = tr("[在线]");
-                break;
-            case UserState::DoNotDisturb:
-                statusText = tr("[勿扰]");
-                break;
-            default:
-                statusText = tr("[未知]");
-        }
-
-        QString displayText = QString("%1 %2 - %3").arg(user.nickname).arg(statusText).arg(user.address.toString());
-        item->setText(displayText);
+    peerSequence = snapshot.sequence;
 
-        // 存储用户ID
-        item->setData(Qt::UserRole, user.userId.toString());
+    // 更新状态信息
+    ui->lblStatus->setText(tr("已发现 %1 个在线用户").arg(ui->listUsers->count()));
+}
 
-        // 检查是否已添加为联系人
-        ContactInfo contact = contactManager.getContact(user.userId);
-        if (!contact.id.isNull()) {
-            item->setForeground(Qt::darkGreen);
+void UserRadarDialog::applyPeerChanges()
+{
+    // 只处理上次刷新之后的变更，变更记录过旧时整体重建
+    QList<PeerChange> changes;
+    if (!userDiscovery.getPeerChanges(peerSequence, &changes)) {
+        updateUserList();
+        return;
+    }
 
-            // 显示备注
-            if (!contact.remark.isEmpty()) {
-                item->setToolTip(tr("备注：%1").arg(contact.remark));
-            }
+    for (const PeerChange &change : changes) {
+        QListWidgetItem *item = userItems.value(change.user.userId, nullptr);
+        bool visible = change.kind != PeerChange::Removed && change.user.state != UserState::Invisible;
 
-            // 检查黑名单/白名单状态
-            if (contactManager.isInBlacklist(user.userId)) {
-                item->setBackground(Qt::lightGray);
-                item->setToolTip(item->toolTip() + tr(" - 黑名单"));
-            } else if (contactManager.isInWhitelist(user.userId)) {
-                item->setToolTip(item->toolTip() + tr(" - 白名单"));
+        if (!visible) {
+            // 离线或转为隐身，移除列表项
+            if (item) {
+                userItems.remove(change.user.userId);
+                delete item;
             }
+        } else if (item) {
+            fillUserItem(item, change.user);
+        } else {
+            item = new QListWidgetItem();
+            fillUserItem(item, change.user);
+            ui->listUsers->addItem(item);
+            userItems[change.user.userId] = item;
         }
 
-        ui->listUsers->addItem(item);
+        peerSequence = change.sequence;
     }
 
     // 更新状态信息
     ui->lblStatus->setText(tr("已发现 %1 个在线用户").arg(ui->listUsers->count()));
 }
 
+void UserRadarDialog::fillUserItem(QListWidgetItem *item, const DiscoveredUser &user)
+{
+    // 复用列表项时先清除旧的样式
+    item->setToolTip(QString());
+    item->setForeground(QBrush());
+    item->setBackground(QBrush());
+
+    // 设置显示文本
+    QString statusText;
+    switch (user.state) {
+        case UserState::Online:
+            statusText = tr("[在线]");
+            break;
+        case UserState::DoNotDisturb:
+            statusText = tr("[勿扰]");
+            break;
+        default:
+            statusText = tr("[未知]");
+    }
+
+    QString displayText = QString("%1 %2 - %3").arg(user.nickname).arg(statusText).arg(user.address.toString());
+    item->setText(displayText);
+
+    // 存储用户ID
+    item->setData(Qt::UserRole, user.userId.toString());
+
+    // 检查是否已添加为联系人
+    ContactInfo contact = contactManager.getContact(user.userId);
+    if (!contact.id.isNull()) {
+        item->setForeground(Qt::darkGreen);
+
+        // 显示备注
+        if (!contact.remark.isEmpty()) {
+            item->setToolTip(tr("备注：%1").arg(contact.remark));
+        }
+
+        // 检查黑名单/白名单状态
+        if (contactManager.isInBlacklist(user.userId)) {
+            item->setBackground(Qt::lightGray);
+            item->setToolTip(item->toolTip() + tr(" - 黑名单"));
+        } else if (contactManager.isInWhitelist(user.userId)) {
+            item->setToolTip(item->toolTip() + tr(" - 白名单"));
+        }
+    }
+}
+
 void UserRadarDialog::on_btnAddContact_clicked()
 {
     QUuid userId = getSelectedUserId();
@@ -26,6 +26,9 @@ private slots:
     // 更新用户列表
     void updateUserList();
 
+    // 应用用户目录的增量变更
+    void applyPeerChanges();
+
     // 添加联系人
     void on_btnAddContact_clicked();
 
@@ -42,10 +45,15 @@ private:
     Ui::UserRadarDialog *ui;
     UserDiscovery &userDiscovery;   // 用户发现服务（引用）
     ContactManager &contactManager; // 联系人管理器（引用）
+    QMap<QUuid, QListWidgetItem*> userItems; // 用户ID到列表项的映射
+    quint64 peerSequence;           // 已处理到的用户目录序号
 
     // 获取选中的用户ID
     QUuid getSelectedUserId() const;
 
+    // 填充用户列表项
+    void fillUserItem(QListWidgetItem *item, const DiscoveredUser &user);
+
     // 刷新界面显示
     void refreshUI();
 };